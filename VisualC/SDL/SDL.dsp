@@ -124,6 +124,14 @@ SOURCE=..\..\src\audio\SDL_audiomem.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\audio\SDL_audioresample.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\audio\SDL_audioresample_c.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\video\SDL_blit.c
 # End Source File
 # Begin Source File
@@ -172,6 +180,14 @@ SOURCE=..\..\src\video\SDL_cursor_c.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\video\SDL_damage.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\video\SDL_damage_c.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\audio\windib\SDL_dibaudio.c
 # End Source File
 # Begin Source File
@@ -316,6 +332,10 @@ SOURCE=..\..\src\audio\SDL_mixer_MMX_VC.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\audio\SDL_mixer_SSE2.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\joystick\win32\SDL_mmjoystick.c
 # End Source File
 # Begin Source File
@@ -348,6 +368,14 @@ SOURCE=..\..\src\video\dummy\SDL_nullvideo.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\video\SDL_pixelpool.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\video\SDL_pixelpool_c.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\video\SDL_pixels.c
 # End Source File
 # Begin Source File
@@ -520,10 +548,22 @@ SOURCE=..\..\src\video\wincommon\SDL_wingl_c.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\video\SDL_workers.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\video\SDL_workers_c.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\video\SDL_yuv.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\video\SDL_yuv_simd.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\video\SDL_yuv_sw.c
 # End Source File
 # Begin Source File
@@ -87,6 +87,10 @@ typedef struct SDL_AudioSpec {
 	 *
 	 *  Once the callback returns, the buffer will no longer be valid.
 	 *  Stereo samples are stored in a LRLRLR ordering.
+	 *
+	 *  The buffer is filled with silence before each call, unless the
+	 *  application has said with SDL_EnableAudioCallbackFills() that
+	 *  the callback always writes all of it.
 	 */
 	void (SDLCALL *callback)(void *userdata, Uint8 *stream, int len);
 	void  *userdata;
@@ -105,6 +109,12 @@ typedef struct SDL_AudioSpec {
 #define AUDIO_S16MSB	0x9010	/**< As above, but big-endian byte order */
 #define AUDIO_U16	AUDIO_U16LSB
 #define AUDIO_S16	AUDIO_S16LSB
+#define AUDIO_S32LSB	0x8020	/**< 32-bit integer samples */
+#define AUDIO_S32MSB	0x9020	/**< As above, but big-endian byte order */
+#define AUDIO_S32	AUDIO_S32LSB
+#define AUDIO_F32LSB	0x8120	/**< 32-bit floating point samples, -1.0 to 1.0 */
+#define AUDIO_F32MSB	0x9120	/**< As above, but big-endian byte order */
+#define AUDIO_F32	AUDIO_F32LSB
 
 /**
  *  @name Native audio byte ordering
@@ -113,9 +123,13 @@ typedef struct SDL_AudioSpec {
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define AUDIO_U16SYS	AUDIO_U16LSB
 #define AUDIO_S16SYS	AUDIO_S16LSB
+#define AUDIO_S32SYS	AUDIO_S32LSB
+#define AUDIO_F32SYS	AUDIO_F32LSB
 #else
 #define AUDIO_U16SYS	AUDIO_U16MSB
 #define AUDIO_S16SYS	AUDIO_S16MSB
+#define AUDIO_S32SYS	AUDIO_S32MSB
+#define AUDIO_F32SYS	AUDIO_F32MSB
 #endif
 /*@}*/
 
@@ -195,6 +209,18 @@ extern DECLSPEC SDL_audiostatus SDLCALL SDL_GetAudioStatus(void);
  */
 extern DECLSPEC void SDLCALL SDL_PauseAudio(int pause_on);
 
+/**
+ * This function tells SDL whether the audio callback always writes the
+ * whole buffer it is given.  If 'fills' is 1, SDL doesn't fill the buffer
+ * with silence before each call.  Leave it at 0, the default, if the
+ * callback sometimes writes less, or mixes into the buffer with
+ * SDL_MixAudio().  If 'fills' is -1, the setting is not changed.
+ * It takes effect at the next SDL_OpenAudio().
+ *
+ * @return The previous setting.
+ */
+extern DECLSPEC int SDLCALL SDL_EnableAudioCallbackFills(int fills);
+
 /**
  * This function loads a WAVE from the data source, automatically freeing
  * that source if 'freesrc' is non-zero.  For example, to load a WAVE file,
@@ -243,9 +269,25 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
  * The data conversion may expand the size of the audio data, so the buffer
  * cvt->buf should be allocated after the cvt structure is initialized by
  * SDL_BuildAudioCVT(), and should be cvt->len*cvt->len_mult bytes long.
+ * When the sample rate changes, the conversion keeps the last samples of
+ * each buffer for the next call, so a stream converted a buffer at a time
+ * has no clicks, and the last few output samples wait for the next buffer.
+ * Call SDL_FlushAudioCVT() after the last buffer to get them.
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
 
+/**
+ * This function finishes a stream converted with SDL_ConvertAudio(),
+ * writing the output samples still waiting for more input to cvt->buf,
+ * as cvt->len_cvt bytes.  cvt->buf should be cvt->len*cvt->len_mult bytes
+ * long, as for SDL_ConvertAudio(), but holds no input; if the samples
+ * don't all fit, call it again until cvt->len_cvt is 0.
+ * After that the next SDL_ConvertAudio() call starts a new stream.
+ *
+ * @return This function returns 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_FlushAudioCVT(SDL_AudioCVT *cvt);
+
 
 #define SDL_MIX_MAXVOLUME 128
 /**
@@ -254,9 +296,21 @@ extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
  * The volume ranges from 0 - 128, and should be set to SDL_MIX_MAXVOLUME
  * for full audio volume.  Note this does not change hardware volume.
  * This is provided for convenience -- you can mix your own audio data.
+ * AUDIO_F32 audio isn't clipped hard: loud samples are bent smoothly
+ * towards full scale instead, from three quarters of it up.
  */
 extern DECLSPEC void SDLCALL SDL_MixAudio(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
 
+/**
+ * This mixes 'num_src' audio buffers of the playing audio format into
+ * 'dst' in a single pass, each at its own volume from 0 - 128, so the
+ * destination is only read and written once.  The sources are added up
+ * before the result is clipped, so this matches calling SDL_MixAudio()
+ * for each source unless that would clip part way through.
+ * Sources that are NULL or have a volume of 0 are skipped.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioMulti(Uint8 *dst, const Uint8 **src, const int *volume, int num_src, Uint32 len);
+
 /**
  * @name Audio Locks
  * The lock manipulated by these functions protects the callback function.
@@ -347,6 +347,14 @@ extern DECLSPEC SDL_EventFilter SDLCALL SDL_GetEventFilter(void);
 */
 extern DECLSPEC Uint8 SDLCALL SDL_EventState(Uint8 type, int state);
 
+/**
+ * Get the number of events the video driver folded into others, like mouse
+ * motion collapsed with SDL_VIDEO_X11_MOTION_COMPRESS, and the number of
+ * events dropped because the event queue was full, since the event loop
+ * was started.  Either pointer may be NULL.
+ */
+extern DECLSPEC void SDLCALL SDL_GetEventStats(Uint32 *coalesced, Uint32 *dropped);
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
@@ -52,6 +52,12 @@ typedef struct SDL_Rect {
 	Uint16 w, h;
 } SDL_Rect;
 
+/** A rectangle for surfaces too big for SDL_Rect, see SDL_BlitSurface32() */
+typedef struct SDL_Rect32 {
+	Sint32 x, y;
+	Sint32 w, h;
+} SDL_Rect32;
+
 typedef struct SDL_Color {
 	Uint8 r;
 	Uint8 g;
@@ -97,7 +103,7 @@ typedef struct SDL_Surface {
 	Uint32 flags;				/**< Read-only */
 	SDL_PixelFormat *format;		/**< Read-only */
 	int w, h;				/**< Read-only */
-	Uint16 pitch;				/**< Read-only */
+	Uint16 pitch;				/**< Read-only, see SDL_GetSurfacePitch() */
 	void *pixels;				/**< Read-write */
 	int offset;				/**< Private */
 
@@ -188,6 +194,19 @@ typedef struct SDL_VideoInfo {
 	int    current_h;	/**< Value: The current video mode height */
 } SDL_VideoInfo;
 
+/** Counters of the screen updates, see SDL_GetPresentStats() */
+typedef struct SDL_PresentStats {
+	Uint32 buffers;		/**< Screen images in rotation, 1 if only one */
+	Uint32 frames;		/**< Updates sent to the display */
+	Uint32 completed;	/**< Updates the display has finished reading */
+	Uint32 latency_ms;	/**< Total time from update to completion */
+	Uint32 max_latency_ms;	/**< Longest time from update to completion */
+	Uint32 stalls;		/**< Updates that waited for a free image */
+	Uint32 stall_ms;	/**< Total time spent waiting in the updates */
+	Uint32 rects;		/**< Rectangles sent in the updates */
+	Uint32 pixels;		/**< Pixels sent in the updates */
+} SDL_PresentStats;
+
 
 /** @name Overlay Formats
  *  The most common video overlay formats.
@@ -203,6 +222,8 @@ typedef struct SDL_VideoInfo {
 #define SDL_YUY2_OVERLAY  0x32595559	/**< Packed mode: Y0+U0+Y1+V0 (1 plane) */
 #define SDL_UYVY_OVERLAY  0x59565955	/**< Packed mode: U0+Y0+V0+Y1 (1 plane) */
 #define SDL_YVYU_OVERLAY  0x55595659	/**< Packed mode: Y0+V0+Y1+U0 (1 plane) */
+#define SDL_NV12_OVERLAY  0x3231564E	/**< Planar mode: Y + U/V interleaved (2 planes) */
+#define SDL_NV21_OVERLAY  0x3132564E	/**< Planar mode: Y + V/U interleaved (2 planes) */
 /*@}*/
 
 /** The YUV hardware video overlay */
@@ -414,6 +435,14 @@ extern DECLSPEC void SDLCALL SDL_UpdateRect
  */
 extern DECLSPEC int SDLCALL SDL_Flip(SDL_Surface *screen);
 
+/**
+ * Get counters of the screen updates since the video mode was set, from
+ * drivers that keep them.  The average latency is latency_ms / completed.
+ * This function returns 0 if successful, or -1 if the video driver doesn't
+ * count its updates.
+ */
+extern DECLSPEC int SDLCALL SDL_GetPresentStats(SDL_PresentStats *stats);
+
 /**
  * Set the gamma correction for each of the color channels.
  * The gamma values range (approximately) between 0.1 and 10.0
@@ -550,6 +579,10 @@ extern DECLSPEC void SDLCALL SDL_GetRGBA(Uint32 pixel,
  * will be set in the flags member of the returned surface.  If for some
  * reason the surface could not be placed in video memory, it will not have
  * the SDL_HWSURFACE flag set, and will be created in system memory instead.
+ *
+ * The width must be less than 16384 and the height less than 65536, so the
+ * pitch fits in the 'pitch' member, and SDL_CreateRGBSurfaceFrom() takes
+ * pitches up to 65535.  Use SDL_CreateRGBSurface32() for bigger surfaces.
  */
 extern DECLSPEC SDL_Surface * SDLCALL SDL_CreateRGBSurface
 			(Uint32 flags, int width, int height, int depth, 
@@ -604,6 +637,43 @@ extern DECLSPEC int SDLCALL SDL_SaveBMP_RW
 #define SDL_SaveBMP(surface, file) \
 		SDL_SaveBMP_RW(surface, SDL_RWFromFile(file, "wb"), 1)
 
+/**
+ * Save the RLE encoding of a surface, so it can be loaded ready to blit
+ * instead of being encoded again.  The surface must have been blitted
+ * with SDL_RLEACCEL set; the encoding only suits destinations with the
+ * pixel format of the last one it was blitted to.
+ * If 'freedst' is non-zero, the destination will be closed afterwards.
+ * Returns 0 if successful or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_SaveRLE_RW
+		(SDL_Surface *surface, SDL_RWops *dst, int freedst);
+
+/** Convenience macro -- save an RLE encoded surface to a file */
+#define SDL_SaveRLE(surface, file) \
+		SDL_SaveRLE_RW(surface, SDL_RWFromFile(file, "wb"), 1)
+
+/**
+ * Load a surface saved by SDL_SaveRLE_RW().  The new surface keeps its
+ * colorkey or alpha settings and has no pixels until it is locked or
+ * blitted to a destination of another format.  Surfaces too big for
+ * SDL_CreateRGBSurface() aren't loaded.
+ * If 'freesrc' is non-zero, the source will be closed after being read.
+ * Returns the new surface, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_Surface * SDLCALL SDL_LoadRLE_RW(SDL_RWops *src, int freesrc);
+
+/** Convenience macro -- load an RLE encoded surface from a file */
+#define SDL_LoadRLE(file)	SDL_LoadRLE_RW(SDL_RWFromFile(file, "rb"), 1)
+
+/**
+ * Create a surface from a whole file saved by SDL_SaveRLE_RW() that is
+ * already in memory, for example mapped with mmap(), blitting straight
+ * from it.  'mem' must be 4-byte aligned and stay valid until the
+ * surface is freed.
+ * Returns the new surface, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_Surface * SDLCALL SDL_CreateRLESurfaceFrom(void *mem, int size);
+
 /**
  * Sets the color key (transparent pixel) in a blittable surface.
  * If 'flag' is SDL_SRCCOLORKEY (optionally OR'd with SDL_RLEACCEL), 
@@ -756,6 +826,80 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 			(SDL_Surface *src, SDL_Rect *srcrect,
 			 SDL_Surface *dst, SDL_Rect *dstrect);
 
+/**
+ * This function performs 'n' blits from 'src' to 'dst', as if calling
+ * SDL_BlitSurface() with srcrects[i] and dstrects[i] for each one, in order.
+ * The blit mapping is checked and the surfaces are locked only once for
+ * the whole batch, which makes it much faster for many small blits, like
+ * tiles and sprites.
+ *
+ * If 'srcrects' is NULL, the entire source surface is used each time.
+ * 'dstrects' must not be NULL, and as with SDL_BlitSurface(), each of them
+ * is updated with the final blit rectangle, or a zero size if it was
+ * clipped away completely.
+ *
+ * This function returns 0 if all the blits succeeded.  Otherwise it stops
+ * at the first one that failed and returns a negative value, as described
+ * for SDL_BlitSurface().
+ */
+extern DECLSPEC int SDLCALL SDL_BlitSurfaceBatch
+			(SDL_Surface *src, SDL_Surface *dst,
+			 const SDL_Rect *srcrects, SDL_Rect *dstrects, int n);
+
+/**
+ * Each surface remembers how to blit to the last few destinations it was
+ * blitted to, and a blit mapping is shared by software destinations with
+ * the same pixel format.  This function returns how many times switching
+ * to another destination found a ready mapping (hits) and how many times
+ * it had to be built again (misses), since the program started.
+ */
+extern DECLSPEC void SDLCALL SDL_GetBlitMapStats(Uint32 *hits, Uint32 *misses);
+
+/**
+ * When the SDL_SURFACE_POOL environment variable is set, the pixels of
+ * software surfaces are aligned on cache lines and freed pixel buffers are
+ * kept for new surfaces of a similar size.  This function returns how many
+ * surfaces reused a kept buffer (hits), how many needed a new one (misses),
+ * and how many bytes of freed buffers are being kept right now (retained).
+ * Any of the pointers may be NULL.
+ */
+extern DECLSPEC void SDLCALL SDL_GetSurfacePoolStats
+			(Uint32 *hits, Uint32 *misses, Uint32 *retained);
+
+/** @name Stretch Filters
+ *  How scaled blits sample the source surface
+ */
+/*@{*/
+typedef enum {
+	SDL_STRETCH_NEAREST,	/**< Nearest pixel, no blending */
+	SDL_STRETCH_BILINEAR,	/**< Linear blend of the 4 nearest pixels */
+	SDL_STRETCH_AREA	/**< Average of the pixels covered, for shrinking */
+} SDL_StretchFilter;
+/*@}*/
+
+/**
+ * This function performs a scaled blit: 'srcrect' of the source surface
+ * is stretched to the size of 'dstrect', and converted and blended onto
+ * the destination like SDL_BlitSurface() would, in a single pass.
+ *
+ * If 'srcrect' is NULL, the entire source surface is used, and if
+ * 'dstrect' is NULL, the entire destination surface.  The blit is clipped
+ * to the source surface and the destination clip rectangle, and the final
+ * destination rectangle is saved in 'dstrect'.
+ *
+ * Surfaces with a colorkey are always scaled with SDL_STRETCH_NEAREST, and
+ * so are 8-bit surfaces.  Scaling a surface onto itself is not supported.
+ *
+ * This function returns 0 on success, or a negative value as described
+ * for SDL_BlitSurface().
+ */
+#define SDL_BlitScaled SDL_UpperBlitScaled
+
+extern DECLSPEC int SDLCALL SDL_UpperBlitScaled
+			(SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect,
+			 SDL_StretchFilter filter);
+
 /**
  * This function performs a fast fill of the given rectangle with 'color'
  * The given rectangle is clipped to the destination surface clip area
@@ -768,6 +912,18 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 extern DECLSPEC int SDLCALL SDL_FillRect
 		(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color);
 
+/**
+ * This function performs a fast fill of many rectangles with the same color.
+ *
+ * Each rectangle is clipped to the destination surface clip area, and
+ * the surface is locked only once for all of them, which is much faster
+ * than calling SDL_FillRect() for a lot of small rectangles.
+ * Unlike SDL_FillRect(), the rectangles are not modified.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_FillRects
+		(SDL_Surface *dst, const SDL_Rect *rects, int count, Uint32 color);
+
 /**
  * This function takes a surface and copies it to a new surface of the
  * pixel format and colors of the video framebuffer, suitable for fast
@@ -808,6 +964,17 @@ extern DECLSPEC SDL_Surface * SDLCALL SDL_DisplayFormatAlpha(SDL_Surface *surfac
 extern DECLSPEC SDL_Overlay * SDLCALL SDL_CreateYUVOverlay(int width, int height,
 				Uint32 format, SDL_Surface *display);
 
+/** This function creates a software overlay on planes owned by the caller,
+ *  such as the frames of a video decoder, so they are shown without a copy.
+ *  'pixels' and 'pitches' give one entry per plane of the format, and the
+ *  pitches are in bytes.  The planes are not copied or freed by SDL, and
+ *  overlay->pixels[] may be pointed at other planes with the same pitches
+ *  between calls to SDL_DisplayYUVOverlay().
+ */
+extern DECLSPEC SDL_Overlay * SDLCALL SDL_CreateYUVOverlayFrom(Uint8 **pixels,
+				Uint16 *pitches, int width, int height,
+				Uint32 format, SDL_Surface *display);
+
 /** Lock an overlay for direct access, and unlock it when you are done */
 extern DECLSPEC int SDLCALL SDL_LockYUVOverlay(SDL_Overlay *overlay);
 extern DECLSPEC void SDLCALL SDL_UnlockYUVOverlay(SDL_Overlay *overlay);
@@ -816,7 +983,9 @@ extern DECLSPEC void SDLCALL SDL_UnlockYUVOverlay(SDL_Overlay *overlay);
  *  The contents of the video surface underneath the blit destination are
  *  not defined.  
  *  The width and height of the destination rectangle may be different from
- *  that of the overlay, but currently only 2x scaling is supported.
+ *  that of the overlay.  Software overlays are fastest at 1x and 2x, other
+ *  sizes use nearest sampling, or bilinear if SDL_VIDEO_YUV_FILTER is set
+ *  to "bilinear".
  */
 extern DECLSPEC int SDLCALL SDL_DisplayYUVOverlay(SDL_Overlay *overlay, SDL_Rect *dstrect);
 
@@ -939,9 +1108,98 @@ extern DECLSPEC SDL_GrabMode SDLCALL SDL_WM_GrabInput(SDL_GrabMode mode);
 
 /*@}*/
 
-/** @internal Not in public API at the moment - do not use! */
+/**
+ * Perform a stretch blit between two surfaces of the same format.
+ *
+ * The source rectangle is scaled to the size of the destination rectangle,
+ * with nearest neighbour sampling.  Both rectangles must be inside their
+ * surfaces, or -1 is returned.  Colorkey and alpha settings are not used,
+ * pixels are copied as they are.  If srcrect or dstrect are NULL, the whole
+ * surface is used.
+ */
 extern DECLSPEC int SDLCALL SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                                     SDL_Surface *dst, SDL_Rect *dstrect);
+
+/**
+ * Like SDL_SoftStretch(), but with a choice of filter.  The pixels are
+ * sampled at their centers, and either rectangle may reach outside of its
+ * surface: the blit is clipped to the pixels of both surfaces and to the
+ * clip rectangle of the destination.
+ *
+ * The filters blend the channels of 16, 24 and 32 bpp surfaces; 8 bpp
+ * surfaces always use SDL_STRETCH_NEAREST.  Filtering is fastest with
+ * 16 and 32 bpp surfaces on CPUs with SSE2 or AVX2.
+ *
+ * @return 0 on success, or -1 on error
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchFiltered(SDL_Surface *src,
+			SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect,
+			SDL_StretchFilter filter);
+
+/** @name Large Surfaces
+ *  Surfaces can be up to 2 GB wide, but SDL_Rect only reaches 32767 pixels
+ *  and the 'pitch' member of a surface only 65535 bytes.  These functions
+ *  take the real pitch and rectangles with 32-bit coordinates.  The usual
+ *  functions still work on big surfaces, as far as SDL_Rect reaches.
+ */
+/*@{*/
+
+/**
+ * Like SDL_CreateRGBSurface() and SDL_CreateRGBSurfaceFrom(), for surfaces
+ * of any size.  Surfaces whose rows take more than 65535 bytes are always
+ * created in system memory, and the 'pitch' member only holds the low 16
+ * bits of their pitch, so code that steps through their rows has to use
+ * SDL_GetSurfacePitch() instead.
+ */
+extern DECLSPEC SDL_Surface * SDLCALL SDL_CreateRGBSurface32
+			(Uint32 flags, int width, int height, int depth,
+			Uint32 Rmask, Uint32 Gmask, Uint32 Bmask, Uint32 Amask);
+extern DECLSPEC SDL_Surface * SDLCALL SDL_CreateRGBSurfaceFrom32(void *pixels,
+			int width, int height, int depth, Uint32 pitch,
+			Uint32 Rmask, Uint32 Gmask, Uint32 Bmask, Uint32 Amask);
+
+/**
+ * Returns the number of bytes between the rows of a surface, which may be
+ * more than the 'pitch' member can hold.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetSurfacePitch(SDL_Surface *surface);
+
+/**
+ * Like SDL_SetClipRect() and SDL_GetClipRect(), with 32-bit coordinates.
+ * The 'clip_rect' member of a big surface is the part of its clip
+ * rectangle that an SDL_Rect can describe.
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_SetClipRect32
+			(SDL_Surface *surface, const SDL_Rect32 *rect);
+extern DECLSPEC void SDLCALL SDL_GetClipRect32
+			(SDL_Surface *surface, SDL_Rect32 *rect);
+
+/**
+ * Like SDL_BlitSurface(), with 32-bit coordinates.  Blits between big
+ * surfaces are always done in software.
+ */
+#define SDL_BlitSurface32 SDL_UpperBlit32
+
+/** This is the public blit function, SDL_BlitSurface32() */
+extern DECLSPEC int SDLCALL SDL_UpperBlit32
+			(SDL_Surface *src, SDL_Rect32 *srcrect,
+			 SDL_Surface *dst, SDL_Rect32 *dstrect);
+/** This is a semi-private blit function and it performs low-level surface
+ *  blitting only, like SDL_LowerBlit().
+ */
+extern DECLSPEC int SDLCALL SDL_LowerBlit32
+			(SDL_Surface *src, SDL_Rect32 *srcrect,
+			 SDL_Surface *dst, SDL_Rect32 *dstrect);
+
+/** Like SDL_FillRect(), with 32-bit coordinates */
+extern DECLSPEC int SDLCALL SDL_FillRect32
+		(SDL_Surface *dst, SDL_Rect32 *dstrect, Uint32 color);
+
+/** Like SDL_SoftStretch(), with 32-bit coordinates */
+extern DECLSPEC int SDLCALL SDL_SoftStretch32(SDL_Surface *src,
+			SDL_Rect32 *srcrect, SDL_Surface *dst, SDL_Rect32 *dstrect);
+
+/*@}*/
                     
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
@@ -47,6 +47,9 @@ extern void SDL_StartTicks(void);
 extern int  SDL_TimerInit(void);
 extern void SDL_TimerQuit(void);
 #endif
+extern void SDL_InitWorkers(void);
+extern void SDL_QuitWorkers(void);
+extern void SDL_QuitPixelPool(void);
 
 /* The current SDL version */
 static SDL_version version = 
@@ -83,6 +86,9 @@ int SDL_InitSubSystem(Uint32 flags)
 	}
 #endif
 
+	/* Start the blitter worker threads, if any were asked for */
+	SDL_InitWorkers();
+
 #if !SDL_VIDEO_DISABLED
 	/* Initialize the video/event subsystem */
 	if ( (flags & SDL_INIT_VIDEO) && !(SDL_initialized & SDL_INIT_VIDEO) ) {
@@ -219,8 +225,15 @@ void SDL_Quit(void)
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : Enter! Calling QuitSubSystem()\n"); fflush(stdout);
 #endif
+	/* Stop the blitter worker threads, if any were started, finishing
+	   any work still queued for the screen before video goes away */
+	SDL_QuitWorkers();
+
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
 
+	/* Free the pixel buffers kept for new surfaces */
+	SDL_QuitPixelPool();
+
 #ifdef CHECK_LEAKS
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : CHECK_LEAKS\n"); fflush(stdout);
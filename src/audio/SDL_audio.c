@@ -27,6 +27,7 @@
 #include "SDL_audio_c.h"
 #include "SDL_audiomem.h"
 #include "SDL_sysaudio.h"
+#include "SDL_audioresample_c.h"
 
 /* Available audio drivers */
 static AudioBootStrap *bootstrap[] = {
@@ -117,6 +118,9 @@ static AudioBootStrap *bootstrap[] = {
 };
 SDL_AudioDevice *current_audio = NULL;
 
+/* Set by SDL_EnableAudioCallbackFills(), read when the audio thread starts */
+static int callback_fills = 0;
+
 /* Various local functions */
 int SDL_AudioInit(const char *driver_name);
 void SDL_AudioQuit(void);
@@ -130,6 +134,8 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	void  *udata;
 	void (SDLCALL *fill)(void *userdata,Uint8 *stream, int len);
 	int    silence;
+	int    fills;
+	int    direct;
 
 	/* Perform any thread setup */
 	if ( audio->ThreadInit ) {
@@ -141,6 +147,12 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	fill  = audio->spec.callback;
 	udata = audio->spec.userdata;
 
+	/* The application may promise that its callback writes every byte
+	   of the stream, so it doesn't need clearing first.
+	 */
+	fills = callback_fills;
+
+	direct = 0;
 	if ( audio->convert.needed ) {
 		if ( audio->convert.src_format == AUDIO_U8 ) {
 			silence = 0x80;
@@ -148,6 +160,18 @@ int SDLCALL SDL_RunAudio(void *audiop)
 			silence = 0;
 		}
 		stream_len = audio->convert.len;
+
+		/* If the conversion fits in the device buffer, mix and
+		   convert right there instead of copying it across after.
+		   The resampler makes a varying amount of audio, so that
+		   is always converted in convert.buf and copied over,
+		   with the part that doesn't fit kept in the fifo.
+		 */
+		if ( !audio->convert_fifo &&
+		     audio->convert.len*audio->convert.len_mult <=
+		     (int)audio->spec.size ) {
+			direct = 1;
+		}
 	} else {
 		silence = audio->spec.silence;
 		stream_len = audio->spec.size;
@@ -157,7 +181,7 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	while ( audio->enabled ) {
 
 		/* Fill the current buffer with sound */
-		if ( audio->convert.needed ) {
+		if ( audio->convert.needed && !direct ) {
 			if ( audio->convert.buf ) {
 				stream = audio->convert.buf;
 			} else {
@@ -170,7 +194,9 @@ int SDLCALL SDL_RunAudio(void *audiop)
 			}
 		}
 
-		SDL_memset(stream, silence, stream_len);
+		if ( audio->paused || !fills ) {
+			SDL_memset(stream, silence, stream_len);
+		}
 
 		if ( ! audio->paused ) {
 			SDL_mutexP(audio->mixer_lock);
@@ -179,14 +205,51 @@ int SDLCALL SDL_RunAudio(void *audiop)
 		}
 
 		/* Convert the audio if necessary */
-		if ( audio->convert.needed ) {
+		if ( direct ) {
+			Uint8 *buf = audio->convert.buf;
+
+			audio->convert.buf = stream;
 			SDL_ConvertAudio(&audio->convert);
+			audio->convert.buf = buf;
+		} else if ( audio->convert.needed ) {
+			Uint8 *fifo = audio->convert_fifo;
+			int len, need;
+
+			SDL_ConvertAudio(&audio->convert);
+			len = audio->convert.len_cvt;
+			need = audio->spec.size - audio->convert_fifo_len;
+			if ( fifo && len < need ) {
+				/* Not a whole buffer yet */
+				SDL_memcpy(fifo + audio->convert_fifo_len,
+				           audio->convert.buf, len);
+				audio->convert_fifo_len += len;
+				continue;
+			}
 			stream = audio->GetAudioBuf(audio);
 			if ( stream == NULL ) {
 				stream = audio->fake_stream;
 			}
-			SDL_memcpy(stream, audio->convert.buf,
-			               audio->convert.len_cvt);
+			if ( fifo ) {
+				/* Play what was left over last time, topped
+				   up from this conversion, and keep the rest.
+				 */
+				int frame = ((audio->spec.format & 0xFF) / 8) *
+				            audio->spec.channels;
+
+				SDL_memcpy(stream, fifo, audio->convert_fifo_len);
+				SDL_memcpy(stream + audio->convert_fifo_len,
+				           audio->convert.buf, need);
+				len -= need;
+				if ( len > audio->convert_fifo_max - frame ) {
+					/* The resampler ran ahead, drop it */
+					len = audio->convert_fifo_max - frame;
+				}
+				SDL_memcpy(fifo, audio->convert.buf + need, len);
+				audio->convert_fifo_len = len;
+			} else {
+				SDL_memcpy(stream, audio->convert.buf,
+				               audio->convert.len_cvt);
+			}
 		}
 
 		/* Ready current buffer for play and change current buffer */
@@ -239,17 +302,32 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		++string;
 		format |= 0x8000;
 		break;
+	    case 'F':
+		++string;
+		format |= 0x8100;
+		break;
 	    default:
 		return 0;
 	}
+	/* Floats are only 32-bit, and 32-bit integers only signed */
 	switch (SDL_atoi(string)) {
 	    case 8:
+		if ( format & 0x0100 ) {
+			return 0;
+		}
 		string += 1;
 		format |= 8;
 		break;
 	    case 16:
+	    case 32:
+		if ( (format & 0x0100) && SDL_atoi(string) != 32 ) {
+			return 0;
+		}
+		if ( !(format & 0x8000) && SDL_atoi(string) == 32 ) {
+			return 0;
+		}
+		format |= SDL_atoi(string);
 		string += 2;
-		format |= 16;
 		if ( SDL_strcmp(string, "LSB") == 0
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 		     || SDL_strcmp(string, "SYS") == 0
@@ -280,6 +358,9 @@ int SDL_AudioInit(const char *driver_name)
 	if ( current_audio != NULL ) {
 		SDL_AudioQuit();
 	}
+	if ( SDL_InitResampler() < 0 ) {
+		return(-1);
+	}
 
 	/* Select the proper audio driver */
 	audio = NULL;
@@ -473,6 +554,13 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 
 	/* Open the audio subsystem */
 	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
+	if ( (desired->format & 0xFF) == 32 && !audio->wide_formats ) {
+		/* The driver would take this for something else, so give
+		   it 16-bit audio and convert to that instead.
+		 */
+		audio->spec.format = AUDIO_S16SYS;
+		SDL_CalculateAudioSpec(&audio->spec);
+	}
 	audio->convert.needed = 0;
 	audio->enabled = 1;
 	audio->paused  = 1;
@@ -524,6 +612,23 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 				return(-1);
 			}
 		}
+		if ( audio->convert.needed && audio->convert.rate_incr != 0.0 ) {
+			/* The resampler makes a varying amount each time */
+			int frame = ((desired->format & 0xFF) / 8) *
+			            desired->channels;
+
+			audio->convert.len -= audio->convert.len % frame;
+			/* Less than a buffer waits here between calls */
+			audio->convert_fifo_max = audio->spec.size;
+			audio->convert_fifo_len = 0;
+			audio->convert_fifo = (Uint8 *)SDL_AllocAudioMem(
+			   audio->convert_fifo_max);
+			if ( audio->convert_fifo == NULL ) {
+				SDL_CloseAudio();
+				SDL_OutOfMemory();
+				return(-1);
+			}
+		}
 	}
 
 	/* Start the audio thread if necessary */
@@ -576,6 +681,16 @@ void SDL_PauseAudio (int pause_on)
 	}
 }
 
+int SDL_EnableAudioCallbackFills (int fills)
+{
+	int previous = callback_fills;
+
+	if ( fills >= 0 ) {
+		callback_fills = (fills != 0);
+	}
+	return(previous);
+}
+
 void SDL_LockAudio (void)
 {
 	SDL_AudioDevice *audio = current_audio;
@@ -620,6 +735,9 @@ void SDL_AudioQuit(void)
 			SDL_FreeAudioMem(audio->convert.buf);
 
 		}
+		if ( audio->convert_fifo != NULL ) {
+			SDL_FreeAudioMem(audio->convert_fifo);
+		}
 		if ( audio->opened ) {
 			audio->CloseAudio(audio);
 			audio->opened = 0;
@@ -628,18 +746,36 @@ void SDL_AudioQuit(void)
 		audio->free(audio);
 		current_audio = NULL;
 	}
+	SDL_QuitResampler();
 }
 
-#define NUM_FORMATS	6
+/* The 32-bit formats come last, so drivers that don't know them will
+   settle on an 8 or 16-bit format before they get that far.
+ */
+#define NUM_FORMATS	10
 static int format_idx;
 static int format_idx_sub;
 static Uint16 format_list[NUM_FORMATS][NUM_FORMATS] = {
- { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB },
- { AUDIO_S8, AUDIO_U8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB },
- { AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB,
+   AUDIO_S32LSB, AUDIO_S32MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S8, AUDIO_U8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB,
+   AUDIO_S32LSB, AUDIO_S32MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_U8, AUDIO_S8,
+   AUDIO_S32LSB, AUDIO_S32MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_U8, AUDIO_S8,
+   AUDIO_S32MSB, AUDIO_S32LSB, AUDIO_F32MSB, AUDIO_F32LSB },
+ { AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U8, AUDIO_S8,
+   AUDIO_S32LSB, AUDIO_S32MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U8, AUDIO_S8,
+   AUDIO_S32MSB, AUDIO_S32LSB, AUDIO_F32MSB, AUDIO_F32LSB },
+ { AUDIO_S32LSB, AUDIO_S32MSB, AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_S16LSB,
+   AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S8, AUDIO_U8 },
+ { AUDIO_S32MSB, AUDIO_S32LSB, AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_S16MSB,
+   AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S8, AUDIO_U8 },
+ { AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_S32LSB, AUDIO_S32MSB, AUDIO_S16LSB,
+   AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S8, AUDIO_U8 },
+ { AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_S32MSB, AUDIO_S32LSB, AUDIO_S16MSB,
+   AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S8, AUDIO_U8 },
 };
 
 Uint16 SDL_FirstAudioFormat(Uint16 format)
@@ -24,6 +24,8 @@
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
 #include "SDL_audio.h"
+#include "SDL_audioresample_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -372,7 +374,18 @@ void SDLCALL SDL_ConvertStereo(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting to stereo\n");
 #endif
-	if ( (format & 0xFF) == 16 ) {
+	if ( (format & 0xFF) == 32 ) {
+		Uint32 *src, *dst;
+
+		src = (Uint32 *)(cvt->buf+cvt->len_cvt);
+		dst = (Uint32 *)(cvt->buf+cvt->len_cvt*2);
+		for ( i=cvt->len_cvt/4; i; --i ) {
+			dst -= 2;
+			src -= 1;
+			dst[0] = src[0];
+			dst[1] = src[0];
+		}
+	} else if ( (format & 0xFF) == 16 ) {
 		Uint16 *src, *dst;
 
 		src = (Uint16 *)(cvt->buf+cvt->len_cvt);
@@ -798,7 +811,7 @@ void SDLCALL SDL_Convert8(SDL_AudioCVT *cvt, Uint16 format)
 		src += 2;
 		dst += 1;
 	}
-	format = ((format & ~0x9010) | AUDIO_U8);
+	format = ((format & ~0x1010) | AUDIO_U8);
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
 		cvt->filters[cvt->filter_index](cvt, format);
@@ -844,11 +857,23 @@ void SDLCALL SDL_ConvertEndian(SDL_AudioCVT *cvt, Uint16 format)
 	fprintf(stderr, "Converting audio endianness\n");
 #endif
 	data = cvt->buf;
-	for ( i=cvt->len_cvt/2; i; --i ) {
-		tmp = data[0];
-		data[0] = data[1];
-		data[1] = tmp;
-		data += 2;
+	if ( (format & 0xFF) == 32 ) {
+		for ( i=cvt->len_cvt/4; i; --i ) {
+			tmp = data[0];
+			data[0] = data[3];
+			data[3] = tmp;
+			tmp = data[1];
+			data[1] = data[2];
+			data[2] = tmp;
+			data += 4;
+		}
+	} else {
+		for ( i=cvt->len_cvt/2; i; --i ) {
+			tmp = data[0];
+			data[0] = data[1];
+			data[1] = tmp;
+			data += 2;
+		}
 	}
 	format = (format ^ 0x1000);
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -856,6 +881,358 @@ void SDLCALL SDL_ConvertEndian(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* The AUDIO_S32 and AUDIO_F32 formats are converted through native
+   floats: the first filter turns any format into AUDIO_F32SYS, the
+   channel and rate changes work on that, and the last filter turns it
+   into the destination format.  Floats keep whatever headroom they
+   have until the destination needs clipping.
+ */
+typedef union {
+	Uint32 u;
+	float f;
+} SDL_FloatBits;
+
+#define S32_SCALE	(1.0f / 2147483648.0f)
+
+/* Round to the nearest integer, clipped to 'lo' and 'hi' */
+static Sint32 SDL_FloatToSample(float value, Sint32 lo, Sint32 hi)
+{
+	if ( value >= (float)hi ) {
+		return(hi);
+	}
+	if ( value <= (float)lo ) {
+		return(lo);
+	}
+	if ( value >= 0.0f ) {
+		return((Sint32)(value + 0.5f));
+	}
+	return(-(Sint32)(0.5f - value));
+}
+
+#if SDL_SSE2_INTRINSICS
+/* 'n' is a multiple of 8, and the blocks go from the end, as the output
+   is wider than the input in the same buffer.
+ */
+SDL_TARGETING("sse2")
+static void SDL_S16ToFloatSSE2(float *dst, const Sint16 *src, int n)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	__m128i s;
+
+	while ( n > 0 ) {
+		n -= 8;
+		s = _mm_loadu_si128((const __m128i *)(src+n));
+		_mm_storeu_ps(dst+n, _mm_mul_ps(scale, _mm_cvtepi32_ps(
+			_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16))));
+		_mm_storeu_ps(dst+n+4, _mm_mul_ps(scale, _mm_cvtepi32_ps(
+			_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16))));
+	}
+}
+
+/* The pack saturates, so this clips like SDL_FloatToSample() */
+SDL_TARGETING("sse2")
+static int SDL_FloatToS16SSE2(Sint16 *dst, const float *src, int n)
+{
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	__m128i a, b;
+	int i;
+
+	n &= ~7;
+	for ( i=0; i<n; i+=8 ) {
+		a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src+i), scale));
+		b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src+i+4), scale));
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packs_epi32(a, b));
+	}
+	return(n);
+}
+
+SDL_TARGETING("sse2")
+static int SDL_S32ToFloatSSE2(float *dst, const Sint32 *src, int n)
+{
+	const __m128 scale = _mm_set1_ps(S32_SCALE);
+	int i;
+
+	n &= ~3;
+	for ( i=0; i<n; i+=4 ) {
+		_mm_storeu_ps(dst+i, _mm_mul_ps(scale, _mm_cvtepi32_ps(
+			_mm_loadu_si128((const __m128i *)(src+i)))));
+	}
+	return(n);
+}
+
+/* Clip before converting, out of range values would come out negative */
+SDL_TARGETING("sse2")
+static int SDL_FloatToS32SSE2(Sint32 *dst, const float *src, int n)
+{
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	const __m128 hi = _mm_set1_ps(2147483520.0f);
+	const __m128 lo = _mm_set1_ps(-2147483648.0f);
+	__m128 v;
+	int i;
+
+	n &= ~3;
+	for ( i=0; i<n; i+=4 ) {
+		v = _mm_mul_ps(_mm_loadu_ps(src+i), scale);
+		v = _mm_max_ps(_mm_min_ps(v, hi), lo);
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_cvtps_epi32(v));
+	}
+	return(n);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+/* Convert any format to native floats */
+void SDLCALL SDL_ConvertToFloat(SDL_AudioCVT *cvt, Uint16 format)
+{
+	const Uint8 *src = cvt->buf;
+	float *dst = (float *)cvt->buf;
+	SDL_FloatBits bits;
+	int i, n, hi;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting to float\n");
+#endif
+	/* Wider samples are written from the end back, so the input they
+	   land on has been read already.
+	 */
+	switch (format & 0xFF) {
+	    case 8: {
+		Uint8 flip = (format & 0x8000) ? 0 : 0x80;
+
+		n = cvt->len_cvt;
+		for ( i=n-1; i>=0; --i ) {
+			dst[i] = (float)(Sint8)(src[i] ^ flip) * (1.0f/128.0f);
+		}
+	    }
+		break;
+	    case 16: {
+		Uint16 flip = (format & 0x8000) ? 0 : 0x8000;
+		int done = 0;
+
+		n = cvt->len_cvt / 2;
+		hi = (format & 0x1000) ? 0 : 1;
+#if SDL_SSE2_INTRINSICS
+		if ( format == AUDIO_S16SYS && SDL_HasSSE2() ) {
+			done = (n & ~7);
+		}
+#endif
+		for ( i=n-1; i>=done; --i ) {
+			Uint16 v = (Uint16)((src[i*2+hi] << 8) | src[i*2+(hi^1)]);
+			dst[i] = (float)(Sint16)(v ^ flip) * (1.0f/32768.0f);
+		}
+#if SDL_SSE2_INTRINSICS
+		if ( done ) {
+			SDL_S16ToFloatSSE2(dst, (const Sint16 *)src, done);
+		}
+#endif
+	    }
+		break;
+	    default:
+		n = cvt->len_cvt / 4;
+		i = 0;
+#if SDL_SSE2_INTRINSICS
+		if ( format == AUDIO_S32SYS && SDL_HasSSE2() ) {
+			i = SDL_S32ToFloatSSE2(dst, (const Sint32 *)src, n);
+		}
+#endif
+		for ( ; i<n; ++i ) {
+			if ( format & 0x1000 ) {
+				bits.u = ((Uint32)src[i*4] << 24) |
+				         ((Uint32)src[i*4+1] << 16) |
+				         ((Uint32)src[i*4+2] << 8) | src[i*4+3];
+			} else {
+				bits.u = ((Uint32)src[i*4+3] << 24) |
+				         ((Uint32)src[i*4+2] << 16) |
+				         ((Uint32)src[i*4+1] << 8) | src[i*4];
+			}
+			if ( !(format & 0x0100) ) {
+				bits.f = (float)(Sint32)bits.u * S32_SCALE;
+			}
+			dst[i] = bits.f;
+		}
+		break;
+	}
+	format = AUDIO_F32SYS;
+	cvt->len_cvt = n * 4;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Convert native floats to the destination format, clipping integers */
+void SDLCALL SDL_ConvertFromFloat(SDL_AudioCVT *cvt, Uint16 format)
+{
+	const float *src = (const float *)cvt->buf;
+	Uint8 *dst = cvt->buf;
+	SDL_FloatBits bits;
+	Sint32 v;
+	int i = 0, n, hi;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting from float\n");
+#endif
+	format = cvt->dst_format;
+	n = cvt->len_cvt / 4;
+	switch (format & 0xFF) {
+	    case 8: {
+		Uint8 flip = (format & 0x8000) ? 0 : 0x80;
+
+		for ( ; i<n; ++i ) {
+			v = SDL_FloatToSample(src[i] * 128.0f, -128, 127);
+			dst[i] = (Uint8)v ^ flip;
+		}
+	    }
+		break;
+	    case 16: {
+		Uint16 flip = (format & 0x8000) ? 0 : 0x8000;
+
+		hi = (format & 0x1000) ? 0 : 1;
+#if SDL_SSE2_INTRINSICS
+		if ( format == AUDIO_S16SYS && SDL_HasSSE2() ) {
+			i = SDL_FloatToS16SSE2((Sint16 *)dst, src, n);
+		}
+#endif
+		for ( ; i<n; ++i ) {
+			v = SDL_FloatToSample(src[i] * 32768.0f, -32768, 32767);
+			v ^= flip;
+			dst[i*2+hi] = (Uint8)(v >> 8);
+			dst[i*2+(hi^1)] = (Uint8)v;
+		}
+	    }
+		break;
+	    default:
+#if SDL_SSE2_INTRINSICS
+		if ( format == AUDIO_S32SYS && SDL_HasSSE2() ) {
+			i = SDL_FloatToS32SSE2((Sint32 *)dst, src, n);
+		}
+#endif
+		for ( ; i<n; ++i ) {
+			bits.f = src[i];
+			if ( !(format & 0x0100) ) {
+				bits.u = (Uint32)SDL_FloatToSample(
+					bits.f * 2147483648.0f,
+					-2147483647-1, 2147483647);
+			}
+			if ( format & 0x1000 ) {
+				dst[i*4] = (Uint8)(bits.u >> 24);
+				dst[i*4+1] = (Uint8)(bits.u >> 16);
+				dst[i*4+2] = (Uint8)(bits.u >> 8);
+				dst[i*4+3] = (Uint8)bits.u;
+			} else {
+				dst[i*4+3] = (Uint8)(bits.u >> 24);
+				dst[i*4+2] = (Uint8)(bits.u >> 16);
+				dst[i*4+1] = (Uint8)(bits.u >> 8);
+				dst[i*4] = (Uint8)bits.u;
+			}
+		}
+		break;
+	}
+	cvt->len_cvt = n * ((format & 0xFF) / 8);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Average stereo floats into mono */
+void SDLCALL SDL_ConvertMonoF32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	float *data = (float *)cvt->buf;
+	int i, n = cvt->len_cvt / 8;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float to mono\n");
+#endif
+	for ( i=0; i<n; ++i ) {
+		data[i] = (data[i*2] + data[i*2+1]) * 0.5f;
+	}
+	cvt->len_cvt /= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Keep the first 'keep' of every 6 float channels */
+static void SDL_StripF32(SDL_AudioCVT *cvt, int keep)
+{
+	float *data = (float *)cvt->buf;
+	int i, c, n = cvt->len_cvt / (6*4);
+
+	for ( i=0; i<n; ++i ) {
+		for ( c=0; c<keep; ++c ) {
+			data[i*keep+c] = data[i*6+c];
+		}
+	}
+	cvt->len_cvt = n * keep * 4;
+}
+
+void SDLCALL SDL_ConvertStripF32(SDL_AudioCVT *cvt, Uint16 format)
+{
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float down to stereo\n");
+#endif
+	SDL_StripF32(cvt, 2);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+void SDLCALL SDL_ConvertStrip_2F32(SDL_AudioCVT *cvt, Uint16 format)
+{
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float 6 down to quad\n");
+#endif
+	SDL_StripF32(cvt, 4);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Spread stereo floats over 'channels' (4 or 6) channels, the way
+   SDL_ConvertSurround() does.  The output is written from the end back.
+ */
+static void SDL_SurroundF32(SDL_AudioCVT *cvt, int channels)
+{
+	float *data = (float *)cvt->buf;
+	float lf, rf, ce;
+	int i, n = cvt->len_cvt / 8;
+
+	for ( i=n-1; i>=0; --i ) {
+		lf = data[i*2];
+		rf = data[i*2+1];
+		ce = (lf + rf) * 0.5f;
+		data[i*channels] = lf;
+		data[i*channels+1] = rf;
+		data[i*channels+2] = lf - ce;
+		data[i*channels+3] = rf - ce;
+		if ( channels == 6 ) {
+			data[i*channels+4] = ce;
+			data[i*channels+5] = ce;
+		}
+	}
+	cvt->len_cvt = n * channels * 4;
+}
+
+void SDLCALL SDL_ConvertSurroundF32(SDL_AudioCVT *cvt, Uint16 format)
+{
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float stereo to surround\n");
+#endif
+	SDL_SurroundF32(cvt, 6);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+void SDLCALL SDL_ConvertSurround_4F32(SDL_AudioCVT *cvt, Uint16 format)
+{
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float stereo to quad\n");
+#endif
+	SDL_SurroundF32(cvt, 4);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
 /* Convert rate up by multiple of 2 */
 void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
 {
@@ -1225,79 +1602,233 @@ void SDLCALL SDL_RateDIV2_c6(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
-/* Very slow rate conversion routine */
-void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
-{
-	double ipos;
-	int i, clen;
+/* Most conversions are between 8 and 16 bit mono and stereo, with the
+   rate changed by a power of two, and the filter chain for those goes
+   over the buffer up to four times.  These filters do the whole chain
+   in one pass instead, with the same results.  The sample formats come
+   from the SDL_AudioCVT, and the channels and the rate change are built
+   into each filter.
+*/
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * %4.4f\n", 1.0/cvt->rate_incr);
-#endif
-	clen = (int)((double)cvt->len_cvt / cvt->rate_incr);
-	if ( cvt->rate_incr > 1.0 ) {
-		switch (format & 0xFF) {
-			case 8: {
-				Uint8 *output;
-
-				output = cvt->buf;
-				ipos = 0.0;
-				for ( i=clen; i; --i ) {
-					*output = cvt->buf[(int)ipos];
-					ipos += cvt->rate_incr;
-					output += 1;
-				}
-			}
-			break;
+/* Mix two samples already in 'format', the way SDL_ConvertMono() does */
+static Uint8 SDL_FusedMix8(Uint8 left, Uint8 right, Uint16 format)
+{
+	if ( format & 0x8000 ) {
+		return((Uint8)(((Sint8)left + (Sint8)right) / 2));
+	}
+	return((Uint8)((left + right) / 2));
+}
 
-			case 16: {
-				Uint16 *output;
+static Uint16 SDL_FusedMix16(Uint16 left, Uint16 right, Uint16 format)
+{
+	Sint32 sample;
 
-				clen &= ~1;
-				output = (Uint16 *)cvt->buf;
-				ipos = 0.0;
-				for ( i=clen/2; i; --i ) {
-					*output=((Uint16 *)cvt->buf)[(int)ipos];
-					ipos += cvt->rate_incr;
-					output += 1;
-				}
-			}
-			break;
-		}
+	if ( (format & 0x1000) != (AUDIO_U16SYS & 0x1000) ) {
+		left = SDL_Swap16(left);
+		right = SDL_Swap16(right);
+	}
+	if ( format & 0x8000 ) {
+		sample = ((Sint32)(Sint16)left + (Sint16)right) / 2;
 	} else {
-		switch (format & 0xFF) {
-			case 8: {
-				Uint8 *output;
-
-				output = cvt->buf+clen;
-				ipos = (double)cvt->len_cvt;
-				for ( i=clen; i; --i ) {
-					ipos -= cvt->rate_incr;
-					output -= 1;
-					*output = cvt->buf[(int)ipos];
-				}
-			}
-			break;
+		sample = ((Sint32)left + right) / 2;
+	}
+	if ( (format & 0x1000) != (AUDIO_U16SYS & 0x1000) ) {
+		return(SDL_Swap16((Uint16)sample));
+	}
+	return((Uint16)sample);
+}
+
+/* The sign bit of the output, where it is when loaded natively */
+static int SDL_FusedFlip(Uint16 src_format, Uint16 dst_format)
+{
+	if ( (src_format & 0x8000) == (dst_format & 0x8000) ) {
+		return(0);
+	}
+	if ( (dst_format & 0xFF) == 16 &&
+	     (dst_format & 0x1000) == (AUDIO_U16SYS & 0x1000) ) {
+		return(0x8000);
+	}
+	return(0x80);
+}
 
-			case 16: {
-				Uint16 *output;
+/* The 16 bit output for every 8 bit sample, which goes in the top byte */
+static void SDL_FusedTable(Uint16 *table, Uint16 src_format, Uint16 dst_format)
+{
+	int i, v;
 
-				clen &= ~1;
-				output = (Uint16 *)(cvt->buf+clen);
-				ipos = (double)cvt->len_cvt/2;
-				for ( i=clen/2; i; --i ) {
-					ipos -= cvt->rate_incr;
-					output -= 1;
-					*output=((Uint16 *)cvt->buf)[(int)ipos];
-				}
-			}
-			break;
+	for ( i=0; i<256; ++i ) {
+		v = (i << 8);
+		if ( (src_format & 0x8000) != (dst_format & 0x8000) ) {
+			v ^= 0x8000;
+		}
+		if ( (dst_format & 0x1000) != (AUDIO_U16SYS & 0x1000) ) {
+			v = SDL_Swap16((Uint16)v);
 		}
+		table[i] = (Uint16)v;
 	}
-	cvt->len_cvt = clen;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+}
+
+/* Make 'up' frames out of each group of 'down' frames.  When the data
+   grows this works from the end, so it isn't overwritten.  LOAD(src, c)
+   gives channel 'c' of a frame in the output format, and MIX mixes two
+   of those.
+ */
+#define FUSED_FRAME(type, LOAD, MIX, src_channels, dst_channels, up) \
+{ \
+	type left, right; \
+	int j; \
+	left = LOAD(src, 0); \
+	right = left; \
+	if ( src_channels == 2 ) { \
+		right = LOAD(src, 1); \
+		if ( dst_channels == 1 ) { \
+			left = MIX(left, right, dst_format); \
+		} \
+	} \
+	for ( j=0; j<up; ++j ) { \
+		dst[j*dst_channels] = left; \
+		if ( dst_channels == 2 ) { \
+			dst[j*dst_channels+1] = right; \
+		} \
+	} \
+}
+#define FUSED_FRAMES(type, LOAD, MIX, src_channels, dst_channels, up, down) \
+{ \
+	const Uint8 *src; \
+	type *dst; \
+	int i, src_step = src_size*down, dst_step = up*dst_channels; \
+	if ( dst_size*up > src_size*down ) { \
+		src = cvt->buf + (groups-1)*src_step; \
+		dst = (type *)cvt->buf + (groups-1)*dst_step; \
+		for ( i=groups; i; --i ) { \
+			FUSED_FRAME(type, LOAD, MIX, src_channels, dst_channels, up) \
+			src -= src_step; \
+			dst -= dst_step; \
+		} \
+	} else { \
+		src = cvt->buf; \
+		dst = (type *)cvt->buf; \
+		for ( i=groups; i; --i ) { \
+			FUSED_FRAME(type, LOAD, MIX, src_channels, dst_channels, up) \
+			src += src_step; \
+			dst += dst_step; \
+		} \
+	} \
+}
+
+#define LOAD_8TO8(src, c)	(Uint8)(src[c] ^ flip)
+#define LOAD_8TO16(src, c)	table[src[c]]
+#define LOAD_16TO8(src, c)	(Uint8)(src[(c)*2+hi] ^ flip)
+#define LOAD_16TO16(src, c)	(Uint16)(((const Uint16 *)src)[c] ^ flip)
+#define LOAD_16TO16_SWAP(src, c) \
+			(Uint16)(SDL_Swap16(((const Uint16 *)src)[c]) ^ flip)
+
+/* Each fused filter is a copy of this, so the loops are specialized */
+#define FUSED_FILTER(name, src_channels, dst_channels, up, down) \
+static void SDLCALL name(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	Uint16 src_format = cvt->src_format; \
+	Uint16 dst_format = cvt->dst_format; \
+	int src_size, dst_size, groups, flip; \
+ \
+	src_size = ((src_format & 0xFF) / 8) * src_channels; \
+	dst_size = ((dst_format & 0xFF) / 8) * dst_channels; \
+	groups = cvt->len_cvt / (src_size*down); \
+	flip = SDL_FusedFlip(src_format, dst_format); \
+	if ( groups > 0 ) { \
+	    if ( (src_format & 0xFF) == 8 ) { \
+		if ( (dst_format & 0xFF) == 8 ) { \
+			FUSED_FRAMES(Uint8, LOAD_8TO8, SDL_FusedMix8, \
+			             src_channels, dst_channels, up, down) \
+		} else { \
+			Uint16 table[256]; \
+			SDL_FusedTable(table, src_format, dst_format); \
+			FUSED_FRAMES(Uint16, LOAD_8TO16, SDL_FusedMix16, \
+			             src_channels, dst_channels, up, down) \
+		} \
+	    } else { \
+		if ( (dst_format & 0xFF) == 8 ) { \
+			int hi = ((src_format & 0x1000) ? 0 : 1); \
+			FUSED_FRAMES(Uint8, LOAD_16TO8, SDL_FusedMix8, \
+			             src_channels, dst_channels, up, down) \
+		} else if ( (src_format & 0x1000) == (dst_format & 0x1000) ) { \
+			FUSED_FRAMES(Uint16, LOAD_16TO16, SDL_FusedMix16, \
+			             src_channels, dst_channels, up, down) \
+		} else { \
+			FUSED_FRAMES(Uint16, LOAD_16TO16_SWAP, SDL_FusedMix16, \
+			             src_channels, dst_channels, up, down) \
+		} \
+	    } \
+	} \
+	cvt->len_cvt = groups*up*dst_size; \
+	format = dst_format; \
+	if ( cvt->filters[++cvt->filter_index] ) { \
+		cvt->filters[cvt->filter_index](cvt, format); \
+	} \
+}
+#define FUSED_FILTERS(s, d) \
+FUSED_FILTER(SDL_Fused##s##to##d, s, d, 1, 1) \
+FUSED_FILTER(SDL_Fused##s##to##d##_MUL2, s, d, 2, 1) \
+FUSED_FILTER(SDL_Fused##s##to##d##_MUL4, s, d, 4, 1) \
+FUSED_FILTER(SDL_Fused##s##to##d##_DIV2, s, d, 1, 2) \
+FUSED_FILTER(SDL_Fused##s##to##d##_DIV4, s, d, 1, 4)
+FUSED_FILTERS(1, 1)
+FUSED_FILTERS(1, 2)
+FUSED_FILTERS(2, 1)
+FUSED_FILTERS(2, 2)
+
+/* Indexed by source and destination channels, and the rate change */
+#define FUSED_TABLE(s, d) { \
+	SDL_Fused##s##to##d##_DIV4, SDL_Fused##s##to##d##_DIV2, \
+	SDL_Fused##s##to##d, \
+	SDL_Fused##s##to##d##_MUL2, SDL_Fused##s##to##d##_MUL4 }
+static void (SDLCALL *fused_filters[2][2][5])(SDL_AudioCVT *cvt,
+							Uint16 format) = {
+	{ FUSED_TABLE(1, 1), FUSED_TABLE(1, 2) },
+	{ FUSED_TABLE(2, 1), FUSED_TABLE(2, 2) }
+};
+
+static int SDL_FusableFormat(Uint16 format)
+{
+	switch (format) {
+	    case AUDIO_U8:
+	    case AUDIO_S8:
+	    case AUDIO_U16LSB:
+	    case AUDIO_S16LSB:
+	    case AUDIO_U16MSB:
+	    case AUDIO_S16MSB:
+		return(1);
+	}
+	return(0);
+}
+
+/* Replace the filter chain with one fused filter, if there is one.
+   'rate_steps' is the number of times the rate is doubled, or halved
+   if it's negative.
+ */
+static void SDL_FuseAudioCVT(SDL_AudioCVT *cvt,
+	Uint16 src_format, int src_channels,
+	Uint16 dst_format, int dst_channels, int rate_steps)
+{
+	const char *env;
+
+	/* A single filter is already one pass */
+	if ( cvt->filter_index < 2 || cvt->rate_incr != 0.0 ) {
+		return;
+	}
+	if ( src_channels < 1 || src_channels > 2 ||
+	     dst_channels < 1 || dst_channels > 2 ||
+	     rate_steps < -2 || rate_steps > 2 ||
+	     !SDL_FusableFormat(src_format) || !SDL_FusableFormat(dst_format) ) {
+		return;
 	}
+	env = SDL_getenv("SDL_AUDIO_FUSED_CONVERT");
+	if ( env && SDL_atoi(env) == 0 ) {
+		return;
+	}
+	cvt->filters[0] =
+		fused_filters[src_channels-1][dst_channels-1][rate_steps+2];
+	cvt->filter_index = 1;
 }
 
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
@@ -1319,6 +1850,23 @@ int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 	return(0);
 }
 
+int SDL_FlushAudioCVT(SDL_AudioCVT *cvt)
+{
+	if ( cvt->buf == NULL ) {
+		SDL_SetError("No buffer allocated for conversion");
+		return(-1);
+	}
+	cvt->len_cvt = 0;
+	if ( cvt->filters[0] == NULL || !SDL_FlushResampler(cvt) ) {
+		return(0);
+	}
+
+	/* The stages before the resampler see no input */
+	cvt->filter_index = 0;
+	cvt->filters[0](cvt, cvt->src_format);
+	return(0);
+}
+
 /* Creates a set of audio filters to convert from one format to another. 
    Returns -1 if the format conversion is not supported, or 1 if the
    audio filter is set up.
@@ -1328,28 +1876,51 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	Uint16 src_format, Uint8 src_channels, int src_rate,
 	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
 {
+	int channels = src_channels;
+	int rate_steps = 0;
+	int wide;
+
 /*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
 		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
-	/* Start off with no conversion necessary */
+	/* Start off with no conversion necessary, and a new stream */
+	SDL_ResetResampler(cvt);
 	cvt->needed = 0;
 	cvt->filter_index = 0;
 	cvt->filters[0] = NULL;
 	cvt->len_mult = 1;
 	cvt->len_ratio = 1.0;
 
+	/* 32-bit audio goes through native floats, unless only the byte
+	   order is changing.
+	 */
+	wide = ((src_format & 0xFF) == 32 || (dst_format & 0xFF) == 32);
+	if ( wide && (src_format & ~0x1000) == (dst_format & ~0x1000) &&
+	     src_channels == dst_channels &&
+	     (src_rate/100) == (dst_rate/100) ) {
+		wide = 0;
+	}
+	if ( wide && src_format != AUDIO_F32SYS ) {
+		int grow = 4 / ((src_format & 0xFF) / 8);
+
+		cvt->filters[cvt->filter_index++] = SDL_ConvertToFloat;
+		cvt->len_mult *= grow;
+		cvt->len_ratio *= grow;
+	}
+
 	/* First filter:  Endian conversion from src to dst */
-	if ( (src_format & 0x1000) != (dst_format & 0x1000)
-	     && ((src_format & 0xff) == 16) && ((dst_format & 0xff) == 16)) {
+	if ( !wide && (src_format & 0x1000) != (dst_format & 0x1000)
+	     && ((src_format & 0xff) == (dst_format & 0xff))
+	     && ((src_format & 0xff) >= 16) ) {
 		cvt->filters[cvt->filter_index++] = SDL_ConvertEndian;
 	}
 	
 	/* Second filter: Sign conversion -- signed/unsigned */
-	if ( (src_format & 0x8000) != (dst_format & 0x8000) ) {
+	if ( !wide && (src_format & 0x8000) != (dst_format & 0x8000) ) {
 		cvt->filters[cvt->filter_index++] = SDL_ConvertSign;
 	}
 
 	/* Next filter:  Convert 16 bit <--> 8 bit PCM */
-	if ( (src_format & 0xFF) != (dst_format & 0xFF) ) {
+	if ( !wide && (src_format & 0xFF) != (dst_format & 0xFF) ) {
 		switch (dst_format&0x10FF) {
 			case AUDIO_U8:
 				cvt->filters[cvt->filter_index++] =
@@ -1382,16 +1953,16 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		}
 		if ( (src_channels == 2) &&
 				(dst_channels == 6) ) {
-			cvt->filters[cvt->filter_index++] =
-						 SDL_ConvertSurround;
+			cvt->filters[cvt->filter_index++] = wide ?
+				SDL_ConvertSurroundF32 : SDL_ConvertSurround;
 			src_channels = 6;
 			cvt->len_mult *= 3;
 			cvt->len_ratio *= 3;
 		}
 		if ( (src_channels == 2) &&
 				(dst_channels == 4) ) {
-			cvt->filters[cvt->filter_index++] =
-						 SDL_ConvertSurround_4;
+			cvt->filters[cvt->filter_index++] = wide ?
+				SDL_ConvertSurround_4F32 : SDL_ConvertSurround_4;
 			src_channels = 4;
 			cvt->len_mult *= 2;
 			cvt->len_ratio *= 2;
@@ -1405,17 +1976,23 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		}
 		if ( (src_channels == 6) &&
 				(dst_channels <= 2) ) {
-			cvt->filters[cvt->filter_index++] =
-						 SDL_ConvertStrip;
+			cvt->filters[cvt->filter_index++] = wide ?
+				SDL_ConvertStripF32 : SDL_ConvertStrip;
 			src_channels = 2;
 			cvt->len_ratio /= 3;
 		}
 		if ( (src_channels == 6) &&
 				(dst_channels == 4) ) {
-			cvt->filters[cvt->filter_index++] =
-						 SDL_ConvertStrip_2;
+			if ( wide ) {
+				cvt->filters[cvt->filter_index++] =
+							 SDL_ConvertStrip_2F32;
+				cvt->len_ratio = cvt->len_ratio * 2 / 3;
+			} else {
+				cvt->filters[cvt->filter_index++] =
+							 SDL_ConvertStrip_2;
+				cvt->len_ratio /= 2;
+			}
 			src_channels = 4;
-			cvt->len_ratio /= 2;
 		}
 		/* This assumes that 4 channel audio is in the format:
 		     Left {front/back} + Right {front/back}
@@ -1423,8 +2000,8 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		 */
 		while ( ((src_channels%2) == 0) &&
 				((src_channels/2) >= dst_channels) ) {
-			cvt->filters[cvt->filter_index++] =
-						 SDL_ConvertMono;
+			cvt->filters[cvt->filter_index++] = wide ?
+				SDL_ConvertMonoF32 : SDL_ConvertMono;
 			src_channels /= 2;
 			cvt->len_ratio /= 2;
 		}
@@ -1437,7 +2014,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	cvt->rate_incr = 0.0;
 	if ( (src_rate/100) != (dst_rate/100) ) {
 		Uint32 hi_rate, lo_rate;
-		int len_mult;
+		int len_mult, steps;
 		double len_ratio;
 		void (SDLCALL *rate_cvt)(SDL_AudioCVT *cvt, Uint16 format);
 
@@ -1449,7 +2026,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 				case 2: rate_cvt = SDL_RateDIV2_c2; break;
 				case 4: rate_cvt = SDL_RateDIV2_c4; break;
 				case 6: rate_cvt = SDL_RateDIV2_c6; break;
-				default: return -1;
+				default: rate_cvt = NULL; break;
 			}
 			len_mult = 1;
 			len_ratio = 0.5;
@@ -1461,42 +2038,47 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 				case 2: rate_cvt = SDL_RateMUL2_c2; break;
 				case 4: rate_cvt = SDL_RateMUL2_c4; break;
 				case 6: rate_cvt = SDL_RateMUL2_c6; break;
-				default: return -1;
+				default: rate_cvt = NULL; break;
 			}
 			len_mult = 2;
 			len_ratio = 2.0;
 		}
 		/* If hi_rate = lo_rate*2^x then conversion is easy */
+		steps = 0;
 		while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
-			cvt->filters[cvt->filter_index++] = rate_cvt;
-			cvt->len_mult *= len_mult;
 			lo_rate *= 2;
-			cvt->len_ratio *= len_ratio;
+			++steps;
 		}
-		/* We may need a slow conversion here to finish up */
-		if ( (lo_rate/100) != (hi_rate/100) ) {
-#if 1
-			/* The problem with this is that if the input buffer is
-			   say 1K, and the conversion rate is say 1.1, then the
-			   output buffer is 1.1K, which may not be an acceptable
-			   buffer size for the audio driver (not a power of 2)
-			*/
-			/* For now, punt and hope the rate distortion isn't great.
+		if ( rate_cvt && !wide && (lo_rate/100) == (hi_rate/100) ) {
+			rate_steps = (src_rate > dst_rate) ? -steps : steps;
+			while ( steps-- ) {
+				cvt->filters[cvt->filter_index++] = rate_cvt;
+				cvt->len_mult *= len_mult;
+				cvt->len_ratio *= len_ratio;
+			}
+		} else {
+			/* Any other ratio, and any float audio, goes
+			   through the band-limited resampler in one step,
+			   rather than doubling or halving the rate without
+			   filtering first.
 			*/
-#else
-			if ( src_rate < dst_rate ) {
-				cvt->rate_incr = (double)lo_rate/hi_rate;
-				cvt->len_mult *= 2;
-				cvt->len_ratio /= cvt->rate_incr;
-			} else {
-				cvt->rate_incr = (double)hi_rate/lo_rate;
-				cvt->len_ratio *= cvt->rate_incr;
+			if ( SDL_BuildResampler(cvt, src_channels,
+			                        src_rate, dst_rate) < 0 ) {
+				return(-1);
 			}
-			cvt->filters[cvt->filter_index++] = SDL_RateSLOW;
-#endif
 		}
 	}
 
+	/* Back from floats to the destination format */
+	if ( wide && dst_format != AUDIO_F32SYS ) {
+		cvt->filters[cvt->filter_index++] = SDL_ConvertFromFloat;
+		cvt->len_ratio = cvt->len_ratio * ((dst_format & 0xFF) / 8) / 4;
+	}
+
+	/* Replace the chain with a single pass, when there's one for it */
+	SDL_FuseAudioCVT(cvt, src_format, channels,
+	                 dst_format, dst_channels, rate_steps);
+
 	/* Set up the filter information */
 	if ( cvt->filter_index != 0 ) {
 		cvt->needed = 1;
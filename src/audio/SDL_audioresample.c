@@ -0,0 +1,789 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Polyphase rate conversion of audio, see SDL_audioresample_c.h */
+
+#include "SDL_audio.h"
+#include "SDL_thread.h"
+#include "SDL_audioresample_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
+
+#define RESAMPLE_PI	3.14159265358979323846
+
+#define RESAMPLE_ZEROS	24	/* Zero crossings of the sinc on each side */
+#define RESAMPLE_BETA	8.0	/* Kaiser window shape, about -80 dB */
+#define RESAMPLE_CUTOFF	0.88	/* Filter cutoff, relative to the lower Nyquist */
+#define MAX_PHASES	1024	/* Ratios are rounded to a denominator this big */
+#define MAX_HALF_TAPS	256	/* Limits the filter for very large ratios */
+#define TAP_ALIGN	8	/* Filters are padded to the SIMD width */
+#define MAX_RESAMPLERS	16	/* Conversions that keep their history */
+
+typedef float (*SDL_ResampleDot)(const float *taps, const float *data, int n);
+
+typedef struct SDL_Resampler {
+	const SDL_AudioCVT *cvt;	/* The conversion this belongs to */
+	double rate_incr;		/* And what it was built for */
+	int channels;
+	int busy;
+	Uint32 last_used;
+
+	int step;		/* Input frames per output frame, in 1/phases */
+	int phases;
+	int step_frames;	/* step / phases */
+	int step_phase;		/* step % phases */
+	int half;		/* Filter taps on each side of the output */
+	int taps;		/* 2*half, padded to TAP_ALIGN */
+	float *bank;		/* 'taps' coefficients for each phase */
+	SDL_ResampleDot dot;
+
+	float *planes;		/* The input history, one plane per channel */
+	int plane_len;		/* Frames allocated for each channel */
+	int kept;		/* Frames of history at the start of the planes */
+	int first;		/* First tap of the next output frame */
+	int phase;		/* And the filter phase it uses */
+
+	double in_ratio;	/* Bytes reaching this stage per input byte */
+	int flushing;		/* Convert the look ahead, with no input */
+} SDL_Resampler;
+
+static SDL_mutex *resample_lock = NULL;
+static SDL_Resampler *resamplers[MAX_RESAMPLERS];
+static Uint32 resample_clock = 0;
+
+/* Without SDL_AudioInit() there's no lock, and conversions had better
+   stay on one thread.
+ */
+static void SDL_LockResamplers(void)
+{
+	if ( resample_lock ) {
+		SDL_mutexP(resample_lock);
+	}
+}
+
+static void SDL_UnlockResamplers(void)
+{
+	if ( resample_lock ) {
+		SDL_mutexV(resample_lock);
+	}
+}
+
+/* The math library isn't always available, and the filters are only
+   computed once per conversion, so these just use the power series.
+ */
+static double SDL_ResampleSin(double x)
+{
+	double sum, term, x2;
+	int n;
+
+	x -= (2.0*RESAMPLE_PI) * (int)(x / (2.0*RESAMPLE_PI));
+	if ( x > RESAMPLE_PI ) {
+		x -= 2.0*RESAMPLE_PI;
+	} else if ( x < -RESAMPLE_PI ) {
+		x += 2.0*RESAMPLE_PI;
+	}
+	x2 = x * x;
+	sum = term = x;
+	for ( n=1; n<=15; ++n ) {
+		term *= -x2 / ((2*n) * (2*n+1));
+		sum += term;
+	}
+	return(sum);
+}
+
+/* The modified Bessel function I0(x), given (x/2)^2 */
+static double SDL_ResampleI0(double y)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for ( k=1; k<100 && term > sum*1e-12; ++k ) {
+		term *= y / ((double)k * k);
+		sum += term;
+	}
+	return(sum);
+}
+
+/* Find the fraction num/den closest to 'ratio' with den <= MAX_PHASES */
+static void SDL_ResampleRatio(double ratio, int *num, int *den)
+{
+	int p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+	int i, a, p2, q2;
+
+	for ( i=0; i<64 && ratio < 1e6; ++i ) {
+		a = (int)ratio;
+		p2 = a*p1 + p0;
+		q2 = a*q1 + q0;
+		if ( q2 > MAX_PHASES ) {
+			break;
+		}
+		p0 = p1; q0 = q1;
+		p1 = p2; q1 = q2;
+		ratio -= a;
+		if ( ratio <= 0.0 ) {
+			break;
+		}
+		ratio = 1.0 / ratio;
+	}
+	if ( p1 < 1 ) {
+		p1 = 1;
+	}
+	if ( q1 < 1 ) {
+		q1 = 1;
+	}
+	*num = p1;
+	*den = q1;
+}
+
+static float SDL_ResampleDotC(const float *taps, const float *data, int n)
+{
+	float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+	int i;
+
+	for ( i=0; i<n; i+=4 ) {
+		s0 += taps[i+0] * data[i+0];
+		s1 += taps[i+1] * data[i+1];
+		s2 += taps[i+2] * data[i+2];
+		s3 += taps[i+3] * data[i+3];
+	}
+	return((s0 + s2) + (s1 + s3));
+}
+
+#if SDL_SSE2_INTRINSICS
+SDL_TARGETING("sse2")
+static float SDL_ResampleDotSSE2(const float *taps, const float *data, int n)
+{
+	__m128 s0 = _mm_setzero_ps();
+	__m128 s1 = _mm_setzero_ps();
+	int i;
+
+	for ( i=0; i<n; i+=8 ) {
+		s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(taps+i),
+		                               _mm_loadu_ps(data+i)));
+		s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(taps+i+4),
+		                               _mm_loadu_ps(data+i+4)));
+	}
+	s0 = _mm_add_ps(s0, s1);
+	s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+	s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+	return(_mm_cvtss_f32(s0));
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+SDL_TARGETING("avx2")
+static float SDL_ResampleDotAVX2(const float *taps, const float *data, int n)
+{
+	__m256 s = _mm256_setzero_ps();
+	__m128 s0;
+	int i;
+
+	for ( i=0; i<n; i+=8 ) {
+		s = _mm256_add_ps(s, _mm256_mul_ps(_mm256_loadu_ps(taps+i),
+		                                   _mm256_loadu_ps(data+i)));
+	}
+	s0 = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+	s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+	s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+	return(_mm_cvtss_f32(s0));
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+/* Compute the Kaiser windowed sinc for every phase of the ratio */
+static int SDL_BuildResampleBank(SDL_Resampler *r)
+{
+	double scale, cutoff, beta2, i0beta;
+	double frac, d, x, w, sum;
+	float *row;
+	int phase, k;
+
+	/* Going down in rate the filter narrows, and gets longer to match */
+	scale = 1.0;
+	if ( r->step > r->phases ) {
+		scale = (double)r->phases / r->step;
+	}
+	cutoff = RESAMPLE_CUTOFF * scale;
+	r->half = (int)(RESAMPLE_ZEROS / scale + 0.999);
+	if ( r->half > MAX_HALF_TAPS ) {
+		r->half = MAX_HALF_TAPS;
+	}
+	r->taps = (2*r->half + TAP_ALIGN-1) & ~(TAP_ALIGN-1);
+	r->bank = (float *)SDL_malloc(r->phases*r->taps*sizeof(float));
+	if ( r->bank == NULL ) {
+		return(-1);
+	}
+
+	beta2 = RESAMPLE_BETA * RESAMPLE_BETA / 4.0;
+	i0beta = SDL_ResampleI0(beta2);
+	for ( phase=0; phase<r->phases; ++phase ) {
+		row = r->bank + phase*r->taps;
+		frac = (double)phase / r->phases;
+		sum = 0.0;
+		for ( k=0; k<2*r->half; ++k ) {
+			/* Distance of the tap from the output, in input frames */
+			d = (k - (r->half-1)) - frac;
+			x = d / r->half;
+			if ( x*x >= 1.0 ) {
+				w = 0.0;
+			} else {
+				w = SDL_ResampleI0(beta2 * (1.0 - x*x)) / i0beta;
+			}
+			x = RESAMPLE_PI * cutoff * d;
+			if ( x == 0.0 ) {
+				w *= cutoff;
+			} else {
+				w *= cutoff * SDL_ResampleSin(x) / x;
+			}
+			row[k] = (float)w;
+			sum += w;
+		}
+		/* Unity gain at DC for every phase */
+		for ( k=0; k<2*r->half; ++k ) {
+			row[k] = (float)(row[k] / sum);
+		}
+		for ( ; k<r->taps; ++k ) {
+			row[k] = 0.0f;
+		}
+	}
+
+	r->dot = SDL_ResampleDotC;
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		r->dot = SDL_ResampleDotSSE2;
+	}
+#endif
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		r->dot = SDL_ResampleDotAVX2;
+	}
+#endif
+	return(0);
+}
+
+static void SDL_FreeResampler(SDL_Resampler *r)
+{
+	if ( r->bank ) {
+		SDL_free(r->bank);
+	}
+	if ( r->planes ) {
+		SDL_free(r->planes);
+	}
+	SDL_free(r);
+}
+
+static SDL_Resampler *SDL_CreateResampler(const SDL_AudioCVT *cvt,
+							int channels)
+{
+	SDL_Resampler *r;
+
+	r = (SDL_Resampler *)SDL_calloc(1, sizeof(*r));
+	if ( r == NULL ) {
+		return(NULL);
+	}
+	r->cvt = cvt;
+	r->rate_incr = cvt->rate_incr;
+	r->channels = channels;
+	SDL_ResampleRatio(cvt->rate_incr, &r->step, &r->phases);
+	r->step_frames = r->step / r->phases;
+	r->step_phase = r->step % r->phases;
+	if ( SDL_BuildResampleBank(r) < 0 ) {
+		SDL_FreeResampler(r);
+		return(NULL);
+	}
+	/* The history starts out silent, centering the first output on the
+	   first input frame.
+	 */
+	r->kept = r->half - 1;
+	r->first = 0;
+	r->phase = 0;
+	return(r);
+}
+
+/* Find the state of a conversion, making it if need be, and mark it busy */
+static SDL_Resampler *SDL_GetResampler(const SDL_AudioCVT *cvt, int channels)
+{
+	SDL_Resampler *r = NULL;
+	int i, slot = -1;
+
+	SDL_LockResamplers();
+	for ( i=0; i<MAX_RESAMPLERS; ++i ) {
+		if ( resamplers[i] && resamplers[i]->cvt == cvt ) {
+			slot = i;
+			break;
+		}
+	}
+	if ( slot >= 0 ) {
+		r = resamplers[slot];
+		if ( r->busy ) {
+			/* Converting the same buffers in two threads?! */
+			r = NULL;
+			goto done;
+		}
+		if ( r->rate_incr != cvt->rate_incr || r->channels != channels ) {
+			SDL_FreeResampler(r);
+			resamplers[slot] = r = NULL;
+		}
+	} else {
+		/* Take an empty slot, or the one used longest ago */
+		for ( i=0; i<MAX_RESAMPLERS; ++i ) {
+			if ( resamplers[i] == NULL ) {
+				slot = i;
+				break;
+			}
+			if ( !resamplers[i]->busy && (slot < 0 ||
+			     (resample_clock - resamplers[i]->last_used) >
+			     (resample_clock - resamplers[slot]->last_used)) ) {
+				slot = i;
+			}
+		}
+		if ( slot < 0 ) {
+			goto done;
+		}
+		if ( resamplers[slot] ) {
+			SDL_FreeResampler(resamplers[slot]);
+			resamplers[slot] = NULL;
+		}
+	}
+	if ( r == NULL ) {
+		r = SDL_CreateResampler(cvt, channels);
+		resamplers[slot] = r;
+	}
+	if ( r ) {
+		r->busy = 1;
+		r->last_used = ++resample_clock;
+	}
+done:
+	SDL_UnlockResamplers();
+	return(r);
+}
+
+static void SDL_ReleaseResampler(SDL_Resampler *r)
+{
+	SDL_LockResamplers();
+	r->busy = 0;
+	SDL_UnlockResamplers();
+}
+
+/* Make room for 'frames' frames of history and input, plus padding */
+static int SDL_GrowResampler(SDL_Resampler *r, int frames)
+{
+	float *planes;
+	int len, c;
+
+	len = frames + r->taps;
+	if ( len <= r->plane_len ) {
+		return(0);
+	}
+	if ( len < 2*r->plane_len ) {
+		len = 2*r->plane_len;
+	}
+	planes = (float *)SDL_malloc(len*r->channels*sizeof(float));
+	if ( planes == NULL ) {
+		return(-1);
+	}
+	for ( c=0; c<r->channels; ++c ) {
+		if ( r->planes ) {
+			SDL_memcpy(planes + c*len, r->planes + c*r->plane_len,
+			           r->kept*sizeof(float));
+		} else {
+			SDL_memset(planes + c*len, 0, r->kept*sizeof(float));
+		}
+	}
+	if ( r->planes ) {
+		SDL_free(r->planes);
+	}
+	r->planes = planes;
+	r->plane_len = len;
+	return(0);
+}
+
+/* Spread the input samples out into the planes after the history */
+static void SDL_LoadResampler(SDL_Resampler *r, const Uint8 *src,
+					int frames, Uint16 format)
+{
+	int c, i, channels = r->channels;
+	float *dst;
+
+	for ( c=0; c<channels; ++c ) {
+		dst = r->planes + c*r->plane_len + r->kept;
+		switch (format) {
+		    case AUDIO_U8:
+			for ( i=0; i<frames; ++i ) {
+				dst[i] = (float)((int)src[i*channels+c] - 128);
+			}
+			break;
+		    case AUDIO_S8:
+			for ( i=0; i<frames; ++i ) {
+				dst[i] = (float)((Sint8)src[i*channels+c]);
+			}
+			break;
+		    case AUDIO_S16SYS: {
+			const Sint16 *s = (const Sint16 *)src + c;
+			for ( i=0; i<frames; ++i ) {
+				dst[i] = (float)s[i*channels];
+			}
+		    }
+			break;
+		    case AUDIO_F32SYS: {
+			const float *s = (const float *)src + c;
+			for ( i=0; i<frames; ++i ) {
+				dst[i] = s[i*channels];
+			}
+		    }
+			break;
+		    default: {
+			/* Other 16-bit formats, a byte at a time */
+			const Uint8 *s = src + c*2;
+			int hi = ((format & 0x1000) ? 0 : 1);
+			int bias = ((format & 0x8000) ? 0 : 32768);
+			int v;
+			for ( i=0; i<frames; ++i ) {
+				v = (s[hi] << 8) | s[hi^1];
+				if ( bias ) {
+					v -= bias;
+				} else if ( v >= 32768 ) {
+					v -= 65536;
+				}
+				dst[i] = (float)v;
+				s += channels*2;
+			}
+		    }
+			break;
+		}
+		/* The padding taps must see numbers, their weight is zero */
+		SDL_memset(dst + frames, 0, r->taps*sizeof(float));
+	}
+}
+
+static int SDL_ResampleClamp(float value, int lo, int hi)
+{
+	int v;
+
+	if ( value >= 0.0f ) {
+		v = (int)(value + 0.5f);
+	} else {
+		v = -(int)(0.5f - value);
+	}
+	if ( v < lo ) {
+		v = lo;
+	} else if ( v > hi ) {
+		v = hi;
+	}
+	return(v);
+}
+
+/* Filter every output frame the history allows, up to 'max_out' */
+static int SDL_RunResampler(SDL_Resampler *r, Uint8 *dst, int avail,
+					int max_out, Uint16 format)
+{
+	int channels = r->channels;
+	int out, c, v;
+	const float *row;
+	float value;
+
+	for ( out=0; out<max_out; ++out ) {
+		if ( r->first + 2*r->half > avail ) {
+			break;
+		}
+		row = r->bank + r->phase*r->taps;
+		for ( c=0; c<channels; ++c ) {
+			value = r->dot(row, r->planes + c*r->plane_len +
+			               r->first, r->taps);
+			switch (format) {
+			    case AUDIO_U8:
+				*dst++ = (Uint8)(SDL_ResampleClamp(value,
+							-128, 127) + 128);
+				break;
+			    case AUDIO_S8:
+				*dst++ = (Uint8)SDL_ResampleClamp(value,
+							-128, 127);
+				break;
+			    case AUDIO_S16SYS:
+				*(Sint16 *)dst = (Sint16)SDL_ResampleClamp(
+						value, -32768, 32767);
+				dst += 2;
+				break;
+			    case AUDIO_F32SYS:
+				/* Floats keep their headroom, no clipping */
+				*(float *)dst = value;
+				dst += 4;
+				break;
+			    default:
+				v = SDL_ResampleClamp(value, -32768, 32767);
+				if ( !(format & 0x8000) ) {
+					v += 32768;
+				}
+				if ( format & 0x1000 ) {
+					dst[0] = (Uint8)(v >> 8);
+					dst[1] = (Uint8)v;
+				} else {
+					dst[0] = (Uint8)v;
+					dst[1] = (Uint8)(v >> 8);
+				}
+				dst += 2;
+				break;
+			}
+		}
+		r->first += r->step_frames;
+		r->phase += r->step_phase;
+		if ( r->phase >= r->phases ) {
+			r->phase -= r->phases;
+			++r->first;
+		}
+	}
+	return(out);
+}
+
+/* Count the output frames centered on the input so far, which need
+   look ahead that hasn't come yet.
+ */
+static int SDL_ResampleTail(const SDL_Resampler *r)
+{
+	int first = r->first, phase = r->phase, n = 0;
+
+	while ( (first + r->half - 1)*r->phases + phase < r->kept*r->phases ) {
+		first += r->step_frames;
+		phase += r->step_phase;
+		if ( phase >= r->phases ) {
+			phase -= r->phases;
+			++first;
+		}
+		++n;
+	}
+	return(n);
+}
+
+/* Start over with silent history, as a new stream */
+static void SDL_RestartResampler(SDL_Resampler *r)
+{
+	int c;
+
+	for ( c=0; c<r->channels; ++c ) {
+		SDL_memset(r->planes + c*r->plane_len, 0,
+		           (r->half - 1)*sizeof(float));
+	}
+	r->kept = r->half - 1;
+	r->first = 0;
+	r->phase = 0;
+}
+
+/* Drop the history the next output frame doesn't need */
+static void SDL_ShiftResampler(SDL_Resampler *r, int avail)
+{
+	int drop, c;
+
+	drop = r->first;
+	if ( drop > avail ) {
+		drop = avail;
+	}
+	if ( drop > 0 ) {
+		for ( c=0; c<r->channels; ++c ) {
+			float *plane = r->planes + c*r->plane_len;
+			SDL_memmove(plane, plane + drop,
+			            (avail - drop)*sizeof(float));
+		}
+	}
+	r->kept = avail - drop;
+	r->first -= drop;
+}
+
+/* Convert the output frames held back for look ahead at the end of the
+   stream, as many as cvt->buf has room for.
+ */
+static void SDL_DrainResampler(SDL_Resampler *r, SDL_AudioCVT *cvt,
+					int size, Uint16 format)
+{
+	int tail, room, avail, out, c;
+
+	r->flushing = 0;
+	cvt->len_cvt = 0;
+	tail = SDL_ResampleTail(r);
+	if ( tail == 0 || SDL_GrowResampler(r, r->kept + r->half) < 0 ) {
+		return;
+	}
+
+	/* The room SDL_ConvertAudio() would have for cvt->len bytes */
+	room = (int)(cvt->len * r->in_ratio) / size;
+	room *= r->phases / r->step + 1;
+	if ( room > tail ) {
+		room = tail;
+	}
+
+	/* Silence after the end of the stream */
+	avail = r->kept + r->half;
+	for ( c=0; c<r->channels; ++c ) {
+		SDL_memset(r->planes + c*r->plane_len + r->kept, 0,
+		           (avail - r->kept + r->taps)*sizeof(float));
+	}
+	out = SDL_RunResampler(r, cvt->buf, avail, room, format);
+	if ( out == tail ) {
+		SDL_RestartResampler(r);
+	} else {
+		SDL_ShiftResampler(r, r->kept);
+	}
+	cvt->len_cvt = out * size;
+}
+
+static void SDL_Resample(SDL_AudioCVT *cvt, Uint16 format, int channels)
+{
+	SDL_Resampler *r;
+	int size, frames, avail, max_out, out;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Resampling audio * %4.4f\n", 1.0/cvt->rate_incr);
+#endif
+	r = SDL_GetResampler(cvt, channels);
+	if ( r ) {
+		size = ((format & 0xFF) / 8) * channels;
+		frames = cvt->len_cvt / size;
+		if ( r->flushing ) {
+			SDL_DrainResampler(r, cvt, size, format);
+		} else if ( SDL_GrowResampler(r, r->kept + frames) == 0 ) {
+			if ( cvt->len > 0 ) {
+				r->in_ratio = (double)cvt->len_cvt / cvt->len;
+			}
+			SDL_LoadResampler(r, cvt->buf, frames, format);
+			avail = r->kept + frames;
+
+			/* Never more than SDL_BuildResampler() made room for */
+			max_out = frames * (r->phases / r->step + 1);
+			out = SDL_RunResampler(r, cvt->buf, avail,
+			                       max_out, format);
+			SDL_ShiftResampler(r, avail);
+			cvt->len_cvt = out * size;
+		}
+		SDL_ReleaseResampler(r);
+	}
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* The stage has to know the channel count, when a copy of a conversion
+   shows up with no saved state.
+ */
+#define RESAMPLE_STAGE(n) \
+static void SDLCALL SDL_Resample_c##n(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	SDL_Resample(cvt, format, n); \
+}
+RESAMPLE_STAGE(1)
+RESAMPLE_STAGE(2)
+RESAMPLE_STAGE(3)
+RESAMPLE_STAGE(4)
+RESAMPLE_STAGE(5)
+RESAMPLE_STAGE(6)
+RESAMPLE_STAGE(7)
+RESAMPLE_STAGE(8)
+
+static void (SDLCALL *resample_stages[SDL_RESAMPLE_MAX_CHANNELS])
+				(SDL_AudioCVT *cvt, Uint16 format) = {
+	SDL_Resample_c1, SDL_Resample_c2, SDL_Resample_c3, SDL_Resample_c4,
+	SDL_Resample_c5, SDL_Resample_c6, SDL_Resample_c7, SDL_Resample_c8
+};
+
+int SDL_BuildResampler(SDL_AudioCVT *cvt, int channels,
+				int src_rate, int dst_rate)
+{
+	int num, den;
+
+	if ( channels < 1 || channels > SDL_RESAMPLE_MAX_CHANNELS ) {
+		SDL_SetError("Can't convert the rate of %d channel audio",
+		             channels);
+		return(-1);
+	}
+	cvt->rate_incr = (double)src_rate / dst_rate;
+	cvt->filters[cvt->filter_index++] = resample_stages[channels-1];
+
+	/* A few frames more than the ratio, depending on the history */
+	SDL_ResampleRatio(cvt->rate_incr, &num, &den);
+	cvt->len_mult *= den / num + 1;
+	cvt->len_ratio *= (double)dst_rate / src_rate;
+	return(0);
+}
+
+int SDL_FlushResampler(const SDL_AudioCVT *cvt)
+{
+	int i, found = 0;
+
+	SDL_LockResamplers();
+	for ( i=0; i<MAX_RESAMPLERS; ++i ) {
+		if ( resamplers[i] && resamplers[i]->cvt == cvt &&
+		     !resamplers[i]->busy ) {
+			resamplers[i]->flushing = 1;
+			found = 1;
+		}
+	}
+	SDL_UnlockResamplers();
+	return(found);
+}
+
+void SDL_ResetResampler(const SDL_AudioCVT *cvt)
+{
+	int i;
+
+	SDL_LockResamplers();
+	for ( i=0; i<MAX_RESAMPLERS; ++i ) {
+		if ( resamplers[i] && resamplers[i]->cvt == cvt ) {
+			if ( resamplers[i]->busy ) {
+				/* Let the old conversion finish, and the
+				   slot be taken over after that.
+				 */
+				resamplers[i]->cvt = NULL;
+			} else {
+				SDL_FreeResampler(resamplers[i]);
+				resamplers[i] = NULL;
+			}
+		}
+	}
+	SDL_UnlockResamplers();
+}
+
+int SDL_InitResampler(void)
+{
+	if ( resample_lock == NULL ) {
+		resample_lock = SDL_CreateMutex();
+		if ( resample_lock == NULL ) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+void SDL_QuitResampler(void)
+{
+	int i;
+
+	SDL_LockResamplers();
+	for ( i=0; i<MAX_RESAMPLERS; ++i ) {
+		if ( resamplers[i] && !resamplers[i]->busy ) {
+			SDL_FreeResampler(resamplers[i]);
+			resamplers[i] = NULL;
+		}
+	}
+	SDL_UnlockResamplers();
+
+	if ( resample_lock ) {
+		SDL_DestroyMutex(resample_lock);
+		resample_lock = NULL;
+	}
+}
@@ -0,0 +1,71 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_audioresample_c_h
+#define _SDL_audioresample_c_h
+
+/* Band-limited rate conversion for SDL_BuildAudioCVT().
+
+   The resampler is a windowed sinc filter, precomputed for every phase
+   of the rate ratio.  It keeps the last input samples of each conversion,
+   so a stream converted a buffer at a time has no seams.  That history
+   can't live in SDL_AudioCVT without breaking binary compatibility, so
+   it is kept here and found by the address of the SDL_AudioCVT, for the
+   few most recently used conversions.  A conversion that was pushed out
+   just starts over with silent history.
+
+   The number of frames out of each SDL_ConvertAudio() call varies by one
+   or so from call to call, as the filter needs a few frames of look ahead.
+   The frames waiting for look ahead at the end of a stream only come out
+   of SDL_FlushAudioCVT(), which runs the filter over silence after them.
+*/
+
+#include "SDL_audio.h"
+
+/* The most channels the resampler handles */
+#define SDL_RESAMPLE_MAX_CHANNELS	8
+
+/* Add a stage converting 'channels' channels of audio from 'src_rate' to
+   'dst_rate' to the filters of 'cvt'.
+   This returns 0, or -1 if the channel count isn't supported.
+*/
+extern int SDL_BuildResampler(SDL_AudioCVT *cvt, int channels,
+					int src_rate, int dst_rate);
+
+/* Have the next run of the conversion at 'cvt' put out the frames held
+   back at the end of its stream instead of converting any input, then
+   start a new stream.
+   This returns 1, or 0 if no history is kept for 'cvt'.
+*/
+extern int SDL_FlushResampler(const SDL_AudioCVT *cvt);
+
+/* Forget the history kept for the SDL_AudioCVT at 'cvt', which is being
+   built for a new stream.
+*/
+extern void SDL_ResetResampler(const SDL_AudioCVT *cvt);
+
+/* Create the lock for the saved resampler state, or free it all */
+extern int SDL_InitResampler(void);
+extern void SDL_QuitResampler(void);
+
+#endif /* _SDL_audioresample_c_h */
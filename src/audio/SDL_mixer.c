@@ -30,6 +30,7 @@
 #include "SDL_mixer_MMX.h"
 #include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
+#include "SDL_mixer_SSE2.h"
 
 /* This table is used to add two sound values together and pin
  * the value to avoid overflow.  (used with permission from ARDI)
@@ -90,6 +91,103 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
+/* Mix whole vectors with SSE2 first, leaving the rest to the C loop */
+#if SDL_SSE2_INTRINSICS
+#define MIX_SSE2(mix) \
+	if ( volume <= SDL_MIX_MAXVOLUME && SDL_HasSSE2() ) { \
+		Uint32 done = mix; \
+		dst += done; \
+		src += done; \
+		len -= done; \
+	}
+#else
+#define MIX_SSE2(mix)
+#endif
+
+/* 32-bit samples, in either byte order */
+typedef union {
+	Uint32 u;
+	float f;
+} SDL_MixBits;
+
+static Uint32 SDL_MixGet32(const Uint8 *p, int big)
+{
+	if ( big ) {
+		return(((Uint32)p[0] << 24) | ((Uint32)p[1] << 16) |
+		       ((Uint32)p[2] << 8) | p[3]);
+	}
+	return(((Uint32)p[3] << 24) | ((Uint32)p[2] << 16) |
+	       ((Uint32)p[1] << 8) | p[0]);
+}
+
+static void SDL_MixPut32(Uint8 *p, Uint32 value, int big)
+{
+	if ( big ) {
+		p[0] = (Uint8)(value >> 24);
+		p[1] = (Uint8)(value >> 16);
+		p[2] = (Uint8)(value >> 8);
+		p[3] = (Uint8)value;
+	} else {
+		p[3] = (Uint8)(value >> 24);
+		p[2] = (Uint8)(value >> 16);
+		p[1] = (Uint8)(value >> 8);
+		p[0] = (Uint8)value;
+	}
+}
+
+/* Floats pass through unchanged up to SDL_MIX_KNEE, and above it bend
+   smoothly towards full scale instead of clipping hard.
+ */
+static float SDL_MixSoftClip(float sample)
+{
+	float over;
+
+	if ( sample > SDL_MIX_KNEE ) {
+		over = (sample - SDL_MIX_KNEE) * (1.0f / (1.0f - SDL_MIX_KNEE));
+		return(SDL_MIX_KNEE +
+		       (1.0f - SDL_MIX_KNEE) * (over / (1.0f + over)));
+	}
+	if ( sample < -SDL_MIX_KNEE ) {
+		over = (-sample - SDL_MIX_KNEE) * (1.0f / (1.0f - SDL_MIX_KNEE));
+		return(-(SDL_MIX_KNEE +
+		         (1.0f - SDL_MIX_KNEE) * (over / (1.0f + over))));
+	}
+	return(sample);
+}
+
+/* Add a 32-bit integer sample at 'volume', clipped to the full range */
+static Sint32 SDL_MixS32(Sint32 dst, Sint32 src, int volume)
+{
+	double sample;
+
+	sample = (double)src * volume / SDL_MIX_MAXVOLUME;
+	if ( sample > -2147483648.0 && sample < 2147483648.0 ) {
+		/* Rounded toward zero, like the other integer formats */
+		sample = (double)(Sint32)sample;
+	}
+	sample += dst;
+	if ( sample > 2147483647.0 ) {
+		return(2147483647);
+	}
+	if ( sample < -2147483648.0 ) {
+		return(-2147483647-1);
+	}
+	return((Sint32)sample);
+}
+
+/* The user-level audio format */
+static Uint16 SDL_MixFormat(void)
+{
+	if ( current_audio ) {
+		if ( current_audio->convert.needed ) {
+			return(current_audio->convert.src_format);
+		}
+		return(current_audio->spec.format);
+	}
+	/* HACK HACK HACK */
+	return(AUDIO_S16);
+}
+
 void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
 	Uint16 format;
@@ -98,16 +196,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		return;
 	}
 	/* Mix the user-level audio format */
-	if ( current_audio ) {
-		if ( current_audio->convert.needed ) {
-			format = current_audio->convert.src_format;
-		} else {
-			format = current_audio->spec.format;
-		}
-	} else {
-  		/* HACK HACK HACK */
-		format = AUDIO_S16;
-	}
+	format = SDL_MixFormat();
 	switch (format) {
 
 		case AUDIO_U8: {
@@ -116,6 +205,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 #else
 			Uint8 src_sample;
 
+			MIX_SSE2(SDL_MixAudio_SSE2_U8(dst, src, len, volume))
 			while ( len-- ) {
 				src_sample = *src;
 				ADJUST_VOLUME_U8(src_sample, volume);
@@ -154,6 +244,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(8-1))-1);
 			const int min_audioval = -(1<<(8-1));
 
+			MIX_SSE2(SDL_MixAudio_SSE2_S8(dst, src, len, volume))
 			src8 = (Sint8 *)src;
 			dst8 = (Sint8 *)dst;
 			while ( len-- ) {
@@ -202,6 +293,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
+			MIX_SSE2(SDL_MixAudio_SSE2_S16(dst, src, len, volume, 0))
 			len /= 2;
 			while ( len-- ) {
 				src1 = ((src[1])<<8|src[0]);
@@ -234,6 +326,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
+			MIX_SSE2(SDL_MixAudio_SSE2_S16(dst, src, len, volume, 1))
 			len /= 2;
 			while ( len-- ) {
 				src1 = ((src[0])<<8|src[1]);
@@ -256,9 +349,243 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		}
 		break;
 
+		case AUDIO_S32LSB:
+		case AUDIO_S32MSB: {
+			const int big = (format == AUDIO_S32MSB);
+			Sint32 sample;
+
+			len /= 4;
+			while ( len-- ) {
+				sample = SDL_MixS32((Sint32)SDL_MixGet32(dst, big),
+				                    (Sint32)SDL_MixGet32(src, big),
+				                    volume);
+				SDL_MixPut32(dst, (Uint32)sample, big);
+				src += 4;
+				dst += 4;
+			}
+		}
+		break;
+
+		case AUDIO_F32LSB:
+		case AUDIO_F32MSB: {
+			const int big = (format == AUDIO_F32MSB);
+			const float scale = (float)volume / SDL_MIX_MAXVOLUME;
+			SDL_MixBits src_sample, dst_sample;
+
+			if ( format == AUDIO_F32SYS ) {
+				MIX_SSE2(SDL_MixAudio_SSE2_F32(dst, src, len, volume))
+			}
+			len /= 4;
+			while ( len-- ) {
+				src_sample.u = SDL_MixGet32(src, big);
+				dst_sample.u = SDL_MixGet32(dst, big);
+				dst_sample.f = SDL_MixSoftClip(dst_sample.f +
+				                               src_sample.f * scale);
+				SDL_MixPut32(dst, dst_sample.u, big);
+				src += 4;
+				dst += 4;
+			}
+		}
+		break;
+
 		default: /* If this happens... FIXME! */
 			SDL_SetError("SDL_MixAudio(): unknown audio format");
 			return;
 	}
 }
 
+#define MIX_BLOCK	256	/* Samples summed at a time */
+
+/* Running sums for each kind of format */
+typedef union {
+	Sint32 i[MIX_BLOCK];	/* 8 and 16-bit */
+	float f[MIX_BLOCK];	/* AUDIO_F32 */
+	double d[MIX_BLOCK];	/* AUDIO_S32 */
+} SDL_MixSums;
+
+/* Add 'samples' samples at 'volume' to the sums, the way SDL_MixAudio()
+   adjusts the volume.  8-bit samples are summed as signed values.
+ */
+static void SDL_MixSum(SDL_MixSums *sum, const Uint8 *src, int samples,
+					int volume, Uint16 format)
+{
+	int i = 0;
+
+#if SDL_SSE2_INTRINSICS
+	if ( volume <= SDL_MIX_MAXVOLUME && SDL_HasSSE2() ) {
+		switch (format) {
+		    case AUDIO_U8:
+		    case AUDIO_S8:
+			i = SDL_MixSum_SSE2_S8(sum->i, src, samples, volume,
+			                       (format == AUDIO_U8));
+			break;
+		    case AUDIO_S16LSB:
+		    case AUDIO_S16MSB:
+			i = SDL_MixSum_SSE2_S16(sum->i, src, samples, volume,
+			                        (format == AUDIO_S16MSB));
+			break;
+		    case AUDIO_F32SYS:
+			i = SDL_MixSum_SSE2_F32(sum->f, src, samples, volume);
+			break;
+		}
+	}
+#endif
+	switch (format) {
+	    case AUDIO_U8:
+		for ( ; i<samples; ++i ) {
+			sum->i[i] += (((int)src[i] - 128) * volume) / SDL_MIX_MAXVOLUME;
+		}
+		break;
+	    case AUDIO_S8:
+		for ( ; i<samples; ++i ) {
+			sum->i[i] += ((Sint8)src[i] * volume) / SDL_MIX_MAXVOLUME;
+		}
+		break;
+	    case AUDIO_S16LSB:
+		for ( ; i<samples; ++i ) {
+			Sint16 sample = (Sint16)((src[i*2+1] << 8) | src[i*2]);
+			sum->i[i] += (sample * volume) / SDL_MIX_MAXVOLUME;
+		}
+		break;
+	    case AUDIO_S16MSB:
+		for ( ; i<samples; ++i ) {
+			Sint16 sample = (Sint16)((src[i*2] << 8) | src[i*2+1]);
+			sum->i[i] += (sample * volume) / SDL_MIX_MAXVOLUME;
+		}
+		break;
+	    case AUDIO_S32LSB:
+	    case AUDIO_S32MSB:
+		for ( ; i<samples; ++i ) {
+			sum->d[i] += SDL_MixS32(0, (Sint32)SDL_MixGet32(src+i*4,
+			                        (format == AUDIO_S32MSB)), volume);
+		}
+		break;
+	    case AUDIO_F32LSB:
+	    case AUDIO_F32MSB: {
+		const float scale = (float)volume / SDL_MIX_MAXVOLUME;
+		SDL_MixBits sample;
+
+		for ( ; i<samples; ++i ) {
+			sample.u = SDL_MixGet32(src+i*4, (format == AUDIO_F32MSB));
+			sum->f[i] += sample.f * scale;
+		}
+	    }
+		break;
+	}
+}
+
+/* Clip the sums and write them out, the top of U8 is 0xFE like mix8[] */
+#define MIX_CLIP(sample, lo, hi) \
+	(sample > hi ? hi : (sample < lo ? lo : sample))
+
+static void SDL_MixStore(Uint8 *dst, const SDL_MixSums *sum, int samples,
+					Uint16 format)
+{
+	Sint32 sample;
+	int i = 0;
+
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		if ( format == AUDIO_F32SYS ) {
+			i = SDL_MixStore_SSE2_F32(dst, sum->f, samples);
+		} else if ( (format & 0xFF) <= 16 ) {
+			i = SDL_MixStore_SSE2(dst, sum->i, samples, format);
+		}
+	}
+#endif
+	switch (format) {
+	    case AUDIO_U8:
+		for ( ; i<samples; ++i ) {
+			sample = MIX_CLIP(sum->i[i], -128, 126);
+			dst[i] = (Uint8)(sample + 128);
+		}
+		break;
+	    case AUDIO_S8:
+		for ( ; i<samples; ++i ) {
+			sample = MIX_CLIP(sum->i[i], -128, 127);
+			dst[i] = (Uint8)sample;
+		}
+		break;
+	    case AUDIO_S16LSB:
+		for ( ; i<samples; ++i ) {
+			sample = MIX_CLIP(sum->i[i], -32768, 32767);
+			dst[i*2] = (Uint8)sample;
+			dst[i*2+1] = (Uint8)(sample >> 8);
+		}
+		break;
+	    case AUDIO_S16MSB:
+		for ( ; i<samples; ++i ) {
+			sample = MIX_CLIP(sum->i[i], -32768, 32767);
+			dst[i*2] = (Uint8)(sample >> 8);
+			dst[i*2+1] = (Uint8)sample;
+		}
+		break;
+	    case AUDIO_S32LSB:
+	    case AUDIO_S32MSB:
+		for ( ; i<samples; ++i ) {
+			double value = MIX_CLIP(sum->d[i],
+			                        -2147483648.0, 2147483647.0);
+			SDL_MixPut32(dst+i*4, (Uint32)(Sint32)value,
+			             (format == AUDIO_S32MSB));
+		}
+		break;
+	    case AUDIO_F32LSB:
+	    case AUDIO_F32MSB: {
+		SDL_MixBits value;
+
+		for ( ; i<samples; ++i ) {
+			value.f = SDL_MixSoftClip(sum->f[i]);
+			SDL_MixPut32(dst+i*4, value.u, (format == AUDIO_F32MSB));
+		}
+	    }
+		break;
+	}
+}
+
+void SDL_MixAudioMulti (Uint8 *dst, const Uint8 **src, const int *volume,
+						int num_src, Uint32 len)
+{
+	SDL_MixSums sum;
+	Uint16 format;
+	int size, samples, n, i, j;
+
+	format = SDL_MixFormat();
+	switch (format) {
+	    case AUDIO_U8:
+	    case AUDIO_S8:
+		size = 1;
+		break;
+	    case AUDIO_S16LSB:
+	    case AUDIO_S16MSB:
+		size = 2;
+		break;
+	    case AUDIO_S32LSB:
+	    case AUDIO_S32MSB:
+	    case AUDIO_F32LSB:
+	    case AUDIO_F32MSB:
+		size = 4;
+		break;
+	    default:
+		SDL_SetError("SDL_MixAudioMulti(): unknown audio format");
+		return;
+	}
+
+	/* The destination is read and written once, a block at a time */
+	samples = len / size;
+	for ( i=0; i<samples; i+=n ) {
+		n = samples - i;
+		if ( n > MIX_BLOCK ) {
+			n = MIX_BLOCK;
+		}
+		/* Zero enough for the widest kind of sum */
+		SDL_memset(&sum, 0, n*sizeof(sum.d[0]));
+		SDL_MixSum(&sum, dst + i*size, n, SDL_MIX_MAXVOLUME, format);
+		for ( j=0; j<num_src; ++j ) {
+			if ( src[j] && volume[j] ) {
+				SDL_MixSum(&sum, src[j] + i*size, n,
+				           volume[j], format);
+			}
+		}
+		SDL_MixStore(dst + i*size, &sum, n, format);
+	}
+}
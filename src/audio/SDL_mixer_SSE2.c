@@ -0,0 +1,302 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* SSE2 mixing, see SDL_mixer_SSE2.h */
+
+#include "SDL_mixer_SSE2.h"
+
+#if SDL_SSE2_INTRINSICS
+
+#define SWAP16(x)	_mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8))
+
+/* x/SDL_MIX_MAXVOLUME, rounded toward zero like C division */
+#define DIVIDE32(x)	_mm_srai_epi32(_mm_add_epi32(x, \
+			_mm_and_si128(_mm_srai_epi32(x, 31), round32)), 7)
+#define DIVIDE16(x)	_mm_srai_epi16(_mm_add_epi16(x, \
+			_mm_and_si128(_mm_srai_epi16(x, 15), round16)), 7)
+
+/* The 32-bit products of eight 16-bit samples and the volume */
+#define MULTIPLY16(s, lo, hi) \
+{ \
+	__m128i l = _mm_mullo_epi16(s, vol); \
+	__m128i h = _mm_mulhi_epi16(s, vol); \
+	lo = _mm_unpacklo_epi16(l, h); \
+	hi = _mm_unpackhi_epi16(l, h); \
+}
+
+/* Sixteen 8-bit signed samples times the volume, divided back down */
+#define SCALE8(s) \
+{ \
+	__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8); \
+	__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8); \
+	lo = _mm_mullo_epi16(lo, vol); \
+	hi = _mm_mullo_epi16(hi, vol); \
+	s = _mm_packs_epi16(DIVIDE16(lo), DIVIDE16(hi)); \
+}
+
+SDL_TARGETING("sse2")
+Uint32 SDL_MixAudio_SSE2_S16(Uint8 *dst, const Uint8 *src,
+				Uint32 len, int volume, int swap)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i round32 = _mm_set1_epi32(SDL_MIX_MAXVOLUME-1);
+	__m128i s, d, lo, hi;
+	Uint32 i, n = (len & ~15);
+
+	for ( i=0; i<n; i+=16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		d = _mm_loadu_si128((const __m128i *)(dst+i));
+		if ( swap ) {
+			s = SWAP16(s);
+			d = SWAP16(d);
+		}
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			MULTIPLY16(s, lo, hi);
+			s = _mm_packs_epi32(DIVIDE32(lo), DIVIDE32(hi));
+		}
+		d = _mm_adds_epi16(d, s);
+		if ( swap ) {
+			d = SWAP16(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst+i), d);
+	}
+	return(n);
+}
+
+SDL_TARGETING("sse2")
+Uint32 SDL_MixAudio_SSE2_S8(Uint8 *dst, const Uint8 *src,
+				Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i round16 = _mm_set1_epi16(SDL_MIX_MAXVOLUME-1);
+	__m128i s, d;
+	Uint32 i, n = (len & ~15);
+
+	for ( i=0; i<n; i+=16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		d = _mm_loadu_si128((const __m128i *)(dst+i));
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			SCALE8(s);
+		}
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_adds_epi8(d, s));
+	}
+	return(n);
+}
+
+/* The C version clips to 0xFE at the top, so this does too */
+SDL_TARGETING("sse2")
+Uint32 SDL_MixAudio_SSE2_U8(Uint8 *dst, const Uint8 *src,
+				Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i round16 = _mm_set1_epi16(SDL_MIX_MAXVOLUME-1);
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+	const __m128i top = _mm_set1_epi8((char)0xFE);
+	__m128i s, d;
+	Uint32 i, n = (len & ~15);
+
+	for ( i=0; i<n; i+=16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		d = _mm_loadu_si128((const __m128i *)(dst+i));
+		s = _mm_xor_si128(s, bias);
+		d = _mm_xor_si128(d, bias);
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			SCALE8(s);
+		}
+		d = _mm_xor_si128(_mm_adds_epi8(d, s), bias);
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_min_epu8(d, top));
+	}
+	return(n);
+}
+
+SDL_TARGETING("sse2")
+int SDL_MixSum_SSE2_S16(Sint32 *sum, const Uint8 *src,
+				int samples, int volume, int swap)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i round32 = _mm_set1_epi32(SDL_MIX_MAXVOLUME-1);
+	__m128i s, lo, hi;
+	int i, n = (samples & ~7);
+
+	for ( i=0; i<n; i+=8 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i*2));
+		if ( swap ) {
+			s = SWAP16(s);
+		}
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			MULTIPLY16(s, lo, hi);
+			lo = DIVIDE32(lo);
+			hi = DIVIDE32(hi);
+		} else {
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+		}
+		lo = _mm_add_epi32(lo, _mm_loadu_si128((__m128i *)(sum+i)));
+		hi = _mm_add_epi32(hi, _mm_loadu_si128((__m128i *)(sum+i+4)));
+		_mm_storeu_si128((__m128i *)(sum+i), lo);
+		_mm_storeu_si128((__m128i *)(sum+i+4), hi);
+	}
+	return(n);
+}
+
+SDL_TARGETING("sse2")
+int SDL_MixSum_SSE2_S8(Sint32 *sum, const Uint8 *src,
+				int samples, int volume, int is_unsigned)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i round16 = _mm_set1_epi16(SDL_MIX_MAXVOLUME-1);
+	const __m128i bias = _mm_set1_epi8((char)(is_unsigned ? 0x80 : 0));
+	__m128i s, lo, hi, x;
+	int i, n = (samples & ~15);
+
+	for ( i=0; i<n; i+=16 ) {
+		s = _mm_loadu_si128((const __m128i *)(src+i));
+		s = _mm_xor_si128(s, bias);
+		lo = _mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8);
+		hi = _mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8);
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			lo = DIVIDE16(_mm_mullo_epi16(lo, vol));
+			hi = DIVIDE16(_mm_mullo_epi16(hi, vol));
+		}
+		x = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+		x = _mm_add_epi32(x, _mm_loadu_si128((__m128i *)(sum+i)));
+		_mm_storeu_si128((__m128i *)(sum+i), x);
+		x = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+		x = _mm_add_epi32(x, _mm_loadu_si128((__m128i *)(sum+i+4)));
+		_mm_storeu_si128((__m128i *)(sum+i+4), x);
+		x = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+		x = _mm_add_epi32(x, _mm_loadu_si128((__m128i *)(sum+i+8)));
+		_mm_storeu_si128((__m128i *)(sum+i+8), x);
+		x = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+		x = _mm_add_epi32(x, _mm_loadu_si128((__m128i *)(sum+i+12)));
+		_mm_storeu_si128((__m128i *)(sum+i+12), x);
+	}
+	return(n);
+}
+
+/* The packs saturate, which clips the same as the C version */
+SDL_TARGETING("sse2")
+int SDL_MixStore_SSE2(Uint8 *dst, const Sint32 *sum,
+				int samples, Uint16 format)
+{
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+	const __m128i top = _mm_set1_epi8((char)0xFE);
+	__m128i a, b;
+	int i, n;
+
+	if ( (format & 0xFF) == 16 ) {
+		n = (samples & ~7);
+		for ( i=0; i<n; i+=8 ) {
+			a = _mm_packs_epi32(
+				_mm_loadu_si128((const __m128i *)(sum+i)),
+				_mm_loadu_si128((const __m128i *)(sum+i+4)));
+			if ( format == AUDIO_S16MSB ) {
+				a = SWAP16(a);
+			}
+			_mm_storeu_si128((__m128i *)(dst+i*2), a);
+		}
+	} else {
+		n = (samples & ~15);
+		for ( i=0; i<n; i+=16 ) {
+			a = _mm_packs_epi32(
+				_mm_loadu_si128((const __m128i *)(sum+i)),
+				_mm_loadu_si128((const __m128i *)(sum+i+4)));
+			b = _mm_packs_epi32(
+				_mm_loadu_si128((const __m128i *)(sum+i+8)),
+				_mm_loadu_si128((const __m128i *)(sum+i+12)));
+			a = _mm_packs_epi16(a, b);
+			if ( format == AUDIO_U8 ) {
+				a = _mm_min_epu8(_mm_xor_si128(a, bias), top);
+			}
+			_mm_storeu_si128((__m128i *)(dst+i), a);
+		}
+	}
+	return(n);
+}
+
+/* SDL_MixSoftClip() on four floats */
+#define SOFTCLIP_CONSTANTS \
+	const __m128 sign = _mm_set1_ps(-0.0f); \
+	const __m128 one = _mm_set1_ps(1.0f); \
+	const __m128 knee = _mm_set1_ps(SDL_MIX_KNEE); \
+	const __m128 range = _mm_set1_ps(1.0f - SDL_MIX_KNEE); \
+	const __m128 inv_range = _mm_set1_ps(1.0f / (1.0f - SDL_MIX_KNEE))
+#define SOFTCLIP(x) \
+{ \
+	__m128 a = _mm_andnot_ps(sign, x); \
+	__m128 t = _mm_mul_ps(_mm_sub_ps(a, knee), inv_range); \
+	__m128 over = _mm_cmpgt_ps(a, knee); \
+	t = _mm_add_ps(knee, _mm_mul_ps(range, \
+		_mm_div_ps(t, _mm_add_ps(one, t)))); \
+	t = _mm_or_ps(t, _mm_and_ps(sign, x)); \
+	x = _mm_or_ps(_mm_and_ps(over, t), _mm_andnot_ps(over, x)); \
+}
+
+SDL_TARGETING("sse2")
+Uint32 SDL_MixAudio_SSE2_F32(Uint8 *dst, const Uint8 *src,
+				Uint32 len, int volume)
+{
+	SOFTCLIP_CONSTANTS;
+	const __m128 scale = _mm_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	__m128 x;
+	Uint32 i, n = (len & ~15);
+
+	for ( i=0; i<n; i+=16 ) {
+		x = _mm_mul_ps(_mm_loadu_ps((const float *)(src+i)), scale);
+		x = _mm_add_ps(_mm_loadu_ps((const float *)(dst+i)), x);
+		SOFTCLIP(x);
+		_mm_storeu_ps((float *)(dst+i), x);
+	}
+	return(n);
+}
+
+SDL_TARGETING("sse2")
+int SDL_MixSum_SSE2_F32(float *sum, const Uint8 *src, int samples, int volume)
+{
+	const __m128 scale = _mm_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	__m128 x;
+	int i, n = (samples & ~3);
+
+	for ( i=0; i<n; i+=4 ) {
+		x = _mm_mul_ps(_mm_loadu_ps((const float *)src+i), scale);
+		_mm_storeu_ps(sum+i, _mm_add_ps(_mm_loadu_ps(sum+i), x));
+	}
+	return(n);
+}
+
+SDL_TARGETING("sse2")
+int SDL_MixStore_SSE2_F32(Uint8 *dst, const float *sum, int samples)
+{
+	SOFTCLIP_CONSTANTS;
+	__m128 x;
+	int i, n = (samples & ~3);
+
+	for ( i=0; i<n; i+=4 ) {
+		x = _mm_loadu_ps(sum+i);
+		SOFTCLIP(x);
+		_mm_storeu_ps((float *)dst+i, x);
+	}
+	return(n);
+}
+
+#endif /* SDL_SSE2_INTRINSICS */
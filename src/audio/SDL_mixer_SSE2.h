@@ -0,0 +1,66 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* SSE2 versions of SDL_MixAudio() and SDL_MixAudioMulti()
+
+   These give exactly the same samples as the C loops in SDL_mixer.c, for
+   volumes up to SDL_MIX_MAXVOLUME.  Each one does as many bytes as fit in
+   whole vectors and returns how many that was, leaving the rest to C.
+ */
+
+#include "SDL_audio.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
+
+/* Float audio mixes linearly up to this level, and is soft clipped
+   above it, in both the C and SSE2 versions.
+ */
+#define SDL_MIX_KNEE	0.75f
+
+#if SDL_SSE2_INTRINSICS
+
+extern Uint32 SDL_MixAudio_SSE2_S16(Uint8 *dst, const Uint8 *src,
+					Uint32 len, int volume, int swap);
+extern Uint32 SDL_MixAudio_SSE2_S8(Uint8 *dst, const Uint8 *src,
+					Uint32 len, int volume);
+extern Uint32 SDL_MixAudio_SSE2_U8(Uint8 *dst, const Uint8 *src,
+					Uint32 len, int volume);
+
+/* Add 'samples' 16-bit samples at 'volume' to the sums */
+extern int SDL_MixSum_SSE2_S16(Sint32 *sum, const Uint8 *src,
+					int samples, int volume, int swap);
+extern int SDL_MixSum_SSE2_S8(Sint32 *sum, const Uint8 *src,
+					int samples, int volume, int is_unsigned);
+
+/* Clip the sums and write them out in 'format' */
+extern int SDL_MixStore_SSE2(Uint8 *dst, const Sint32 *sum,
+					int samples, Uint16 format);
+
+/* The same for native floats, with soft clipping */
+extern Uint32 SDL_MixAudio_SSE2_F32(Uint8 *dst, const Uint8 *src,
+					Uint32 len, int volume);
+extern int SDL_MixSum_SSE2_F32(float *sum, const Uint8 *src,
+					int samples, int volume);
+extern int SDL_MixStore_SSE2_F32(Uint8 *dst, const float *sum,
+					int samples);
+
+#endif /* SDL_SSE2_INTRINSICS */
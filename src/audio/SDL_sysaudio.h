@@ -70,6 +70,15 @@ struct SDL_AudioDevice {
 	/* An audio conversion block for audio format emulation */
 	SDL_AudioCVT convert;
 
+	/* Converted audio waiting to be played, when resampling makes a
+	   little more or less than a buffer at a time */
+	Uint8 *convert_fifo;
+	int convert_fifo_len;
+	int convert_fifo_max;
+
+	/* Set by drivers that take AUDIO_S32 and AUDIO_F32 formats */
+	int wide_formats;
+
 	/* Current state flags */
 	int enabled;
 	int paused;
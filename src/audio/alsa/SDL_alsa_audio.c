@@ -238,6 +238,7 @@ static SDL_AudioDevice *Audio_CreateDevice(int devindex)
 	this->PlayAudio = ALSA_PlayAudio;
 	this->GetAudioBuf = ALSA_GetAudioBuf;
 	this->CloseAudio = ALSA_CloseAudio;
+	this->wide_formats = 1;
 
 	this->free = Audio_DeleteDevice;
 
@@ -540,6 +541,18 @@ static int ALSA_OpenAudio(_THIS, SDL_AudioSpec *spec)
 			case AUDIO_U16MSB:
 				format = SND_PCM_FORMAT_U16_BE;
 				break;
+			case AUDIO_S32LSB:
+				format = SND_PCM_FORMAT_S32_LE;
+				break;
+			case AUDIO_S32MSB:
+				format = SND_PCM_FORMAT_S32_BE;
+				break;
+			case AUDIO_F32LSB:
+				format = SND_PCM_FORMAT_FLOAT_LE;
+				break;
+			case AUDIO_F32MSB:
+				format = SND_PCM_FORMAT_FLOAT_BE;
+				break;
 			default:
 				format = 0;
 				break;
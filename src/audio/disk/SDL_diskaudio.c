@@ -105,6 +105,7 @@ static SDL_AudioDevice *DISKAUD_CreateDevice(int devindex)
 	this->PlayAudio = DISKAUD_PlayAudio;
 	this->GetAudioBuf = DISKAUD_GetAudioBuf;
 	this->CloseAudio = DISKAUD_CloseAudio;
+	this->wide_formats = 1;
 
 	this->free = DISKAUD_DeleteDevice;
 
@@ -25,6 +25,7 @@
 
 #include "SDL.h"
 #include "SDL_cpuinfo.h"
+#include "SDL_cpuinfo_c.h"
 
 #if defined(__MACOSX__) && (defined(__ppc__) || defined(__ppc64__))
 #include <sys/sysctl.h> /* For AltiVec check */
@@ -37,6 +38,10 @@
 #include <setjmp.h>
 #endif
 
+#if defined(_MSC_VER) && (_MSC_VER >= 1600) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h> /* For __cpuidex() and _xgetbv() */
+#endif
+
 #if defined(__QNXNTO__)
 #include <sys/syspage.h>
 #endif
@@ -79,6 +84,8 @@
 #define CPU_HAS_ALTIVEC	0x00000100
 #define CPU_HAS_ARM_SIMD 0x00000200
 #define CPU_HAS_NEON     0x00000400
+#define CPU_HAS_AVX2     0x00000800
+#define CPU_HAS_SSSE3    0x00001000
 
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__ && !__OpenBSD__
 /* This is the brute force way of detecting instruction sets...
@@ -339,6 +346,46 @@ done:
 	return features;
 }
 
+/* Run CPUID with the given leaf and subleaf, the caller checks CPUID support */
+static __inline__ void CPU_getCPUIDRegs(int func, int subfunc, int regs[4])
+{
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#if defined(__GNUC__) && defined(__i386__)
+	__asm__ (
+"        pushl   %%ebx                                                 \n"
+"        cpuid                                                         \n"
+"        movl    %%ebx,%%esi                                           \n"
+"        popl    %%ebx                                                 \n"
+	: "=a" (regs[0]), "=S" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+	: "a" (func), "c" (subfunc)
+	);
+#elif defined(__GNUC__) && defined(__x86_64__)
+	__asm__ (
+"        pushq   %%rbx                                                 \n"
+"        cpuid                                                         \n"
+"        movl    %%ebx,%%esi                                           \n"
+"        popq    %%rbx                                                 \n"
+	: "=a" (regs[0]), "=S" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+	: "a" (func), "c" (subfunc)
+	);
+#elif defined(_MSC_VER) && (_MSC_VER >= 1600) && (defined(_M_IX86) || defined(_M_X64))
+	__cpuidex(regs, func, subfunc);
+#endif
+}
+
+/* Read XCR0 to see which register states the OS saves on context switch */
+static __inline__ Uint32 CPU_getXCR0(void)
+{
+	Uint32 xcr0 = 0;
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	Uint32 edx;
+	__asm__ (".byte 0x0f, 0x01, 0xd0" : "=a" (xcr0), "=d" (edx) : "c" (0));
+#elif defined(_MSC_VER) && (_MSC_VER >= 1600) && (defined(_M_IX86) || defined(_M_X64))
+	xcr0 = (Uint32)_xgetbv(0);
+#endif
+	return xcr0;
+}
+
 static __inline__ int CPU_haveRDTSC(void)
 {
 	if ( CPU_haveCPUID() ) {
@@ -395,6 +442,44 @@ static __inline__ int CPU_haveSSE2(void)
 	return 0;
 }
 
+static __inline__ int CPU_haveSSSE3(void)
+{
+	if ( CPU_haveCPUID() ) {
+		int regs[4];
+
+		CPU_getCPUIDRegs(0, 0, regs);
+		if ( regs[0] < 1 ) {
+			return 0;
+		}
+		CPU_getCPUIDRegs(1, 0, regs);
+		return (regs[2] & 0x00000200);
+	}
+	return 0;
+}
+
+static __inline__ int CPU_haveAVX2(void)
+{
+	if ( CPU_haveCPUID() ) {
+		int regs[4];
+
+		CPU_getCPUIDRegs(0, 0, regs);
+		if ( regs[0] < 7 ) {
+			return 0;
+		}
+		/* The OS must use XSAVE and preserve the SSE and AVX state */
+		CPU_getCPUIDRegs(1, 0, regs);
+		if ( (regs[2] & 0x18000000) != 0x18000000 ) {
+			return 0;
+		}
+		if ( (CPU_getXCR0() & 0x00000006) != 0x00000006 ) {
+			return 0;
+		}
+		CPU_getCPUIDRegs(7, 0, regs);
+		return (regs[1] & 0x00000020);
+	}
+	return 0;
+}
+
 static __inline__ int CPU_haveAltiVec(void)
 {
 	volatile int altivec = 0;
@@ -597,6 +682,12 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveSSE2() ) {
 			SDL_CPUFeatures |= CPU_HAS_SSE2;
 		}
+		if ( CPU_haveSSSE3() ) {
+			SDL_CPUFeatures |= CPU_HAS_SSSE3;
+		}
+		if ( CPU_haveAVX2() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX2;
+		}
 		if ( CPU_haveAltiVec() ) {
 			SDL_CPUFeatures |= CPU_HAS_ALTIVEC;
 		}
@@ -666,6 +757,22 @@ SDL_bool SDL_HasSSE2(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasSSSE3(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_SSSE3 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasAVX2(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX2 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 SDL_bool SDL_HasAltiVec(void)
 {
 	if ( SDL_GetCPUFeatures() & CPU_HAS_ALTIVEC ) {
@@ -703,6 +810,8 @@ int main()
 	printf("3DNowExt: %d\n", SDL_Has3DNowExt());
 	printf("SSE: %d\n", SDL_HasSSE());
 	printf("SSE2: %d\n", SDL_HasSSE2());
+	printf("SSSE3: %d\n", SDL_HasSSSE3());
+	printf("AVX2: %d\n", SDL_HasAVX2());
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
 	printf("ARM SIMD: %d\n", SDL_HasARMSIMD());
 	printf("NEON: %d\n", SDL_HasNEON());
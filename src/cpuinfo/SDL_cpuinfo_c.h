@@ -0,0 +1,58 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_cpuinfo_c_h
+#define _SDL_cpuinfo_c_h
+
+/* CPU features and SIMD intrinsics used internally by SDL */
+
+#include "SDL_cpuinfo.h"
+
+/* Not public - for the internal x86 SIMD routines only */
+extern SDL_bool SDL_HasSSSE3(void);	/* whether CPU has SSSE3 features */
+extern SDL_bool SDL_HasAVX2(void);	/* whether CPU and OS support AVX2 */
+
+/* Intrinsic based x86 kernels are compiled with per-function target
+   attributes, so they can be selected at runtime without building the
+   whole library with -msse2 / -mavx2.
+ */
+#if SDL_ASSEMBLY_ROUTINES
+#  if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && \
+      (defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#    define SDL_SSE2_INTRINSICS 1
+#    define SDL_SSSE3_INTRINSICS 1
+#    define SDL_AVX2_INTRINSICS 1
+#    define SDL_TARGETING(x) __attribute__((target(x)))
+#  elif defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_IX86) || defined(_M_X64))
+#    define SDL_SSE2_INTRINSICS 1
+#    define SDL_SSSE3_INTRINSICS 1
+#    define SDL_AVX2_INTRINSICS 1
+#    define SDL_TARGETING(x)
+#  endif
+#endif /* SDL_ASSEMBLY_ROUTINES */
+
+#if SDL_SSE2_INTRINSICS || SDL_SSSE3_INTRINSICS || SDL_AVX2_INTRINSICS
+#include <immintrin.h>
+#endif
+
+#endif /* _SDL_cpuinfo_c_h */
@@ -49,6 +49,10 @@ static struct {
 	struct SDL_SysWMmsg wmmsg[MAXEVENTS];
 } SDL_EventQ;
 
+/* Counters for SDL_GetEventStats() */
+static Uint32 SDL_EventsCoalesced = 0;
+static Uint32 SDL_EventsDropped = 0;
+
 /* Private data -- event locking structure */
 static struct {
 	SDL_mutex *lock;
@@ -240,6 +244,8 @@ int SDL_StartEventLoop(Uint32 flags)
 	/* It's not safe to call SDL_EventState() yet */
 	SDL_eventstate &= ~(0x00000001 << SDL_SYSWMEVENT);
 	SDL_ProcessEvents[SDL_SYSWMEVENT] = SDL_IGNORE;
+	SDL_EventsCoalesced = 0;
+	SDL_EventsDropped = 0;
 
 	/* Initialize event handlers */
 	retcode = 0;
@@ -269,6 +275,7 @@ static int SDL_AddEvent(SDL_Event *event)
 	tail = (SDL_EventQ.tail+1)%MAXEVENTS;
 	if ( tail == SDL_EventQ.head ) {
 		/* Overflow, drop event */
+		++SDL_EventsDropped;
 		added = 0;
 	} else {
 		SDL_EventQ.event[SDL_EventQ.tail] = *event;
@@ -500,3 +507,18 @@ int SDL_PrivateSysWMEvent(SDL_SysWMmsg *message)
 	/* Update internal event state */
 	return(posted);
 }
+
+void SDL_PrivateEventsCoalesced(int count)
+{
+	SDL_EventsCoalesced += count;
+}
+
+void SDL_GetEventStats(Uint32 *coalesced, Uint32 *dropped)
+{
+	if ( coalesced ) {
+		*coalesced = SDL_EventsCoalesced;
+	}
+	if ( dropped ) {
+		*dropped = SDL_EventsDropped;
+	}
+}
@@ -64,6 +64,9 @@ extern int SDL_PrivateExpose(void);
 extern int SDL_PrivateQuit(void);
 extern int SDL_PrivateSysWMEvent(SDL_SysWMmsg *message);
 
+/* Used by the video drivers to count the events they folded into others */
+extern void SDL_PrivateEventsCoalesced(int count);
+
 /* Used to clamp the mouse coordinates separately from the video surface */
 extern void SDL_SetMouseRange(int maxX, int maxY);
 
@@ -89,7 +89,11 @@
 #include "SDL_video.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
+#include "SDL_pixels_c.h"
 #include "SDL_RLEaccel_c.h"
+#include "SDL_workers_c.h"
+#include "SDL_pixelpool_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
 /* Force MMX to 0; this blows up on almost every major compiler now. --ryan. */
 #if 0 && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && SDL_ASSEMBLY_ROUTINES
@@ -781,9 +785,10 @@ do {							\
  * right. Top clipping has already been taken care of.
  */
 static void RLEClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
-			Uint8 *dstbuf, SDL_Rect *srcrect, unsigned alpha)
+			Uint8 *dstbuf, const SDL_Rect32 *srcrect, unsigned alpha)
 {
     SDL_PixelFormat *fmt = dst->format;
+    int dstpitch = (int)SDL_SURFACE_PITCH(dst);
 
 #define RLECLIPBLIT(bpp, Type, do_blit)					   \
     do {								   \
@@ -822,7 +827,7 @@ static void RLEClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 		break;							   \
 	    if(ofs == w) {						   \
 		ofs = 0;						   \
-		dstbuf += dst->pitch;					   \
+		dstbuf += dstpitch;					   \
 		if(!--linecount)					   \
 		    break;						   \
 	    }								   \
@@ -839,11 +844,22 @@ static void RLEClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 /* blit a colorkeyed RLE surface */
 int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	SDL_Rect32 sr, dr;
+
+	SDL_WIDEN_RECT(&sr, srcrect);
+	SDL_WIDEN_RECT(&dr, dstrect);
+	return(SDL_RLEBlit32(src, &sr, dst, &dr));
+}
+
+int SDL_RLEBlit32(SDL_Surface *src, const SDL_Rect32 *srcrect,
+		SDL_Surface *dst, const SDL_Rect32 *dstrect)
 {
 	Uint8 *dstbuf;
 	Uint8 *srcbuf;
 	int x, y;
 	int w = src->w;
+	int dstpitch = (int)SDL_SURFACE_PITCH(dst);
 	unsigned alpha;
 
 	/* Lock the destination if necessary */
@@ -857,7 +873,7 @@ int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	x = dstrect->x;
 	y = dstrect->y;
 	dstbuf = (Uint8 *)dst->pixels
-	         + y * dst->pitch + x * src->format->BytesPerPixel;
+	         + (size_t)y * dstpitch + (size_t)x * src->format->BytesPerPixel;
 	srcbuf = (Uint8 *)src->map->sw_data->aux_data;
 
 	{
@@ -921,7 +937,7 @@ int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			break;						      \
 		    if(ofs == w) {					      \
 			ofs = 0;					      \
-			dstbuf += dst->pitch;				      \
+			dstbuf += dstpitch;				      \
 			if(!--linecount)				      \
 			    break;					      \
 		    }							      \
@@ -1013,9 +1029,10 @@ typedef struct {
 
 /* blit a pixel-alpha RLE surface clipped at the right and/or left edges */
 static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
-			     Uint8 *dstbuf, SDL_Rect *srcrect)
+			     Uint8 *dstbuf, const SDL_Rect32 *srcrect)
 {
     SDL_PixelFormat *df = dst->format;
+    int dstpitch = (int)SDL_SURFACE_PITCH(dst);
     /*
      * clipped blitter: Ptype is the destination pixel type,
      * Ctype the translucent count type, and do_blend the macro
@@ -1085,7 +1102,7 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 		    ofs += run;						  \
 		}							  \
 	    } while(ofs < w);						  \
-	    dstbuf += dst->pitch;					  \
+	    dstbuf += dstpitch;					  \
 	} while(--linecount);						  \
     } while(0)
 
@@ -1106,9 +1123,20 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 /* blit a pixel-alpha RLE surface */
 int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		     SDL_Surface *dst, SDL_Rect *dstrect)
+{
+    SDL_Rect32 sr, dr;
+
+    SDL_WIDEN_RECT(&sr, srcrect);
+    SDL_WIDEN_RECT(&dr, dstrect);
+    return(SDL_RLEAlphaBlit32(src, &sr, dst, &dr));
+}
+
+int SDL_RLEAlphaBlit32(SDL_Surface *src, const SDL_Rect32 *srcrect,
+		     SDL_Surface *dst, const SDL_Rect32 *dstrect)
 {
     int x, y;
     int w = src->w;
+    int dstpitch = (int)SDL_SURFACE_PITCH(dst);
     Uint8 *srcbuf, *dstbuf;
     SDL_PixelFormat *df = dst->format;
 
@@ -1122,7 +1150,7 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
     x = dstrect->x;
     y = dstrect->y;
     dstbuf = (Uint8 *)dst->pixels
-	     + y * dst->pitch + x * df->BytesPerPixel;
+	     + (size_t)y * dstpitch + (size_t)x * df->BytesPerPixel;
     srcbuf = (Uint8 *)src->map->sw_data->aux_data + sizeof(RLEDestFormat);
 
     {
@@ -1232,7 +1260,7 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			ofs += run;					 \
 		    }							 \
 		} while(ofs < w);					 \
-		dstbuf += dst->pitch;					 \
+		dstbuf += dstpitch;					 \
 	    } while(--linecount);					 \
 	} while(0)
 
@@ -1396,105 +1424,383 @@ static int uncopy_32(Uint32 *dst, void *src, int n,
 #define ISTRANSL(pixel, fmt)	\
     ((unsigned)((((pixel) & fmt->Amask) >> fmt->Ashift) - 1U) < 254U)
 
-/* convert surface to be quickly alpha-blittable onto dest, if possible */
-static int RLEAlphaSurface(SDL_Surface *surface)
+/* At most this many bands are encoded in parallel */
+#define MAX_RLE_BANDS	64
+
+/*
+ * Run detection for the encoders.
+ * Each function returns the end of the run starting at x, where a run is
+ * made of pixels which are (in != 0) or aren't (in == 0) of a kind.
+ */
+#define RLE_OPAQUE	0	/* alpha == 255 */
+#define RLE_TRANSL	1	/* 1 <= alpha <= 254 */
+
+typedef int (*RLEKeyRunFunc)(const Uint8 *row, int x, int w, int bpp,
+			     Uint32 rgbmask, Uint32 ckey, int in);
+typedef int (*RLEAlphaRunFunc)(const Uint32 *row, int x, int w,
+			       SDL_PixelFormat *sf, int kind, int in);
+
+static Uint32 getpix_8(Uint8 *srcbuf)
 {
-    SDL_Surface *dest;
+    return *srcbuf;
+}
+
+static Uint32 getpix_16(Uint8 *srcbuf)
+{
+    return *(Uint16 *)srcbuf;
+}
+
+static Uint32 getpix_24(Uint8 *srcbuf)
+{
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    return srcbuf[0] + (srcbuf[1] << 8) + (srcbuf[2] << 16);
+#else
+    return (srcbuf[0] << 16) + (srcbuf[1] << 8) + srcbuf[2];
+#endif
+}
+
+static Uint32 getpix_32(Uint8 *srcbuf)
+{
+    return *(Uint32 *)srcbuf;
+}
+
+typedef Uint32 (*getpix_func)(Uint8 *);
+
+static getpix_func getpixes[4] = {
+    getpix_8, getpix_16, getpix_24, getpix_32
+};
+
+static int RLEKeyRun(const Uint8 *row, int x, int w, int bpp,
+		     Uint32 rgbmask, Uint32 ckey, int in)
+{
+    getpix_func getpix = getpixes[bpp - 1];
+    if(bpp == 3) {
+	/* no call per pixel for the depth that has no vector version */
+	const Uint8 *p = row + x * 3;
+	while(x < w && ((getpix_24((Uint8 *)p) & rgbmask) == ckey) == in) {
+	    p += 3;
+	    x++;
+	}
+	return x;
+    }
+    while(x < w && ((getpix((Uint8 *)row + x * bpp) & rgbmask) == ckey) == in)
+	x++;
+    return x;
+}
+
+static int RLEAlphaRun(const Uint32 *row, int x, int w,
+		       SDL_PixelFormat *sf, int kind, int in)
+{
+    if(kind == RLE_OPAQUE) {
+	while(x < w && !ISOPAQUE(row[x], sf) == !in)
+	    x++;
+    } else {
+	while(x < w && !ISTRANSL(row[x], sf) == !in)
+	    x++;
+    }
+    return x;
+}
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/* index of the lowest set bit, which must exist */
+static __inline__ int RLEFirstBit(Uint32 bits)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, bits);
+    return (int)i;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+#endif
+
+#if SDL_SSE2_INTRINSICS
+/* 16 bytes of pixels at a time, for 8, 16 and 32 bpp */
+static int SDL_TARGETING("sse2") RLEKeyRunSSE2(const Uint8 *row, int x,
+		int w, int bpp, Uint32 rgbmask, Uint32 ckey, int in)
+{
+    const int n = 16 / bpp;
+    __m128i mask, key;
+
+    if(bpp == 3)
+	return RLEKeyRun(row, x, w, bpp, rgbmask, ckey, in);
+    if(bpp == 1) {
+	mask = _mm_set1_epi8((char)rgbmask);
+	key = _mm_set1_epi8((char)ckey);
+    } else if(bpp == 2) {
+	mask = _mm_set1_epi16((short)rgbmask);
+	key = _mm_set1_epi16((short)ckey);
+    } else {
+	mask = _mm_set1_epi32((int)rgbmask);
+	key = _mm_set1_epi32((int)ckey);
+    }
+    for(; x + n <= w; x += n) {
+	__m128i v = _mm_and_si128(
+	    _mm_loadu_si128((const __m128i *)(row + x * bpp)), mask);
+	Uint32 stop;
+	if(bpp == 1)
+	    v = _mm_cmpeq_epi8(v, key);
+	else if(bpp == 2)
+	    v = _mm_cmpeq_epi16(v, key);
+	else
+	    v = _mm_cmpeq_epi32(v, key);
+	stop = _mm_movemask_epi8(v);
+	if(in)
+	    stop ^= 0xffff;
+	if(stop)
+	    return x + RLEFirstBit(stop) / bpp;
+    }
+    return RLEKeyRun(row, x, w, bpp, rgbmask, ckey, in);
+}
+
+/* 4 pixels at a time, for sources with 8 bits of alpha */
+static int SDL_TARGETING("sse2") RLEAlphaRunSSE2(const Uint32 *row, int x,
+		int w, SDL_PixelFormat *sf, int kind, int in)
+{
+    const __m128i amask = _mm_set1_epi32((int)sf->Amask);
+    const __m128i zero = _mm_setzero_si128();
+
+    for(; x + 4 <= w; x += 4) {
+	__m128i a = _mm_and_si128(
+	    _mm_loadu_si128((const __m128i *)(row + x)), amask);
+	__m128i opaque = _mm_cmpeq_epi32(a, amask);
+	Uint32 stop;
+	if(kind == RLE_OPAQUE)
+	    stop = _mm_movemask_ps(_mm_castsi128_ps(opaque));
+	else
+	    stop = _mm_movemask_ps(_mm_castsi128_ps(
+		_mm_or_si128(opaque, _mm_cmpeq_epi32(a, zero)))) ^ 0xf;
+	if(in)
+	    stop ^= 0xf;
+	if(stop)
+	    return x + RLEFirstBit(stop);
+    }
+    return RLEAlphaRun(row, x, w, sf, kind, in);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* 32 bytes of pixels at a time, for 8, 16 and 32 bpp */
+static int SDL_TARGETING("avx2") RLEKeyRunAVX2(const Uint8 *row, int x,
+		int w, int bpp, Uint32 rgbmask, Uint32 ckey, int in)
+{
+    const int n = 32 / bpp;
+    __m256i mask, key;
+
+    if(bpp == 3)
+	return RLEKeyRun(row, x, w, bpp, rgbmask, ckey, in);
+    if(bpp == 1) {
+	mask = _mm256_set1_epi8((char)rgbmask);
+	key = _mm256_set1_epi8((char)ckey);
+    } else if(bpp == 2) {
+	mask = _mm256_set1_epi16((short)rgbmask);
+	key = _mm256_set1_epi16((short)ckey);
+    } else {
+	mask = _mm256_set1_epi32((int)rgbmask);
+	key = _mm256_set1_epi32((int)ckey);
+    }
+    for(; x + n <= w; x += n) {
+	__m256i v = _mm256_and_si256(
+	    _mm256_loadu_si256((const __m256i *)(row + x * bpp)), mask);
+	Uint32 stop;
+	if(bpp == 1)
+	    v = _mm256_cmpeq_epi8(v, key);
+	else if(bpp == 2)
+	    v = _mm256_cmpeq_epi16(v, key);
+	else
+	    v = _mm256_cmpeq_epi32(v, key);
+	stop = (Uint32)_mm256_movemask_epi8(v);
+	if(in)
+	    stop = ~stop;
+	if(stop)
+	    return x + RLEFirstBit(stop) / bpp;
+    }
+    return RLEKeyRun(row, x, w, bpp, rgbmask, ckey, in);
+}
+
+/* 8 pixels at a time, for sources with 8 bits of alpha */
+static int SDL_TARGETING("avx2") RLEAlphaRunAVX2(const Uint32 *row, int x,
+		int w, SDL_PixelFormat *sf, int kind, int in)
+{
+    const __m256i amask = _mm256_set1_epi32((int)sf->Amask);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for(; x + 8 <= w; x += 8) {
+	__m256i a = _mm256_and_si256(
+	    _mm256_loadu_si256((const __m256i *)(row + x)), amask);
+	__m256i opaque = _mm256_cmpeq_epi32(a, amask);
+	Uint32 stop;
+	if(kind == RLE_OPAQUE)
+	    stop = _mm256_movemask_ps(_mm256_castsi256_ps(opaque));
+	else
+	    stop = _mm256_movemask_ps(_mm256_castsi256_ps(
+		_mm256_or_si256(opaque, _mm256_cmpeq_epi32(a, zero)))) ^ 0xff;
+	if(in)
+	    stop ^= 0xff;
+	if(stop)
+	    return x + RLEFirstBit(stop);
+    }
+    return RLEAlphaRun(row, x, w, sf, kind, in);
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+static RLEKeyRunFunc RLEChooseKeyRun(void)
+{
+#if SDL_AVX2_INTRINSICS
+    if(SDL_HasAVX2())
+	return RLEKeyRunAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+    if(SDL_HasSSE2())
+	return RLEKeyRunSSE2;
+#endif
+    return RLEKeyRun;
+}
+
+static RLEAlphaRunFunc RLEChooseAlphaRun(SDL_PixelFormat *sf)
+{
+    /* the vector versions compare the whole alpha field with 255 */
+    if(sf->Amask != (0xffU << sf->Ashift))
+	return RLEAlphaRun;
+#if SDL_AVX2_INTRINSICS
+    if(SDL_HasAVX2())
+	return RLEAlphaRunAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+    if(SDL_HasSSE2())
+	return RLEAlphaRunSSE2;
+#endif
+    return RLEAlphaRun;
+}
+
+/*
+ * The encoders work on bands of scan lines, which are encoded in parallel
+ * by the worker pool on large surfaces and then concatenated.  Every
+ * encoded line ends 32-bit aligned relative to the start of its band, so
+ * the alignment padding doesn't depend on where the band ends up.
+ */
+typedef struct RLEEncoder {
+    SDL_Surface *surface;
+    Uint8 *(*encode)(struct RLEEncoder *enc, int y, int h,
+		     Uint8 *dst, Uint8 **lastline);
+    int rowsize;		/* worst case encoded size of a line */
+    int countsize;		/* size of the end marker */
+
+    /* colorkey encoding */
+    RLEKeyRunFunc keyrun;
+
+    /* alpha encoding */
+    RLEAlphaRunFunc alpharun;
     SDL_PixelFormat *df;
-    int maxsize = 0;
     int max_opaque_run;
-    int max_transl_run = 65535;
-    unsigned masksum;
-    Uint8 *rlebuf, *dst;
     int (*copy_opaque)(void *, Uint32 *, int,
 		       SDL_PixelFormat *, SDL_PixelFormat *);
     int (*copy_transl)(void *, Uint32 *, int,
 		       SDL_PixelFormat *, SDL_PixelFormat *);
 
-    dest = surface->map->dst;
-    if(!dest)
-	return -1;
-    df = dest->format;
-    if(surface->format->BitsPerPixel != 32)
-	return -1;		/* only 32bpp source supported */
+    /* the bands */
+    Uint8 **buf;		/* encoded lines of each band */
+    Uint8 **end;		/* end of the encoded lines */
+    Uint8 **last;		/* end of the last line with any pixels */
+} RLEEncoder;
 
-    /* find out whether the destination is one we support,
-       and determine the max size of the encoded result */
-    masksum = df->Rmask | df->Gmask | df->Bmask;
-    switch(df->BytesPerPixel) {
-    case 2:
-	/* 16bpp: only support 565 and 555 formats */
-	switch(masksum) {
-	case 0xffff:
-	    if(df->Gmask == 0x07e0
-	       || df->Rmask == 0x07e0 || df->Bmask == 0x07e0) {
-		copy_opaque = copy_opaque_16;
-		copy_transl = copy_transl_565;
-	    } else
-		return -1;
-	    break;
-	case 0x7fff:
-	    if(df->Gmask == 0x03e0
-	       || df->Rmask == 0x03e0 || df->Bmask == 0x03e0) {
-		copy_opaque = copy_opaque_16;
-		copy_transl = copy_transl_555;
-	    } else
-		return -1;
-	    break;
-	default:
-	    return -1;
-	}
-	max_opaque_run = 255;	/* runs stored as bytes */
+static void RLEEncodeBand(void *data, int band, int nbands)
+{
+    RLEEncoder *enc = (RLEEncoder *)data;
+    int h = enc->surface->h;
+    int y = h * band / nbands;
 
-	/* worst case is alternating opaque and translucent pixels,
-	   with room for alignment padding between lines */
-	maxsize = surface->h * (2 + (4 + 2) * (surface->w + 1)) + 2;
-	break;
-    case 4:
-	if(masksum != 0x00ffffff)
-	    return -1;		/* requires unused high byte */
-	copy_opaque = copy_32;
-	copy_transl = copy_32;
-	max_opaque_run = 255;	/* runs stored as short ints */
+    enc->last[band] = enc->buf[band];
+    enc->end[band] = enc->encode(enc, y, h * (band + 1) / nbands - y,
+				 enc->buf[band], &enc->last[band]);
+}
 
-	/* worst case is alternating opaque and translucent pixels */
-	maxsize = surface->h * 2 * 4 * (surface->w + 1) + 4;
-	break;
-    default:
-	return -1;		/* anything else unsupported right now */
+/*
+ * Encode the whole surface after 'headsize' bytes of header.
+ * Returns the buffer, with room for the end marker at '*end', which
+ * follows the last line that isn't completely transparent.
+ */
+static Uint8 *RLEEncodeSurface(RLEEncoder *enc, int headsize, Uint8 **end)
+{
+    SDL_Surface *surface = enc->surface;
+    int nbands = SDL_GetWorkerBands(SDL_WORKER_PIXELS(surface->w, surface->h),
+				    surface->h);
+    Uint8 *bufs[MAX_RLE_BANDS], *ends[MAX_RLE_BANDS];
+    Uint8 *lasts[MAX_RLE_BANDS];
+    Uint8 *rlebuf, *dst;
+    size_t size;
+    int i;
+
+    if(nbands > MAX_RLE_BANDS)
+	nbands = MAX_RLE_BANDS;
+    enc->buf = bufs;
+    enc->end = ends;
+    enc->last = lasts;
+
+    if(nbands == 1) {
+	/* encode straight into the final buffer */
+	size = headsize + (size_t)surface->h * enc->rowsize + enc->countsize;
+	rlebuf = (Uint8 *)SDL_malloc(size);
+	if(!rlebuf) {
+	    SDL_OutOfMemory();
+	    return NULL;
+	}
+	bufs[0] = rlebuf + headsize;
+	RLEEncodeBand(enc, 0, 1);
+	*end = lasts[0];
+	return rlebuf;
     }
 
-    maxsize += sizeof(RLEDestFormat);
-    rlebuf = (Uint8 *)SDL_malloc(maxsize);
-    if(!rlebuf) {
-	SDL_OutOfMemory();
-	return -1;
+    for(i = 0; i < nbands; i++) {
+	int rows = surface->h * (i + 1) / nbands - surface->h * i / nbands;
+	bufs[i] = (Uint8 *)SDL_malloc((size_t)rows * enc->rowsize);
+	if(!bufs[i]) {
+	    while(i--)
+		SDL_free(bufs[i]);
+	    SDL_OutOfMemory();
+	    return NULL;
+	}
     }
-    {
-	/* save the destination format so we can undo the encoding later */
-	RLEDestFormat *r = (RLEDestFormat *)rlebuf;
-	r->BytesPerPixel = df->BytesPerPixel;
-	r->Rloss = df->Rloss;
-	r->Gloss = df->Gloss;
-	r->Bloss = df->Bloss;
-	r->Rshift = df->Rshift;
-	r->Gshift = df->Gshift;
-	r->Bshift = df->Bshift;
-	r->Ashift = df->Ashift;
-	r->Rmask = df->Rmask;
-	r->Gmask = df->Gmask;
-	r->Bmask = df->Bmask;
-	r->Amask = df->Amask;
+    SDL_RunWorkers(RLEEncodeBand, enc, nbands);
+
+    /* concatenate, leaving out the trailing blank lines */
+    size = headsize + enc->countsize;
+    for(i = 0; i < nbands; i++)
+	size += ends[i] - bufs[i];
+    rlebuf = (Uint8 *)SDL_malloc(size);
+    if(rlebuf) {
+	dst = rlebuf + headsize;
+	*end = dst;
+	for(i = 0; i < nbands; i++) {
+	    SDL_memcpy(dst, bufs[i], ends[i] - bufs[i]);
+	    if(lasts[i] != bufs[i])
+		*end = dst + (lasts[i] - bufs[i]);
+	    dst += ends[i] - bufs[i];
+	}
+    } else {
+	SDL_OutOfMemory();
     }
-    dst = rlebuf + sizeof(RLEDestFormat);
+    for(i = 0; i < nbands; i++)
+	SDL_free(bufs[i]);
+    return rlebuf;
+}
 
-    /* Do the actual encoding */
-    {
-	int x, y;
-	int h = surface->h, w = surface->w;
-	SDL_PixelFormat *sf = surface->format;
-	Uint32 *src = (Uint32 *)surface->pixels;
-	Uint8 *lastline = dst;	/* end of last non-blank line */
+/* Encode lines y to y+h-1 of a surface with per-pixel alpha */
+static Uint8 *RLEAlphaRows(RLEEncoder *enc, int y, int h,
+			   Uint8 *dst, Uint8 **lastline)
+{
+    SDL_Surface *surface = enc->surface;
+    SDL_PixelFormat *sf = surface->format;
+    SDL_PixelFormat *df = enc->df;
+    RLEAlphaRunFunc findrun = enc->alpharun;
+    int max_opaque_run = enc->max_opaque_run;
+    int max_transl_run = 65535;
+    Uint8 *base = dst;
+    int w = surface->w;
+    int x;
+    Uint32 *src = (Uint32 *)((Uint8 *)surface->pixels
+			     + (size_t)y * SDL_SURFACE_PITCH(surface));
 
 	/* opaque counts are 8 or 16 bits, depending on target depth */
 #define ADD_OPAQUE_COUNTS(n, m)			\
@@ -1512,7 +1818,7 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 #define ADD_TRANSL_COUNTS(n, m)		\
 	(((Uint16 *)dst)[0] = n, ((Uint16 *)dst)[1] = m, dst += 4)
 
-	for(y = 0; y < h; y++) {
+	for(; h > 0; h--) {
 	    int runstart, skipstart;
 	    int blankline = 0;
 	    /* First encode all opaque pixels of a scan line */
@@ -1520,11 +1826,9 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	    do {
 		int run, skip, len;
 		skipstart = x;
-		while(x < w && !ISOPAQUE(src[x], sf))
-		    x++;
+		x = findrun(src, x, w, sf, RLE_OPAQUE, 0);
 		runstart = x;
-		while(x < w && ISOPAQUE(src[x], sf))
-		    x++;
+		x = findrun(src, x, w, sf, RLE_OPAQUE, 1);
 		skip = runstart - skipstart;
 		if(skip == w)
 		    blankline = 1;
@@ -1535,31 +1839,29 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 		}
 		len = MIN(run, max_opaque_run);
 		ADD_OPAQUE_COUNTS(skip, len);
-		dst += copy_opaque(dst, src + runstart, len, sf, df);
+		dst += enc->copy_opaque(dst, src + runstart, len, sf, df);
 		runstart += len;
 		run -= len;
 		while(run) {
 		    len = MIN(run, max_opaque_run);
 		    ADD_OPAQUE_COUNTS(0, len);
-		    dst += copy_opaque(dst, src + runstart, len, sf, df);
+		    dst += enc->copy_opaque(dst, src + runstart, len, sf, df);
 		    runstart += len;
 		    run -= len;
 		}
 	    } while(x < w);
 
 	    /* Make sure the next output address is 32-bit aligned */
-	    dst += (uintptr_t)dst & 2;
+	    dst += (dst - base) & 2;
 
 	    /* Next, encode all translucent pixels of the same scan line */
 	    x = 0;
 	    do {
 		int run, skip, len;
 		skipstart = x;
-		while(x < w && !ISTRANSL(src[x], sf))
-		    x++;
+		x = findrun(src, x, w, sf, RLE_TRANSL, 0);
 		runstart = x;
-		while(x < w && ISTRANSL(src[x], sf))
-		    x++;
+		x = findrun(src, x, w, sf, RLE_TRANSL, 1);
 		skip = runstart - skipstart;
 		blankline &= (skip == w);
 		run = x - runstart;
@@ -1569,34 +1871,126 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 		}
 		len = MIN(run, max_transl_run);
 		ADD_TRANSL_COUNTS(skip, len);
-		dst += copy_transl(dst, src + runstart, len, sf, df);
+		dst += enc->copy_transl(dst, src + runstart, len, sf, df);
 		runstart += len;
 		run -= len;
 		while(run) {
 		    len = MIN(run, max_transl_run);
 		    ADD_TRANSL_COUNTS(0, len);
-		    dst += copy_transl(dst, src + runstart, len, sf, df);
+		    dst += enc->copy_transl(dst, src + runstart, len, sf, df);
 		    runstart += len;
 		    run -= len;
 		}
 		if(!blankline)
-		    lastline = dst;
+		    *lastline = dst;
 	    } while(x < w);
 
-	    src += surface->pitch >> 2;
+	    src += SDL_SURFACE_PITCH(surface) >> 2;
+	}
+
+#undef ADD_TRANSL_COUNTS
+
+    return dst;
+}
+
+/* convert surface to be quickly alpha-blittable onto dest, if possible */
+static int RLEAlphaSurface(SDL_Surface *surface)
+{
+    SDL_Surface *dest;
+    SDL_PixelFormat *df;
+    RLEEncoder enc;
+    unsigned masksum;
+    Uint8 *rlebuf, *dst;
+
+    dest = surface->map->dst;
+    if(!dest)
+	return -1;
+    df = dest->format;
+    if(surface->format->BitsPerPixel != 32)
+	return -1;		/* only 32bpp source supported */
+
+    SDL_memset(&enc, 0, sizeof(enc));
+
+    /* find out whether the destination is one we support,
+       and determine the max size of the encoded result */
+    masksum = df->Rmask | df->Gmask | df->Bmask;
+    switch(df->BytesPerPixel) {
+    case 2:
+	/* 16bpp: only support 565 and 555 formats */
+	switch(masksum) {
+	case 0xffff:
+	    if(df->Gmask == 0x07e0
+	       || df->Rmask == 0x07e0 || df->Bmask == 0x07e0) {
+		enc.copy_opaque = copy_opaque_16;
+		enc.copy_transl = copy_transl_565;
+	    } else
+		return -1;
+	    break;
+	case 0x7fff:
+	    if(df->Gmask == 0x03e0
+	       || df->Rmask == 0x03e0 || df->Bmask == 0x03e0) {
+		enc.copy_opaque = copy_opaque_16;
+		enc.copy_transl = copy_transl_555;
+	    } else
+		return -1;
+	    break;
+	default:
+	    return -1;
 	}
-	dst = lastline;		/* back up past trailing blank lines */
-	ADD_OPAQUE_COUNTS(0, 0);
+	enc.max_opaque_run = 255;	/* runs stored as bytes */
+
+	/* worst case is alternating opaque and translucent pixels,
+	   with room for alignment padding between lines */
+	enc.rowsize = 2 + (4 + 2) * (surface->w + 1);
+	enc.countsize = 2;
+	break;
+    case 4:
+	if(masksum != 0x00ffffff)
+	    return -1;		/* requires unused high byte */
+	enc.copy_opaque = copy_32;
+	enc.copy_transl = copy_32;
+	enc.max_opaque_run = 255;	/* runs stored as short ints */
+
+	/* worst case is alternating opaque and translucent pixels */
+	enc.rowsize = 2 * 4 * (surface->w + 1);
+	enc.countsize = 4;
+	break;
+    default:
+	return -1;		/* anything else unsupported right now */
+    }
+
+    /* Do the actual encoding */
+    enc.surface = surface;
+    enc.encode = RLEAlphaRows;
+    enc.alpharun = RLEChooseAlphaRun(surface->format);
+    enc.df = df;
+    rlebuf = RLEEncodeSurface(&enc, sizeof(RLEDestFormat), &dst);
+    if(!rlebuf)
+	return -1;
+    {
+	/* save the destination format so we can undo the encoding later */
+	RLEDestFormat *r = (RLEDestFormat *)rlebuf;
+	r->BytesPerPixel = df->BytesPerPixel;
+	r->Rloss = df->Rloss;
+	r->Gloss = df->Gloss;
+	r->Bloss = df->Bloss;
+	r->Rshift = df->Rshift;
+	r->Gshift = df->Gshift;
+	r->Bshift = df->Bshift;
+	r->Ashift = df->Ashift;
+	r->Rmask = df->Rmask;
+	r->Gmask = df->Gmask;
+	r->Bmask = df->Bmask;
+	r->Amask = df->Amask;
     }
+    ADD_OPAQUE_COUNTS(0, 0);
 
 #undef ADD_OPAQUE_COUNTS
-#undef ADD_TRANSL_COUNTS
 
     /* Now that we have it encoded, release the original pixels */
     if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
        && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	SDL_free( surface->pixels );
-	surface->pixels = NULL;
+	SDL_FreeSurfacePixels(surface);
     }
 
     /* realloc the buffer to release unused memory */
@@ -1610,84 +2004,19 @@ static int RLEAlphaSurface(SDL_Surface *surface)
     return 0;
 }
 
-static Uint32 getpix_8(Uint8 *srcbuf)
-{
-    return *srcbuf;
-}
-
-static Uint32 getpix_16(Uint8 *srcbuf)
-{
-    return *(Uint16 *)srcbuf;
-}
-
-static Uint32 getpix_24(Uint8 *srcbuf)
-{
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-    return srcbuf[0] + (srcbuf[1] << 8) + (srcbuf[2] << 16);
-#else
-    return (srcbuf[0] << 16) + (srcbuf[1] << 8) + srcbuf[2];
-#endif
-}
-
-static Uint32 getpix_32(Uint8 *srcbuf)
-{
-    return *(Uint32 *)srcbuf;
-}
-
-typedef Uint32 (*getpix_func)(Uint8 *);
-
-static getpix_func getpixes[4] = {
-    getpix_8, getpix_16, getpix_24, getpix_32
-};
-
-static int RLEColorkeySurface(SDL_Surface *surface)
+/* Encode lines y to y+h-1 of a colorkeyed surface */
+static Uint8 *RLEColorkeyRows(RLEEncoder *enc, int y, int h,
+			      Uint8 *dst, Uint8 **lastline)
 {
-        Uint8 *rlebuf, *dst;
-	int maxn;
-	int y;
-	Uint8 *srcbuf, *lastline;
-	int maxsize = 0;
+	SDL_Surface *surface = enc->surface;
+	RLEKeyRunFunc findrun = enc->keyrun;
 	int bpp = surface->format->BytesPerPixel;
-	getpix_func getpix;
-	Uint32 ckey, rgbmask;
-	int w, h;
-
-	/* calculate the worst case size for the compressed surface */
-	switch(bpp) {
-	case 1:
-	    /* worst case is alternating opaque and transparent pixels,
-	       starting with an opaque pixel */
-	    maxsize = surface->h * 3 * (surface->w / 2 + 1) + 2;
-	    break;
-	case 2:
-	case 3:
-	    /* worst case is solid runs, at most 255 pixels wide */
-	    maxsize = surface->h * (2 * (surface->w / 255 + 1)
-				    + surface->w * bpp) + 2;
-	    break;
-	case 4:
-	    /* worst case is solid runs, at most 65535 pixels wide */
-	    maxsize = surface->h * (4 * (surface->w / 65535 + 1)
-				    + surface->w * 4) + 4;
-	    break;
-	}
-
-	rlebuf = (Uint8 *)SDL_malloc(maxsize);
-	if ( rlebuf == NULL ) {
-		SDL_OutOfMemory();
-		return(-1);
-	}
-
-	/* Set up the conversion */
-	srcbuf = (Uint8 *)surface->pixels;
-	maxn = bpp == 4 ? 65535 : 255;
-	dst = rlebuf;
-	rgbmask = ~surface->format->Amask;
-	ckey = surface->format->colorkey & rgbmask;
-	lastline = dst;
-	getpix = getpixes[bpp - 1];
-	w = surface->w;
-	h = surface->h;
+	int maxn = bpp == 4 ? 65535 : 255;
+	Uint32 rgbmask = ~surface->format->Amask;
+	Uint32 ckey = surface->format->colorkey & rgbmask;
+	Uint8 *srcbuf = (Uint8 *)surface->pixels
+			+ (size_t)y * SDL_SURFACE_PITCH(surface);
+	int w = surface->w;
 
 #define ADD_COUNTS(n, m)			\
 	if(bpp == 4) {				\
@@ -1700,7 +2029,7 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	    dst += 2;				\
 	}
 
-	for(y = 0; y < h; y++) {
+	for(; h > 0; h--) {
 	    int x = 0;
 	    int blankline = 0;
 	    do {
@@ -1709,11 +2038,9 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 		int skipstart = x;
 
 		/* find run of transparent, then opaque pixels */
-		while(x < w && (getpix(srcbuf + x * bpp) & rgbmask) == ckey)
-		    x++;
+		x = findrun(srcbuf, x, w, bpp, rgbmask, ckey, 1);
 		runstart = x;
-		while(x < w && (getpix(srcbuf + x * bpp) & rgbmask) != ckey)
-		    x++;
+		x = findrun(srcbuf, x, w, bpp, rgbmask, ckey, 0);
 		skip = runstart - skipstart;
 		if(skip == w)
 		    blankline = 1;
@@ -1739,12 +2066,50 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 		    run -= len;
 		}
 		if(!blankline)
-		    lastline = dst;
+		    *lastline = dst;
 	    } while(x < w);
 
-	    srcbuf += surface->pitch;
+	    srcbuf += SDL_SURFACE_PITCH(surface);
+	}
+	return dst;
+}
+
+static int RLEColorkeySurface(SDL_Surface *surface)
+{
+	RLEEncoder enc;
+	Uint8 *rlebuf, *dst;
+	int bpp = surface->format->BytesPerPixel;
+
+	SDL_memset(&enc, 0, sizeof(enc));
+
+	/* calculate the worst case size for each compressed line */
+	switch(bpp) {
+	case 1:
+	    /* worst case is alternating opaque and transparent pixels,
+	       starting with an opaque pixel */
+	    enc.rowsize = 3 * (surface->w / 2 + 1);
+	    enc.countsize = 2;
+	    break;
+	case 2:
+	case 3:
+	    /* worst case is solid runs, at most 255 pixels wide */
+	    enc.rowsize = 2 * (surface->w / 255 + 1) + surface->w * bpp;
+	    enc.countsize = 2;
+	    break;
+	case 4:
+	    /* worst case is solid runs, at most 65535 pixels wide */
+	    enc.rowsize = 4 * (surface->w / 65535 + 1) + surface->w * 4;
+	    enc.countsize = 4;
+	    break;
+	}
+
+	enc.surface = surface;
+	enc.encode = RLEColorkeyRows;
+	enc.keyrun = RLEChooseKeyRun();
+	rlebuf = RLEEncodeSurface(&enc, 0, &dst);
+	if ( rlebuf == NULL ) {
+		return(-1);
 	}
-	dst = lastline;		/* back up bast trailing blank lines */
 	ADD_COUNTS(0, 0);
 
 #undef ADD_COUNTS
@@ -1752,8 +2117,7 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	/* Now that we have it encoded, release the original pixels */
 	if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
 	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	    SDL_free( surface->pixels );
-	    surface->pixels = NULL;
+	    SDL_FreeSurfacePixels(surface);
 	}
 
 	/* realloc the buffer to release unused memory */
@@ -1840,12 +2204,12 @@ static SDL_bool UnRLEAlpha(SDL_Surface *surface)
 	uncopy_opaque = uncopy_transl = uncopy_32;
     }
 
-    surface->pixels = SDL_malloc(surface->h * surface->pitch);
-    if ( !surface->pixels ) {
+    if ( SDL_AllocSurfacePixels(surface) < 0 ) {
         return(SDL_FALSE);
     }
     /* fill background with transparent pixels */
-    SDL_memset(surface->pixels, 0, surface->h * surface->pitch);
+    SDL_memset(surface->pixels, 0,
+	       (size_t)surface->h * SDL_SURFACE_PITCH(surface));
 
     dst = surface->pixels;
     srcbuf = (Uint8 *)(df + 1);
@@ -1886,7 +2250,7 @@ static SDL_bool UnRLEAlpha(SDL_Surface *surface)
 		ofs += run;
 	    }
 	} while(ofs < w);
-	dst += surface->pitch >> 2;
+	dst += SDL_SURFACE_PITCH(surface) >> 2;
     }
     /* Make the compiler happy */
     return(SDL_TRUE);
@@ -1900,19 +2264,18 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 	if(recode && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
 	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
 	    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
-		SDL_Rect full;
+		SDL_Rect32 full;
 		unsigned alpha_flag;
 
 		/* re-create the original surface */
-		surface->pixels = SDL_malloc(surface->h * surface->pitch);
-		if ( !surface->pixels ) {
+		if ( SDL_AllocSurfacePixels(surface) < 0 ) {
 			/* Oh crap... */
 			surface->flags |= SDL_RLEACCEL;
 			return;
 		}
 
 		/* fill it with the background colour */
-		SDL_FillRect(surface, NULL, surface->format->colorkey);
+		SDL_FillRect32(surface, NULL, surface->format->colorkey);
 
 		/* now render the encoded surface */
 		full.x = full.y = 0;
@@ -1920,7 +2283,7 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 		full.h = surface->h;
 		alpha_flag = surface->flags & SDL_SRCALPHA;
 		surface->flags &= ~SDL_SRCALPHA; /* opaque blit */
-		SDL_RLEBlit(surface, &full, surface, &full);
+		SDL_RLEBlit32(surface, &full, surface, &full);
 		surface->flags |= alpha_flag;
 	    } else {
 		if ( !UnRLEAlpha(surface) ) {
@@ -1932,10 +2295,416 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 	}
 
 	if ( surface->map && surface->map->sw_data->aux_data ) {
-	    SDL_free(surface->map->sw_data->aux_data);
+	    if ( !surface->map->sw_data->aux_shared ) {
+		SDL_free(surface->map->sw_data->aux_data);
+	    }
 	    surface->map->sw_data->aux_data = NULL;
+	    surface->map->sw_data->aux_shared = 0;
+	}
+    }
+}
+
+
+
+/*
+ * See if the encoding of a surface can be used for blits to 'dst' as well,
+ * so that it doesn't have to be decoded and made again.
+ * Colorkey encodings are only used for blits to the same format, and
+ * alpha encodings record the format they were made for.
+ */
+int SDL_RLEFits(SDL_Surface *surface, SDL_Surface *dst)
+{
+    SDL_PixelFormat *sf = surface->format;
+    SDL_PixelFormat *df;
+
+    if((surface->flags & SDL_RLEACCEL) != SDL_RLEACCEL
+       || !surface->map->sw_data->aux_data
+       || !dst || dst == surface
+       || (dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE)
+	return 0;
+    df = dst->format;
+
+    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
+	if(df->BitsPerPixel != sf->BitsPerPixel
+	   || df->Rmask != sf->Rmask || df->Gmask != sf->Gmask
+	   || df->Bmask != sf->Bmask || df->Amask != sf->Amask)
+	    return 0;
+	if(sf->palette) {
+	    return df->palette
+		&& df->palette->ncolors >= sf->palette->ncolors
+		&& SDL_memcmp(df->palette->colors, sf->palette->colors,
+			      sf->palette->ncolors * sizeof(SDL_Color)) == 0;
+	}
+	return 1;
+    } else {
+	RLEDestFormat *r = surface->map->sw_data->aux_data;
+	return sf->BitsPerPixel == 32 && sf->Amask
+	    && !df->palette
+	    && df->BytesPerPixel == r->BytesPerPixel
+	    && df->Rmask == r->Rmask && df->Gmask == r->Gmask
+	    && df->Bmask == r->Bmask && df->Amask == r->Amask;
+    }
+}
+
+/*
+ * Saving and loading of encoded surfaces.
+ *
+ * The file starts with a header of little-endian 16 and 32 bit fields:
+ *
+ *   "SRLE", version, byte order of the encoding (1234 or 4321),
+ *   flags (SDL_SRCCOLORKEY and SDL_SRCALPHA), width, height, depth,
+ *   Rmask, Gmask, Bmask, Amask, colorkey, alpha, number of colors,
+ *   size of the encoding
+ *
+ * followed by the palette as r,g,b,unused bytes. The encoding itself,
+ * exactly as it is kept in memory, starts at the next multiple of
+ * 16 bytes from the beginning of the file, so a file that is mapped
+ * into memory can be blitted from directly.
+ */
+#define RLE_FILE_VERSION	1
+#define RLE_FILE_HEADER		56
+#define RLE_FILE_ALIGN		16
+
+/* See if a recorded destination format is one RLEAlphaSurface() makes */
+static int RLEValidDestFormat(const RLEDestFormat *df)
+{
+    Uint32 masksum = df->Rmask | df->Gmask | df->Bmask;
+
+    if(df->Rloss > 8 || df->Gloss > 8 || df->Bloss > 8
+       || df->Rshift > 31 || df->Gshift > 31 || df->Bshift > 31
+       || df->Rmask != (Uint32)((0xFF >> df->Rloss) << df->Rshift)
+       || df->Gmask != (Uint32)((0xFF >> df->Gloss) << df->Gshift)
+       || df->Bmask != (Uint32)((0xFF >> df->Bloss) << df->Bshift)
+       || (df->Rmask & df->Gmask) || ((df->Rmask | df->Gmask) & df->Bmask))
+	return 0;
+    switch(df->BytesPerPixel) {
+    case 2:
+	if(masksum == 0xffff)
+	    return df->Gmask == 0x07e0
+		|| df->Rmask == 0x07e0 || df->Bmask == 0x07e0;
+	if(masksum == 0x7fff)
+	    return df->Gmask == 0x03e0
+		|| df->Rmask == 0x03e0 || df->Bmask == 0x03e0;
+	return 0;
+    case 4:
+	return masksum == 0x00ffffff;
+    }
+    return 0;
+}
+
+/* Return the size of an encoding, or -1 if it doesn't fit the surface */
+static int RLEEncodingSize(SDL_Surface *surface, const Uint8 *data, int size)
+{
+    int w = surface->w;
+    int bpp = surface->format->BytesPerPixel;
+    int alpha = (surface->flags & SDL_SRCCOLORKEY) != SDL_SRCCOLORKEY;
+    int countsize;
+    int lines = 0;
+    int ofs = 0;
+
+    if(alpha) {
+	const RLEDestFormat *df = (const RLEDestFormat *)data;
+	/* alpha encodings are only made of (and decoded to) 32bpp */
+	if(surface->format->BitsPerPixel != 32 || !surface->format->Amask
+	   || size < (int)sizeof(RLEDestFormat) || !RLEValidDestFormat(df))
+	    return -1;
+	bpp = df->BytesPerPixel;
+	ofs = sizeof(RLEDestFormat);
+    }
+    countsize = bpp == 4 ? 4 : 2;
+
+    for(;;) {
+	int x = 0;
+	do {
+	    int skip, run;
+	    if(size - ofs < countsize)
+		return -1;
+	    if(countsize == 4) {
+		skip = ((const Uint16 *)(data + ofs))[0];
+		run = ((const Uint16 *)(data + ofs))[1];
+	    } else {
+		skip = data[ofs];
+		run = data[ofs + 1];
+	    }
+	    ofs += countsize;
+	    if(x == 0 && skip == 0 && run == 0)
+		return ofs;	/* end of the encoding */
+	    x += skip + run;
+	    if(x > w || size - ofs < run * bpp)
+		return -1;
+	    ofs += run * bpp;
+	} while(x < w);
+
+	if(++lines > surface->h)
+	    return -1;
+
+	if(alpha) {
+	    /* the translucent pixels of the same line */
+	    ofs += ofs & 2;
+	    x = 0;
+	    do {
+		int skip, run;
+		if(size - ofs < 4)
+		    return -1;
+		skip = ((const Uint16 *)(data + ofs))[0];
+		run = ((const Uint16 *)(data + ofs))[1];
+		ofs += 4;
+		x += skip + run;
+		if(x > w || size - ofs < run * 4)
+		    return -1;
+		ofs += run * 4;
+	    } while(x < w);
 	}
     }
 }
 
+static int RLEFileDataOffset(int ncolors)
+{
+    return (RLE_FILE_HEADER + ncolors * 4 + RLE_FILE_ALIGN - 1)
+	& ~(RLE_FILE_ALIGN - 1);
+}
 
+int SDL_SaveRLE_RW(SDL_Surface *surface, SDL_RWops *dst, int freedst)
+{
+    SDL_Palette *palette = surface->format->palette;
+    Uint8 *data;
+    int size, ncolors, pad, i;
+    int retval = -1;
+
+    if(!dst) {
+	return -1;	/* SDL_RWFromFile() has set the error */
+    }
+    if((surface->flags & SDL_RLEACCEL) != SDL_RLEACCEL
+       || !surface->map->sw_data->aux_data) {
+	SDL_SetError("Surface isn't RLE accelerated, blit it first");
+	goto done;
+    }
+    data = surface->map->sw_data->aux_data;
+    size = RLEEncodingSize(surface, data, 0x7FFFFFFF);
+    ncolors = palette ? palette->ncolors : 0;
+
+    if(!SDL_RWwrite(dst, "SRLE", 4, 1)
+       || !SDL_WriteLE16(dst, RLE_FILE_VERSION)
+       || !SDL_WriteLE16(dst, SDL_BYTEORDER)
+       || !SDL_WriteLE32(dst, surface->flags & (SDL_SRCCOLORKEY|SDL_SRCALPHA))
+       || !SDL_WriteLE32(dst, surface->w)
+       || !SDL_WriteLE32(dst, surface->h)
+       || !SDL_WriteLE32(dst, surface->format->BitsPerPixel)
+       || !SDL_WriteLE32(dst, surface->format->Rmask)
+       || !SDL_WriteLE32(dst, surface->format->Gmask)
+       || !SDL_WriteLE32(dst, surface->format->Bmask)
+       || !SDL_WriteLE32(dst, surface->format->Amask)
+       || !SDL_WriteLE32(dst, surface->format->colorkey)
+       || !SDL_WriteLE32(dst, surface->format->alpha)
+       || !SDL_WriteLE32(dst, ncolors)
+       || !SDL_WriteLE32(dst, size)) {
+	SDL_Error(SDL_EFWRITE);
+	goto done;
+    }
+    for(i = 0; i < ncolors; i++) {
+	Uint8 color[4];
+	color[0] = palette->colors[i].r;
+	color[1] = palette->colors[i].g;
+	color[2] = palette->colors[i].b;
+	color[3] = palette->colors[i].unused;
+	if(!SDL_RWwrite(dst, color, 4, 1)) {
+	    SDL_Error(SDL_EFWRITE);
+	    goto done;
+	}
+    }
+    for(pad = RLEFileDataOffset(ncolors) - RLE_FILE_HEADER - ncolors * 4;
+	pad > 0; pad--) {
+	if(!SDL_RWwrite(dst, "", 1, 1)) {
+	    SDL_Error(SDL_EFWRITE);
+	    goto done;
+	}
+    }
+    if(SDL_RWwrite(dst, data, size, 1) != 1) {
+	SDL_Error(SDL_EFWRITE);
+	goto done;
+    }
+    retval = 0;
+
+done:
+    if(freedst) {
+	SDL_RWclose(dst);
+    }
+    return retval;
+}
+
+/* See if a mask is a single run of bits in the low 'depth' bits */
+static int RLEValidMask(Uint32 mask, int depth)
+{
+    if(depth < 32 && (mask >> depth) != 0)
+	return 0;
+    return (mask & (mask + (mask & (~mask + 1)))) == 0;
+}
+
+/*
+ * Read the header of a saved surface and make an empty surface like it,
+ * leaving 'src' at the start of the encoding.
+ */
+static SDL_Surface *RLEReadHeader(SDL_RWops *src, int *size)
+{
+    SDL_Surface *surface;
+    SDL_Color colors[256];
+    char magic[4];
+    Uint32 flags, colorkey, alpha;
+    Uint32 Rmask, Gmask, Bmask, Amask;
+    int w, h, depth, pitch, ncolors, pad, i;
+
+    if(SDL_RWread(src, magic, 4, 1) != 1) {
+	SDL_Error(SDL_EFREAD);
+	return NULL;
+    }
+    if(SDL_memcmp(magic, "SRLE", 4) != 0) {
+	SDL_SetError("File is not an RLE surface");
+	return NULL;
+    }
+    if(SDL_ReadLE16(src) != RLE_FILE_VERSION) {
+	SDL_SetError("Unsupported RLE surface version");
+	return NULL;
+    }
+    if(SDL_ReadLE16(src) != SDL_BYTEORDER) {
+	SDL_SetError("RLE surface was saved with a different byte order");
+	return NULL;
+    }
+    flags = SDL_ReadLE32(src);
+    w = (int)SDL_ReadLE32(src);
+    h = (int)SDL_ReadLE32(src);
+    depth = (int)SDL_ReadLE32(src);
+    Rmask = SDL_ReadLE32(src);
+    Gmask = SDL_ReadLE32(src);
+    Bmask = SDL_ReadLE32(src);
+    Amask = SDL_ReadLE32(src);
+    colorkey = SDL_ReadLE32(src);
+    alpha = SDL_ReadLE32(src);
+    ncolors = (int)SDL_ReadLE32(src);
+    *size = (int)SDL_ReadLE32(src);
+
+    pitch = (w > 0 && w <= 0x7FFFFFFF / 4)
+	? ((w * ((depth + 7) / 8)) + 3) & ~3 : 0;
+    if(pitch <= 0 || h <= 0 || h > 0x7FFFFFFF / pitch
+       || w >= 16384 || h >= 65536	/* like SDL_CreateRGBSurface() */
+       || depth < 8 || depth > 32 || *size <= 0
+       || ncolors < 0 || ncolors > (depth == 8 ? 256 : 0)
+       || (depth == 8 && (Rmask | Gmask | Bmask | Amask) != 0)
+       || !RLEValidMask(Rmask, depth) || !RLEValidMask(Gmask, depth)
+       || !RLEValidMask(Bmask, depth) || !RLEValidMask(Amask, depth)
+       || (Rmask & Gmask) || ((Rmask | Gmask) & Bmask)
+       || ((Rmask | Gmask | Bmask) & Amask)
+       || !((flags & SDL_SRCCOLORKEY) || ((flags & SDL_SRCALPHA) && Amask))
+       || (!(flags & SDL_SRCCOLORKEY) && depth != 32)) {
+	SDL_SetError("Corrupt RLE surface header");
+	return NULL;
+    }
+    for(i = 0; i < ncolors; i++) {
+	Uint8 color[4];
+	if(SDL_RWread(src, color, 4, 1) != 1) {
+	    SDL_Error(SDL_EFREAD);
+	    return NULL;
+	}
+	colors[i].r = color[0];
+	colors[i].g = color[1];
+	colors[i].b = color[2];
+	colors[i].unused = color[3];
+    }
+    pad = RLEFileDataOffset(ncolors) - RLE_FILE_HEADER - ncolors * 4;
+    if(SDL_RWseek(src, pad, RW_SEEK_CUR) < 0) {
+	SDL_Error(SDL_EFSEEK);
+	return NULL;
+    }
+
+    /* There are no pixels until the surface is decoded */
+    surface = SDL_CreateRGBSurface(SDL_SWSURFACE, 0, 0, depth,
+				   Rmask, Gmask, Bmask, Amask);
+    if(!surface)
+	return NULL;
+    surface->w = w;
+    surface->h = h;
+    SDL_SetSurfacePitch(surface, SDL_AlignPitch(SDL_CalculatePitch32(surface)));
+    SDL_SetClipRect(surface, NULL);
+    if(ncolors)
+	SDL_SetColors(surface, colors, 0, ncolors);
+    if(flags & SDL_SRCALPHA)
+	SDL_SetAlpha(surface, SDL_SRCALPHA|SDL_RLEACCEL, (Uint8)alpha);
+    if(flags & SDL_SRCCOLORKEY)
+	SDL_SetColorKey(surface, SDL_SRCCOLORKEY|SDL_RLEACCEL, colorkey);
+    return surface;
+}
+
+/* Give a surface its encoding, checking that it is sound */
+static int RLEAttach(SDL_Surface *surface, Uint8 *data, int size, int shared)
+{
+    if(((uintptr_t)data & 3) != 0) {
+	SDL_SetError("RLE surface data must be 4-byte aligned");
+	return -1;
+    }
+    if(RLEEncodingSize(surface, data, size) != size) {
+	SDL_SetError("Corrupt RLE surface data");
+	return -1;
+    }
+    surface->map->sw_data->aux_data = data;
+    surface->map->sw_data->aux_shared = shared;
+    surface->flags |= SDL_RLEACCEL;
+    return 0;
+}
+
+SDL_Surface *SDL_LoadRLE_RW(SDL_RWops *src, int freesrc)
+{
+    SDL_Surface *surface;
+    SDL_bool was_error = SDL_TRUE;
+    Uint8 *data = NULL;
+    int size;
+
+    if(!src) {
+	return NULL;	/* SDL_RWFromFile() has set the error */
+    }
+    surface = RLEReadHeader(src, &size);
+    if(surface) {
+	data = (Uint8 *)SDL_malloc(size);
+	if(!data) {
+	    SDL_OutOfMemory();
+	} else if(SDL_RWread(src, data, size, 1) != 1) {
+	    SDL_Error(SDL_EFREAD);
+	} else if(RLEAttach(surface, data, size, 0) == 0) {
+	    was_error = SDL_FALSE;
+	}
+	if(was_error) {
+	    if(data) {
+		SDL_free(data);
+	    }
+	    SDL_FreeSurface(surface);
+	    surface = NULL;
+	}
+    }
+    if(freesrc) {
+	SDL_RWclose(src);
+    }
+    return surface;
+}
+
+SDL_Surface *SDL_CreateRLESurfaceFrom(void *mem, int size)
+{
+    SDL_RWops *src;
+    SDL_Surface *surface;
+    int datasize, offset;
+
+    src = SDL_RWFromConstMem(mem, size);
+    if(!src)
+	return NULL;
+    surface = RLEReadHeader(src, &datasize);
+    if(surface) {
+	offset = SDL_RWtell(src);
+	if(datasize > size - offset) {
+	    SDL_Error(SDL_EFREAD);
+	    SDL_FreeSurface(surface);
+	    surface = NULL;
+	} else if(RLEAttach(surface, (Uint8 *)mem + offset, datasize, 1) < 0) {
+	    SDL_FreeSurface(surface);
+	    surface = NULL;
+	}
+    }
+    SDL_RWclose(src);
+    return surface;
+}
@@ -28,4 +28,9 @@ extern int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
                        SDL_Surface *dst, SDL_Rect *dstrect);
 extern int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			    SDL_Surface *dst, SDL_Rect *dstrect);
+extern int SDL_RLEBlit32(SDL_Surface *src, const SDL_Rect32 *srcrect,
+			 SDL_Surface *dst, const SDL_Rect32 *dstrect);
+extern int SDL_RLEAlphaBlit32(SDL_Surface *src, const SDL_Rect32 *srcrect,
+			      SDL_Surface *dst, const SDL_Rect32 *dstrect);
 extern void SDL_UnRLESurface(SDL_Surface *surface, int recode);
+extern int SDL_RLEFits(SDL_Surface *surface, SDL_Surface *dst);
@@ -26,6 +26,7 @@
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
+#include "SDL_workers_c.h"
 
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && SDL_ASSEMBLY_ROUTINES
 #define MMX_ASMBLIT
@@ -39,64 +40,111 @@
 #include "mmx.h"
 #endif
 
-/* The general purpose software blit routine */
-static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
-			SDL_Surface *dst, SDL_Rect *dstrect)
+/* A blit split into horizontal bands for the worker pool */
+typedef struct {
+	SDL_BlitInfo *info;
+	SDL_loblit blit;
+} SDL_BandBlit;
+
+static void SDL_RunBlitBand(void *data, int band, int nbands)
+{
+	SDL_BandBlit *job = (SDL_BandBlit *)data;
+	SDL_BlitInfo info = *job->info;
+	int srcpitch, dstpitch;
+	int top, bottom;
+
+	srcpitch = info.s_width*info.src->BytesPerPixel + info.s_skip;
+	dstpitch = info.d_width*info.dst->BytesPerPixel + info.d_skip;
+	top = (info.d_height * band) / nbands;
+	bottom = (info.d_height * (band+1)) / nbands;
+
+	info.s_pixels += (size_t)top * srcpitch;
+	info.d_pixels += (size_t)top * dstpitch;
+	info.s_height = bottom - top;
+	info.d_height = bottom - top;
+	job->blit(&info);
+}
+
+/* Run the software blit for one rectangle of locked surfaces */
+static void SDL_SoftBlitRect(SDL_Surface *src, const SDL_Rect32 *srcrect,
+				SDL_Surface *dst, const SDL_Rect32 *dstrect)
+{
+	SDL_BlitInfo info;
+	SDL_loblit RunBlit;
+	int srcpitch = (int)SDL_SURFACE_PITCH(src);
+	int dstpitch = (int)SDL_SURFACE_PITCH(dst);
+	int nbands;
+
+	/* Set up the blit information */
+	info.s_pixels = (Uint8 *)src->pixels +
+			(size_t)srcrect->y*srcpitch +
+			(size_t)srcrect->x*src->format->BytesPerPixel;
+	info.s_width = srcrect->w;
+	info.s_height = srcrect->h;
+	info.s_skip=srcpitch-info.s_width*src->format->BytesPerPixel;
+	info.d_pixels = (Uint8 *)dst->pixels +
+			(size_t)dstrect->y*dstpitch +
+			(size_t)dstrect->x*dst->format->BytesPerPixel;
+	info.d_width = dstrect->w;
+	info.d_height = dstrect->h;
+	info.d_skip=dstpitch-info.d_width*dst->format->BytesPerPixel;
+	info.aux_data = src->map->sw_data->aux_data;
+	info.src = src->format;
+	info.table = src->map->table;
+	info.dst = dst->format;
+	RunBlit = src->map->sw_data->blit;
+
+	/* Run the actual software blit, in bands if it's big enough.
+	   Blits within a single surface may overlap, so they aren't
+	   split up.
+	 */
+	if ( src != dst &&
+	     (nbands = SDL_GetWorkerBands(SDL_WORKER_PIXELS(info.d_width,
+	                                                    info.d_height),
+	                                  info.d_height)) > 1 ) {
+		SDL_BandBlit job;
+
+		job.info = &info;
+		job.blit = RunBlit;
+		SDL_RunWorkers(SDL_RunBlitBand, &job, nbands);
+	} else {
+		RunBlit(&info);
+	}
+}
+
+/* Lock the surfaces of a software blit, if they're in hardware */
+static int SDL_LockBlit(SDL_Surface *src, SDL_Surface *dst,
+			int *src_locked, int *dst_locked)
 {
 	int okay;
-	int src_locked;
-	int dst_locked;
 
 	/* Everything is okay at the beginning...  */
 	okay = 1;
 
 	/* Lock the destination if it's in hardware */
-	dst_locked = 0;
+	*dst_locked = 0;
 	if ( SDL_MUSTLOCK(dst) ) {
 		if ( SDL_LockSurface(dst) < 0 ) {
 			okay = 0;
 		} else {
-			dst_locked = 1;
+			*dst_locked = 1;
 		}
 	}
 	/* Lock the source if it's in hardware */
-	src_locked = 0;
+	*src_locked = 0;
 	if ( SDL_MUSTLOCK(src) ) {
 		if ( SDL_LockSurface(src) < 0 ) {
 			okay = 0;
 		} else {
-			src_locked = 1;
+			*src_locked = 1;
 		}
 	}
+	return(okay);
+}
 
-	/* Set up source and destination buffer pointers, and BLIT! */
-	if ( okay  && srcrect->w && srcrect->h ) {
-		SDL_BlitInfo info;
-		SDL_loblit RunBlit;
-
-		/* Set up the blit information */
-		info.s_pixels = (Uint8 *)src->pixels +
-				(Uint16)srcrect->y*src->pitch +
-				(Uint16)srcrect->x*src->format->BytesPerPixel;
-		info.s_width = srcrect->w;
-		info.s_height = srcrect->h;
-		info.s_skip=src->pitch-info.s_width*src->format->BytesPerPixel;
-		info.d_pixels = (Uint8 *)dst->pixels +
-				(Uint16)dstrect->y*dst->pitch +
-				(Uint16)dstrect->x*dst->format->BytesPerPixel;
-		info.d_width = dstrect->w;
-		info.d_height = dstrect->h;
-		info.d_skip=dst->pitch-info.d_width*dst->format->BytesPerPixel;
-		info.aux_data = src->map->sw_data->aux_data;
-		info.src = src->format;
-		info.table = src->map->table;
-		info.dst = dst->format;
-		RunBlit = src->map->sw_data->blit;
-
-		/* Run the actual software blit */
-		RunBlit(&info);
-	}
-
+static void SDL_UnlockBlit(SDL_Surface *src, SDL_Surface *dst,
+			int src_locked, int dst_locked)
+{
 	/* We need to unlock the surfaces if they're locked */
 	if ( dst_locked ) {
 		SDL_UnlockSurface(dst);
@@ -104,10 +152,73 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( src_locked ) {
 		SDL_UnlockSurface(src);
 	}
+}
+
+/* Run the software blit for a list of clipped rectangles, locking the
+   surfaces only once.  Empty rectangles are skipped.
+ */
+int SDL_SoftBlitRects(SDL_Surface *src, const SDL_Rect *srcrects,
+			SDL_Surface *dst, const SDL_Rect *dstrects, int n)
+{
+	int okay;
+	int src_locked;
+	int dst_locked;
+
+	okay = SDL_LockBlit(src, dst, &src_locked, &dst_locked);
+
+	/* Set up source and destination buffer pointers, and BLIT! */
+	if ( okay ) {
+		SDL_Rect32 sr, dr;
+		int i;
+
+		for ( i=0; i<n; ++i ) {
+			if ( srcrects[i].w && srcrects[i].h ) {
+				SDL_WIDEN_RECT(&sr, &srcrects[i]);
+				SDL_WIDEN_RECT(&dr, &dstrects[i]);
+				SDL_SoftBlitRect(src, &sr, dst, &dr);
+			}
+		}
+	}
+
+	SDL_UnlockBlit(src, dst, src_locked, dst_locked);
+
 	/* Blit is done! */
 	return(okay ? 0 : -1);
 }
 
+/* Run the software blit of a surface, which may be RLE accelerated, for
+   a clipped rectangle with 32-bit coordinates.
+ */
+int SDL_SoftBlit32(SDL_Surface *src, const SDL_Rect32 *srcrect,
+			SDL_Surface *dst, const SDL_Rect32 *dstrect)
+{
+	int okay;
+	int src_locked;
+	int dst_locked;
+
+	if ( src->map->sw_blit == SDL_RLEBlit ) {
+		return(SDL_RLEBlit32(src, srcrect, dst, dstrect));
+	}
+	if ( src->map->sw_blit == SDL_RLEAlphaBlit ) {
+		return(SDL_RLEAlphaBlit32(src, srcrect, dst, dstrect));
+	}
+
+	okay = SDL_LockBlit(src, dst, &src_locked, &dst_locked);
+	if ( okay && srcrect->w && srcrect->h ) {
+		SDL_SoftBlitRect(src, srcrect, dst, dstrect);
+	}
+	SDL_UnlockBlit(src, dst, src_locked, dst_locked);
+
+	return(okay ? 0 : -1);
+}
+
+/* The general purpose software blit routine */
+static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	return SDL_SoftBlitRects(src, srcrect, dst, dstrect, 1);
+}
+
 #ifdef MMX_ASMBLIT
 static __inline__ void SDL_memcpyMMX(Uint8 *to, const Uint8 *from, int len)
 {
@@ -233,9 +344,12 @@ static void SDL_BlitCopyOverlap(SDL_BlitInfo *info)
 int SDL_CalculateBlit(SDL_Surface *surface)
 {
 	int blit_index;
+	int keep_rle;
 
-	/* Clean everything out to start */
-	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
+	/* Clean everything out to start, but keep an RLE encoding that
+	   was made for (or loaded for) this kind of destination already */
+	keep_rle = SDL_RLEFits(surface, surface->map->dst);
+	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL && ! keep_rle ) {
 		SDL_UnRLESurface(surface, 1);
 	}
 	surface->map->sw_blit = NULL;
@@ -344,13 +458,17 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 	        if(surface->map->identity
 		   && (blit_index == 1
 		       || (blit_index == 3 && !surface->format->Amask))) {
-		        if ( SDL_RLESurface(surface) == 0 )
+		        if ( keep_rle || SDL_RLESurface(surface) == 0 )
 			        surface->map->sw_blit = SDL_RLEBlit;
 		} else if(blit_index == 2 && surface->format->Amask) {
-		        if ( SDL_RLESurface(surface) == 0 )
+		        if ( keep_rle || SDL_RLESurface(surface) == 0 )
 			        surface->map->sw_blit = SDL_RLEAlphaBlit;
 		}
 	}
+	if ( keep_rle && surface->map->sw_blit != SDL_RLEBlit &&
+	     surface->map->sw_blit != SDL_RLEAlphaBlit ) {
+		SDL_UnRLESurface(surface, 1);
+	}
 	
 	if ( surface->map->sw_blit == NULL ) {
 		surface->map->sw_blit = SDL_SoftBlit;
@@ -52,13 +52,18 @@ typedef void (*SDL_loblit)(SDL_BlitInfo *info);
 struct private_swaccel {
 	SDL_loblit blit;
 	void *aux_data;
+	int aux_shared;		/* aux_data belongs to the application */
 };
 
+/* The nearest palette entries to RGB colors, see SDL_pixels.c */
+typedef struct SDL_InverseMap SDL_InverseMap;
+
 /* Blit mapping definition */
 typedef struct SDL_BlitMap {
 	SDL_Surface *dst;
 	int identity;
 	Uint8 *table;
+	SDL_InverseMap *inverse;	/* owns the table of N->1 mappings */
 	SDL_blit hw_blit;
 	SDL_blit sw_blit;
 	struct private_hwaccel *hw_data;
@@ -67,11 +72,50 @@ typedef struct SDL_BlitMap {
 	/* the version count matches the destination; mismatch indicates
 	   an invalid mapping */
         unsigned int format_version;
+
+	/* the destination format, if the mapping can be shared with any
+	   other software surface of the same format */
+	int shareable;
+	Uint8 dst_BitsPerPixel;
+	Uint32 dst_Rmask, dst_Gmask, dst_Bmask, dst_Amask;
+
+	/* recent mappings to other destinations, most recently used first */
+	struct SDL_BlitMap *next;
+
+	/* the clip rectangle of the surface with 32-bit coordinates, only
+	   in the first mapping of the list */
+	SDL_Rect32 clip;
 } SDL_BlitMap;
 
+/* How many mappings to other destinations a surface remembers */
+#define SDL_BLITMAP_CACHE	4
+
+/* Surfaces with rows over 64K keep the high bits of their pitch in the
+   top half of 'unused1', see SDL_SetSurfacePitch()
+ */
+#define SDL_PITCH_HIGH_BITS	0xFFFF0000
+#define SDL_SURFACE_PITCH(surface) \
+	((Uint32)(surface)->pitch | ((surface)->unused1 & SDL_PITCH_HIGH_BITS))
+
+/* Converting between SDL_Rect and SDL_Rect32 */
+#define SDL_RECT32_FITS(r) \
+	((r)->x >= -32768 && (r)->x <= 32767 && \
+	 (r)->y >= -32768 && (r)->y <= 32767 && \
+	 (r)->w >= 0 && (r)->w <= 65535 && (r)->h >= 0 && (r)->h <= 65535)
+#define SDL_WIDEN_RECT(r32, r) \
+	((r32)->x = (r)->x, (r32)->y = (r)->y, \
+	 (r32)->w = (r)->w, (r32)->h = (r)->h)
+#define SDL_NARROW_RECT(r, r32) \
+	((r)->x = (Sint16)(r32)->x, (r)->y = (Sint16)(r32)->y, \
+	 (r)->w = (Uint16)(r32)->w, (r)->h = (Uint16)(r32)->h)
+
 
 /* Functions found in SDL_blit.c */
 extern int SDL_CalculateBlit(SDL_Surface *surface);
+extern int SDL_SoftBlitRects(SDL_Surface *src, const SDL_Rect *srcrects,
+			SDL_Surface *dst, const SDL_Rect *dstrects, int n);
+extern int SDL_SoftBlit32(SDL_Surface *src, const SDL_Rect32 *srcrect,
+			SDL_Surface *dst, const SDL_Rect32 *dstrect);
 
 /* Functions found in SDL_blit_{0,1,N,A}.c */
 extern SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int complex);
@@ -87,6 +131,10 @@ extern SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int complex);
     ((A)->BitsPerPixel == (B)->BitsPerPixel				\
      && ((A)->Rmask == (B)->Rmask) && ((A)->Amask == (B)->Amask))
 
+/* Index of an 8-bit R-G-B color in the inverse colormap of a palette */
+#define INVERSE_INDEX(r, g, b)						\
+    ((((r) & 0xF8) << 7) | (((g) & 0xF8) << 2) | (((b) & 0xF8) >> 3))
+
 /* Load pixel of the specified format from a buffer and get its R-G-B values */
 /* FIXME: rescale values to 0..255 here? */
 #define RGB_FROM_PIXEL(Pixel, fmt, r, g, b)				\
@@ -53,6 +53,7 @@
 
 /* Function to check the CPU flags */
 #include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 #if GCC_ASMBLIT
 #include "mmx.h"
 #elif MSVC_ASMBLIT
@@ -102,9 +103,7 @@ static void BlitNto1SurfaceAlpha(SDL_BlitInfo *info)
 			  ((dG>>5)<<(2))|
 			  ((dB>>6)<<(0));
 		} else {
-		    *dst = palmap[((dR>>5)<<(3+2))|
-				  ((dG>>5)<<(2))  |
-				  ((dB>>6)<<(0))];
+		    *dst = palmap[INVERSE_INDEX(dR, dG, dB)];
 		}
 		dst++;
 		src += srcbpp;
@@ -155,9 +154,7 @@ static void BlitNto1PixelAlpha(SDL_BlitInfo *info)
 			  ((dG>>5)<<(2))|
 			  ((dB>>6)<<(0));
 		} else {
-		    *dst = palmap[((dR>>5)<<(3+2))|
-				  ((dG>>5)<<(2))  |
-				  ((dB>>6)<<(0))  ];
+		    *dst = palmap[INVERSE_INDEX(dR, dG, dB)];
 		}
 		dst++;
 		src += srcbpp;
@@ -210,9 +207,7 @@ static void BlitNto1SurfaceAlphaKey(SDL_BlitInfo *info)
 			      ((dG>>5)<<(2)) |
 			      ((dB>>6)<<(0));
 		    } else {
-			*dst = palmap[((dR>>5)<<(3+2))|
-				      ((dG>>5)<<(2))  |
-				      ((dB>>6)<<(0))  ];
+			*dst = palmap[INVERSE_INDEX(dR, dG, dB)];
 		    }
 		}
 		dst++;
@@ -2644,6 +2639,659 @@ static void BlitARGBto555PixelAlpha(SDL_BlitInfo *info)
 	}
 }
 
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/*
+ * SSE2 / AVX2 blenders for x86.  These use the same fixed point math as
+ * the scalar versions above, d + ((s - d) * alpha >> 8), computed as
+ * (s * alpha + d * (256 - alpha)) >> 8 so it fits in unsigned 16 bit
+ * lanes.  Opaque pixels use alpha=256 so they copy the source exactly.
+ * The 16 bpp ones blend each channel like the C blitter they replace:
+ * at 5 bits like BlitARGBto565PixelAlpha() for pixel alpha, and widened
+ * to 8 bits like ALPHA_BLEND() in BlitNtoNSurfaceAlpha() for surface alpha.
+ */
+
+/* single pixel versions for the row tails, with the same rounding */
+static __inline__ Uint32 Blend32(Uint32 s, Uint32 d, unsigned alpha)
+{
+	Uint32 rb = ((s & 0xff00ff) * alpha + (d & 0xff00ff) * (256 - alpha))
+	            >> 8;
+	Uint32 g = ((s & 0xff00) * alpha + (d & 0xff00) * (256 - alpha)) >> 8;
+	return (rb & 0xff00ff) | (g & 0xff00);
+}
+
+static __inline__ Uint32 BlendRGBtoRGBPixelAlpha(Uint32 s, Uint32 d)
+{
+	unsigned alpha = s >> 24;
+	if(alpha == SDL_ALPHA_OPAQUE) {
+		alpha = 256;
+	}
+	return Blend32(s, d, alpha) | (d & 0xff000000);
+}
+
+static __inline__ Uint32 BlendRGBtoRGBSurfaceAlpha(Uint32 s, Uint32 d,
+                                                   unsigned alpha)
+{
+	return Blend32(s, d, alpha) | 0xff000000;
+}
+
+/* blend one 32 bit pixel into RGB565/RGB555 with a 5 bit alpha */
+static __inline__ Uint16 Blend32to16(Uint32 s, Uint16 d, int alpha, int is565)
+{
+	const int gbits = is565 ? 6 : 5;
+	const int gmask = (1 << gbits) - 1;
+	int sl = s >> 3 & 0x1f;
+	int sg = s >> (16 - gbits) & gmask;
+	int sh = s >> 19 & 0x1f;
+	int dl = d & 0x1f;
+	int dg = d >> 5 & gmask;
+	int dh = d >> (5 + gbits) & 0x1f;
+
+	dl += (sl - dl) * alpha >> 5;
+	dg += (sg - dg) * alpha >> 5;
+	dh += (sh - dh) * alpha >> 5;
+	return (Uint16)(dl | dg << 5 | dh << (5 + gbits));
+}
+
+/*
+ * blend one 32 bit pixel into RGB565/RGB555 with an 8 bit alpha, as
+ * ALPHA_BLEND() does on the destination widened to 8 bits per channel:
+ * d + (((s - d) * alpha + 255) >> 8) is (s * alpha + d * (256 - alpha)
+ * + 255) >> 8, which doesn't go negative and fits in 16 bits
+ */
+static __inline__ Uint16 Blend32to16Surface(Uint32 s, Uint16 d,
+                                            unsigned alpha, int is565)
+{
+	const int gbits = is565 ? 6 : 5;
+	const unsigned gmask = (1 << gbits) - 1;
+	unsigned dl = (d & 0x1f) << 3;
+	unsigned dg = (d >> 5 & gmask) << (8 - gbits);
+	unsigned dh = (d >> (5 + gbits) & 0x1f) << 3;
+
+	dl = ((s & 0xff) * alpha + dl * (256 - alpha) + 255) >> 11;
+	dg = ((s >> 8 & 0xff) * alpha + dg * (256 - alpha) + 255) >> (16 - gbits);
+	dh = ((s >> 16 & 0xff) * alpha + dh * (256 - alpha) + 255) >> 11;
+	return (Uint16)(dl | dg << 5 | dh << (5 + gbits));
+}
+
+static __inline__ void Blit32to16PixelAlphaTail(Uint32 *srcp, Uint16 *dstp,
+                                                int n, int is565)
+{
+	while(n--) {
+		Uint32 s = *srcp++;
+		unsigned alpha = s >> 27; /* downscale alpha to 5 bits */
+		if(alpha) {
+			/* alpha 32 copies the source pixel exactly */
+			if(alpha == (SDL_ALPHA_OPAQUE >> 3)) {
+				alpha = 32;
+			}
+			*dstp = Blend32to16(s, *dstp, alpha, is565);
+		}
+		dstp++;
+	}
+}
+#endif /* SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS */
+
+#if SDL_SSE2_INTRINSICS
+/* blend 4 ARGB pixels with the 16 bit alpha factors in each channel */
+static __inline__ __m128i SDL_TARGETING("sse2")
+Blend4x32_SSE2(__m128i s, __m128i d, __m128i alo, __m128i ahi)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c256 = _mm_set1_epi16(256);
+	__m128i lo, hi;
+
+	lo = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), alo),
+		_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero),
+		                _mm_sub_epi16(c256, alo)));
+	hi = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), ahi),
+		_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero),
+		                _mm_sub_epi16(c256, ahi)));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+/* broadcast the alpha of each pixel to all channels, with 255 -> 256 */
+static __inline__ __m128i SDL_TARGETING("sse2")
+ExpandAlpha_SSE2(__m128i s16)
+{
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xff), 0xff);
+	return _mm_sub_epi16(a, _mm_cmpeq_epi16(a, _mm_set1_epi16(0xff)));
+}
+
+/* SSE2 ARGB888->(A)RGB888 blending with pixel alpha */
+static void SDL_TARGETING("sse2") BlitRGBtoRGBPixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(0xff000000);
+
+	while(height--) {
+		int n = width;
+		while(n >= 4) {
+			__m128i s = _mm_loadu_si128((const __m128i *)srcp);
+			__m128i sa = _mm_and_si128(s, amask);
+			/* skip fully transparent runs, copy fully opaque ones */
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) != 0xffff) {
+				__m128i d = _mm_loadu_si128((__m128i *)dstp);
+				__m128i da = _mm_and_si128(d, amask);
+				if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, amask)) != 0xffff) {
+					s = Blend4x32_SSE2(s, d,
+					    ExpandAlpha_SSE2(_mm_unpacklo_epi8(s, zero)),
+					    ExpandAlpha_SSE2(_mm_unpackhi_epi8(s, zero)));
+				}
+				d = _mm_or_si128(_mm_andnot_si128(amask, s), da);
+				_mm_storeu_si128((__m128i *)dstp, d);
+			}
+			srcp += 4;
+			dstp += 4;
+			n -= 4;
+		}
+		while(n--) {
+			*dstp = BlendRGBtoRGBPixelAlpha(*srcp, *dstp);
+			srcp++;
+			dstp++;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* SSE2 RGB888->(A)RGB888 blending with surface alpha */
+static void SDL_TARGETING("sse2") BlitRGBtoRGBSurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	unsigned alpha = info->src->alpha;
+	const __m128i a = _mm_set1_epi16(alpha);
+	const __m128i amask = _mm_set1_epi32(0xff000000);
+
+	while(height--) {
+		int n = width;
+		while(n >= 4) {
+			__m128i s = _mm_loadu_si128((const __m128i *)srcp);
+			__m128i d = _mm_loadu_si128((__m128i *)dstp);
+			d = _mm_or_si128(Blend4x32_SSE2(s, d, a, a), amask);
+			_mm_storeu_si128((__m128i *)dstp, d);
+			srcp += 4;
+			dstp += 4;
+			n -= 4;
+		}
+		while(n--) {
+			*dstp = BlendRGBtoRGBSurfaceAlpha(*srcp, *dstp, alpha);
+			srcp++;
+			dstp++;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* extract a bit field from each 32 bit pixel, packed to 8 16 bit lanes */
+#define FIELD32x8_SSE2(s0, s1, shift, mask)				\
+	_mm_packs_epi32(						\
+		_mm_and_si128(_mm_srli_epi32(s0, shift), mask),		\
+		_mm_and_si128(_mm_srli_epi32(s1, shift), mask))
+
+/*
+ * blend 8 ARGB8888 pixels into 8 RGB565/RGB555 pixels; each channel is
+ * blended at its destination precision, with a 5 bit alpha
+ */
+static __inline__ __m128i SDL_TARGETING("sse2")
+Blend32to16_SSE2(__m128i s0, __m128i s1, __m128i d, __m128i alpha, int is565)
+{
+	const __m128i m5 = _mm_set1_epi32(0x1f);
+	const __m128i mg = _mm_set1_epi32(is565 ? 0x3f : 0x1f);
+	const __m128i m5w = _mm_set1_epi16(0x1f);
+	const __m128i mgw = _mm_set1_epi16(is565 ? 0x3f : 0x1f);
+	const int gshift = is565 ? 6 : 5;
+	__m128i sl, sg, sh, dl, dg, dh;
+
+	sl = FIELD32x8_SSE2(s0, s1, 3, m5);
+	sg = FIELD32x8_SSE2(s0, s1, 16 - gshift, mg);
+	sh = FIELD32x8_SSE2(s0, s1, 19, m5);
+	dl = _mm_and_si128(d, m5w);
+	dg = _mm_and_si128(_mm_srli_epi16(d, 5), mgw);
+	dh = _mm_and_si128(_mm_srli_epi16(d, 5 + gshift), m5w);
+
+	dl = _mm_add_epi16(dl, _mm_srai_epi16(
+		_mm_mullo_epi16(_mm_sub_epi16(sl, dl), alpha), 5));
+	dg = _mm_add_epi16(dg, _mm_srai_epi16(
+		_mm_mullo_epi16(_mm_sub_epi16(sg, dg), alpha), 5));
+	dh = _mm_add_epi16(dh, _mm_srai_epi16(
+		_mm_mullo_epi16(_mm_sub_epi16(sh, dh), alpha), 5));
+
+	return _mm_or_si128(_mm_or_si128(dl, _mm_slli_epi16(dg, 5)),
+	                    _mm_slli_epi16(dh, 5 + gshift));
+}
+
+/* 8 pixels of Blend32to16Surface(), 'inv' is 256 - alpha */
+static __inline__ __m128i SDL_TARGETING("sse2")
+Blend32to16Surface_SSE2(__m128i s0, __m128i s1, __m128i d,
+                        __m128i alpha, __m128i inv, int is565)
+{
+	const __m128i m8 = _mm_set1_epi32(0xff);
+	const __m128i m5w = _mm_set1_epi16(0x1f);
+	const __m128i mgw = _mm_set1_epi16(is565 ? 0x3f : 0x1f);
+	const __m128i c255 = _mm_set1_epi16(255);
+	const int gshift = is565 ? 6 : 5;
+	__m128i sl, sg, sh, dl, dg, dh;
+
+	sl = FIELD32x8_SSE2(s0, s1, 0, m8);
+	sg = FIELD32x8_SSE2(s0, s1, 8, m8);
+	sh = FIELD32x8_SSE2(s0, s1, 16, m8);
+	dl = _mm_slli_epi16(_mm_and_si128(d, m5w), 3);
+	dg = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(d, 5), mgw),
+	                    8 - gshift);
+	dh = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(d, 5 + gshift), m5w),
+	                    3);
+
+	dl = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(sl, alpha), _mm_mullo_epi16(dl, inv)), c255), 11);
+	dg = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(sg, alpha), _mm_mullo_epi16(dg, inv)), c255),
+		16 - gshift);
+	dh = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(sh, alpha), _mm_mullo_epi16(dh, inv)), c255), 11);
+
+	return _mm_or_si128(_mm_or_si128(dl, _mm_slli_epi16(dg, 5)),
+	                    _mm_slli_epi16(dh, 5 + gshift));
+}
+
+static __inline__ void SDL_TARGETING("sse2")
+Blit32to16PixelAlphaSSE2(SDL_BlitInfo *info, int is565)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a31 = _mm_set1_epi16(SDL_ALPHA_OPAQUE >> 3);
+	const __m128i top = _mm_set1_epi16(is565 ? 0 : 0x8000);
+
+	while(height--) {
+		int n = width;
+		while(n >= 8) {
+			__m128i s0 = _mm_loadu_si128((const __m128i *)srcp);
+			__m128i s1 = _mm_loadu_si128((const __m128i *)(srcp + 4));
+			/* downscale alpha to 5 bits */
+			__m128i alpha = _mm_packs_epi32(_mm_srli_epi32(s0, 27),
+			                                _mm_srli_epi32(s1, 27));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(alpha, zero)) != 0xffff) {
+				__m128i d = _mm_loadu_si128((__m128i *)dstp);
+				/* transparent pixels keep the unused bit of RGB555 */
+				__m128i keep = _mm_and_si128(d, _mm_and_si128(
+					_mm_cmpeq_epi16(alpha, zero), top));
+				alpha = _mm_sub_epi16(alpha, _mm_cmpeq_epi16(alpha, a31));
+				d = Blend32to16_SSE2(s0, s1, d, alpha, is565);
+				d = _mm_or_si128(d, keep);
+				_mm_storeu_si128((__m128i *)dstp, d);
+			}
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		Blit32to16PixelAlphaTail(srcp, dstp, n, is565);
+		srcp += n + srcskip;
+		dstp += n + dstskip;
+	}
+}
+
+static __inline__ void SDL_TARGETING("sse2")
+Blit32to16SurfaceAlphaSSE2(SDL_BlitInfo *info, int is565)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	unsigned alpha = info->src->alpha;
+	const __m128i a = _mm_set1_epi16(alpha);
+	const __m128i inv = _mm_set1_epi16(256 - alpha);
+
+	/* BlitNtoNSurfaceAlpha() leaves everything alone */
+	if(alpha == 0) {
+		return;
+	}
+	while(height--) {
+		int n = width;
+		while(n >= 8) {
+			__m128i s0 = _mm_loadu_si128((const __m128i *)srcp);
+			__m128i s1 = _mm_loadu_si128((const __m128i *)(srcp + 4));
+			__m128i d = _mm_loadu_si128((__m128i *)dstp);
+			d = Blend32to16Surface_SSE2(s0, s1, d, a, inv, is565);
+			_mm_storeu_si128((__m128i *)dstp, d);
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		while(n--) {
+			*dstp = Blend32to16Surface(*srcp, *dstp, alpha, is565);
+			srcp++;
+			dstp++;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* SSE2 ARGB8888->RGB565 blending with pixel alpha */
+static void SDL_TARGETING("sse2") BlitARGBto565PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit32to16PixelAlphaSSE2(info, 1);
+}
+
+/* SSE2 ARGB8888->RGB555 blending with pixel alpha */
+static void SDL_TARGETING("sse2") BlitARGBto555PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit32to16PixelAlphaSSE2(info, 0);
+}
+
+/* SSE2 RGB888->RGB565 blending with surface alpha */
+static void SDL_TARGETING("sse2") BlitRGBto565SurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit32to16SurfaceAlphaSSE2(info, 1);
+}
+
+/* SSE2 RGB888->RGB555 blending with surface alpha */
+static void SDL_TARGETING("sse2") BlitRGBto555SurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit32to16SurfaceAlphaSSE2(info, 0);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* AVX2 versions of the above, 8 (32 bpp) or 16 (16 bpp) pixels at a time */
+static __inline__ __m256i SDL_TARGETING("avx2")
+Blend8x32_AVX2(__m256i s, __m256i d, __m256i alo, __m256i ahi)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i c256 = _mm256_set1_epi16(256);
+	__m256i lo, hi;
+
+	lo = _mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), alo),
+		_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero),
+		                   _mm256_sub_epi16(c256, alo)));
+	hi = _mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), ahi),
+		_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero),
+		                   _mm256_sub_epi16(c256, ahi)));
+	return _mm256_packus_epi16(_mm256_srli_epi16(lo, 8),
+	                           _mm256_srli_epi16(hi, 8));
+}
+
+static __inline__ __m256i SDL_TARGETING("avx2")
+ExpandAlpha_AVX2(__m256i s16)
+{
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s16, 0xff), 0xff);
+	return _mm256_sub_epi16(a, _mm256_cmpeq_epi16(a, _mm256_set1_epi16(0xff)));
+}
+
+/* AVX2 ARGB888->(A)RGB888 blending with pixel alpha */
+static void SDL_TARGETING("avx2") BlitRGBtoRGBPixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i amask = _mm256_set1_epi32(0xff000000);
+
+	while(height--) {
+		int n = width;
+		while(n >= 8) {
+			__m256i s = _mm256_loadu_si256((const __m256i *)srcp);
+			__m256i sa = _mm256_and_si256(s, amask);
+			/* skip fully transparent runs, copy fully opaque ones */
+			if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) != -1) {
+				__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+				__m256i da = _mm256_and_si256(d, amask);
+				if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, amask)) != -1) {
+					s = Blend8x32_AVX2(s, d,
+					    ExpandAlpha_AVX2(_mm256_unpacklo_epi8(s, zero)),
+					    ExpandAlpha_AVX2(_mm256_unpackhi_epi8(s, zero)));
+				}
+				d = _mm256_or_si256(_mm256_andnot_si256(amask, s), da);
+				_mm256_storeu_si256((__m256i *)dstp, d);
+			}
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		while(n--) {
+			*dstp = BlendRGBtoRGBPixelAlpha(*srcp, *dstp);
+			srcp++;
+			dstp++;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* AVX2 RGB888->(A)RGB888 blending with surface alpha */
+static void SDL_TARGETING("avx2") BlitRGBtoRGBSurfaceAlphaAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	unsigned alpha = info->src->alpha;
+	const __m256i a = _mm256_set1_epi16(alpha);
+	const __m256i amask = _mm256_set1_epi32(0xff000000);
+
+	while(height--) {
+		int n = width;
+		while(n >= 8) {
+			__m256i s = _mm256_loadu_si256((const __m256i *)srcp);
+			__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+			d = _mm256_or_si256(Blend8x32_AVX2(s, d, a, a), amask);
+			_mm256_storeu_si256((__m256i *)dstp, d);
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		while(n--) {
+			*dstp = BlendRGBtoRGBSurfaceAlpha(*srcp, *dstp, alpha);
+			srcp++;
+			dstp++;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* packs_epi32 works per 128 bit lane, so put the quadwords back in order */
+#define FIELD32x16_AVX2(s0, s1, shift, mask)				\
+	_mm256_permute4x64_epi64(_mm256_packs_epi32(			\
+		_mm256_and_si256(_mm256_srli_epi32(s0, shift), mask),	\
+		_mm256_and_si256(_mm256_srli_epi32(s1, shift), mask)), 0xd8)
+
+static __inline__ __m256i SDL_TARGETING("avx2")
+Blend32to16_AVX2(__m256i s0, __m256i s1, __m256i d, __m256i alpha, int is565)
+{
+	const __m256i m5 = _mm256_set1_epi32(0x1f);
+	const __m256i mg = _mm256_set1_epi32(is565 ? 0x3f : 0x1f);
+	const __m256i m5w = _mm256_set1_epi16(0x1f);
+	const __m256i mgw = _mm256_set1_epi16(is565 ? 0x3f : 0x1f);
+	const int gshift = is565 ? 6 : 5;
+	__m256i sl, sg, sh, dl, dg, dh;
+
+	sl = FIELD32x16_AVX2(s0, s1, 3, m5);
+	sg = FIELD32x16_AVX2(s0, s1, 16 - gshift, mg);
+	sh = FIELD32x16_AVX2(s0, s1, 19, m5);
+	dl = _mm256_and_si256(d, m5w);
+	dg = _mm256_and_si256(_mm256_srli_epi16(d, 5), mgw);
+	dh = _mm256_and_si256(_mm256_srli_epi16(d, 5 + gshift), m5w);
+
+	dl = _mm256_add_epi16(dl, _mm256_srai_epi16(
+		_mm256_mullo_epi16(_mm256_sub_epi16(sl, dl), alpha), 5));
+	dg = _mm256_add_epi16(dg, _mm256_srai_epi16(
+		_mm256_mullo_epi16(_mm256_sub_epi16(sg, dg), alpha), 5));
+	dh = _mm256_add_epi16(dh, _mm256_srai_epi16(
+		_mm256_mullo_epi16(_mm256_sub_epi16(sh, dh), alpha), 5));
+
+	return _mm256_or_si256(_mm256_or_si256(dl, _mm256_slli_epi16(dg, 5)),
+	                       _mm256_slli_epi16(dh, 5 + gshift));
+}
+
+static __inline__ __m256i SDL_TARGETING("avx2")
+Blend32to16Surface_AVX2(__m256i s0, __m256i s1, __m256i d,
+                        __m256i alpha, __m256i inv, int is565)
+{
+	const __m256i m8 = _mm256_set1_epi32(0xff);
+	const __m256i m5w = _mm256_set1_epi16(0x1f);
+	const __m256i mgw = _mm256_set1_epi16(is565 ? 0x3f : 0x1f);
+	const __m256i c255 = _mm256_set1_epi16(255);
+	const int gshift = is565 ? 6 : 5;
+	__m256i sl, sg, sh, dl, dg, dh;
+
+	sl = FIELD32x16_AVX2(s0, s1, 0, m8);
+	sg = FIELD32x16_AVX2(s0, s1, 8, m8);
+	sh = FIELD32x16_AVX2(s0, s1, 16, m8);
+	dl = _mm256_slli_epi16(_mm256_and_si256(d, m5w), 3);
+	dg = _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(d, 5), mgw),
+	                       8 - gshift);
+	dh = _mm256_slli_epi16(_mm256_and_si256(
+		_mm256_srli_epi16(d, 5 + gshift), m5w), 3);
+
+	dl = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+		_mm256_mullo_epi16(sl, alpha), _mm256_mullo_epi16(dl, inv)),
+		c255), 11);
+	dg = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+		_mm256_mullo_epi16(sg, alpha), _mm256_mullo_epi16(dg, inv)),
+		c255), 16 - gshift);
+	dh = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(
+		_mm256_mullo_epi16(sh, alpha), _mm256_mullo_epi16(dh, inv)),
+		c255), 11);
+
+	return _mm256_or_si256(_mm256_or_si256(dl, _mm256_slli_epi16(dg, 5)),
+	                       _mm256_slli_epi16(dh, 5 + gshift));
+}
+
+static __inline__ void SDL_TARGETING("avx2")
+Blit32to16PixelAlphaAVX2(SDL_BlitInfo *info, int is565)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i a31 = _mm256_set1_epi16(SDL_ALPHA_OPAQUE >> 3);
+	const __m256i top = _mm256_set1_epi16(is565 ? 0 : 0x8000);
+
+	while(height--) {
+		int n = width;
+		while(n >= 16) {
+			__m256i s0 = _mm256_loadu_si256((const __m256i *)srcp);
+			__m256i s1 = _mm256_loadu_si256((const __m256i *)(srcp + 8));
+			/* downscale alpha to 5 bits */
+			__m256i alpha = _mm256_permute4x64_epi64(_mm256_packs_epi32(
+				_mm256_srli_epi32(s0, 27),
+				_mm256_srli_epi32(s1, 27)), 0xd8);
+			if(_mm256_movemask_epi8(_mm256_cmpeq_epi16(alpha, zero)) != -1) {
+				__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+				/* transparent pixels keep the unused bit of RGB555 */
+				__m256i keep = _mm256_and_si256(d, _mm256_and_si256(
+					_mm256_cmpeq_epi16(alpha, zero), top));
+				alpha = _mm256_sub_epi16(alpha,
+				                         _mm256_cmpeq_epi16(alpha, a31));
+				d = Blend32to16_AVX2(s0, s1, d, alpha, is565);
+				d = _mm256_or_si256(d, keep);
+				_mm256_storeu_si256((__m256i *)dstp, d);
+			}
+			srcp += 16;
+			dstp += 16;
+			n -= 16;
+		}
+		Blit32to16PixelAlphaTail(srcp, dstp, n, is565);
+		srcp += n + srcskip;
+		dstp += n + dstskip;
+	}
+}
+
+static __inline__ void SDL_TARGETING("avx2")
+Blit32to16SurfaceAlphaAVX2(SDL_BlitInfo *info, int is565)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	unsigned alpha = info->src->alpha;
+	const __m256i a = _mm256_set1_epi16(alpha);
+	const __m256i inv = _mm256_set1_epi16(256 - alpha);
+
+	/* BlitNtoNSurfaceAlpha() leaves everything alone */
+	if(alpha == 0) {
+		return;
+	}
+	while(height--) {
+		int n = width;
+		while(n >= 16) {
+			__m256i s0 = _mm256_loadu_si256((const __m256i *)srcp);
+			__m256i s1 = _mm256_loadu_si256((const __m256i *)(srcp + 8));
+			__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+			d = Blend32to16Surface_AVX2(s0, s1, d, a, inv, is565);
+			_mm256_storeu_si256((__m256i *)dstp, d);
+			srcp += 16;
+			dstp += 16;
+			n -= 16;
+		}
+		while(n--) {
+			*dstp = Blend32to16Surface(*srcp, *dstp, alpha, is565);
+			srcp++;
+			dstp++;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* AVX2 ARGB8888->RGB565 blending with pixel alpha */
+static void SDL_TARGETING("avx2") BlitARGBto565PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	Blit32to16PixelAlphaAVX2(info, 1);
+}
+
+/* AVX2 ARGB8888->RGB555 blending with pixel alpha */
+static void SDL_TARGETING("avx2") BlitARGBto555PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	Blit32to16PixelAlphaAVX2(info, 0);
+}
+
+/* AVX2 RGB888->RGB565 blending with surface alpha */
+static void SDL_TARGETING("avx2") BlitRGBto565SurfaceAlphaAVX2(SDL_BlitInfo *info)
+{
+	Blit32to16SurfaceAlphaAVX2(info, 1);
+}
+
+/* AVX2 RGB888->RGB555 blending with surface alpha */
+static void SDL_TARGETING("avx2") BlitRGBto555SurfaceAlphaAVX2(SDL_BlitInfo *info)
+{
+	Blit32to16SurfaceAlphaAVX2(info, 0);
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
 /* General (slow) N->N blending with per-surface alpha */
 static void BlitNtoNSurfaceAlpha(SDL_BlitInfo *info)
 {
@@ -2824,6 +3472,36 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 			return Blit555to555SurfaceAlpha;
 		    }
 		}
+#if SDL_AVX2_INTRINSICS || SDL_SSE2_INTRINSICS
+		if(sf->BytesPerPixel == 4 && sf->Gmask == 0xff00
+		   && (sf->Rmask | sf->Gmask | sf->Bmask) == 0xffffff
+		   && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
+		       || (sf->Bmask == 0xff && df->Bmask == 0x1f)))
+		{
+		    if(df->Gmask == 0x7e0)
+		    {
+#if SDL_AVX2_INTRINSICS
+			if(SDL_HasAVX2())
+			    return BlitRGBto565SurfaceAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+			if(SDL_HasSSE2())
+			    return BlitRGBto565SurfaceAlphaSSE2;
+#endif
+		    }
+		    else if(df->Gmask == 0x3e0)
+		    {
+#if SDL_AVX2_INTRINSICS
+			if(SDL_HasAVX2())
+			    return BlitRGBto555SurfaceAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+			if(SDL_HasSSE2())
+			    return BlitRGBto555SurfaceAlphaSSE2;
+#endif
+		    }
+		}
+#endif
 		return BlitNtoNSurfaceAlpha;
 
 	    case 4:
@@ -2832,6 +3510,17 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		   && sf->Bmask == df->Bmask
 		   && sf->BytesPerPixel == 4)
 		{
+			if((sf->Rmask | sf->Gmask | sf->Bmask) == 0xffffff)
+			{
+#if SDL_AVX2_INTRINSICS
+				if(SDL_HasAVX2())
+					return BlitRGBtoRGBSurfaceAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+				if(SDL_HasSSE2())
+					return BlitRGBtoRGBSurfaceAlphaSSE2;
+#endif
+			}
 #if MMX_ASMBLIT
 			if(sf->Rshift % 8 == 0
 			   && sf->Gshift % 8 == 0
@@ -2896,10 +3585,27 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Gmask == 0xff00
 	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
-		if(df->Gmask == 0x7e0)
+		if(df->Gmask == 0x7e0) {
+#if SDL_AVX2_INTRINSICS
+		    if(SDL_HasAVX2())
+			return BlitARGBto565PixelAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+		    if(SDL_HasSSE2())
+			return BlitARGBto565PixelAlphaSSE2;
+#endif
 		    return BlitARGBto565PixelAlpha;
-		else if(df->Gmask == 0x3e0)
+		} else if(df->Gmask == 0x3e0) {
+#if SDL_AVX2_INTRINSICS
+		    if(SDL_HasAVX2())
+			return BlitARGBto555PixelAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+		    if(SDL_HasSSE2())
+			return BlitARGBto555PixelAlphaSSE2;
+#endif
 		    return BlitARGBto555PixelAlpha;
+		}
 	    }
 	    return BlitNtoNPixelAlpha;
 
@@ -2909,6 +3615,17 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Bmask == df->Bmask
 	       && sf->BytesPerPixel == 4)
 	    {
+		if(sf->Amask == 0xff000000)
+		{
+#if SDL_AVX2_INTRINSICS
+			if(SDL_HasAVX2())
+				return BlitRGBtoRGBPixelAlphaAVX2;
+#endif
+#if SDL_SSE2_INTRINSICS
+			if(SDL_HasSSE2())
+				return BlitRGBtoRGBPixelAlphaSSE2;
+#endif
+		}
 #if MMX_ASMBLIT
 		if(sf->Rshift % 8 == 0
 		   && sf->Gshift % 8 == 0
@@ -25,6 +25,7 @@
 #include "SDL_endian.h"
 #include "SDL_cpuinfo.h"
 #include "SDL_blit.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
 /* General optimized routines that write char by char */
 #define HAVE_FAST_WRITE_INT8 1
@@ -41,7 +42,11 @@ enum blit_features {
 	BLIT_FEATURE_HAS_MMX = 1,
 	BLIT_FEATURE_HAS_ALTIVEC = 2,
 	BLIT_FEATURE_ALTIVEC_DONT_USE_PREFETCH = 4,
-	BLIT_FEATURE_HAS_ARM_SIMD = 8
+	BLIT_FEATURE_HAS_ARM_SIMD = 8,
+	BLIT_FEATURE_HAS_SSSE3 = 16,
+	BLIT_FEATURE_HAS_AVX2 = 32,
+	/* Not a CPU feature: all channels of both formats are whole bytes */
+	BLIT_FEATURE_BYTE_CHANNELS = 64
 };
 
 #if SDL_ALTIVEC_BLITTERS
@@ -893,6 +898,9 @@ static enum blit_features GetBlitFeatures( void )
                 | ((SDL_HasMMX()) ? BLIT_FEATURE_HAS_MMX : 0)
                 /* Feature 2 is has-AltiVec */
                 | ((SDL_HasAltiVec()) ? BLIT_FEATURE_HAS_ALTIVEC : 0)
+                /* Feature 16 is has-SSSE3, 32 is has-AVX2 */
+                | ((SDL_HasSSSE3()) ? BLIT_FEATURE_HAS_SSSE3 : 0)
+                | ((SDL_HasAVX2()) ? BLIT_FEATURE_HAS_AVX2 : 0)
                 /* Feature 4 is dont-use-prefetch */
                 /* !!!! FIXME: Check for G5 or later, not the cache size! Always prefetch on a G4. */
                 | ((GetL3CacheSize() == 0) ? BLIT_FEATURE_ALTIVEC_DONT_USE_PREFETCH : 0)
@@ -906,7 +914,8 @@ static enum blit_features GetBlitFeatures( void )
 #endif
 #else
 /* Feature 1 is has-MMX */
-#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0))
+#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0) | \
+                           (SDL_HasSSSE3() ? BLIT_FEATURE_HAS_SSSE3 : 0) | (SDL_HasAVX2() ? BLIT_FEATURE_HAS_AVX2 : 0))
 #endif
 
 #if SDL_ARM_SIMD_BLITTERS
@@ -967,6 +976,12 @@ static void Blit_RGB444_RGB888ARMSIMD(SDL_BlitInfo *info)
 	              (((src)&0x0000E000)>>11)| \
 	              (((src)&0x000000C0)>>6)); \
 }
+/* RGB 8-8-8 --> index in the inverse colormap of the palette */
+#define RGB888_INDEX(dst, src) { \
+	dst = (((src)&0x00F80000)>>9)| \
+	      (((src)&0x0000F800)>>6)| \
+	      (((src)&0x000000F8)>>3); \
+}
 static void Blit_RGB888_index8(SDL_BlitInfo *info)
 {
 #ifndef USE_DUFFS_LOOP
@@ -1025,37 +1040,37 @@ static void Blit_RGB888_index8(SDL_BlitInfo *info)
 		while ( height-- ) {
 #ifdef USE_DUFFS_LOOP
 			DUFFS_LOOP(
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
 			, width);
 #else
 			for ( c=width/4; c; --c ) {
 				/* Pack RGB into 8bit pixel */
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
 			}
 			switch ( width & 3 ) {
 				case 3:
-					RGB888_RGB332(Pixel, *src);
+					RGB888_INDEX(Pixel, *src);
 					*dst++ = map[Pixel];
 					++src;
 				case 2:
-					RGB888_RGB332(Pixel, *src);
+					RGB888_INDEX(Pixel, *src);
 					*dst++ = map[Pixel];
 					++src;
 				case 1:
-					RGB888_RGB332(Pixel, *src);
+					RGB888_INDEX(Pixel, *src);
 					*dst++ = map[Pixel];
 					++src;
 			}
@@ -1916,12 +1931,12 @@ static void Blit_RGB565_BGRA8888(SDL_BlitInfo *info)
     Blit_RGB565_32(info, RGB565_BGRA8888_LUT);
 }
 
-/* Special optimized blit for RGB 8-8-8 --> RGB 3-3-2 */
-#ifndef RGB888_RGB332
-#define RGB888_RGB332(dst, src) { \
-	dst = (((src)&0x00E00000)>>16)| \
-	      (((src)&0x0000E000)>>11)| \
-	      (((src)&0x000000C0)>>6); \
+/* RGB 8-8-8 --> index in the inverse colormap of the palette */
+#ifndef RGB888_INDEX
+#define RGB888_INDEX(dst, src) { \
+	dst = (((src)&0x00F80000)>>9)| \
+	      (((src)&0x0000F800)>>6)| \
+	      (((src)&0x000000F8)>>3); \
 }
 #endif
 static void Blit_RGB888_index8_map(SDL_BlitInfo *info)
@@ -1948,7 +1963,7 @@ static void Blit_RGB888_index8_map(SDL_BlitInfo *info)
 #ifdef USE_DUFFS_LOOP
 	while ( height-- ) {
 		DUFFS_LOOP(
-			RGB888_RGB332(Pixel, *src);
+			RGB888_INDEX(Pixel, *src);
 			*dst++ = map[Pixel];
 			++src;
 		, width);
@@ -1959,30 +1974,30 @@ static void Blit_RGB888_index8_map(SDL_BlitInfo *info)
 	while ( height-- ) {
 		for ( c=width/4; c; --c ) {
 			/* Pack RGB into 8bit pixel */
-			RGB888_RGB332(Pixel, *src);
+			RGB888_INDEX(Pixel, *src);
 			*dst++ = map[Pixel];
 			++src;
-			RGB888_RGB332(Pixel, *src);
+			RGB888_INDEX(Pixel, *src);
 			*dst++ = map[Pixel];
 			++src;
-			RGB888_RGB332(Pixel, *src);
+			RGB888_INDEX(Pixel, *src);
 			*dst++ = map[Pixel];
 			++src;
-			RGB888_RGB332(Pixel, *src);
+			RGB888_INDEX(Pixel, *src);
 			*dst++ = map[Pixel];
 			++src;
 		}
 		switch ( width & 3 ) {
 			case 3:
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
 			case 2:
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
 			case 1:
-				RGB888_RGB332(Pixel, *src);
+				RGB888_INDEX(Pixel, *src);
 				*dst++ = map[Pixel];
 				++src;
 		}
@@ -2057,9 +2072,7 @@ static void BlitNto1(SDL_BlitInfo *info)
 								sR, sG, sB);
 				if ( 1 ) {
 				  	/* Pack RGB into 8bit pixel */
-				  	*dst = map[((sR>>5)<<(3+2))|
-						   ((sG>>5)<<(2))  |
-						   ((sB>>6)<<(0))  ];
+				  	*dst = map[INVERSE_INDEX(sR, sG, sB)];
 				}
 				dst++;
 				src += srcbpp;
@@ -2070,9 +2083,7 @@ static void BlitNto1(SDL_BlitInfo *info)
 								sR, sG, sB);
 				if ( 1 ) {
 				  	/* Pack RGB into 8bit pixel */
-				  	*dst = map[((sR>>5)<<(3+2))|
-						   ((sG>>5)<<(2))  |
-						   ((sB>>6)<<(0))  ];
+				  	*dst = map[INVERSE_INDEX(sR, sG, sB)];
 				}
 				dst++;
 				src += srcbpp;
@@ -2233,6 +2244,203 @@ get_permutation(SDL_PixelFormat *srcfmt, SDL_PixelFormat *dstfmt,
     }
 }
 
+#if SDL_SSSE3_INTRINSICS || SDL_AVX2_INTRINSICS
+/* whether every channel of a 24 or 32 bit format is a whole byte */
+static int HasByteChannels(const SDL_PixelFormat *fmt)
+{
+	if ( fmt->BytesPerPixel != 3 && fmt->BytesPerPixel != 4 ) {
+		return 0;
+	}
+	if ( fmt->Rloss || fmt->Gloss || fmt->Bloss ||
+	     (fmt->Rshift % 8) || (fmt->Gshift % 8) || (fmt->Bshift % 8) ) {
+		return 0;
+	}
+	if ( fmt->Amask && (fmt->Aloss || (fmt->Ashift % 8)) ) {
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Build the pshufb mask moving 4 pixels of srcbpp bytes into 4 pixels of
+ * dstbpp bytes, the same permutation as get_permutation() for BlitNtoN()
+ * and BlitNtoNCopyAlpha().  Unused destination bytes are cleared, and
+ * the constant alpha to OR into each destination pixel is returned.
+ * '*keep' gets the destination bytes to leave alone: the padding byte of
+ * a 32 bpp destination in the formats where the table would have picked
+ * Blit_3or4_to_3or4__same_rgb() or __inversed_rgb(), which only write the
+ * 3 color bytes.
+ */
+static Uint32 calc_swizzle_x86(const SDL_PixelFormat *srcfmt,
+                               const SDL_PixelFormat *dstfmt,
+                               Uint8 shuffle[16], Uint32 *keep)
+{
+	int srcbpp = srcfmt->BytesPerPixel;
+	int dstbpp = dstfmt->BytesPerPixel;
+	Uint8 map[4];
+	Uint32 alpha = 0;
+	int i, j;
+
+	*keep = 0;
+	if ( dstbpp == 4 && !dstfmt->Amask &&
+	     (srcfmt->Rmask|srcfmt->Gmask|srcfmt->Bmask) == 0x00FFFFFF &&
+	     (dstfmt->Rmask|dstfmt->Gmask|dstfmt->Bmask) == 0x00FFFFFF &&
+	     srcfmt->Gmask == 0x0000FF00 && dstfmt->Gmask == 0x0000FF00 &&
+	     (srcbpp == 3 || srcfmt->Rmask != dstfmt->Rmask) ) {
+		*keep = 0xFF000000;
+	}
+
+	/* source byte for each byte of a destination pixel (little endian) */
+	SDL_memset(map, 0x80, sizeof(map));
+	map[dstfmt->Rshift / 8] = srcfmt->Rshift / 8;
+	map[dstfmt->Gshift / 8] = srcfmt->Gshift / 8;
+	map[dstfmt->Bshift / 8] = srcfmt->Bshift / 8;
+	if ( dstfmt->Amask ) {
+		if ( srcfmt->Amask ) {
+			map[dstfmt->Ashift / 8] = srcfmt->Ashift / 8;
+		} else {
+			alpha = (Uint32)srcfmt->alpha << dstfmt->Ashift;
+		}
+	}
+
+	SDL_memset(shuffle, 0x80, 16);
+	for ( i = 0; i < 4; ++i ) {
+		for ( j = 0; j < dstbpp; ++j ) {
+			if ( map[j] != 0x80 ) {
+				shuffle[i * dstbpp + j] = (Uint8)(i * srcbpp + map[j]);
+			}
+		}
+	}
+	return alpha;
+}
+
+/* convert the last (up to 4) pixels of a row through a bounce buffer */
+static __inline__ void SDL_TARGETING("ssse3")
+SwizzleTailSSSE3(const Uint8 *src, int srcbpp, Uint8 *dst, int dstbpp,
+                 int n, __m128i shuffle, __m128i alpha, __m128i keep)
+{
+	Uint8 buf[16];
+	__m128i v, d;
+
+	SDL_memset(buf, 0, sizeof(buf));
+	SDL_memcpy(buf, dst, n * dstbpp);
+	d = _mm_and_si128(_mm_loadu_si128((const __m128i *)buf), keep);
+	SDL_memcpy(buf, src, n * srcbpp);
+	v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)buf), shuffle);
+	v = _mm_or_si128(_mm_andnot_si128(keep, _mm_or_si128(v, alpha)), d);
+	_mm_storeu_si128((__m128i *)buf, v);
+	SDL_memcpy(dst, buf, n * dstbpp);
+}
+
+/* SSSE3 24/32 bpp -> 24/32 bpp byte permutation, 4 pixels at a time */
+static void SDL_TARGETING("ssse3") BlitNtoNSwizzleSSSE3(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	int srcbpp = info->src->BytesPerPixel;
+	int dstbpp = info->dst->BytesPerPixel;
+	/* full 16 byte loads and stores must stay inside the row */
+	int minbpp = (srcbpp < dstbpp) ? srcbpp : dstbpp;
+	int blockmin = (16 + minbpp - 1) / minbpp;
+	Uint8 table[16];
+	Uint32 keepbits;
+	__m128i shuffle;
+	__m128i alpha;
+	__m128i keep;
+
+	alpha = _mm_set1_epi32(calc_swizzle_x86(info->src, info->dst, table,
+	                                        &keepbits));
+	shuffle = _mm_loadu_si128((const __m128i *)table);
+	keep = _mm_set1_epi32(keepbits);
+	if ( dstbpp != 4 ) {
+		alpha = _mm_setzero_si128();
+	}
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= blockmin ) {
+			__m128i v = _mm_loadu_si128((const __m128i *)src);
+			v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+			if ( keepbits ) {
+				__m128i d = _mm_loadu_si128((const __m128i *)dst);
+				v = _mm_or_si128(_mm_andnot_si128(keep, v),
+				                 _mm_and_si128(keep, d));
+			}
+			_mm_storeu_si128((__m128i *)dst, v);
+			src += 4 * srcbpp;
+			dst += 4 * dstbpp;
+			n -= 4;
+		}
+		while ( n > 0 ) {
+			int k = (n < 4) ? n : 4;
+			SwizzleTailSSSE3(src, srcbpp, dst, dstbpp, k,
+			                 shuffle, alpha, keep);
+			src += k * srcbpp;
+			dst += k * dstbpp;
+			n -= k;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+#endif /* SDL_SSSE3_INTRINSICS || SDL_AVX2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* AVX2 32 bpp -> 32 bpp byte permutation, 8 pixels at a time */
+static void SDL_TARGETING("avx2") Blit4to4SwizzleAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	Uint8 table[16];
+	Uint32 keepbits;
+	__m128i shuffle, alpha, keep;
+	__m256i shuffle8, alpha8, keep8;
+
+	alpha = _mm_set1_epi32(calc_swizzle_x86(info->src, info->dst, table,
+	                                        &keepbits));
+	shuffle = _mm_loadu_si128((const __m128i *)table);
+	keep = _mm_set1_epi32(keepbits);
+	/* pshufb works within each 128 bit lane, so use the same mask twice */
+	shuffle8 = _mm256_broadcastsi128_si256(shuffle);
+	alpha8 = _mm256_broadcastsi128_si256(alpha);
+	keep8 = _mm256_broadcastsi128_si256(keep);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m256i v = _mm256_loadu_si256((const __m256i *)src);
+			v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle8), alpha8);
+			if ( keepbits ) {
+				__m256i d = _mm256_loadu_si256((const __m256i *)dst);
+				v = _mm256_or_si256(_mm256_andnot_si256(keep8, v),
+				                    _mm256_and_si256(keep8, d));
+			}
+			_mm256_storeu_si256((__m256i *)dst, v);
+			src += 32;
+			dst += 32;
+			n -= 8;
+		}
+		while ( n > 0 ) {
+			int k = (n < 4) ? n : 4;
+			SwizzleTailSSSE3(src, 4, dst, 4, k, shuffle, alpha, keep);
+			src += k * 4;
+			dst += k * 4;
+			n -= k;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
 
 static void BlitNtoN(SDL_BlitInfo *info)
 {
@@ -2451,9 +2659,7 @@ static void BlitNto1Key(SDL_BlitInfo *info)
 								sR, sG, sB);
 				if ( (Pixel & rgbmask) != ckey ) {
 				  	/* Pack RGB into 8bit pixel */
-				  	*dst = (Uint8)palmap[((sR>>5)<<(3+2))|
-							             ((sG>>5)<<(2))  |
-							             ((sB>>6)<<(0))  ];
+				  	*dst = palmap[INVERSE_INDEX(sR, sG, sB)];
 				}
 				dst++;
 				src += srcbpp;
@@ -3089,6 +3295,13 @@ static const struct blit_table normal_blit_2[] = {
     { 0,0,0, 0, 0,0,0, 0, NULL, BlitNtoN, 0 }
 };
 static const struct blit_table normal_blit_3[] = {
+#if SDL_SSSE3_INTRINSICS
+    /* any byte aligned 3->4 or 3->3 permutation */
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSSE3 | BLIT_FEATURE_BYTE_CHANNELS, NULL, BlitNtoNSwizzleSSSE3, NO_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 3, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSSE3 | BLIT_FEATURE_BYTE_CHANNELS, NULL, BlitNtoNSwizzleSSSE3, NO_ALPHA },
+#endif
     /* 3->4 with same rgb triplet */
     {0x000000FF, 0x0000FF00, 0x00FF0000, 4, 0x000000FF, 0x0000FF00, 0x00FF0000,
      0, NULL, Blit_3or4_to_3or4__same_rgb,
@@ -3173,6 +3386,18 @@ static const struct blit_table normal_blit_4[] = {
       0, NULL, Blit_RGB888_RGB565, NO_ALPHA },
     { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x00007C00,0x000003E0,0x0000001F,
       0, NULL, Blit_RGB888_RGB555, NO_ALPHA },
+#endif
+#if SDL_AVX2_INTRINSICS
+    /* any byte aligned 4->4 permutation */
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_AVX2 | BLIT_FEATURE_BYTE_CHANNELS, NULL, Blit4to4SwizzleAVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#if SDL_SSSE3_INTRINSICS
+    /* any byte aligned 4->4 or 4->3 permutation */
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSSE3 | BLIT_FEATURE_BYTE_CHANNELS, NULL, BlitNtoNSwizzleSSSE3, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 3, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSSE3 | BLIT_FEATURE_BYTE_CHANNELS, NULL, BlitNtoNSwizzleSSSE3, NO_ALPHA },
 #endif
     /* 4->3 with same rgb triplet */
     {0x000000FF, 0x0000FF00, 0x00FF0000, 3, 0x000000FF, 0x0000FF00, 0x00FF0000,
@@ -3278,8 +3503,13 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 	} else {
 		/* Now the meat, choose the blitter we want */
 		Uint32 a_need = NO_ALPHA;
+		enum blit_features features = GetBlitFeatures();
 		if(dstfmt->Amask)
 		    a_need = srcfmt->Amask ? COPY_ALPHA : SET_ALPHA;
+#if SDL_SSSE3_INTRINSICS || SDL_AVX2_INTRINSICS
+		if(HasByteChannels(srcfmt) && HasByteChannels(dstfmt))
+		    features |= BLIT_FEATURE_BYTE_CHANNELS;
+#endif
 		table = normal_blit[srcfmt->BytesPerPixel-1];
 		for ( which=0; table[which].dstbpp; ++which ) {
 			if ( MASKOK(srcfmt->Rmask, table[which].srcR) &&
@@ -3290,7 +3520,7 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 			    MASKOK(dstfmt->Bmask, table[which].dstB) &&
 			    dstfmt->BytesPerPixel == table[which].dstbpp &&
 			    (a_need & table[which].alpha) == a_need &&
-			    ((table[which].blit_features & GetBlitFeatures()) == table[which].blit_features) )
+			    ((table[which].blit_features & features) == table[which].blit_features) )
 				break;
 		}
 		sdata->aux_data = table[which].aux_data;
@@ -35,6 +35,7 @@
 
 #include "SDL_video.h"
 #include "SDL_endian.h"
+#include "SDL_blit.h"
 
 /* Compression encodings for BMP files */
 #ifndef BI_RGB
@@ -51,6 +52,7 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 	long fp_offset = 0;
 	int bmpPitch;
 	int i, pad;
+	Uint32 pitch;
 	SDL_Surface *surface;
 	Uint32 Rmask;
 	Uint32 Gmask;
@@ -276,8 +278,9 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 		was_error = SDL_TRUE;
 		goto done;
 	}
+	pitch = SDL_SURFACE_PITCH(surface);
 	top = (Uint8 *)surface->pixels;
-	end = (Uint8 *)surface->pixels+(surface->h*surface->pitch);
+	end = (Uint8 *)surface->pixels+((size_t)surface->h*pitch);
 	switch (ExpandBMP) {
 		case 1:
 			bmpPitch = (biWidth + 7) >> 3;
@@ -288,14 +291,15 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			pad  = (((bmpPitch)%4) ? (4-((bmpPitch)%4)) : 0);
 			break;
 		default:
-			pad  = ((surface->pitch%4) ?
-					(4-(surface->pitch%4)) : 0);
+			/* The surface rows may be padded more than the file's */
+			bmpPitch = surface->w * surface->format->BytesPerPixel;
+			pad  = (((bmpPitch)%4) ? (4-((bmpPitch)%4)) : 0);
 			break;
 	}
 	if ( topDown ) {
 		bits = top;
 	} else {
-		bits = end - surface->pitch;
+		bits = end - pitch;
 	}
 	while ( bits >= top && bits < end ) {
 		switch (ExpandBMP) {
@@ -324,8 +328,8 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			break;
 
 			default:
-			if ( SDL_RWread(src, bits, 1, surface->pitch)
-							 != surface->pitch ) {
+			if ( SDL_RWread(src, bits, 1, bmpPitch)
+							 != bmpPitch ) {
 				SDL_Error(SDL_EFREAD);
 				was_error = SDL_TRUE;
 				goto done;
@@ -370,9 +374,9 @@ SDL_Surface * SDL_LoadBMP_RW (SDL_RWops *src, int freesrc)
 			}
 		}
 		if ( topDown ) {
-			bits += surface->pitch;
+			bits += pitch;
 		} else {
-			bits -= surface->pitch;
+			bits -= pitch;
 		}
 	}
 done:
@@ -445,7 +449,7 @@ int SDL_SaveBMP_RW (SDL_Surface *saveme, SDL_RWops *dst, int freedst)
 			SDL_Rect bounds;
 
 			/* Convert to 24 bits per pixel */
-			surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
+			surface = SDL_CreateRGBSurface32(SDL_SWSURFACE,
 					saveme->w, saveme->h, 24,
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 					0x00FF0000, 0x0000FF00, 0x000000FF,
@@ -471,6 +475,7 @@ int SDL_SaveBMP_RW (SDL_Surface *saveme, SDL_RWops *dst, int freedst)
 
 	if ( surface && (SDL_LockSurface(surface) == 0) ) {
 		const int bw = surface->w*surface->format->BytesPerPixel;
+		const Uint32 pitch = SDL_SURFACE_PITCH(surface);
 
 		/* Set the BMP file header values */
 		bfSize = 0;		 /* We'll write this when we're done */
@@ -494,7 +499,7 @@ int SDL_SaveBMP_RW (SDL_Surface *saveme, SDL_RWops *dst, int freedst)
 		biPlanes = 1;
 		biBitCount = surface->format->BitsPerPixel;
 		biCompression = BI_RGB;
-		biSizeImage = surface->h*surface->pitch;
+		biSizeImage = surface->h*((bw + 3) & ~3);
 		biXPelsPerMeter = 0;
 		biYPelsPerMeter = 0;
 		if ( surface->format->palette ) {
@@ -543,10 +548,10 @@ int SDL_SaveBMP_RW (SDL_Surface *saveme, SDL_RWops *dst, int freedst)
 		}
 
 		/* Write the bitmap image upside down */
-		bits = (Uint8 *)surface->pixels+(surface->h*surface->pitch);
+		bits = (Uint8 *)surface->pixels+((size_t)surface->h*pitch);
 		pad  = ((bw%4) ? (4-(bw%4)) : 0);
 		while ( bits > (Uint8 *)surface->pixels ) {
-			bits -= surface->pitch;
+			bits -= pitch;
 			if ( SDL_RWwrite(dst, bits, 1, bw) != bw) {
 				SDL_Error(SDL_EFWRITE);
 				break;
@@ -389,9 +389,9 @@ static void SDL_DrawCursorFast(SDL_Surface *screen, SDL_Rect *area)
 			palette_changed = 0;
 		}
 		dst = (Uint8 *)screen->pixels +
-                       (SDL_cursor->area.y+area->y)*screen->pitch +
+                       (SDL_cursor->area.y+area->y)*SDL_SURFACE_PITCH(screen) +
                        SDL_cursor->area.x;
-		dstskip = screen->pitch-area->w;
+		dstskip = SDL_SURFACE_PITCH(screen)-area->w;
 
 		for ( h=area->h; h; h-- ) {
 			for ( w=area->w/8; w; w-- ) {
@@ -416,9 +416,9 @@ static void SDL_DrawCursorFast(SDL_Surface *screen, SDL_Rect *area)
 		int dstskip;
 
 		dst = (Uint16 *)screen->pixels +
-                       (SDL_cursor->area.y+area->y)*screen->pitch/2 +
+                       (SDL_cursor->area.y+area->y)*SDL_SURFACE_PITCH(screen)/2 +
                        SDL_cursor->area.x;
-		dstskip = (screen->pitch/2)-area->w;
+		dstskip = (SDL_SURFACE_PITCH(screen)/2)-area->w;
 
 		for ( h=area->h; h; h-- ) {
 			for ( w=area->w/8; w; w-- ) {
@@ -443,9 +443,9 @@ static void SDL_DrawCursorFast(SDL_Surface *screen, SDL_Rect *area)
 		int dstskip;
 
 		dst = (Uint8 *)screen->pixels +
-                       (SDL_cursor->area.y+area->y)*screen->pitch +
+                       (SDL_cursor->area.y+area->y)*SDL_SURFACE_PITCH(screen) +
                        SDL_cursor->area.x*3;
-		dstskip = screen->pitch-area->w*3;
+		dstskip = SDL_SURFACE_PITCH(screen)-area->w*3;
 
 		for ( h=area->h; h; h-- ) {
 			for ( w=area->w/8; w; w-- ) {
@@ -470,9 +470,9 @@ static void SDL_DrawCursorFast(SDL_Surface *screen, SDL_Rect *area)
 		int dstskip;
 
 		dst = (Uint32 *)screen->pixels +
-                       (SDL_cursor->area.y+area->y)*screen->pitch/4 +
+                       (SDL_cursor->area.y+area->y)*SDL_SURFACE_PITCH(screen)/4 +
                        SDL_cursor->area.x;
-		dstskip = (screen->pitch/4)-area->w;
+		dstskip = (SDL_SURFACE_PITCH(screen)/4)-area->w;
 
 		for ( h=area->h; h; h-- ) {
 			for ( w=area->w/8; w; w-- ) {
@@ -508,9 +508,9 @@ static void SDL_DrawCursorSlow(SDL_Surface *screen, SDL_Rect *area)
 	mask = SDL_cursor->mask + area->y * SDL_cursor->area.w/8;
 	dstbpp = screen->format->BytesPerPixel;
 	dst = (Uint8 *)screen->pixels +
-                       (SDL_cursor->area.y+area->y)*screen->pitch +
+                       (SDL_cursor->area.y+area->y)*SDL_SURFACE_PITCH(screen) +
                        SDL_cursor->area.x*dstbpp;
-	dstskip = screen->pitch-SDL_cursor->area.w*dstbpp;
+	dstskip = SDL_SURFACE_PITCH(screen)-SDL_cursor->area.w*dstbpp;
 
 	minx = area->x;
 	maxx = area->x+area->w;
@@ -614,7 +614,7 @@ void SDL_DrawCursorNoLock(SDL_Surface *screen)
 	  } else {
 		dst = SDL_cursor->save[1];
 	  }
-	  src = (Uint8 *)screen->pixels + area.y * screen->pitch +
+	  src = (Uint8 *)screen->pixels + area.y * SDL_SURFACE_PITCH(screen) +
                                           area.x * screenbpp;
 
 	  /* Perform the copy */
@@ -623,7 +623,7 @@ void SDL_DrawCursorNoLock(SDL_Surface *screen)
 	  while ( h-- ) {
 		  SDL_memcpy(dst, src, w);
 		  dst += w;
-		  src += screen->pitch;
+		  src += SDL_SURFACE_PITCH(screen);
 	  }
 	}
 
@@ -691,7 +691,7 @@ void SDL_EraseCursorNoLock(SDL_Surface *screen)
 	  } else {
 		src = SDL_cursor->save[1];
 	  }
-	  dst = (Uint8 *)screen->pixels + area.y * screen->pitch +
+	  dst = (Uint8 *)screen->pixels + area.y * SDL_SURFACE_PITCH(screen) +
                                           area.x * screenbpp;
 
 	  /* Perform the copy */
@@ -700,7 +700,7 @@ void SDL_EraseCursorNoLock(SDL_Surface *screen)
 	  while ( h-- ) {
 		  SDL_memcpy(dst, src, w);
 		  src += w;
-		  dst += screen->pitch;
+		  dst += SDL_SURFACE_PITCH(screen);
 	  }
 
 	  /* Perform pixel conversion on cursor background */
@@ -0,0 +1,323 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Dirty rectangle merging for the video surface updates */
+
+#include "SDL_video.h"
+#include "SDL_sysvideo.h"
+#include "SDL_damage_c.h"
+
+/* Past this many rectangles, the whole screen is updated */
+#define MAX_MERGE_RECTS	256
+
+/* Overlapping rectangles are merged into their bounding box if it is at
+   most 1/MERGE_WASTE bigger than their union, and split apart otherwise */
+#define MERGE_WASTE	8
+
+typedef struct {
+	SDL_Rect *rects;
+	int count;
+	int max;
+	int full;	/* the whole screen is damaged */
+} SDL_DamageList;
+
+int SDL_damage_auto = 0;
+
+static int damage_tile = 0;
+static int damage_full = 0;	/* percent of the screen, 0 = never */
+
+static SDL_DamageList recorded = { NULL, 0, 0, 0 };
+static SDL_DamageList pending = { NULL, 0, 0, 0 };
+static SDL_Rect whole_screen;
+
+/* Clip a rectangle to the screen and snap it out to the tile grid */
+static int SDL_ClipDamage(SDL_Rect *rect, int w, int h)
+{
+	int x1, y1, x2, y2;
+
+	if ( rect->w == 0 || rect->h == 0 ) {
+		return(0);
+	}
+	x1 = rect->x;
+	y1 = rect->y;
+	x2 = x1 + rect->w;
+	y2 = y1 + rect->h;
+	if ( damage_tile > 1 ) {
+		if ( x1 > 0 ) x1 -= x1 % damage_tile;
+		if ( y1 > 0 ) y1 -= y1 % damage_tile;
+		if ( x2 > 0 && x2 % damage_tile )
+			x2 += damage_tile - x2 % damage_tile;
+		if ( y2 > 0 && y2 % damage_tile )
+			y2 += damage_tile - y2 % damage_tile;
+	}
+	if ( x1 < 0 ) x1 = 0;
+	if ( y1 < 0 ) y1 = 0;
+	if ( x2 > w ) x2 = w;
+	if ( y2 > h ) y2 = h;
+	if ( x2 <= x1 || y2 <= y1 ) {
+		return(0);
+	}
+	rect->x = x1;
+	rect->y = y1;
+	rect->w = x2 - x1;
+	rect->h = y2 - y1;
+	return(1);
+}
+
+/* Grow 'a' to cover 'b' if their union is a rectangle, or nearly one */
+static int SDL_MergeDamage(SDL_Rect *a, const SDL_Rect *b)
+{
+	int ax2 = a->x + a->w, ay2 = a->y + a->h;
+	int bx2 = b->x + b->w, by2 = b->y + b->h;
+	int x1, y1, x2, y2;
+	Uint32 box, used;
+
+	if ( b->x >= a->x && b->y >= a->y && bx2 <= ax2 && by2 <= ay2 ) {
+		/* b is inside a */
+		return(1);
+	}
+	if ( a->x >= b->x && a->y >= b->y && ax2 <= bx2 && ay2 <= by2 ) {
+		/* a is inside b */
+		*a = *b;
+		return(1);
+	}
+	if ( a->x == b->x && a->w == b->w && b->y <= ay2 && a->y <= by2 ) {
+		/* Same columns, overlapping or touching rows */
+		if ( b->y < a->y ) a->y = b->y;
+		a->h = ((ay2 > by2) ? ay2 : by2) - a->y;
+		return(1);
+	}
+	if ( a->y == b->y && a->h == b->h && b->x <= ax2 && a->x <= bx2 ) {
+		/* Same rows, overlapping or touching columns */
+		if ( b->x < a->x ) a->x = b->x;
+		a->w = ((ax2 > bx2) ? ax2 : bx2) - a->x;
+		return(1);
+	}
+
+	/* Overlapping, take the bounding box if it doesn't waste much */
+	x1 = (a->x > b->x) ? a->x : b->x;
+	y1 = (a->y > b->y) ? a->y : b->y;
+	x2 = (ax2 < bx2) ? ax2 : bx2;
+	y2 = (ay2 < by2) ? ay2 : by2;
+	if ( x1 >= x2 || y1 >= y2 ) {
+		return(0);
+	}
+	used = (Uint32)a->w * a->h + (Uint32)b->w * b->h -
+	       (Uint32)(x2 - x1) * (y2 - y1);
+	x1 = (a->x < b->x) ? a->x : b->x;
+	y1 = (a->y < b->y) ? a->y : b->y;
+	x2 = (ax2 > bx2) ? ax2 : bx2;
+	y2 = (ay2 > by2) ? ay2 : by2;
+	box = (Uint32)(x2 - x1) * (y2 - y1);
+	if ( (box - used) * MERGE_WASTE > box ) {
+		return(0);
+	}
+	a->x = x1;
+	a->y = y1;
+	a->w = x2 - x1;
+	a->h = y2 - y1;
+	return(1);
+}
+
+static void SDL_AppendDamage(SDL_DamageList *list, const SDL_Rect *rect);
+
+/* Add the parts of 'a' outside of 'b' to the list, if they overlap */
+static int SDL_SplitDamage(SDL_DamageList *list,
+			const SDL_Rect *a, const SDL_Rect *b)
+{
+	SDL_Rect piece[4];
+	int ax2 = a->x + a->w, ay2 = a->y + a->h;
+	int bx2 = b->x + b->w, by2 = b->y + b->h;
+	int y1, y2;
+	int i, n;
+
+	if ( a->x >= bx2 || b->x >= ax2 || a->y >= by2 || b->y >= ay2 ) {
+		return(0);
+	}
+
+	/* The list changes as the pieces are added, so collect them first */
+	n = 0;
+	y1 = a->y;
+	y2 = ay2;
+	if ( a->y < b->y ) {
+		piece[n].x = a->x;
+		piece[n].y = a->y;
+		piece[n].w = a->w;
+		piece[n].h = b->y - a->y;
+		++n;
+		y1 = b->y;
+	}
+	if ( ay2 > by2 ) {
+		piece[n].x = a->x;
+		piece[n].y = by2;
+		piece[n].w = a->w;
+		piece[n].h = ay2 - by2;
+		++n;
+		y2 = by2;
+	}
+	if ( a->x < b->x ) {
+		piece[n].x = a->x;
+		piece[n].y = y1;
+		piece[n].w = b->x - a->x;
+		piece[n].h = y2 - y1;
+		++n;
+	}
+	if ( ax2 > bx2 ) {
+		piece[n].x = bx2;
+		piece[n].y = y1;
+		piece[n].w = ax2 - bx2;
+		piece[n].h = y2 - y1;
+		++n;
+	}
+	for ( i=0; i<n; ++i ) {
+		SDL_AppendDamage(list, &piece[i]);
+	}
+	return(1);
+}
+
+/* Add a clipped rectangle to a list, merging it with what's there */
+static void SDL_AppendDamage(SDL_DamageList *list, const SDL_Rect *rect)
+{
+	SDL_Rect r = *rect;
+	int i;
+
+	if ( list->full ) {
+		return;
+	}
+	/* Whenever it grows, it may now merge with earlier ones */
+	i = 0;
+	while ( i < list->count ) {
+		if ( SDL_MergeDamage(&r, &list->rects[i]) ) {
+			list->rects[i] = list->rects[--list->count];
+			i = 0;
+		} else if ( SDL_SplitDamage(list, &r, &list->rects[i]) ) {
+			return;
+		} else {
+			++i;
+		}
+	}
+	if ( list->count == MAX_MERGE_RECTS ) {
+		list->full = 1;
+		return;
+	}
+	if ( list->count == list->max ) {
+		int max = list->max ? list->max * 2 : 64;
+		SDL_Rect *rects;
+
+		rects = (SDL_Rect *)SDL_realloc(list->rects, max*sizeof(*rects));
+		if ( rects == NULL ) {
+			/* Just update everything */
+			list->full = 1;
+			return;
+		}
+		list->rects = rects;
+		list->max = max;
+	}
+	list->rects[list->count++] = r;
+}
+
+static int SDL_GetEnvNumber(const char *name)
+{
+	const char *env = SDL_getenv(name);
+
+	return(env ? SDL_atoi(env) : 0);
+}
+
+void SDL_InitDamage(void)
+{
+	damage_tile = SDL_GetEnvNumber("SDL_VIDEO_UPDATE_TILE");
+	damage_full = SDL_GetEnvNumber("SDL_VIDEO_UPDATE_FULL");
+	SDL_damage_auto = (SDL_GetEnvNumber("SDL_VIDEO_AUTO_DAMAGE") > 0);
+	SDL_ClearDamage();
+}
+
+void SDL_QuitDamage(void)
+{
+	SDL_damage_auto = 0;
+	if ( recorded.rects ) {
+		SDL_free(recorded.rects);
+	}
+	if ( pending.rects ) {
+		SDL_free(pending.rects);
+	}
+	SDL_memset(&recorded, 0, sizeof(recorded));
+	SDL_memset(&pending, 0, sizeof(pending));
+}
+
+void SDL_AddDamage(const SDL_Rect *rect)
+{
+	SDL_Rect r = *rect;
+
+	if ( SDL_ClipDamage(&r, SDL_PublicSurface->w, SDL_PublicSurface->h) ) {
+		SDL_AppendDamage(&recorded, &r);
+	}
+}
+
+void SDL_ClearDamage(void)
+{
+	recorded.count = 0;
+	recorded.full = 0;
+}
+
+SDL_Rect *SDL_CoalesceDamage(SDL_Surface *screen,
+			int numrects, const SDL_Rect *rects, int *count)
+{
+	Uint32 area;
+	int i;
+
+	pending.count = 0;
+	pending.full = recorded.full;
+	for ( i=0; i<recorded.count; ++i ) {
+		SDL_AppendDamage(&pending, &recorded.rects[i]);
+	}
+	SDL_ClearDamage();
+
+	for ( i=0; i<numrects; ++i ) {
+		SDL_Rect r = rects[i];
+
+		if ( SDL_ClipDamage(&r, screen->w, screen->h) ) {
+			SDL_AppendDamage(&pending, &r);
+		}
+	}
+
+	/* Past the threshold one big update is cheaper than many small ones */
+	if ( damage_full > 0 && ! pending.full ) {
+		area = 0;
+		for ( i=0; i<pending.count; ++i ) {
+			area += (Uint32)pending.rects[i].w * pending.rects[i].h;
+		}
+		if ( area >= (Uint32)screen->w*screen->h/100*damage_full ) {
+			pending.full = 1;
+		}
+	}
+	if ( pending.full ) {
+		whole_screen.x = 0;
+		whole_screen.y = 0;
+		whole_screen.w = screen->w;
+		whole_screen.h = screen->h;
+		*count = 1;
+		return(&whole_screen);
+	}
+	*count = pending.count;
+	return(pending.rects);
+}
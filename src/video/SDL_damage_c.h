@@ -0,0 +1,70 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_damage_c_h
+#define _SDL_damage_c_h
+
+/* Damage tracking for the video surface.
+
+   The rectangles passed to SDL_UpdateRects() are clipped to the screen
+   and made disjoint, so no pixel is pushed twice: rectangles that overlap
+   are merged into their bounding box if it is at most 1/8 bigger than
+   their union, and otherwise only the parts of the new rectangle outside
+   the old one are kept.  Past 256 rectangles the whole screen is updated.
+   These environment variables, read by SDL_SetVideoMode(), trade a few
+   extra pixels for fewer, bigger updates:
+
+   SDL_VIDEO_UPDATE_TILE=N	snap the rectangles out to an NxN grid
+   SDL_VIDEO_UPDATE_FULL=P	update the whole screen once the rectangles
+				cover P percent of it
+   SDL_VIDEO_AUTO_DAMAGE=1	remember what SDL_BlitSurface() and
+				SDL_FillRect() draw on the screen, and
+				update it with SDL_UpdateRects(screen, 0, NULL)
+*/
+
+#include "SDL_sysvideo.h"
+
+/* Set when blits and fills to the screen should be recorded */
+extern int SDL_damage_auto;
+
+#define SDL_DAMAGE_TRACKED(surface) \
+	(SDL_damage_auto && current_video && (surface) == SDL_PublicSurface)
+
+/* Read the settings and forget all damage, when the video mode is set */
+extern void SDL_InitDamage(void);
+extern void SDL_QuitDamage(void);
+
+/* Record a rectangle of the screen that has been drawn on */
+extern void SDL_AddDamage(const SDL_Rect *rect);
+
+/* Forget the damage, for example after a full screen update */
+extern void SDL_ClearDamage(void);
+
+/* Merge 'rects' with the damage recorded so far and return the list of
+   rectangles to update, which stays valid until the next call.
+   The recorded damage is cleared.
+*/
+extern SDL_Rect *SDL_CoalesceDamage(SDL_Surface *screen,
+			int numrects, const SDL_Rect *rects, int *count);
+
+#endif /* _SDL_damage_c_h */
@@ -0,0 +1,275 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Aligned, recycled pixel buffers for software surfaces */
+
+#include "SDL_video.h"
+#include "SDL_thread.h"
+#include "SDL_blit.h"
+#include "SDL_pixelpool_c.h"
+
+/* Each pooled buffer starts on a cache line, with this just before it */
+typedef struct SDL_PixelHeader {
+	void *base;			/* what SDL_malloc() returned */
+	size_t size;			/* usable bytes */
+	int size_class;			/* -1 if it's too big to keep */
+	struct SDL_PixelHeader *next;	/* in the free list of its class,
+					   or among the buffers handed out */
+} SDL_PixelHeader;
+
+#define HEADER_ROOM	((sizeof(SDL_PixelHeader)+SDL_POOL_ALIGN-1) & \
+					~(SDL_POOL_ALIGN-1))
+
+/* Size classes go up in quarters of a power of two, wasting at most a
+   fifth of a buffer, from the alignment up to 1 GB.
+ */
+#define MIN_CLASS_SHIFT	6
+#define MAX_CLASS_SHIFT	30
+#define NUM_CLASSES	((MAX_CLASS_SHIFT-MIN_CLASS_SHIFT+1)*4)
+
+/* The buffers handed out, hashed by address, so the pixels of a surface
+   are only taken back if they are still the ones it was given.
+ */
+#define LIVE_BUCKETS	256
+#define LIVE_BUCKET(pixels) \
+	((int)(((uintptr_t)(pixels) / SDL_POOL_ALIGN) % LIVE_BUCKETS))
+
+static int pool_enabled = -1;		/* -1 = not initialized yet */
+static Uint32 pool_limit = 0;		/* bytes of free buffers to keep */
+static SDL_mutex *pool_lock = NULL;
+static SDL_PixelHeader *pool_free[NUM_CLASSES];
+static SDL_PixelHeader *pool_live[LIVE_BUCKETS];
+
+/* Statistics, protected by pool_lock */
+static Uint32 pool_hits = 0;
+static Uint32 pool_misses = 0;
+static Uint32 pool_retained = 0;
+
+void SDL_InitPixelPool(void)
+{
+	if ( pool_enabled < 0 ) {
+		const char *env = SDL_getenv("SDL_SURFACE_POOL");
+
+		/* Only look once, the lock has to outlive the buffers */
+		pool_enabled = 0;
+		if ( env != NULL ) {
+			Uint32 kbytes = (Uint32)SDL_strtoul(env, NULL, 0);
+
+			if ( kbytes > 0xFFFFFFFF/1024 ) {
+				kbytes = 0xFFFFFFFF/1024;
+			}
+			pool_limit = kbytes * 1024;
+			pool_lock = SDL_CreateMutex();
+			pool_enabled = (pool_lock != NULL);
+		}
+	}
+}
+
+static int SDL_PixelPoolEnabled(void)
+{
+	return(pool_enabled > 0);
+}
+
+static void SDL_LockPixelPool(void)
+{
+	if ( pool_lock ) {
+		SDL_mutexP(pool_lock);
+	}
+}
+
+static void SDL_UnlockPixelPool(void)
+{
+	if ( pool_lock ) {
+		SDL_mutexV(pool_lock);
+	}
+}
+
+/* Find the class of a buffer size, and round the size up to it */
+static int SDL_PixelSizeClass(size_t *size)
+{
+	size_t step;
+	int shift, quarter;
+
+	if ( *size <= (1 << MIN_CLASS_SHIFT) ) {
+		*size = (1 << MIN_CLASS_SHIFT);
+		return(0);
+	}
+	if ( *size > (1 << MAX_CLASS_SHIFT) ) {
+		return(-1);
+	}
+	shift = MIN_CLASS_SHIFT;
+	while ( (*size - 1) >> (shift + 1) ) {
+		++shift;
+	}
+	step = ((size_t)1 << shift) / 4;
+	quarter = (int)((*size - ((size_t)1 << shift) + step - 1) / step);
+	*size = ((size_t)1 << shift) + quarter * step;
+	return((shift - MIN_CLASS_SHIFT) * 4 + quarter);
+}
+
+Uint32 SDL_AlignPitch(Uint32 pitch)
+{
+	Uint32 aligned = (pitch + SDL_POOL_ALIGN-1) &
+					~(Uint32)(SDL_POOL_ALIGN-1);
+
+	if ( SDL_PixelPoolEnabled() && aligned <= 0x7FFFFFFF &&
+	     (pitch > 0xFFFF || aligned <= 0xFFFF) ) {
+		pitch = aligned;
+	}
+	return(pitch);
+}
+
+int SDL_AllocSurfacePixels(SDL_Surface *surface)
+{
+	SDL_PixelHeader *header;
+	size_t size = (size_t)surface->h * SDL_SURFACE_PITCH(surface);
+	Uint8 *base;
+	int size_class;
+
+	surface->unused1 &= ~SDL_POOLED_PIXELS;
+	if ( ! SDL_PixelPoolEnabled() ) {
+		surface->pixels = SDL_malloc(size);
+		return(surface->pixels ? 0 : -1);
+	}
+
+	/* A freed buffer of the same class will do */
+	size_class = SDL_PixelSizeClass(&size);
+	header = NULL;
+	SDL_LockPixelPool();
+	if ( size_class >= 0 && pool_free[size_class] ) {
+		header = pool_free[size_class];
+		pool_free[size_class] = header->next;
+		pool_retained -= (Uint32)header->size;
+		++pool_hits;
+	} else {
+		++pool_misses;
+	}
+	SDL_UnlockPixelPool();
+
+	if ( header == NULL ) {
+		if ( size > (size_t)-1 - HEADER_ROOM - SDL_POOL_ALIGN ) {
+			return(-1);
+		}
+		base = (Uint8 *)SDL_malloc(size + HEADER_ROOM + SDL_POOL_ALIGN-1);
+		if ( base == NULL ) {
+			return(-1);
+		}
+		header = (SDL_PixelHeader *)
+			((((uintptr_t)base + HEADER_ROOM + SDL_POOL_ALIGN-1) &
+			  ~(uintptr_t)(SDL_POOL_ALIGN-1)) - sizeof(*header));
+		header->base = base;
+		header->size = size;
+		header->size_class = size_class;
+	}
+	surface->pixels = header + 1;
+	surface->unused1 |= SDL_POOLED_PIXELS;
+
+	SDL_LockPixelPool();
+	header->next = pool_live[LIVE_BUCKET(surface->pixels)];
+	pool_live[LIVE_BUCKET(surface->pixels)] = header;
+	SDL_UnlockPixelPool();
+	return(0);
+}
+
+/* Take back a buffer that was handed out, or return NULL if it wasn't */
+static SDL_PixelHeader *SDL_TakeLivePixels(void *pixels)
+{
+	SDL_PixelHeader **prev = &pool_live[LIVE_BUCKET(pixels)];
+	SDL_PixelHeader *header;
+
+	for ( header = *prev; header; prev = &header->next, header = *prev ) {
+		if ( (void *)(header + 1) == pixels ) {
+			*prev = header->next;
+			header->next = NULL;
+			return(header);
+		}
+	}
+	return(NULL);
+}
+
+void SDL_FreeSurfacePixels(SDL_Surface *surface)
+{
+	SDL_PixelHeader *header;
+	void *pixels = surface->pixels;
+
+	if ( pixels == NULL ) {
+		return;
+	}
+	surface->pixels = NULL;
+	if ( ! (surface->unused1 & SDL_POOLED_PIXELS) ) {
+		SDL_free(pixels);
+		return;
+	}
+	surface->unused1 &= ~SDL_POOLED_PIXELS;
+
+	/* Keep it if there's room in the pool */
+	SDL_LockPixelPool();
+	header = SDL_TakeLivePixels(pixels);
+	if ( header && header->size_class >= 0 &&
+	     header->size <= pool_limit - pool_retained ) {
+		header->next = pool_free[header->size_class];
+		pool_free[header->size_class] = header;
+		pool_retained += (Uint32)header->size;
+		pixels = NULL;
+	}
+	SDL_UnlockPixelPool();
+
+	if ( header == NULL ) {
+		/* The application put pixels of its own in the surface */
+		SDL_free(pixels);
+	} else if ( pixels ) {
+		SDL_free(header->base);
+	}
+}
+
+void SDL_QuitPixelPool(void)
+{
+	int i;
+
+	SDL_LockPixelPool();
+	for ( i=0; i<NUM_CLASSES; ++i ) {
+		while ( pool_free[i] ) {
+			SDL_PixelHeader *header = pool_free[i];
+
+			pool_free[i] = header->next;
+			SDL_free(header->base);
+		}
+	}
+	pool_retained = 0;
+	SDL_UnlockPixelPool();
+}
+
+void SDL_GetSurfacePoolStats(Uint32 *hits, Uint32 *misses, Uint32 *retained)
+{
+	SDL_LockPixelPool();
+	if ( hits ) {
+		*hits = pool_hits;
+	}
+	if ( misses ) {
+		*misses = pool_misses;
+	}
+	if ( retained ) {
+		*retained = pool_retained;
+	}
+	SDL_UnlockPixelPool();
+}
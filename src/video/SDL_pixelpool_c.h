@@ -0,0 +1,64 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_pixelpool_c_h
+#define _SDL_pixelpool_c_h
+
+/* Aligned and recycled pixel buffers for software surfaces.
+
+   The pool is disabled by default.  Setting the SDL_SURFACE_POOL
+   environment variable to a number of kilobytes enables it: the pixels
+   of new software surfaces start on a cache line and their pitch is
+   rounded up to a multiple of it, and freed buffers are kept for reuse
+   until they add up to that many kilobytes.  The variable is read by
+   the first SDL_VideoInit(), and surfaces made before that aren't pooled.
+*/
+
+#include "SDL_video.h"
+
+/* Pixel buffers start on this boundary when the pool is enabled */
+#define SDL_POOL_ALIGN	64
+
+/* Set in surface->unused1 when the pixels belong to the pool */
+#define SDL_POOLED_PIXELS	0x00000001
+
+/* Read SDL_SURFACE_POOL and set up the pool, the first time it's called */
+extern void SDL_InitPixelPool(void);
+
+/* Round up a pitch to the pool alignment, if the pool is enabled.
+   Pitches that fit in 16 bits are kept that way.
+*/
+extern Uint32 SDL_AlignPitch(Uint32 pitch);
+
+/* Allocate the rows of pixels of a surface, not cleared.
+   Returns 0, or -1 if out of memory.
+*/
+extern int SDL_AllocSurfacePixels(SDL_Surface *surface);
+
+/* Free or recycle the pixels of a surface, and set them to NULL */
+extern void SDL_FreeSurfacePixels(SDL_Surface *surface);
+
+/* Free the buffers kept for reuse */
+extern void SDL_QuitPixelPool(void);
+
+#endif /* _SDL_pixelpool_c_h */
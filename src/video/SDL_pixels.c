@@ -24,6 +24,7 @@
 /* General (mostly internal) pixel/color manipulation routines for SDL */
 
 #include "SDL_endian.h"
+#include "SDL_mutex.h"
 #include "SDL_video.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
@@ -290,15 +291,28 @@ void SDL_DitherColors(SDL_Color *colors, int bpp)
  * an error.
  */
 Uint16 SDL_CalculatePitch(SDL_Surface *surface)
+{
+	Uint32 pitch = SDL_CalculatePitch32(surface);
+
+	if (pitch > 0xFFFF) {
+		SDL_SetError("A scanline is too wide");
+		return(0);
+	}
+	return((Uint16)pitch);
+}
+/*
+ * The same for surfaces which may have rows over 64K, up to 2 GB
+ */
+Uint32 SDL_CalculatePitch32(SDL_Surface *surface)
 {
 	unsigned int pitch = 0;
 	Uint8 byte;
 
 	/* Surface should be 4-byte aligned for speed */
-	/* The code tries to prevent from an Uint16 overflow. */;
+	/* The code tries to prevent from an overflow. */;
 	for (byte = surface->format->BytesPerPixel; byte; byte--) {
 		pitch += (unsigned int)surface->w;
-		if (pitch < surface->w) {
+		if (pitch < (unsigned int)surface->w) {
 			SDL_SetError("A scanline is too wide");
 			return(0);
 		}
@@ -329,12 +343,380 @@ Uint16 SDL_CalculatePitch(SDL_Surface *surface)
 		}
 		pitch = (pitch + 3) & ~3;
 	}
-	if (pitch > 0xFFFF) {
+	if (pitch > 0x7FFFFFFF) {
 		SDL_SetError("A scanline is too wide");
 		return(0);
 	}
-	return((Uint16)pitch);
+	return((Uint32)pitch);
+}
+/*
+ * Set the pitch of a surface, which may not fit in its 'pitch' member
+ */
+void SDL_SetSurfacePitch(SDL_Surface *surface, Uint32 pitch)
+{
+	surface->pitch = (Uint16)pitch;
+	surface->unused1 = (surface->unused1 & ~SDL_PITCH_HIGH_BITS) |
+	                   (pitch & SDL_PITCH_HIGH_BITS);
 }
+/*
+ * Inverse colormaps, to find the nearest palette entry to an RGB color
+ * without measuring the distance to all of them.
+ *
+ * The RGB cube is split into 8x8x8 blocks, and each block remembers the
+ * palette entries that can be nearest to some color inside it: those at
+ * least as close to the block as the farthest point of the block is from
+ * the best single entry.  The blocks are filled in lazily, and give
+ * exactly the same answer as a search of the whole palette.  Blitters to
+ * 8-bit surfaces get a 15-bit cube holding the nearest entry for every
+ * cell, built the same way.
+ *
+ * The maps are found by the palette colors, so a palette changed by
+ * SDL_SetColors() or in any other way never uses a stale one.  The list
+ * is kept most recently used first, so the first comparison usually
+ * finds it.  It is guarded by a lock from SDL_VideoInit(), since
+ * SDL_MapRGB() may be called from any thread.
+ */
+#define INVERSE_BLOCKS		(8*8*8)
+#define INVERSE_MIN_COLORS	16	/* smaller palettes are just searched */
+#define INVERSE_CACHE		4	/* unused maps that are kept around */
+
+struct SDL_InverseMap {
+	int refcount;
+	int ncolors;
+	SDL_Color colors[256];
+	/* Squared distance along each axis from every color to the nearest
+	   and the farthest value of each of the 8 block positions */
+	Uint16 nearest[3][8][256];
+	Uint16 farthest[3][8][256];
+	Uint32 first[INVERSE_BLOCKS];	/* start of each block's candidates */
+	Uint16 count[INVERSE_BLOCKS];	/* number of candidates, 0 if unknown */
+	Uint8 *candidates;
+	Uint32 used, size;
+	Uint8 *cube;			/* RGB 5-5-5 to palette index */
+	struct SDL_InverseMap *next;
+};
+
+static SDL_InverseMap *inverse_maps = NULL;
+static SDL_mutex *inverse_lock = NULL;
+
+static void SDL_LockInverseMaps(void)
+{
+	if ( inverse_lock ) {
+		SDL_mutexP(inverse_lock);
+	}
+}
+
+static void SDL_UnlockInverseMaps(void)
+{
+	if ( inverse_lock ) {
+		SDL_mutexV(inverse_lock);
+	}
+}
+
+static void SDL_MeasureInverseAxis(SDL_InverseMap *inv, int axis,
+						int pos, int i, int v)
+{
+	int lo = pos << 5;
+	int hi = lo + 31;
+	int d;
+
+	d = (v < lo) ? lo - v : (v > hi) ? v - hi : 0;
+	inv->nearest[axis][pos][i] = (Uint16)(d*d);
+	d = (v < lo+16) ? hi - v : v - lo;
+	inv->farthest[axis][pos][i] = (Uint16)(d*d);
+}
+
+/* Find the palette entries that can be nearest to a color in the block */
+static int SDL_FillInverseBlock(SDL_InverseMap *inv, int block)
+{
+	const Uint16 *nr = inv->nearest[0][block >> 6];
+	const Uint16 *ng = inv->nearest[1][(block >> 3) & 7];
+	const Uint16 *nb = inv->nearest[2][block & 7];
+	const Uint16 *fr = inv->farthest[0][block >> 6];
+	const Uint16 *fg = inv->farthest[1][(block >> 3) & 7];
+	const Uint16 *fb = inv->farthest[2][block & 7];
+	unsigned int farthest, distance;
+	int i, n;
+
+	farthest = ~0;
+	for ( i=0; i<inv->ncolors; ++i ) {
+		distance = fr[i] + fg[i] + fb[i];
+		if ( distance < farthest ) {
+			farthest = distance;
+		}
+	}
+
+	/* Make sure there's room for the whole palette */
+	if ( inv->used + inv->ncolors > inv->size ) {
+		Uint32 size = inv->size * 2;
+		Uint8 *candidates;
+
+		while ( size < inv->used + inv->ncolors ) {
+			size *= 2;
+		}
+		candidates = (Uint8 *)SDL_realloc(inv->candidates, size);
+		if ( candidates == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		inv->candidates = candidates;
+		inv->size = size;
+	}
+	n = 0;
+	for ( i=0; i<inv->ncolors; ++i ) {
+		if ( (unsigned int)(nr[i] + ng[i] + nb[i]) <= farthest ) {
+			inv->candidates[inv->used+n++] = (Uint8)i;
+		}
+	}
+	inv->first[block] = inv->used;
+	inv->count[block] = (Uint16)n;
+	inv->used += n;
+	return(0);
+}
+
+/* The first of the nearest candidates, like a search of the whole palette */
+static Uint8 SDL_SearchInverseBlock(SDL_InverseMap *inv, int block,
+						int r, int g, int b)
+{
+	const Uint8 *candidate = &inv->candidates[inv->first[block]];
+	unsigned int smallest;
+	unsigned int distance;
+	int rd, gd, bd;
+	int i;
+	Uint8 pixel = 0;
+
+	smallest = ~0;
+	for ( i=inv->count[block]; i; --i, ++candidate ) {
+		const SDL_Color *c = &inv->colors[*candidate];
+
+		rd = c->r - r;
+		gd = c->g - g;
+		bd = c->b - b;
+		distance = (rd*rd)+(gd*gd)+(bd*bd);
+		if ( distance < smallest ) {
+			pixel = *candidate;
+			if ( distance == 0 ) { /* Perfect match! */
+				break;
+			}
+			smallest = distance;
+		}
+	}
+	return(pixel);
+}
+
+/* Fill the 4x4x4 cells of the cube in a block, which hold the nearest
+   entry to the 8-bit color of the cell.
+ */
+static void SDL_FillInverseCells(SDL_InverseMap *inv, int block, Uint8 *cube)
+{
+	const Uint8 *candidate = &inv->candidates[inv->first[block]];
+	int n = inv->count[block];
+	Uint32 rd[4][256], gd[4][256], bd[4][256], rg[256];
+	Uint32 smallest;
+	int r0 = (block >> 6) << 2;
+	int g0 = ((block >> 3) & 7) << 2;
+	int b0 = (block & 7) << 2;
+	int i, r, g, b, d;
+
+	/* Squared distances along each axis to the candidates, shifted up
+	   so the smallest sum has the first nearest candidate at the bottom.
+	 */
+	for ( i=0; i<4; ++i ) {
+		int cr = ((r0+i) << 3) | ((r0+i) >> 2);
+		int cg = ((g0+i) << 3) | ((g0+i) >> 2);
+		int cb = ((b0+i) << 3) | ((b0+i) >> 2);
+
+		for ( d=0; d<n; ++d ) {
+			const SDL_Color *c = &inv->colors[candidate[d]];
+
+			rd[i][d] = ((c->r - cr) * (c->r - cr)) << 8;
+			gd[i][d] = ((c->g - cg) * (c->g - cg)) << 8;
+			bd[i][d] = (((c->b - cb) * (c->b - cb)) << 8) | d;
+		}
+	}
+	for ( r=0; r<4; ++r ) {
+		for ( g=0; g<4; ++g ) {
+			Uint8 *cell = &cube[((r0+r) << 10) | ((g0+g) << 5) | b0];
+
+			for ( d=0; d<n; ++d ) {
+				rg[d] = rd[r][d] + gd[g][d];
+			}
+			for ( b=0; b<4; ++b ) {
+				smallest = 0xFFFFFFFF;
+				for ( d=0; d<n; ++d ) {
+					Uint32 distance = rg[d] + bd[b][d];
+					smallest = (distance < smallest) ?
+							distance : smallest;
+				}
+				cell[b] = candidate[smallest & 0xFF];
+			}
+		}
+	}
+}
+
+static void SDL_FreeInverseMap(SDL_InverseMap *inv)
+{
+	if ( inv->candidates ) {
+		SDL_free(inv->candidates);
+	}
+	if ( inv->cube ) {
+		SDL_free(inv->cube);
+	}
+	SDL_free(inv);
+}
+
+/* Find the inverse colormap for a palette, creating it if needed */
+static SDL_InverseMap *SDL_LookupInverseMap(const SDL_Palette *pal)
+{
+	SDL_InverseMap *inv, *prev;
+	size_t size = pal->ncolors * sizeof(SDL_Color);
+	int unused, i, pos;
+
+	prev = NULL;
+	for ( inv = inverse_maps; inv; inv = inv->next ) {
+		if ( inv->ncolors == pal->ncolors &&
+		     SDL_memcmp(inv->colors, pal->colors, size) == 0 ) {
+			/* Move it to the front of the list */
+			if ( prev ) {
+				prev->next = inv->next;
+				inv->next = inverse_maps;
+				inverse_maps = inv;
+			}
+			return(inv);
+		}
+		prev = inv;
+	}
+
+	inv = (SDL_InverseMap *)SDL_malloc(sizeof(*inv));
+	if ( inv == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(inv, 0, sizeof(*inv));
+	inv->ncolors = pal->ncolors;
+	SDL_memcpy(inv->colors, pal->colors, size);
+	for ( i=0; i<inv->ncolors; ++i ) {
+		for ( pos=0; pos<8; ++pos ) {
+			SDL_MeasureInverseAxis(inv, 0, pos, i, inv->colors[i].r);
+			SDL_MeasureInverseAxis(inv, 1, pos, i, inv->colors[i].g);
+			SDL_MeasureInverseAxis(inv, 2, pos, i, inv->colors[i].b);
+		}
+	}
+	inv->size = 4096;
+	inv->candidates = (Uint8 *)SDL_malloc(inv->size);
+	if ( inv->candidates == NULL ) {
+		SDL_FreeInverseMap(inv);
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	inv->next = inverse_maps;
+	inverse_maps = inv;
+
+	/* Forget the least recently used maps nobody is holding on to */
+	unused = 0;
+	prev = inv;
+	while ( prev->next ) {
+		SDL_InverseMap *next = prev->next;
+
+		if ( next->refcount == 0 && ++unused > INVERSE_CACHE ) {
+			prev->next = next->next;
+			SDL_FreeInverseMap(next);
+		} else {
+			prev = next;
+		}
+	}
+	return(inv);
+}
+
+/* Get an inverse colormap with a full cube for blitting to a palette */
+SDL_InverseMap *SDL_AcquireInverseMap(const SDL_Palette *pal)
+{
+	SDL_InverseMap *inv;
+	int block;
+
+	SDL_LockInverseMaps();
+	inv = SDL_LookupInverseMap(pal);
+	if ( inv && inv->cube == NULL ) {
+		Uint8 *cube = (Uint8 *)SDL_malloc(32*32*32);
+		if ( cube == NULL ) {
+			SDL_OutOfMemory();
+			inv = NULL;
+		}
+		for ( block=0; cube && block<INVERSE_BLOCKS; ++block ) {
+			if ( !inv->count[block] &&
+			     SDL_FillInverseBlock(inv, block) < 0 ) {
+				SDL_free(cube);
+				cube = NULL;
+				inv = NULL;
+				break;
+			}
+			SDL_FillInverseCells(inv, block, cube);
+		}
+		if ( inv ) {
+			inv->cube = cube;
+		}
+	}
+	if ( inv ) {
+		++inv->refcount;
+	}
+	SDL_UnlockInverseMaps();
+	return(inv);
+}
+
+Uint8 *SDL_GetInverseCube(SDL_InverseMap *inv)
+{
+	return(inv->cube);
+}
+
+void SDL_ReleaseInverseMap(SDL_InverseMap *inv)
+{
+	SDL_LockInverseMaps();
+	--inv->refcount;
+	SDL_UnlockInverseMaps();
+}
+
+int SDL_InitInverseMaps(void)
+{
+	if ( inverse_lock == NULL ) {
+		inverse_lock = SDL_CreateMutex();
+		if ( inverse_lock == NULL ) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+/* Free the inverse colormaps that aren't in use */
+void SDL_QuitInverseMaps(void)
+{
+	SDL_InverseMap *inv, *prev;
+
+	SDL_LockInverseMaps();
+	prev = NULL;
+	inv = inverse_maps;
+	while ( inv ) {
+		SDL_InverseMap *next = inv->next;
+
+		if ( inv->refcount == 0 ) {
+			if ( prev ) {
+				prev->next = next;
+			} else {
+				inverse_maps = next;
+			}
+			SDL_FreeInverseMap(inv);
+		} else {
+			prev = inv;
+		}
+		inv = next;
+	}
+	SDL_UnlockInverseMaps();
+
+	if ( inverse_lock ) {
+		SDL_DestroyMutex(inverse_lock);
+		inverse_lock = NULL;
+	}
+}
+
 /*
  * Match an RGB value to a particular palette index
  */
@@ -346,7 +728,26 @@ Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
 	int rd, gd, bd;
 	int i;
 	Uint8 pixel=0;
-		
+
+	/* Big palettes only need to check a few colors */
+	if ( pal->ncolors > INVERSE_MIN_COLORS && pal->ncolors <= 256 ) {
+		SDL_InverseMap *inv;
+		int block = ((r >> 5) << 6) | ((g >> 5) << 3) | (b >> 5);
+		int found = 0;
+
+		SDL_LockInverseMaps();
+		inv = SDL_LookupInverseMap(pal);
+		if ( inv && (inv->count[block] ||
+		             SDL_FillInverseBlock(inv, block) == 0) ) {
+			pixel = SDL_SearchInverseBlock(inv, block, r, g, b);
+			found = 1;
+		}
+		SDL_UnlockInverseMaps();
+		if ( found ) {
+			return(pixel);
+		}
+	}
+
 	smallest = ~0;
 	for ( i=0; i<pal->ncolors; ++i ) {
 		rd = pal->colors[i].r - r;
@@ -513,22 +914,31 @@ static Uint8 *Map1toN(SDL_PixelFormat *src, SDL_PixelFormat *dst)
 	}
 	return(map);
 }
-/* Map from BitField to Dithered-Palette to Palette */
-static Uint8 *MapNto1(SDL_PixelFormat *src, SDL_PixelFormat *dst, int *identical)
+/* Map from BitField to Palette, through the inverse colormap of the palette */
+static Uint8 *MapNto1(SDL_PixelFormat *src, SDL_PixelFormat *dst,
+			int *identical, SDL_InverseMap **inverse)
 {
-	/* Generate a 256 color dither palette */
-	SDL_Palette dithered;
 	SDL_Color colors[256];
 	SDL_Palette *pal = dst->palette;
-	
-	/* SDL_DitherColors does not initialize the 'unused' component of colors,
-	   but Map1to1 compares it against pal, so we should initialize it. */  
-	SDL_memset(colors, 0, sizeof(colors));
 
-	dithered.ncolors = 256;
+	/* The blitters pack RGB 3-3-2 themselves for the dithered palette.
+	   SDL_DitherColors does not initialize the 'unused' component of
+	   colors, but we compare it against pal, so we should initialize it.
+	 */
+	SDL_memset(colors, 0, sizeof(colors));
 	SDL_DitherColors(colors, 8);
-	dithered.colors = colors;
-	return(Map1to1(&dithered, pal, identical));
+	if ( pal->ncolors >= 256 &&
+	     SDL_memcmp(colors, pal->colors, sizeof(colors)) == 0 ) {
+		*identical = 1;
+		return(NULL);
+	}
+	*identical = 0;
+
+	*inverse = SDL_AcquireInverseMap(pal);
+	if ( *inverse == NULL ) {
+		return(NULL);
+	}
+	return(SDL_GetInverseCube(*inverse));
 }
 
 SDL_BlitMap *SDL_AllocBlitMap(void)
@@ -555,30 +965,202 @@ SDL_BlitMap *SDL_AllocBlitMap(void)
 	/* It's ready to go */
 	return(map);
 }
-void SDL_InvalidateMap(SDL_BlitMap *map)
+/* Blit map cache statistics */
+static Uint32 blitmap_hits = 0;
+static Uint32 blitmap_misses = 0;
+
+/* Free the mapping held by a blit map, leaving it empty */
+static void SDL_ClearMap(SDL_BlitMap *map)
 {
-	if ( ! map ) {
-		return;
-	}
 	map->dst = NULL;
 	map->format_version = (unsigned int)-1;
+	map->shareable = 0;
+	if ( map->inverse ) {
+		/* The table is the cube of a shared inverse colormap */
+		SDL_ReleaseInverseMap(map->inverse);
+		map->inverse = NULL;
+		map->table = NULL;
+	}
 	if ( map->table ) {
 		SDL_free(map->table);
 		map->table = NULL;
 	}
 }
+void SDL_InvalidateMap(SDL_BlitMap *map)
+{
+	if ( ! map ) {
+		return;
+	}
+	/* The surface changed, so none of the mappings are any good now */
+	do {
+		SDL_ClearMap(map);
+		map = map->next;
+	} while ( map );
+}
+
+/* Exchange the mappings held by two blit maps, keeping the list order
+   and the clip rectangle, which belong to the surface */
+static void SDL_SwapBlitMaps(SDL_BlitMap *a, SDL_BlitMap *b)
+{
+	SDL_BlitMap tmp;
+	SDL_BlitMap *a_next = a->next;
+	SDL_BlitMap *b_next = b->next;
+	SDL_Rect32 a_clip = a->clip;
+	SDL_Rect32 b_clip = b->clip;
+
+	tmp = *a;
+	*a = *b;
+	*b = tmp;
+	a->next = a_next;
+	b->next = b_next;
+	a->clip = a_clip;
+	b->clip = b_clip;
+}
+
+/* Move a cached map to the front of the list after 'map' */
+static void SDL_TouchBlitMap(SDL_BlitMap *map, SDL_BlitMap *prev,
+						SDL_BlitMap *cached)
+{
+	prev->next = cached->next;
+	cached->next = map->next;
+	map->next = cached;
+}
+
+/* See if a shareable mapping is right for another destination */
+static int SDL_BlitMapFits(SDL_BlitMap *map, SDL_Surface *src, SDL_Surface *dst)
+{
+	SDL_PixelFormat *dstfmt = dst->format;
+
+	return ( map->shareable && dst != src &&
+	         (dst->flags & SDL_HWSURFACE) != SDL_HWSURFACE &&
+	         dstfmt->palette == NULL &&
+	         dstfmt->BitsPerPixel == map->dst_BitsPerPixel &&
+	         dstfmt->Rmask == map->dst_Rmask &&
+	         dstfmt->Gmask == map->dst_Gmask &&
+	         dstfmt->Bmask == map->dst_Bmask &&
+	         dstfmt->Amask == map->dst_Amask );
+}
+
+/* Hardware and RLE mappings change the surface itself, so they can't be
+   put aside and brought back later.
+ */
+static int SDL_BlitMapKeepable(SDL_Surface *src)
+{
+	return ( src->map->dst != NULL &&
+	         (src->flags & (SDL_HWACCEL|SDL_RLEACCEL)) == 0 );
+}
+
+/* Put the current mapping of a surface aside, so it can be reused */
+static void SDL_KeepBlitMap(SDL_Surface *src)
+{
+	SDL_BlitMap *map = src->map;
+	SDL_BlitMap *prev, *cached;
+	int count;
+
+	/* Use an empty slot, a new one, or the least recently used one */
+	count = 0;
+	prev = map;
+	for ( cached = map->next; cached; cached = cached->next ) {
+		++count;
+		if ( cached->dst == NULL || cached->next == NULL ) {
+			break;
+		}
+		prev = cached;
+	}
+	if ( cached == NULL || (cached->dst && count < SDL_BLITMAP_CACHE) ) {
+		SDL_BlitMap *slot = SDL_AllocBlitMap();
+		if ( slot == NULL ) {
+			return;
+		}
+		slot->next = map->next;
+		map->next = slot;
+		prev = map;
+		cached = slot;
+	}
+	SDL_ClearMap(cached);
+	SDL_SwapBlitMaps(map, cached);
+	SDL_TouchBlitMap(map, prev, cached);
+}
+
+/* Switch a surface to one of its recent mappings, if one fits 'dst' */
+static int SDL_ReuseBlitMap(SDL_Surface *src, SDL_Surface *dst)
+{
+	SDL_BlitMap *map = src->map;
+	SDL_BlitMap *prev, *cached;
+
+	/* The current mapping may be fine for this destination too */
+	if ( map->dst && SDL_BlitMapFits(map, src, dst) ) {
+		map->dst = dst;
+		map->format_version = dst->format_version;
+		return(1);
+	}
+
+	/* Look for a recent mapping to this destination, or an equal one */
+	prev = map;
+	for ( cached = map->next; cached; cached = cached->next ) {
+		if ( cached->dst != NULL &&
+		     ((cached->dst == dst &&
+		       cached->format_version == dst->format_version) ||
+		      SDL_BlitMapFits(cached, src, dst)) ) {
+			break;
+		}
+		prev = cached;
+	}
+	if ( cached == NULL ) {
+		return(0);
+	}
+
+	/* Swap it with the current mapping, which is cleared if it has to
+	   be rebuilt from scratch next time.
+	 */
+	if ( ! SDL_BlitMapKeepable(src) ) {
+		if ( (src->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
+			SDL_UnRLESurface(src, 1);
+		}
+		SDL_ClearMap(map);
+	}
+	src->flags &= ~SDL_HWACCEL;
+	SDL_SwapBlitMaps(map, cached);
+	SDL_TouchBlitMap(map, prev, cached);
+
+	map->dst = dst;
+	map->format_version = dst->format_version;
+	return(1);
+}
+
+void SDL_GetBlitMapStats(Uint32 *hits, Uint32 *misses)
+{
+	if ( hits ) {
+		*hits = blitmap_hits;
+	}
+	if ( misses ) {
+		*misses = blitmap_misses;
+	}
+}
+
 int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 {
 	SDL_PixelFormat *srcfmt;
 	SDL_PixelFormat *dstfmt;
 	SDL_BlitMap *map;
 
-	/* Clear out any previous mapping */
+	/* Use a recent mapping if we have one */
+	if ( SDL_ReuseBlitMap(src, dst) ) {
+		++blitmap_hits;
+		return(0);
+	}
+	++blitmap_misses;
+
+	/* Clear out any previous mapping, keeping it for later if we can */
+	if ( SDL_BlitMapKeepable(src) ) {
+		SDL_KeepBlitMap(src);
+	}
 	map = src->map;
-	if ( (src->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
+	if ( (src->flags & SDL_RLEACCEL) == SDL_RLEACCEL &&
+	     ! SDL_RLEFits(src, dst) ) {
 		SDL_UnRLESurface(src, 1);
 	}
-	SDL_InvalidateMap(map);
+	SDL_ClearMap(map);
 
 	/* Figure out what kind of mapping we're doing */
 	map->identity = 0;
@@ -619,7 +1201,8 @@ int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 		switch (dstfmt->BytesPerPixel) {
 		    case 1:
 			/* BitField --> Palette */
-			map->table = MapNto1(srcfmt, dstfmt, &map->identity);
+			map->table = MapNto1(srcfmt, dstfmt,
+					&map->identity, &map->inverse);
 			if ( ! map->identity ) {
 				if ( map->table == NULL ) {
 					return(-1);
@@ -640,15 +1223,32 @@ int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 	map->format_version = dst->format_version;
 
 	/* Choose your blitters wisely */
-	return(SDL_CalculateBlit(src));
+	if ( SDL_CalculateBlit(src) < 0 ) {
+		return(-1);
+	}
+
+	/* Software blits only depend on the destination pixel format */
+	map->shareable = ( dst != src &&
+	                   (dst->flags & SDL_HWSURFACE) != SDL_HWSURFACE &&
+	                   (src->flags & SDL_HWACCEL) != SDL_HWACCEL &&
+	                   dstfmt->palette == NULL );
+	map->dst_BitsPerPixel = dstfmt->BitsPerPixel;
+	map->dst_Rmask = dstfmt->Rmask;
+	map->dst_Gmask = dstfmt->Gmask;
+	map->dst_Bmask = dstfmt->Bmask;
+	map->dst_Amask = dstfmt->Amask;
+	return(0);
 }
 void SDL_FreeBlitMap(SDL_BlitMap *map)
 {
-	if ( map ) {
-		SDL_InvalidateMap(map);
+	while ( map ) {
+		SDL_BlitMap *next = map->next;
+
+		SDL_ClearMap(map);
 		if ( map->sw_data != NULL ) {
 			SDL_free(map->sw_data);
 		}
 		SDL_free(map);
+		map = next;
 	}
 }
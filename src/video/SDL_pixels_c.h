@@ -39,8 +39,19 @@ extern void SDL_InvalidateMap(SDL_BlitMap *map);
 extern int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst);
 extern void SDL_FreeBlitMap(SDL_BlitMap *map);
 
+/* Inverse colormaps, shared by blit maps to palettes with the same colors.
+   The cube holds the nearest palette entry for each RGB 5-5-5 color.
+ */
+extern SDL_InverseMap *SDL_AcquireInverseMap(const SDL_Palette *pal);
+extern Uint8 *SDL_GetInverseCube(SDL_InverseMap *inv);
+extern void SDL_ReleaseInverseMap(SDL_InverseMap *inv);
+extern int SDL_InitInverseMaps(void);
+extern void SDL_QuitInverseMaps(void);
+
 /* Miscellaneous functions */
 extern Uint16 SDL_CalculatePitch(SDL_Surface *surface);
+extern Uint32 SDL_CalculatePitch32(SDL_Surface *surface);
+extern void SDL_SetSurfacePitch(SDL_Surface *surface, Uint32 pitch);
 extern void SDL_DitherColors(SDL_Color *colors, int bpp);
 extern Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b);
 extern void SDL_ApplyGamma(Uint16 *gamma, SDL_Color *colors, SDL_Color *output, int ncolors);
@@ -25,256 +25,972 @@
    Tomasz Cejner - thanks! :)
 
    April 27, 2000 - Sam Lantinga
+
+   The filtered modes work in two passes for each destination row: the
+   source rows under it are blended into a row of 16-bit channels, which
+   is then resampled horizontally with per-column coefficient tables.
 */
 
 #include "SDL_video.h"
 #include "SDL_blit.h"
+#include "SDL_workers_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
-/* This isn't ready for general consumption yet - it should be folded
-   into the general blitting mechanism.
-*/
+/* Filter weights are 7-bit fixed point, so a blend of 8-bit channels
+   still fits in a signed 16-bit lane for the multiply-add instructions.
+ */
+#define WEIGHT_BITS	7
+#define WEIGHT_ONE	(1 << WEIGHT_BITS)
+#define FILTER_ROUND	(1 << (2*WEIGHT_BITS - 1))
 
-#if ((defined(_MSC_VER) && defined(_M_IX86)) || \
-     (defined(__GNUC__) && defined(__i386__))) && SDL_ASSEMBLY_ROUTINES
-/* There's a bug with gcc 4.4.1 and -O2 where srcp doesn't get the correct
- * value after the first scanline.  FIXME? */
-/*#define USE_ASM_STRETCH*/
-#endif
+/* SDL_SoftStretch() picks its pixels the way it always has, stepping from
+   the first source pixel instead of sampling at the pixel centers.
+ */
+#define SDL_STRETCH_LEGACY	((SDL_StretchFilter)-1)
 
-#ifdef USE_ASM_STRETCH
+/* The source pixels under each visible destination column or row */
+typedef struct {
+	int first;		/* first visible destination pixel */
+	int count;		/* number of visible destination pixels */
+	int *start;		/* first source pixel for each of them */
+	Sint16 *weights;	/* 'taps' weights each, NULL for nearest */
+	int taps;		/* number of weights per pixel, even */
+} SDL_StretchCoeffs;
 
-#ifdef __WIN32__
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#elif defined(HAVE_MPROTECT)
-#include <sys/types.h>
-#include <sys/mman.h>
-#else
-#undef USE_ASM_STRETCH
-#endif
-#ifdef __GNUC__
-#define PAGE_ALIGNED __attribute__((__aligned__(4096)))
-#elif defined(_MSC_VER)
-#define PAGE_ALIGNED __declspec(align(4096))
-#else
-#undef USE_ASM_STRETCH
-#endif
-#endif /**/
+/* How 16-bit pixels are split into four 8-bit channels */
+typedef struct {
+	Uint16 mask[4];
+	Uint8 shift[4];
+	Uint8 loss[4];
+} SDL_StretchFormat;
 
-#ifdef USE_ASM_STRETCH
-#define PREFIX16	0x66
-#define STORE_BYTE	0xAA
-#define STORE_WORD	0xAB
-#define LOAD_BYTE	0xAC
-#define LOAD_WORD	0xAD
-#define RETURN		0xC3
+/* The passes work on pixels x to width-1 of a row */
+typedef void (*SDL_StretchVFilter)(const Uint8 **lines, const Sint16 *weights,
+		int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt);
+typedef void (*SDL_StretchHFilter)(const Uint16 *row,
+		const SDL_StretchCoeffs *xc, int x, Uint8 *out);
+typedef void (*SDL_StretchPack)(const Uint8 *in, Uint8 *out, int x,
+		int width, const SDL_StretchFormat *fmt);
 
-static PAGE_ALIGNED unsigned char copy_row[4096];
+/* Scratch memory for each band of destination rows */
+typedef struct {
+	Uint16 *filtered;	/* vertically filtered source row */
+	Uint8 *packed;		/* resampled row, 4 channels per pixel */
+	const Uint8 **lines;	/* source rows under a destination row */
+	Sint16 *weights;	/* and their weights */
+	Uint8 *row;		/* resampled row, for scaled blits */
+} SDL_StretchBand;
 
-static int generate_rowbytes(int src_w, int dst_w, int bpp)
+typedef struct {
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	int x, y, w, h;		/* destination pixels drawn */
+	SDL_StretchCoeffs xc;	/* starts are relative to src_x */
+	SDL_StretchCoeffs yc;
+	int src_x;		/* first source column read */
+	int src_w;		/* number of source columns read */
+	SDL_StretchFormat fmt;
+	SDL_StretchVFilter vfilter;
+	SDL_StretchHFilter hfilter;
+	SDL_StretchPack pack;
+	SDL_loblit blit;	/* converts rows for scaled blits */
+	SDL_BlitInfo row;
+	SDL_StretchBand *bands;
+} SDL_StretchInfo;
+
+static int SDL_FloorToInt(double x)
 {
-	static struct {
-		int bpp;
-		int src_w;
-		int dst_w;
-		int status;
-	} last;
+	int i = (int)x;
+	return (x < i) ? i-1 : i;
+}
 
-	int i;
-	int pos, inc;
-	unsigned char *eip, *fence;
-	unsigned char load, store;
-#ifdef  __WIN32__
-	DWORD oldprot;
+static int SDL_CeilToInt(double x)
+{
+	int i = (int)x;
+	return (x > i) ? i+1 : i;
+}
+
+/* Find the destination pixels along one axis which are inside the clip
+   range and whose centers map inside the source surface.
+ */
+static int SDL_StretchRange(int src_pos, int src_len, int src_max,
+                            int dst_pos, int dst_len, int clip_lo, int clip_hi,
+                            int *first, int *count)
+{
+	double ratio = (double)dst_len / src_len;
+	int lo, hi;
+
+	lo = SDL_CeilToInt((0 - src_pos) * ratio - 0.5);
+	hi = SDL_CeilToInt((src_max - src_pos) * ratio - 0.5);
+	if ( lo < 0 ) lo = 0;
+	if ( hi > dst_len ) hi = dst_len;
+	if ( lo < clip_lo - dst_pos ) lo = clip_lo - dst_pos;
+	if ( hi > clip_hi - dst_pos ) hi = clip_hi - dst_pos;
+	*first = lo;
+	*count = hi - lo;
+	return (*count > 0);
+}
+
+static void SDL_FreeStretchCoeffs(SDL_StretchCoeffs *c)
+{
+	if ( c->start ) {
+		SDL_free(c->start);
+		c->start = NULL;
+	}
+	if ( c->weights ) {
+		SDL_free(c->weights);
+		c->weights = NULL;
+	}
+}
+
+/* Compute the source pixels and weights for the destination pixels
+   c->first to c->first+c->count-1 of one axis.  Samples which fall
+   outside [0, src_max) are folded into the edge pixels, so the taps
+   of every destination pixel stay contiguous in the source.
+ */
+static int SDL_BuildStretchCoeffs(SDL_StretchCoeffs *c, int filter,
+                                  int src_pos, int src_len, int src_max,
+                                  int dst_len)
+{
+	double scale = (double)src_len / dst_len;
+	double *coverage;
+	int maxtaps;
+	int i, k;
+
+	c->start = (int *)SDL_malloc(c->count*sizeof(*c->start));
+	c->weights = NULL;
+	c->taps = 0;
+	if ( c->start == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	if ( filter == SDL_STRETCH_LEGACY ) {
+		/* The 16.16 fixed point steps, exact in a double */
+		double inc = (double)(src_len / dst_len) * 0x10000 +
+		             (int)((double)(src_len % dst_len) * 0x10000 / dst_len);
+		for ( i=0; i<c->count; ++i ) {
+			c->start[i] = src_pos +
+			              (int)((c->first+i) * inc / 0x10000);
+		}
+		return(0);
+	}
+	if ( filter == SDL_STRETCH_NEAREST ) {
+		for ( i=0; i<c->count; ++i ) {
+			int s = SDL_FloorToInt(src_pos + (c->first+i+0.5)*scale);
+			if ( s < 0 ) s = 0;
+			if ( s > src_max-1 ) s = src_max-1;
+			c->start[i] = s;
+		}
+		return(0);
+	}
+
+	if ( filter == SDL_STRETCH_AREA ) {
+		maxtaps = SDL_CeilToInt(scale) + 1;
+	} else {
+		maxtaps = 2;
+	}
+	c->taps = (maxtaps + 1) & ~1;
+	c->weights = (Sint16 *)SDL_malloc(c->count*c->taps*sizeof(Sint16));
+	coverage = (double *)SDL_malloc(2*c->taps*sizeof(double));
+	if ( c->weights == NULL || coverage == NULL ) {
+		if ( coverage ) {
+			SDL_free(coverage);
+		}
+		SDL_FreeStretchCoeffs(c);
+		SDL_OutOfMemory();
+		return(-1);
+	}
+
+	for ( i=0; i<c->count; ++i ) {
+		double *w = coverage + c->taps;
+		Sint16 *out = c->weights + i*c->taps;
+		int d = c->first + i;
+		int s0, n, s, big, sum;
+
+		if ( filter == SDL_STRETCH_AREA ) {
+			/* How much of each source pixel the destination covers */
+			double a = src_pos + d*scale;
+			double b = a + scale;
+
+			s0 = SDL_FloorToInt(a);
+			n = SDL_CeilToInt(b) - s0;
+			if ( n > maxtaps ) n = maxtaps;
+			for ( k=0; k<n; ++k ) {
+				double lo = (a > s0+k) ? a : s0+k;
+				double hi = (b < s0+k+1) ? b : s0+k+1;
+				coverage[k] = (hi > lo) ? (hi - lo) / scale : 0.0;
+			}
+		} else {
+			/* Linear interpolation between the two nearest centers */
+			double pos = src_pos + (d+0.5)*scale - 0.5;
+
+			s0 = SDL_FloorToInt(pos);
+			n = 2;
+			coverage[1] = pos - s0;
+			coverage[0] = 1.0 - coverage[1];
+		}
+
+		/* Clamp to the source, merging the weights of the edges */
+		s = s0;
+		if ( s < 0 ) s = 0;
+		if ( s > src_max-1 ) s = src_max-1;
+		for ( k=0; k<c->taps; ++k ) {
+			w[k] = 0.0;
+		}
+		for ( k=0; k<n; ++k ) {
+			int p = s0 + k;
+			if ( p < 0 ) p = 0;
+			if ( p > src_max-1 ) p = src_max-1;
+			w[p - s] += coverage[k];
+		}
+
+		/* Quantize, making sure the weights add up to exactly one */
+		big = 0;
+		sum = 0;
+		for ( k=0; k<c->taps; ++k ) {
+			out[k] = (Sint16)(w[k]*WEIGHT_ONE + 0.5);
+			sum += out[k];
+			if ( w[k] > w[big] ) {
+				big = k;
+			}
+		}
+		out[big] += WEIGHT_ONE - sum;
+		c->start[i] = s;
+	}
+	SDL_free(coverage);
+	return(0);
+}
+
+static void SDL_GetStretchFormat(const SDL_PixelFormat *f, SDL_StretchFormat *fmt)
+{
+	fmt->mask[0] = (Uint16)f->Rmask;
+	fmt->mask[1] = (Uint16)f->Gmask;
+	fmt->mask[2] = (Uint16)f->Bmask;
+	fmt->mask[3] = (Uint16)f->Amask;
+	fmt->shift[0] = f->Rshift;
+	fmt->shift[1] = f->Gshift;
+	fmt->shift[2] = f->Bshift;
+	fmt->shift[3] = f->Ashift;
+	fmt->loss[0] = f->Rloss;
+	fmt->loss[1] = f->Gloss;
+	fmt->loss[2] = f->Bloss;
+	fmt->loss[3] = f->Aloss;
+}
+
+/* Portable versions of the filter passes */
+
+static void VFilter32(const Uint8 **lines, const Sint16 *weights,
+		int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	int k;
+
+	for ( x*=4; x<width*4; ++x ) {
+		int sum = 0;
+		for ( k=0; k<n; ++k ) {
+			sum += lines[k][x] * weights[k];
+		}
+		out[x] = (Uint16)sum;
+	}
+}
+
+static void VFilter24(const Uint8 **lines, const Sint16 *weights,
+		int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	int c, k;
+
+	for ( ; x<width; ++x ) {
+		for ( c=0; c<3; ++c ) {
+			int sum = 0;
+			for ( k=0; k<n; ++k ) {
+				sum += lines[k][x*3+c] * weights[k];
+			}
+			out[x*4+c] = (Uint16)sum;
+		}
+		out[x*4+3] = 0;
+	}
+}
+
+static void VFilter16(const Uint8 **lines, const Sint16 *weights,
+		int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	int c, k;
+
+	for ( ; x<width; ++x ) {
+		int sum[4] = { 0, 0, 0, 0 };
+		for ( k=0; k<n; ++k ) {
+			Uint16 pixel = ((const Uint16 *)lines[k])[x];
+			for ( c=0; c<4; ++c ) {
+				sum[c] += (((pixel & fmt->mask[c]) >> fmt->shift[c])
+				           << fmt->loss[c]) * weights[k];
+			}
+		}
+		for ( c=0; c<4; ++c ) {
+			out[x*4+c] = (Uint16)sum[c];
+		}
+	}
+}
+
+static void HFilter(const Uint16 *row, const SDL_StretchCoeffs *xc,
+                    int x, Uint8 *out)
+{
+	int k, c;
+
+	for ( ; x<xc->count; ++x ) {
+		const Uint16 *p = row + 4*xc->start[x];
+		const Sint16 *w = xc->weights + x*xc->taps;
+		for ( c=0; c<4; ++c ) {
+			int sum = FILTER_ROUND;
+			for ( k=0; k<xc->taps; ++k ) {
+				sum += p[4*k+c] * w[k];
+			}
+			out[4*x+c] = (Uint8)(sum >> (2*WEIGHT_BITS));
+		}
+	}
+}
+
+static void Pack24(const Uint8 *in, Uint8 *out, int x, int width,
+                   const SDL_StretchFormat *fmt)
+{
+	for ( ; x<width; ++x ) {
+		out[3*x+0] = in[4*x+0];
+		out[3*x+1] = in[4*x+1];
+		out[3*x+2] = in[4*x+2];
+	}
+}
+
+static void Pack16(const Uint8 *in, Uint8 *out, int x, int width,
+                   const SDL_StretchFormat *fmt)
+{
+	int c;
+
+	for ( ; x<width; ++x ) {
+		Uint16 pixel = 0;
+		for ( c=0; c<4; ++c ) {
+			int value = in[4*x+c];
+			if ( fmt->loss[c] >= 8 ) {
+				continue;
+			}
+			/* Round to the nearest value the format can hold */
+			if ( fmt->loss[c] > 0 ) {
+				value += 1 << (fmt->loss[c] - 1);
+				if ( value > 255 ) value = 255;
+			}
+			pixel |= (value >> fmt->loss[c]) << fmt->shift[c];
+		}
+		((Uint16 *)out)[x] = pixel;
+	}
+}
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/* The pair of weights for taps k and k+1, for the multiply-add */
+#define WEIGHT_PAIR(w, k) \
+	(int)((Uint16)(w)[k] | ((Uint32)(Uint16)(w)[(k)+1] << 16))
 #endif
 
-	/* See if we need to regenerate the copy buffer */
-	if ( (src_w == last.src_w) &&
-	     (dst_w == last.dst_w) && (bpp == last.bpp) ) {
-		return(last.status);
+#if SDL_SSE2_INTRINSICS
+static void SDL_TARGETING("sse2") VFilter32SSE2(const Uint8 **lines,
+		const Sint16 *weights, int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int k;
+
+	for ( ; x+4<=width; x+=4 ) {
+		__m128i lo = zero, hi = zero;
+		for ( k=0; k<n; ++k ) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(lines[k]+4*x));
+			__m128i w = _mm_set1_epi16(weights[k]);
+			lo = _mm_add_epi16(lo,
+				_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), w));
+			hi = _mm_add_epi16(hi,
+				_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), w));
+		}
+		_mm_storeu_si128((__m128i *)(out+4*x), lo);
+		_mm_storeu_si128((__m128i *)(out+4*x+8), hi);
 	}
-	last.bpp = bpp;
-	last.src_w = src_w;
-	last.dst_w = dst_w;
-	last.status = -1;
+	VFilter32(lines, weights, n, x, width, out, fmt);
+}
+
+/* Store 8 pixels of planar channels as 4 channels per pixel */
+static __inline__ void SDL_TARGETING("sse2")
+Interleave8_SSE2(Uint16 *out, __m128i r, __m128i g, __m128i b, __m128i a)
+{
+	__m128i rg = _mm_unpacklo_epi16(r, g);
+	__m128i ba = _mm_unpacklo_epi16(b, a);
+	_mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi32(rg, ba));
+	_mm_storeu_si128((__m128i *)(out+8), _mm_unpackhi_epi32(rg, ba));
+	rg = _mm_unpackhi_epi16(r, g);
+	ba = _mm_unpackhi_epi16(b, a);
+	_mm_storeu_si128((__m128i *)(out+16), _mm_unpacklo_epi32(rg, ba));
+	_mm_storeu_si128((__m128i *)(out+24), _mm_unpackhi_epi32(rg, ba));
+}
+
+static void SDL_TARGETING("sse2") VFilter16SSE2(const Uint8 **lines,
+		const Sint16 *weights, int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	__m128i mask[4], shift[4], loss[4];
+	int c, k;
+
+	for ( c=0; c<4; ++c ) {
+		mask[c] = _mm_set1_epi16(fmt->mask[c]);
+		shift[c] = _mm_cvtsi32_si128(fmt->shift[c]);
+		loss[c] = _mm_cvtsi32_si128(fmt->loss[c]);
+	}
+	for ( ; x+8<=width; x+=8 ) {
+		__m128i sum[4];
+		for ( c=0; c<4; ++c ) {
+			sum[c] = _mm_setzero_si128();
+		}
+		for ( k=0; k<n; ++k ) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(lines[k]+2*x));
+			__m128i w = _mm_set1_epi16(weights[k]);
+			for ( c=0; c<4; ++c ) {
+				__m128i ch = _mm_and_si128(v, mask[c]);
+				ch = _mm_sll_epi16(_mm_srl_epi16(ch, shift[c]), loss[c]);
+				sum[c] = _mm_add_epi16(sum[c], _mm_mullo_epi16(ch, w));
+			}
+		}
+		Interleave8_SSE2(out+4*x, sum[0], sum[1], sum[2], sum[3]);
+	}
+	VFilter16(lines, weights, n, x, width, out, fmt);
+}
+
+/* Blend two pixels of the filtered row for each destination pixel */
+static __inline__ __m128i SDL_TARGETING("sse2")
+HFilterTaps_SSE2(const Uint16 *p, const Sint16 *w, int taps)
+{
+	__m128i sum = _mm_set1_epi32(FILTER_ROUND);
+	int k;
+
+	for ( k=0; k<taps; k+=2 ) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p+4*k));
+		v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+		sum = _mm_add_epi32(sum,
+			_mm_madd_epi16(v, _mm_set1_epi32(WEIGHT_PAIR(w, k))));
+	}
+	return _mm_srai_epi32(sum, 2*WEIGHT_BITS);
+}
+
+static void SDL_TARGETING("sse2") HFilterSSE2(const Uint16 *row,
+		const SDL_StretchCoeffs *xc, int x, Uint8 *out)
+{
+	const int taps = xc->taps;
+
+	for ( ; x+2<=xc->count; x+=2 ) {
+		__m128i a = HFilterTaps_SSE2(row + 4*xc->start[x],
+		                             xc->weights + x*taps, taps);
+		__m128i b = HFilterTaps_SSE2(row + 4*xc->start[x+1],
+		                             xc->weights + (x+1)*taps, taps);
+		a = _mm_packs_epi32(a, b);
+		_mm_storel_epi64((__m128i *)(out+4*x), _mm_packus_epi16(a, a));
+	}
+	HFilter(row, xc, x, out);
+}
+
+static void SDL_TARGETING("sse2") Pack16SSE2(const Uint8 *in, Uint8 *out,
+		int x, int width, const SDL_StretchFormat *fmt)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i round_rg, round_ba, keep[4], shift[4], loss[4];
+	Uint8 round[4];
+	int c;
+
+	for ( c=0; c<4; ++c ) {
+		/* Missing channels are shifted out entirely */
+		int l = (fmt->loss[c] >= 8) ? 16 : fmt->loss[c];
+		round[c] = (l > 0 && l < 16) ? (1 << (l - 1)) : 0;
+		shift[c] = _mm_cvtsi32_si128(fmt->shift[c]);
+		loss[c] = _mm_cvtsi32_si128(l);
+		keep[c] = _mm_set1_epi16(fmt->mask[c]);
+	}
+	round_rg = _mm_set_epi8(round[1], round[1], round[1], round[1],
+	                        round[1], round[1], round[1], round[1],
+	                        round[0], round[0], round[0], round[0],
+	                        round[0], round[0], round[0], round[0]);
+	round_ba = _mm_set_epi8(round[3], round[3], round[3], round[3],
+	                        round[3], round[3], round[3], round[3],
+	                        round[2], round[2], round[2], round[2],
+	                        round[2], round[2], round[2], round[2]);
+	for ( ; x+8<=width; x+=8 ) {
+		__m128i v0 = _mm_loadu_si128((const __m128i *)(in+4*x));
+		__m128i v1 = _mm_loadu_si128((const __m128i *)(in+4*x+16));
+		__m128i t0, t1, ch[4], pixels;
+
+		/* Transpose to 8 bytes of each channel */
+		t0 = _mm_unpacklo_epi8(v0, v1);
+		t1 = _mm_unpackhi_epi8(v0, v1);
+		v0 = _mm_unpacklo_epi8(t0, t1);
+		v1 = _mm_unpackhi_epi8(t0, t1);
+		t0 = _mm_adds_epu8(_mm_unpacklo_epi8(v0, v1), round_rg);
+		t1 = _mm_adds_epu8(_mm_unpackhi_epi8(v0, v1), round_ba);
+		ch[0] = _mm_unpacklo_epi8(t0, zero);
+		ch[1] = _mm_unpackhi_epi8(t0, zero);
+		ch[2] = _mm_unpacklo_epi8(t1, zero);
+		ch[3] = _mm_unpackhi_epi8(t1, zero);
+
+		pixels = zero;
+		for ( c=0; c<4; ++c ) {
+			__m128i v = _mm_srl_epi16(ch[c], loss[c]);
+			v = _mm_and_si128(_mm_sll_epi16(v, shift[c]), keep[c]);
+			pixels = _mm_or_si128(pixels, v);
+		}
+		_mm_storeu_si128((__m128i *)(out+2*x), pixels);
+	}
+	Pack16(in, out, x, width, fmt);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+static void SDL_TARGETING("avx2") VFilter32AVX2(const Uint8 **lines,
+		const Sint16 *weights, int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	int k;
+
+	for ( ; x+8<=width; x+=8 ) {
+		__m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+		for ( k=0; k<n; ++k ) {
+			const __m128i *p = (const __m128i *)(lines[k]+4*x);
+			__m256i w = _mm256_set1_epi16(weights[k]);
+			lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(p)), w));
+			hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(
+				_mm256_cvtepu8_epi16(_mm_loadu_si128(p+1)), w));
+		}
+		_mm256_storeu_si256((__m256i *)(out+4*x), lo);
+		_mm256_storeu_si256((__m256i *)(out+4*x+16), hi);
+	}
+	VFilter32(lines, weights, n, x, width, out, fmt);
+}
+
+static void SDL_TARGETING("avx2") VFilter16AVX2(const Uint8 **lines,
+		const Sint16 *weights, int n, int x, int width, Uint16 *out,
+		const SDL_StretchFormat *fmt)
+{
+	__m256i mask[4];
+	__m128i shift[4], loss[4];
+	int c, k;
+
+	for ( c=0; c<4; ++c ) {
+		mask[c] = _mm256_set1_epi16(fmt->mask[c]);
+		shift[c] = _mm_cvtsi32_si128(fmt->shift[c]);
+		loss[c] = _mm_cvtsi32_si128(fmt->loss[c]);
+	}
+	for ( ; x+16<=width; x+=16 ) {
+		__m256i sum[4], rg, ba, p0, p1, p2, p3;
+		for ( c=0; c<4; ++c ) {
+			sum[c] = _mm256_setzero_si256();
+		}
+		for ( k=0; k<n; ++k ) {
+			__m256i v = _mm256_loadu_si256((const __m256i *)(lines[k]+2*x));
+			__m256i w = _mm256_set1_epi16(weights[k]);
+			for ( c=0; c<4; ++c ) {
+				__m256i ch = _mm256_and_si256(v, mask[c]);
+				ch = _mm256_sll_epi16(_mm256_srl_epi16(ch, shift[c]),
+				                      loss[c]);
+				sum[c] = _mm256_add_epi16(sum[c],
+				                          _mm256_mullo_epi16(ch, w));
+			}
+		}
+		/* The unpacks work within each 128-bit lane */
+		rg = _mm256_unpacklo_epi16(sum[0], sum[1]);
+		ba = _mm256_unpacklo_epi16(sum[2], sum[3]);
+		p0 = _mm256_unpacklo_epi32(rg, ba);	/* 0-1, 8-9 */
+		p1 = _mm256_unpackhi_epi32(rg, ba);	/* 2-3, 10-11 */
+		rg = _mm256_unpackhi_epi16(sum[0], sum[1]);
+		ba = _mm256_unpackhi_epi16(sum[2], sum[3]);
+		p2 = _mm256_unpacklo_epi32(rg, ba);	/* 4-5, 12-13 */
+		p3 = _mm256_unpackhi_epi32(rg, ba);	/* 6-7, 14-15 */
+		_mm256_storeu_si256((__m256i *)(out+4*x),
+		                    _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i *)(out+4*x+16),
+		                    _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256((__m256i *)(out+4*x+32),
+		                    _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256((__m256i *)(out+4*x+48),
+		                    _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+	VFilter16(lines, weights, n, x, width, out, fmt);
+}
+
+/* Two destination pixels at once, one in each 128-bit lane */
+static __inline__ __m256i SDL_TARGETING("avx2")
+HFilterTaps_AVX2(const Uint16 *p0, const Sint16 *w0,
+                 const Uint16 *p1, const Sint16 *w1, int taps)
+{
+	__m256i sum = _mm256_set1_epi32(FILTER_ROUND);
+	int k;
+
+	for ( k=0; k<taps; k+=2 ) {
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_loadu_si128((const __m128i *)(p0+4*k))),
+			_mm_loadu_si128((const __m128i *)(p1+4*k)), 1);
+		__m256i w = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_set1_epi32(WEIGHT_PAIR(w0, k))),
+			_mm_set1_epi32(WEIGHT_PAIR(w1, k)), 1);
+		v = _mm256_unpacklo_epi16(v, _mm256_srli_si256(v, 8));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+	}
+	return _mm256_srai_epi32(sum, 2*WEIGHT_BITS);
+}
+
+static void SDL_TARGETING("avx2") HFilterAVX2(const Uint16 *row,
+		const SDL_StretchCoeffs *xc, int x, Uint8 *out)
+{
+	const int taps = xc->taps;
+	const Sint16 *w = xc->weights;
+
+	for ( ; x+4<=xc->count; x+=4 ) {
+		__m256i a = HFilterTaps_AVX2(
+			row + 4*xc->start[x], w + x*taps,
+			row + 4*xc->start[x+1], w + (x+1)*taps, taps);
+		__m256i b = HFilterTaps_AVX2(
+			row + 4*xc->start[x+2], w + (x+2)*taps,
+			row + 4*xc->start[x+3], w + (x+3)*taps, taps);
+		/* Pixels 0 2 | 1 3 after packing within the lanes */
+		a = _mm256_packs_epi32(a, b);
+		a = _mm256_packus_epi16(a, a);
+		_mm_storeu_si128((__m128i *)(out+4*x), _mm_unpacklo_epi32(
+			_mm256_castsi256_si128(a),
+			_mm256_extracti128_si256(a, 1)));
+	}
+	HFilter(row, xc, x, out);
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+/* Nearest neighbour copy of one row, 'xs' are the source columns */
+static void SDL_StretchRowNearest(const Uint8 *src, Uint8 *dst,
+                                  const int *xs, int count, int bpp)
+{
+	int i;
 
 	switch (bpp) {
 	    case 1:
-		load = LOAD_BYTE;
-		store = STORE_BYTE;
+		for ( i=0; i<count; ++i ) {
+			dst[i] = src[xs[i]];
+		}
 		break;
 	    case 2:
+		for ( i=0; i<count; ++i ) {
+			((Uint16 *)dst)[i] = ((const Uint16 *)src)[xs[i]];
+		}
+		break;
+	    case 3:
+		for ( i=0; i<count; ++i ) {
+			const Uint8 *p = src + 3*xs[i];
+			dst[3*i+0] = p[0];
+			dst[3*i+1] = p[1];
+			dst[3*i+2] = p[2];
+		}
+		break;
 	    case 4:
-		load = LOAD_WORD;
-		store = STORE_WORD;
+		for ( i=0; i<count; ++i ) {
+			((Uint32 *)dst)[i] = ((const Uint32 *)src)[xs[i]];
+		}
 		break;
-	    default:
-		SDL_SetError("ASM stretch of %d bytes isn't supported\n", bpp);
-		return(-1);
 	}
-	/* Make the code writeable */
-#ifdef __WIN32__
-	if (!VirtualProtect(copy_row, sizeof(copy_row), PAGE_READWRITE, &oldprot)) {
-		SDL_SetError("Couldn't make copy buffer writeable");
-		return(-1);
+}
+
+/* Resample destination row 'y' into 'out', in the source format */
+static void SDL_StretchRow(SDL_StretchInfo *info, SDL_StretchBand *band,
+                           int y, Uint8 *out)
+{
+	SDL_Surface *src = info->src;
+	const int bpp = src->format->BytesPerPixel;
+	const Sint16 *w;
+	int k, n;
+
+	if ( info->yc.weights == NULL ) {
+		SDL_StretchRowNearest((const Uint8 *)src->pixels +
+		                      (size_t)info->yc.start[y]*
+		                      SDL_SURFACE_PITCH(src),
+		                      out, info->xc.start, info->w, bpp);
+		return;
 	}
-#elif defined(HAVE_MPROTECT)
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_WRITE) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer writeable");
-		return(-1);
+
+	/* Blend the source rows, skipping the padding taps */
+	w = info->yc.weights + y*info->yc.taps;
+	n = 0;
+	for ( k=0; k<info->yc.taps; ++k ) {
+		if ( w[k] ) {
+			band->lines[n] = (const Uint8 *)src->pixels +
+			                 (size_t)(info->yc.start[y]+k)*
+			                 SDL_SURFACE_PITCH(src) +
+			                 (size_t)info->src_x*bpp;
+			band->weights[n] = w[k];
+			++n;
+		}
 	}
-#endif
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	eip = copy_row;
-	fence = copy_row+sizeof(copy_row)-2;
-	for ( i=0; i<dst_w; ++i ) {
-		while ( pos >= 0x10000L ) {
-			if ( eip == fence ) {
-				return -1;
-			}
-			if ( bpp == 2 ) {
-				*eip++ = PREFIX16;
+	info->vfilter(band->lines, band->weights, n, 0, info->src_w,
+	              band->filtered, &info->fmt);
+	if ( info->pack ) {
+		info->hfilter(band->filtered, &info->xc, 0, band->packed);
+		info->pack(band->packed, out, 0, info->w, &info->fmt);
+	} else {
+		info->hfilter(band->filtered, &info->xc, 0, out);
+	}
+}
+
+static void SDL_RunStretchBand(void *data, int index, int count)
+{
+	SDL_StretchInfo *info = (SDL_StretchInfo *)data;
+	SDL_StretchBand *band = &info->bands[index];
+	SDL_Surface *dst = info->dst;
+	const int bpp = dst->format->BytesPerPixel;
+	const Uint32 pitch = SDL_SURFACE_PITCH(dst);
+	int first = info->h * index / count;
+	int last = info->h * (index+1) / count;
+	Uint8 *dstp = (Uint8 *)dst->pixels +
+	              (size_t)(info->y+first)*pitch + (size_t)info->x*bpp;
+	int y, same;
+
+	for ( y=first; y<last; ++y, dstp += pitch ) {
+		/* Nearest rows sampling the same source row are the same */
+		same = ( y > first && info->yc.weights == NULL &&
+		         info->yc.start[y] == info->yc.start[y-1] );
+		if ( info->blit ) {
+			/* Convert the resampled row onto the destination */
+			SDL_BlitInfo row = info->row;
+
+			if ( ! same ) {
+				SDL_StretchRow(info, band, y, band->row);
 			}
-			*eip++ = load;
-			pos -= 0x10000L;
-		}
-		if ( eip == fence ) {
-			return -1;
+			row.s_pixels = band->row;
+			row.d_pixels = dstp;
+			info->blit(&row);
+		} else if ( same ) {
+			SDL_memcpy(dstp, dstp - pitch, (size_t)info->w*bpp);
+		} else {
+			SDL_StretchRow(info, band, y, dstp);
 		}
-		if ( bpp == 2 ) {
-			*eip++ = PREFIX16;
+	}
+}
+
+static void SDL_FreeStretchInfo(SDL_StretchInfo *info, int bands)
+{
+	int i;
+
+	if ( info->bands ) {
+		for ( i=0; i<bands; ++i ) {
+			SDL_StretchBand *band = &info->bands[i];
+			if ( band->filtered ) SDL_free(band->filtered);
+			if ( band->packed ) SDL_free(band->packed);
+			if ( band->lines ) SDL_free((void *)band->lines);
+			if ( band->weights ) SDL_free(band->weights);
+			if ( band->row ) SDL_free(band->row);
 		}
-		*eip++ = store;
-		pos += inc;
+		SDL_free(info->bands);
+		info->bands = NULL;
 	}
-	*eip++ = RETURN;
+	SDL_FreeStretchCoeffs(&info->xc);
+	SDL_FreeStretchCoeffs(&info->yc);
+}
 
-	/* Make the code executable but not writeable */
-#ifdef __WIN32__
-	if (!VirtualProtect(copy_row, sizeof(copy_row), PAGE_EXECUTE_READ, &oldprot)) {
-		SDL_SetError("Couldn't make copy buffer executable");
-		return(-1);
+/* Pick the filter passes for the source format */
+static void SDL_ChooseStretchFilters(SDL_StretchInfo *info)
+{
+	const SDL_PixelFormat *format = info->src->format;
+
+	info->pack = NULL;
+	info->hfilter = HFilter;
+	switch (format->BytesPerPixel) {
+	    case 2:
+		SDL_GetStretchFormat(format, &info->fmt);
+		info->vfilter = VFilter16;
+		info->pack = Pack16;
+		break;
+	    case 3:
+		info->vfilter = VFilter24;
+		info->pack = Pack24;
+		break;
+	    default:
+		info->vfilter = VFilter32;
+		break;
 	}
-#elif defined(HAVE_MPROTECT)
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_EXEC) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer executable");
-		return(-1);
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		info->hfilter = HFilterAVX2;
+		if ( format->BytesPerPixel == 2 ) {
+			info->vfilter = VFilter16AVX2;
+			info->pack = Pack16SSE2;
+		} else if ( format->BytesPerPixel == 4 ) {
+			info->vfilter = VFilter32AVX2;
+		}
+		return;
+	}
+#endif
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		info->hfilter = HFilterSSE2;
+		if ( format->BytesPerPixel == 2 ) {
+			info->vfilter = VFilter16SSE2;
+			info->pack = Pack16SSE2;
+		} else if ( format->BytesPerPixel == 4 ) {
+			info->vfilter = VFilter32SSE2;
+		}
 	}
 #endif
-	last.status = 0;
-	return(0);
 }
 
-#endif /* USE_ASM_STRETCH */
-
-#define DEFINE_COPY_ROW(name, type)			\
-void name(type *src, int src_w, type *dst, int dst_w)	\
-{							\
-	int i;						\
-	int pos, inc;					\
-	type pixel = 0;					\
-							\
-	pos = 0x10000;					\
-	inc = (src_w << 16) / dst_w;			\
-	for ( i=dst_w; i>0; --i ) {			\
-		while ( pos >= 0x10000L ) {		\
-			pixel = *src++;			\
-			pos -= 0x10000L;		\
-		}					\
-		*dst++ = pixel;				\
-		pos += inc;				\
-	}						\
-}
-DEFINE_COPY_ROW(copy_row1, Uint8)
-DEFINE_COPY_ROW(copy_row2, Uint16)
-DEFINE_COPY_ROW(copy_row4, Uint32)
-
-/* The ASM code doesn't handle 24-bpp stretch blits */
-void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
+static int SDL_AllocStretchBands(SDL_StretchInfo *info, int bands)
 {
+	int len = 0;
 	int i;
-	int pos, inc;
-	Uint8 pixel[3] = { 0, 0, 0 };
 
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	for ( i=dst_w; i>0; --i ) {
-		while ( pos >= 0x10000L ) {
-			pixel[0] = *src++;
-			pixel[1] = *src++;
-			pixel[2] = *src++;
-			pos -= 0x10000L;
+	info->bands = (SDL_StretchBand *)SDL_calloc(bands, sizeof(SDL_StretchBand));
+	if ( info->bands == NULL ) {
+		return(-1);
+	}
+	if ( info->yc.weights ) {
+		/* Padding taps may read past the last source column */
+		len = info->xc.start[info->xc.count-1] + info->xc.taps;
+		if ( len < info->src_w ) {
+			len = info->src_w;
+		}
+	}
+	for ( i=0; i<bands; ++i ) {
+		SDL_StretchBand *band = &info->bands[i];
+		if ( info->blit ) {
+			band->row = (Uint8 *)SDL_malloc(info->w *
+			                    info->src->format->BytesPerPixel);
+			if ( band->row == NULL ) {
+				return(-1);
+			}
+		}
+		if ( len == 0 ) {
+			continue;
+		}
+		/* Keep it zeroed, so the padding is harmless */
+		band->filtered = (Uint16 *)SDL_calloc(len, 4*sizeof(Uint16));
+		band->lines = (const Uint8 **)SDL_malloc(info->yc.taps*sizeof(Uint8 *));
+		band->weights = (Sint16 *)SDL_malloc(info->yc.taps*sizeof(Sint16));
+		if ( !band->filtered || !band->lines || !band->weights ) {
+			return(-1);
+		}
+		if ( info->pack ) {
+			band->packed = (Uint8 *)SDL_malloc(info->w*4);
+			if ( band->packed == NULL ) {
+				return(-1);
+			}
 		}
-		*dst++ = pixel[0];
-		*dst++ = pixel[1];
-		*dst++ = pixel[2];
-		pos += inc;
 	}
+	return(0);
 }
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
-int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
-                    SDL_Surface *dst, SDL_Rect *dstrect)
+/* Scale 'srcrect' of 'src' to 'dstrect' of 'dst', clipped to 'clip'.
+   With 'blit' set, the rows go through the blit mapping of the source,
+   otherwise both surfaces must have the same format.  If anything is
+   drawn, the destination pixels covered are stored in 'drawn'.
+ */
+static int SDL_StretchSurface(SDL_Surface *src, const SDL_Rect32 *srcrect,
+                              SDL_Surface *dst, const SDL_Rect32 *dstrect,
+                              const SDL_Rect32 *clip, SDL_StretchFilter filter,
+                              int blit, SDL_Rect32 *drawn)
 {
+	SDL_StretchInfo info;
+	SDL_Rect32 full_src;
+	SDL_Rect32 full_dst;
 	int src_locked;
 	int dst_locked;
-	int pos, inc;
-	int dst_maxrow;
-	int src_row, dst_row;
-	Uint8 *srcp = NULL;
-	Uint8 *dstp;
-	SDL_Rect full_src;
-	SDL_Rect full_dst;
-#ifdef USE_ASM_STRETCH
-	SDL_bool use_asm = SDL_TRUE;
-#ifdef __GNUC__
-	int u1, u2;
-#endif
-#endif /* USE_ASM_STRETCH */
-	const int bpp = dst->format->BytesPerPixel;
+	int bands;
+	int i;
 
-	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
+	if ( !blit &&
+	     src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
 		SDL_SetError("Only works with same format surfaces");
 		return(-1);
 	}
-
-	/* Verify the blit rectangles */
-	if ( srcrect ) {
-		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
-		     ((srcrect->x+srcrect->w) > src->w) ||
-		     ((srcrect->y+srcrect->h) > src->h) ) {
-			SDL_SetError("Invalid source blit rectangle");
-			return(-1);
-		}
-	} else {
+	if ( srcrect == NULL ) {
 		full_src.x = 0;
 		full_src.y = 0;
 		full_src.w = src->w;
 		full_src.h = src->h;
 		srcrect = &full_src;
 	}
-	if ( dstrect ) {
-		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
-		     ((dstrect->x+dstrect->w) > dst->w) ||
-		     ((dstrect->y+dstrect->h) > dst->h) ) {
-			SDL_SetError("Invalid destination blit rectangle");
-			return(-1);
-		}
-	} else {
+	if ( dstrect == NULL ) {
 		full_dst.x = 0;
 		full_dst.y = 0;
 		full_dst.w = dst->w;
 		full_dst.h = dst->h;
 		dstrect = &full_dst;
 	}
+	if ( srcrect->w == 0 || srcrect->h == 0 ||
+	     dstrect->w == 0 || dstrect->h == 0 ) {
+		return(0);
+	}
+	/* Blending palette indices makes no sense */
+	if ( src->format->BytesPerPixel == 1 && filter != SDL_STRETCH_LEGACY ) {
+		filter = SDL_STRETCH_NEAREST;
+	}
+
+	SDL_memset(&info, 0, sizeof(info));
+	if ( !SDL_StretchRange(srcrect->x, srcrect->w, src->w,
+	                       dstrect->x, dstrect->w,
+	                       clip->x, clip->x + clip->w,
+	                       &info.xc.first, &info.xc.count) ||
+	     !SDL_StretchRange(srcrect->y, srcrect->h, src->h,
+	                       dstrect->y, dstrect->h,
+	                       clip->y, clip->y + clip->h,
+	                       &info.yc.first, &info.yc.count) ) {
+		/* Nothing to draw */
+		return(0);
+	}
+	info.src = src;
+	info.dst = dst;
+	info.x = dstrect->x + info.xc.first;
+	info.y = dstrect->y + info.yc.first;
+	info.w = info.xc.count;
+	info.h = info.yc.count;
+	bands = SDL_GetWorkerBands(SDL_WORKER_PIXELS(info.w, info.h), info.h);
+
+	if ( SDL_BuildStretchCoeffs(&info.xc, filter, srcrect->x, srcrect->w,
+	                            src->w, dstrect->w) < 0 ||
+	     SDL_BuildStretchCoeffs(&info.yc, filter, srcrect->y, srcrect->h,
+	                            src->h, dstrect->h) < 0 ) {
+		SDL_FreeStretchInfo(&info, 0);
+		return(-1);
+	}
+	if ( filter != SDL_STRETCH_NEAREST && filter != SDL_STRETCH_LEGACY ) {
+		/* Only the source columns under the destination are filtered */
+		info.src_x = info.xc.start[0];
+		info.src_w = info.xc.start[info.xc.count-1] + info.xc.taps;
+		if ( info.src_w > src->w ) {
+			info.src_w = src->w;
+		}
+		info.src_w -= info.src_x;
+		for ( i=0; i<info.xc.count; ++i ) {
+			info.xc.start[i] -= info.src_x;
+		}
+		SDL_ChooseStretchFilters(&info);
+	}
+	if ( blit ) {
+		/* Each resampled row is converted like a one row blit */
+		info.blit = src->map->sw_data->blit;
+		info.row.s_width = info.w;
+		info.row.s_height = 1;
+		info.row.d_width = info.w;
+		info.row.d_height = 1;
+		info.row.aux_data = src->map->sw_data->aux_data;
+		info.row.src = src->format;
+		info.row.table = src->map->table;
+		info.row.dst = dst->format;
+	}
+	if ( SDL_AllocStretchBands(&info, bands) < 0 ) {
+		SDL_FreeStretchInfo(&info, bands);
+		SDL_OutOfMemory();
+		return(-1);
+	}
 
 	/* Lock the destination if it's in hardware */
 	dst_locked = 0;
 	if ( SDL_MUSTLOCK(dst) ) {
 		if ( SDL_LockSurface(dst) < 0 ) {
+			SDL_FreeStretchInfo(&info, bands);
 			SDL_SetError("Unable to lock destination surface");
 			return(-1);
 		}
@@ -287,81 +1003,14 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 			if ( dst_locked ) {
 				SDL_UnlockSurface(dst);
 			}
+			SDL_FreeStretchInfo(&info, bands);
 			SDL_SetError("Unable to lock source surface");
 			return(-1);
 		}
 		src_locked = 1;
 	}
 
-	/* Set up the data... */
-	pos = 0x10000;
-	inc = (srcrect->h << 16) / dstrect->h;
-	src_row = srcrect->y;
-	dst_row = dstrect->y;
-
-#ifdef USE_ASM_STRETCH
-	/* Write the opcodes for this stretch */
-	if ( (bpp == 3) ||
-	     (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0) ) {
-		use_asm = SDL_FALSE;
-	}
-#endif
-
-	/* Perform the stretch blit */
-	for ( dst_maxrow = dst_row+dstrect->h; dst_row<dst_maxrow; ++dst_row ) {
-		dstp = (Uint8 *)dst->pixels + (dst_row*dst->pitch)
-		                            + (dstrect->x*bpp);
-		while ( pos >= 0x10000L ) {
-			srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
-			                            + (srcrect->x*bpp);
-			++src_row;
-			pos -= 0x10000L;
-		}
-#ifdef USE_ASM_STRETCH
-		if (use_asm) {
-#ifdef __GNUC__
-			__asm__ __volatile__ (
-			"call *%4"
-			: "=&D" (u1), "=&S" (u2)
-			: "0" (dstp), "1" (srcp), "r" (copy_row)
-			: "memory" );
-#elif defined(_MSC_VER)
-		{ void *code = copy_row;
-			__asm {
-				push edi
-				push esi
-	
-				mov edi, dstp
-				mov esi, srcp
-				call dword ptr code
-
-				pop esi
-				pop edi
-			}
-		}
-#else
-#error Need inline assembly for this compiler
-#endif
-		} else
-#endif
-		switch (bpp) {
-		    case 1:
-			copy_row1(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 2:
-			copy_row2((Uint16 *)srcp, srcrect->w,
-			          (Uint16 *)dstp, dstrect->w);
-			break;
-		    case 3:
-			copy_row3(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 4:
-			copy_row4((Uint32 *)srcp, srcrect->w,
-			          (Uint32 *)dstp, dstrect->w);
-			break;
-		}
-		pos += inc;
-	}
+	SDL_RunWorkers(SDL_RunStretchBand, &info, bands);
 
 	/* We need to unlock the surfaces if they're locked */
 	if ( dst_locked ) {
@@ -370,6 +1019,110 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( src_locked ) {
 		SDL_UnlockSurface(src);
 	}
+	if ( drawn ) {
+		drawn->x = info.x;
+		drawn->y = info.y;
+		drawn->w = info.w;
+		drawn->h = info.h;
+	}
+	SDL_FreeStretchInfo(&info, bands);
 	return(0);
 }
 
+/* Perform a stretch blit between two surfaces of the same format.
+   Both rectangles must be inside their surfaces.
+*/
+int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
+                    SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	SDL_Rect32 sr, dr;
+
+	if ( srcrect ) {
+		SDL_WIDEN_RECT(&sr, srcrect);
+	}
+	if ( dstrect ) {
+		SDL_WIDEN_RECT(&dr, dstrect);
+	}
+	return SDL_SoftStretch32(src, srcrect ? &sr : NULL,
+	                         dst, dstrect ? &dr : NULL);
+}
+
+int SDL_SoftStretch32(SDL_Surface *src, SDL_Rect32 *srcrect,
+                      SDL_Surface *dst, SDL_Rect32 *dstrect)
+{
+	SDL_Rect32 clip;
+
+	/* Verify the blit rectangles */
+	if ( srcrect ) {
+		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
+		     (srcrect->w > src->w - srcrect->x) ||
+		     (srcrect->h > src->h - srcrect->y) ) {
+			SDL_SetError("Invalid source blit rectangle");
+			return(-1);
+		}
+	}
+	if ( dstrect ) {
+		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
+		     (dstrect->w > dst->w - dstrect->x) ||
+		     (dstrect->h > dst->h - dstrect->y) ) {
+			SDL_SetError("Invalid destination blit rectangle");
+			return(-1);
+		}
+	}
+
+	clip.x = 0;
+	clip.y = 0;
+	clip.w = dst->w;
+	clip.h = dst->h;
+	return SDL_StretchSurface(src, srcrect, dst, dstrect,
+	                          &clip, SDL_STRETCH_LEGACY, 0, NULL);
+}
+
+int SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                            SDL_Surface *dst, SDL_Rect *dstrect,
+                            SDL_StretchFilter filter)
+{
+	SDL_Rect32 sr, dr, clip;
+
+	if ( filter != SDL_STRETCH_NEAREST &&
+	     filter != SDL_STRETCH_BILINEAR && filter != SDL_STRETCH_AREA ) {
+		SDL_SetError("Unknown stretch filter");
+		return(-1);
+	}
+	if ( srcrect ) {
+		SDL_WIDEN_RECT(&sr, srcrect);
+	}
+	if ( dstrect ) {
+		SDL_WIDEN_RECT(&dr, dstrect);
+	}
+	SDL_GetClipRect32(dst, &clip);
+	return SDL_StretchSurface(src, srcrect ? &sr : NULL,
+	                          dst, dstrect ? &dr : NULL,
+	                          &clip, filter, 0, NULL);
+}
+
+int SDL_StretchBlit(SDL_Surface *src, SDL_Rect *srcrect,
+                    SDL_Surface *dst, SDL_Rect *dstrect,
+                    SDL_StretchFilter filter)
+{
+	SDL_Rect32 sr, dr, clip, drawn;
+	int retval;
+
+	drawn.x = dstrect->x;
+	drawn.y = dstrect->y;
+	drawn.w = drawn.h = 0;
+
+	/* Blending would smear the colorkey into its neighbours */
+	if ( src->flags & SDL_SRCCOLORKEY ) {
+		filter = SDL_STRETCH_NEAREST;
+	}
+	if ( srcrect ) {
+		SDL_WIDEN_RECT(&sr, srcrect);
+	}
+	SDL_WIDEN_RECT(&dr, dstrect);
+	SDL_GetClipRect32(dst, &clip);
+	retval = SDL_StretchSurface(src, srcrect ? &sr : NULL, dst, &dr,
+	                            &clip, filter, 1, &drawn);
+	SDL_NARROW_RECT(dstrect, &drawn);
+	return(retval);
+}
@@ -21,9 +21,15 @@
 */
 #include "SDL_config.h"
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
+/* Perform a stretch blit between two surfaces of the same format. */
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                            SDL_Surface *dst, SDL_Rect *dstrect);
 
+/* Perform a scaled software blit through the blit mapping of 'src',
+   which must be valid for 'dst'.  The rectangle drawn is stored in
+   'dstrect', which must not be NULL.
+*/
+extern int SDL_StretchBlit(SDL_Surface *src, SDL_Rect *srcrect,
+                           SDL_Surface *dst, SDL_Rect *dstrect,
+                           SDL_StretchFilter filter);
+
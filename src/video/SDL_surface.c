@@ -28,7 +28,11 @@
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
 #include "SDL_leaks.h"
-#include "SDL_cpuinfo.h"
+#include "SDL_workers_c.h"
+#include "SDL_damage_c.h"
+#include "SDL_stretch_c.h"
+#include "SDL_pixelpool_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 
 
 /* Public routines */
@@ -38,15 +42,30 @@
 SDL_Surface * SDL_CreateRGBSurface (Uint32 flags,
 			int width, int height, int depth,
 			Uint32 Rmask, Uint32 Gmask, Uint32 Bmask, Uint32 Amask)
+{
+	/* Make sure the size requested doesn't overflow our datatypes */
+	/* Next time I write a library like SDL, I'll use int for size. :) */
+	if ( width >= 16384 || height >= 65536 ) {
+		SDL_SetError("Width or height is too large");
+		return(NULL);
+	}
+	return SDL_CreateRGBSurface32(flags, width, height, depth,
+	                              Rmask, Gmask, Bmask, Amask);
+}
+/*
+ * The same, for surfaces that may not fit in the 'pitch' member
+ */
+SDL_Surface * SDL_CreateRGBSurface32 (Uint32 flags,
+			int width, int height, int depth,
+			Uint32 Rmask, Uint32 Gmask, Uint32 Bmask, Uint32 Amask)
 {
 	SDL_VideoDevice *video = current_video;
 	SDL_VideoDevice *this  = current_video;
 	SDL_Surface *screen;
 	SDL_Surface *surface;
+	Uint32 pitch;
 
-	/* Make sure the size requested doesn't overflow our datatypes */
-	/* Next time I write a library like SDL, I'll use int for size. :) */
-	if ( width >= 16384 || height >= 65536 ) {
+	if ( width < 0 || height < 0 ) {
 		SDL_SetError("Width or height is too large");
 		return(NULL);
 	}
@@ -110,37 +129,51 @@ SDL_Surface * SDL_CreateRGBSurface (Uint32 flags,
 	}
 	surface->w = width;
 	surface->h = height;
-	surface->pitch = SDL_CalculatePitch(surface);
 	surface->pixels = NULL;
 	surface->offset = 0;
 	surface->hwdata = NULL;
 	surface->locked = 0;
 	surface->map = NULL;
 	surface->unused1 = 0;
-	SDL_SetClipRect(surface, NULL);
 	SDL_FormatChanged(surface);
 
+	/* Rows over 64K can only be in system memory */
+	pitch = SDL_CalculatePitch32(surface);
+	if ( (width && !pitch) ||
+	     (height && pitch > ((size_t)-1 - 2*SDL_POOL_ALIGN) / height) ) {
+		SDL_FreeFormat(surface->format);
+		SDL_free(surface);
+		SDL_SetError("Width or height is too large");
+		return(NULL);
+	}
+	if ( pitch > 0xFFFF ) {
+		flags &= ~SDL_HWSURFACE;
+	}
+	SDL_SetSurfacePitch(surface, pitch);
+
 	/* Get the pixels */
 	if ( ((flags&SDL_HWSURFACE) == SDL_SWSURFACE) || 
 				(video->AllocHWSurface(this, surface) < 0) ) {
 		if ( surface->w && surface->h ) {
-			surface->pixels = SDL_malloc(surface->h*surface->pitch);
-			if ( surface->pixels == NULL ) {
+			pitch = SDL_AlignPitch(SDL_SURFACE_PITCH(surface));
+			SDL_SetSurfacePitch(surface, pitch);
+			if ( SDL_AllocSurfacePixels(surface) < 0 ) {
 				SDL_FreeSurface(surface);
 				SDL_OutOfMemory();
 				return(NULL);
 			}
 			/* This is important for bitmaps */
-			SDL_memset(surface->pixels, 0, surface->h*surface->pitch);
+			SDL_memset(surface->pixels, 0, (size_t)surface->h*pitch);
 		}
 	}
 
-	/* Allocate an empty mapping */
+	/* Allocate an empty mapping, which holds the clip rectangle */
 	surface->map = SDL_AllocBlitMap();
 	if ( surface->map == NULL ) {
 		SDL_FreeSurface(surface);
 		return(NULL);
 	}
+	SDL_SetClipRect(surface, NULL);
 
 	/* The surface is ready to go */
 	surface->refcount = 1;
@@ -155,17 +188,34 @@ SDL_Surface * SDL_CreateRGBSurface (Uint32 flags,
 SDL_Surface * SDL_CreateRGBSurfaceFrom (void *pixels,
 			int width, int height, int depth, int pitch,
 			Uint32 Rmask, Uint32 Gmask, Uint32 Bmask, Uint32 Amask)
+{
+	/* The pitch has to fit in the 'pitch' member */
+	if ( pitch < 0 || pitch > 0xFFFF ) {
+		SDL_SetError("Pitch is too large");
+		return(NULL);
+	}
+	return SDL_CreateRGBSurfaceFrom32(pixels, width, height, depth,
+	                                  (Uint32)pitch,
+	                                  Rmask, Gmask, Bmask, Amask);
+}
+SDL_Surface * SDL_CreateRGBSurfaceFrom32 (void *pixels,
+			int width, int height, int depth, Uint32 pitch,
+			Uint32 Rmask, Uint32 Gmask, Uint32 Bmask, Uint32 Amask)
 {
 	SDL_Surface *surface;
 
-	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, 0, 0, depth,
-	                               Rmask, Gmask, Bmask, Amask);
+	if ( width < 0 || height < 0 || pitch > 0x7FFFFFFF ) {
+		SDL_SetError("Width or height is too large");
+		return(NULL);
+	}
+	surface = SDL_CreateRGBSurface32(SDL_SWSURFACE, 0, 0, depth,
+	                                 Rmask, Gmask, Bmask, Amask);
 	if ( surface != NULL ) {
 		surface->flags |= SDL_PREALLOC;
 		surface->pixels = pixels;
 		surface->w = width;
 		surface->h = height;
-		surface->pitch = pitch;
+		SDL_SetSurfacePitch(surface, pitch);
 		SDL_SetClipRect(surface, NULL);
 	}
 	return(surface);
@@ -316,7 +366,8 @@ int SDL_SetAlphaChannel(SDL_Surface *surface, Uint8 value)
 	row = surface->h;
 	while (row--) {
 		col = surface->w;
-		buf = (Uint8 *)surface->pixels + row * surface->pitch + offset;
+		buf = (Uint8 *)surface->pixels +
+		      (size_t)row * SDL_SURFACE_PITCH(surface) + offset;
 		while(col--) {
 			*buf = value;
 			buf += 4;
@@ -363,12 +414,75 @@ SDL_bool SDL_IntersectRect(const SDL_Rect *A, const SDL_Rect *B, SDL_Rect *inter
 
 	return (intersection->w && intersection->h);
 }
+/*
+ * The same with 32-bit coordinates, where the far edges may overflow
+ */
+static __inline__ Sint32 SDL_RectEnd(Sint32 pos, Sint32 len)
+{
+	if ( len <= 0 ) {
+		return pos;
+	}
+	return (pos > 0x7FFFFFFF - len) ? 0x7FFFFFFF : pos + len;
+}
+static __inline__ Sint32 SDL_RectSpan(Sint32 min, Sint32 max)
+{
+	Uint32 span;
+
+	if ( max <= min ) {
+		return 0;
+	}
+	span = (Uint32)max - (Uint32)min;
+	return (span > 0x7FFFFFFF) ? 0x7FFFFFFF : (Sint32)span;
+}
+static SDL_bool SDL_IntersectRect32(const SDL_Rect32 *A, const SDL_Rect32 *B,
+						SDL_Rect32 *intersection)
+{
+	Sint32 Amin, Amax, Bmin, Bmax;
+
+	/* Horizontal intersection */
+	Amin = A->x;
+	Amax = SDL_RectEnd(A->x, A->w);
+	Bmin = B->x;
+	Bmax = SDL_RectEnd(B->x, B->w);
+	if(Bmin > Amin)
+	        Amin = Bmin;
+	if(Bmax < Amax)
+	        Amax = Bmax;
+	intersection->x = Amin;
+	intersection->w = SDL_RectSpan(Amin, Amax);
+
+	/* Vertical intersection */
+	Amin = A->y;
+	Amax = SDL_RectEnd(A->y, A->h);
+	Bmin = B->y;
+	Bmax = SDL_RectEnd(B->y, B->h);
+	if(Bmin > Amin)
+	        Amin = Bmin;
+	if(Bmax < Amax)
+	        Amax = Bmax;
+	intersection->y = Amin;
+	intersection->h = SDL_RectSpan(Amin, Amax);
+
+	return (intersection->w && intersection->h);
+}
 /*
  * Set the clipping rectangle for a blittable surface
  */
 SDL_bool SDL_SetClipRect(SDL_Surface *surface, const SDL_Rect *rect)
 {
-	SDL_Rect full_rect;
+	SDL_Rect32 rect32;
+
+	if ( ! rect ) {
+		return SDL_SetClipRect32(surface, NULL);
+	}
+	SDL_WIDEN_RECT(&rect32, rect);
+	return SDL_SetClipRect32(surface, &rect32);
+}
+SDL_bool SDL_SetClipRect32(SDL_Surface *surface, const SDL_Rect32 *rect)
+{
+	SDL_Rect32 full_rect;
+	SDL_Rect32 clip;
+	SDL_bool retval;
 
 	/* Don't do anything if there's no surface to act on */
 	if ( ! surface ) {
@@ -383,10 +497,28 @@ SDL_bool SDL_SetClipRect(SDL_Surface *surface, const SDL_Rect *rect)
 
 	/* Set the clipping rectangle */
 	if ( ! rect ) {
-		surface->clip_rect = full_rect;
-		return 1;
+		clip = full_rect;
+		retval = SDL_TRUE;
+	} else {
+		retval = SDL_IntersectRect32(rect, &full_rect, &clip);
+	}
+	if ( surface->map ) {
+		surface->map->clip = clip;
+	}
+
+	/* Keep the part an SDL_Rect can reach for the 16-bit functions */
+	if ( clip.x > 32767 || clip.y > 32767 ) {
+		clip.x = clip.y = 0;
+		clip.w = clip.h = 0;
 	}
-	return SDL_IntersectRect(rect, &full_rect, &surface->clip_rect);
+	if ( clip.w > 65535 ) {
+		clip.w = 65535;
+	}
+	if ( clip.h > 65535 ) {
+		clip.h = 65535;
+	}
+	SDL_NARROW_RECT(&surface->clip_rect, &clip);
+	return retval;
 }
 void SDL_GetClipRect(SDL_Surface *surface, SDL_Rect *rect)
 {
@@ -394,6 +526,20 @@ void SDL_GetClipRect(SDL_Surface *surface, SDL_Rect *rect)
 		*rect = surface->clip_rect;
 	}
 }
+void SDL_GetClipRect32(SDL_Surface *surface, SDL_Rect32 *rect)
+{
+	if ( surface && rect ) {
+		if ( surface->map ) {
+			*rect = surface->map->clip;
+		} else {
+			SDL_WIDEN_RECT(rect, &surface->clip_rect);
+		}
+	}
+}
+Uint32 SDL_GetSurfacePitch(SDL_Surface *surface)
+{
+	return surface ? SDL_SURFACE_PITCH(surface) : 0;
+}
 /* 
  * Set up a blit between two surfaces -- split into three parts:
  * The upper part, SDL_UpperBlit(), performs clipping and rectangle 
@@ -441,28 +587,42 @@ int SDL_LowerBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	return(do_blit(src, srcrect, dst, dstrect));
 }
 
-
-int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
-		   SDL_Surface *dst, SDL_Rect *dstrect)
+int SDL_LowerBlit32 (SDL_Surface *src, SDL_Rect32 *srcrect,
+				SDL_Surface *dst, SDL_Rect32 *dstrect)
 {
-        SDL_Rect fulldst;
-	int srcx, srcy, w, h;
+	SDL_Rect sr, dr;
 
-	/* Make sure the surfaces aren't locked */
-	if ( ! src || ! dst ) {
-		SDL_SetError("SDL_UpperBlit: passed a NULL surface");
-		return(-1);
+	/* Rectangles which fit take the usual way, with hardware blits */
+	if ( SDL_RECT32_FITS(srcrect) && SDL_RECT32_FITS(dstrect) ) {
+		SDL_NARROW_RECT(&sr, srcrect);
+		SDL_NARROW_RECT(&dr, dstrect);
+		return SDL_LowerBlit(src, &sr, dst, &dr);
 	}
-	if ( src->locked || dst->locked ) {
-		SDL_SetError("Surfaces must not be locked during blit");
+
+	/* Check to make sure the blit mapping is valid */
+	if ( (src->map->dst != dst) ||
+             (src->map->dst->format_version != src->map->format_version) ) {
+		if ( SDL_MapSurface(src, dst) < 0 ) {
+			return(-1);
+		}
+	}
+	if ( (src->flags & SDL_HWACCEL) == SDL_HWACCEL ) {
+		SDL_SetError("Hardware blits need 16-bit rectangles");
 		return(-1);
 	}
+	return(SDL_SoftBlit32(src, srcrect, dst, dstrect));
+}
 
-	/* If the destination rectangle is NULL, use the entire dest surface */
-	if ( dstrect == NULL ) {
-	        fulldst.x = fulldst.y = 0;
-		dstrect = &fulldst;
-	}
+
+/*
+ * Clip a blit against the source surface and the destination clip
+ * rectangle.  The clipped source rectangle is stored in 'sr' and the
+ * final destination is saved in 'dstrect'.  Returns 0 if nothing is left.
+ */
+static __inline__ int SDL_ClipBlit (SDL_Surface *src, const SDL_Rect *srcrect,
+				SDL_Surface *dst, SDL_Rect *dstrect, SDL_Rect *sr)
+{
+	int srcx, srcy, w, h;
 
 	/* clip the source rectangle to the source surface */
 	if(srcrect) {
@@ -523,17 +683,280 @@ int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	}
 
 	if(w > 0 && h > 0) {
-	        SDL_Rect sr;
-	        sr.x = srcx;
-		sr.y = srcy;
-		sr.w = dstrect->w = w;
-		sr.h = dstrect->h = h;
-		return SDL_LowerBlit(src, &sr, dst, dstrect);
+	        sr->x = srcx;
+		sr->y = srcy;
+		sr->w = dstrect->w = w;
+		sr->h = dstrect->h = h;
+		return 1;
+	}
+	sr->w = sr->h = 0;
+	dstrect->w = dstrect->h = 0;
+	return 0;
+}
+
+/* Move a coordinate forward, returns 0 if it leaves the 32-bit range */
+static __inline__ int SDL_ShiftCoord(Sint32 *pos, Uint32 delta)
+{
+	if ( delta > (Uint32)0x7FFFFFFF - (Uint32)*pos ) {
+		return 0;
+	}
+	*pos = (Sint32)((Uint32)*pos + delta);
+	return 1;
+}
+
+/*
+ * SDL_ClipBlit() with 32-bit coordinates, against the clip rectangle
+ * 'clip' of the destination.  The coordinates may be anywhere in the
+ * 32-bit range without overflowing.
+ */
+static int SDL_ClipBlit32 (SDL_Surface *src, const SDL_Rect32 *srcrect,
+				const SDL_Rect32 *clip, SDL_Rect32 *dstrect,
+				SDL_Rect32 *sr)
+{
+	SDL_Rect32 full, d;
+
+	/* clip the source rectangle to the source surface */
+	full.x = full.y = 0;
+	full.w = src->w;
+	full.h = src->h;
+	if ( srcrect ) {
+		if ( !SDL_IntersectRect32(srcrect, &full, sr) ||
+		     !SDL_ShiftCoord(&dstrect->x,
+		                     (Uint32)sr->x - (Uint32)srcrect->x) ||
+		     !SDL_ShiftCoord(&dstrect->y,
+		                     (Uint32)sr->y - (Uint32)srcrect->y) ) {
+			goto empty;
+		}
+	} else {
+		*sr = full;
 	}
+
+	/* clip the destination rectangle against the clip rectangle */
+	d.x = dstrect->x;
+	d.y = dstrect->y;
+	d.w = sr->w;
+	d.h = sr->h;
+	if ( !SDL_IntersectRect32(&d, clip, &d) ) {
+		goto empty;
+	}
+	sr->x = (Sint32)((Uint32)sr->x + ((Uint32)d.x - (Uint32)dstrect->x));
+	sr->y = (Sint32)((Uint32)sr->y + ((Uint32)d.y - (Uint32)dstrect->y));
+	sr->w = d.w;
+	sr->h = d.h;
+	*dstrect = d;
+	return 1;
+
+empty:
+	sr->w = sr->h = 0;
 	dstrect->w = dstrect->h = 0;
 	return 0;
 }
 
+int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
+		   SDL_Surface *dst, SDL_Rect *dstrect)
+{
+        SDL_Rect fulldst;
+	SDL_Rect sr;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_UpperBlit: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+
+	/* If the destination rectangle is NULL, use the entire dest surface */
+	if ( dstrect == NULL ) {
+	        fulldst.x = fulldst.y = 0;
+		dstrect = &fulldst;
+	}
+
+	if ( SDL_ClipBlit(src, srcrect, dst, dstrect, &sr) ) {
+		if ( SDL_DAMAGE_TRACKED(dst) ) {
+			SDL_AddDamage(dstrect);
+		}
+		return SDL_LowerBlit(src, &sr, dst, dstrect);
+	}
+	return 0;
+}
+
+int SDL_UpperBlit32 (SDL_Surface *src, SDL_Rect32 *srcrect,
+		     SDL_Surface *dst, SDL_Rect32 *dstrect)
+{
+	SDL_Rect32 fulldst;
+	SDL_Rect32 clip;
+	SDL_Rect32 sr;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_UpperBlit32: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+
+	/* If the destination rectangle is NULL, use the entire dest surface */
+	if ( dstrect == NULL ) {
+		fulldst.x = fulldst.y = 0;
+		dstrect = &fulldst;
+	}
+
+	SDL_GetClipRect32(dst, &clip);
+	if ( SDL_ClipBlit32(src, srcrect, &clip, dstrect, &sr) ) {
+		if ( SDL_DAMAGE_TRACKED(dst) ) {
+			SDL_Rect damage;
+
+			/* The screen is never too big for an SDL_Rect */
+			SDL_NARROW_RECT(&damage, dstrect);
+			SDL_AddDamage(&damage);
+		}
+		return SDL_LowerBlit32(src, &sr, dst, dstrect);
+	}
+	return 0;
+}
+
+/* How many clipped rectangles SDL_BlitSurfaceBatch() handles at a time */
+#define BATCH_RECTS	64
+
+int SDL_BlitSurfaceBatch (SDL_Surface *src, SDL_Surface *dst,
+			const SDL_Rect *srcrects, SDL_Rect *dstrects, int n)
+{
+	SDL_Rect sr[BATCH_RECTS];
+	int i, j, count;
+	int retval;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_BlitSurfaceBatch: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+	if ( n <= 0 ) {
+		return(0);
+	}
+	if ( ! dstrects ) {
+		SDL_SetError("SDL_BlitSurfaceBatch: passed NULL rectangles");
+		return(-1);
+	}
+
+	/* Check to make sure the blit mapping is valid */
+	if ( (src->map->dst != dst) ||
+             (src->map->dst->format_version != src->map->format_version) ) {
+		if ( SDL_MapSurface(src, dst) < 0 ) {
+			return(-1);
+		}
+	}
+
+	/* Hardware and RLE blits handle their own locking, one at a time */
+	if ( (src->flags & (SDL_HWACCEL|SDL_RLEACCEL)) ) {
+		for ( i=0; i<n; ++i ) {
+			if ( SDL_ClipBlit(src, srcrects ? &srcrects[i] : NULL,
+			                  dst, &dstrects[i], &sr[0]) ) {
+				if ( SDL_DAMAGE_TRACKED(dst) ) {
+					SDL_AddDamage(&dstrects[i]);
+				}
+				retval = SDL_LowerBlit(src, &sr[0],
+				                       dst, &dstrects[i]);
+				if ( retval < 0 ) {
+					return(retval);
+				}
+			}
+		}
+		return(0);
+	}
+
+	/* Clip a chunk of rectangles and blit them with one lock */
+	for ( i=0; i<n; i+=count ) {
+		count = n - i;
+		if ( count > BATCH_RECTS ) {
+			count = BATCH_RECTS;
+		}
+		for ( j=0; j<count; ++j ) {
+			if ( SDL_ClipBlit(src, srcrects ? &srcrects[i+j] : NULL,
+			                  dst, &dstrects[i+j], &sr[j]) &&
+			     SDL_DAMAGE_TRACKED(dst) ) {
+				SDL_AddDamage(&dstrects[i+j]);
+			}
+		}
+		retval = SDL_SoftBlitRects(src, sr, dst, &dstrects[i], count);
+		if ( retval < 0 ) {
+			return(retval);
+		}
+	}
+	return(0);
+}
+
+int SDL_UpperBlitScaled (SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect,
+			SDL_StretchFilter filter)
+{
+	SDL_Rect fullsrc;
+	SDL_Rect fulldst;
+	int retval;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_UpperBlitScaled: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+	if ( src == dst ) {
+		SDL_SetError("Can't scale a surface onto itself");
+		return(-1);
+	}
+	if ( src->format->BitsPerPixel < 8 ) {
+		SDL_SetError("Scaled blits need at least 8 bits per pixel");
+		return(-1);
+	}
+	if ( filter != SDL_STRETCH_NEAREST &&
+	     filter != SDL_STRETCH_BILINEAR && filter != SDL_STRETCH_AREA ) {
+		SDL_SetError("Unknown stretch filter");
+		return(-1);
+	}
+
+	if ( srcrect == NULL ) {
+		fullsrc.x = fullsrc.y = 0;
+		fullsrc.w = src->w;
+		fullsrc.h = src->h;
+		srcrect = &fullsrc;
+	}
+	if ( dstrect == NULL ) {
+		fulldst.x = fulldst.y = 0;
+		fulldst.w = dst->w;
+		fulldst.h = dst->h;
+		dstrect = &fulldst;
+	}
+
+	/* Without scaling this is just a regular blit */
+	if ( srcrect->w == dstrect->w && srcrect->h == dstrect->h ) {
+		return SDL_UpperBlit(src, srcrect, dst, dstrect);
+	}
+
+	/* Check to make sure the blit mapping is valid */
+	if ( (src->map->dst != dst) ||
+             (src->map->dst->format_version != src->map->format_version) ) {
+		if ( SDL_MapSurface(src, dst) < 0 ) {
+			return(-1);
+		}
+	}
+	retval = SDL_StretchBlit(src, srcrect, dst, dstrect, filter);
+	if ( retval == 0 && dstrect->w && SDL_DAMAGE_TRACKED(dst) ) {
+		SDL_AddDamage(dstrect);
+	}
+	return(retval);
+}
+
 static int SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
 	/* FIXME: We have to worry about packing order.. *sigh* */
@@ -548,61 +971,198 @@ static int SDL_FillRect4(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 	return -1;
 }
 
-/* 
- * This function performs a fast fill of the given rectangle with 'color'
+/* Fills bigger than this many bytes bypass the cache on x86 */
+#define FILL_STREAM_THRESHOLD	(4*1024*1024)
+
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+/*
+ * The x86 fill kernels store whole vectors of a repeating byte pattern.
+ * 48 bytes is a multiple of every pixel size and of 16, and 96 bytes of
+ * 32, so three vectors loaded at the right phase of the pattern cover
+ * 24 bpp as well.  Fills of more than SDL_FILL_STREAM_THRESHOLD bytes use
+ * non-temporal stores, so clearing a big canvas doesn't push everything
+ * else out of the cache.
  */
-int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
-{
-	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this  = current_video;
-	int x, y;
-	Uint8 *row;
+#define FILL_PATTERN_BYTES	(96+3)	/* 96 bytes from any pixel phase */
 
-	/* This function doesn't work on surfaces < 8 bpp */
-	if ( dst->format->BitsPerPixel < 8 ) {
-		switch(dst->format->BitsPerPixel) {
-		    case 1:
-			return SDL_FillRect1(dst, dstrect, color);
-			break;
-		    case 4:
-			return SDL_FillRect4(dst, dstrect, color);
-			break;
-		    default:
-			SDL_SetError("Fill rect on unsupported surface format");
-			return(-1);
-			break;
+typedef void (*SDL_FillRowsFunc)(Uint8 *row, int pitch, int width, int h,
+				const Uint8 *pattern, int bpp, int stream);
+
+static Uint32 fill_stream_threshold = 0;
+
+static Uint32 SDL_GetFillStreamThreshold(void)
+{
+	if ( fill_stream_threshold == 0 ) {
+		const char *env = SDL_getenv("SDL_FILL_STREAM_THRESHOLD");
+		Uint32 threshold = FILL_STREAM_THRESHOLD;
+
+		if ( env ) {
+			threshold = (Uint32)SDL_strtoul(env, NULL, 0);
+			if ( threshold == 0 ) {
+				/* Never stream */
+				threshold = 0xFFFFFFFF;
+			}
 		}
+		fill_stream_threshold = threshold;
 	}
+	return(fill_stream_threshold);
+}
 
-	/* If 'dstrect' == NULL, then fill the whole surface */
-	if ( dstrect ) {
-		/* Perform clipping */
-		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
-			return(0);
+#if SDL_SSE2_INTRINSICS
+static void SDL_TARGETING("sse2") SDL_FillRowsSSE2(Uint8 *row, int pitch,
+		int width, int h, const Uint8 *pattern, int bpp, int stream)
+{
+	while ( h-- ) {
+		Uint8 *d = row;
+		const Uint8 *p;
+		int n = width;
+		int head = (int)(-(intptr_t)d & 15);
+		__m128i v0, v1, v2;
+
+		if ( head > n ) {
+			head = n;
 		}
-	} else {
-		dstrect = &dst->clip_rect;
+		SDL_memcpy(d, pattern, head);
+		d += head;
+		n -= head;
+		p = pattern + head % bpp;
+		v0 = _mm_loadu_si128((const __m128i *)p);
+		v1 = _mm_loadu_si128((const __m128i *)(p+16));
+		v2 = _mm_loadu_si128((const __m128i *)(p+32));
+		if ( stream ) {
+			for ( ; n >= 48; n -= 48, d += 48 ) {
+				_mm_stream_si128((__m128i *)d, v0);
+				_mm_stream_si128((__m128i *)(d+16), v1);
+				_mm_stream_si128((__m128i *)(d+32), v2);
+			}
+		} else {
+			for ( ; n >= 48; n -= 48, d += 48 ) {
+				_mm_store_si128((__m128i *)d, v0);
+				_mm_store_si128((__m128i *)(d+16), v1);
+				_mm_store_si128((__m128i *)(d+32), v2);
+			}
+		}
+		if ( n >= 16 ) {
+			_mm_store_si128((__m128i *)d, v0);
+			d += 16;
+			n -= 16;
+			p += 16;
+			if ( n >= 16 ) {
+				_mm_store_si128((__m128i *)d, v1);
+				d += 16;
+				n -= 16;
+				p += 16;
+			}
+		}
+		SDL_memcpy(d, p, n);
+		row += pitch;
+	}
+	if ( stream ) {
+		_mm_sfence();
 	}
+}
+#endif /* SDL_SSE2_INTRINSICS */
 
-	/* Check for hardware acceleration */
-	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
-					video->info.blit_fill ) {
-		SDL_Rect hw_rect;
-		if ( dst == SDL_VideoSurface ) {
-			hw_rect = *dstrect;
-			hw_rect.x += current_video->offset_x;
-			hw_rect.y += current_video->offset_y;
-			dstrect = &hw_rect;
+#if SDL_AVX2_INTRINSICS
+static void SDL_TARGETING("avx2") SDL_FillRowsAVX2(Uint8 *row, int pitch,
+		int width, int h, const Uint8 *pattern, int bpp, int stream)
+{
+	while ( h-- ) {
+		Uint8 *d = row;
+		const Uint8 *p;
+		int n = width;
+		int head = (int)(-(intptr_t)d & 31);
+		__m256i v0, v1, v2;
+
+		if ( head > n ) {
+			head = n;
+		}
+		SDL_memcpy(d, pattern, head);
+		d += head;
+		n -= head;
+		p = pattern + head % bpp;
+		v0 = _mm256_loadu_si256((const __m256i *)p);
+		v1 = _mm256_loadu_si256((const __m256i *)(p+32));
+		v2 = _mm256_loadu_si256((const __m256i *)(p+64));
+		if ( stream ) {
+			for ( ; n >= 96; n -= 96, d += 96 ) {
+				_mm256_stream_si256((__m256i *)d, v0);
+				_mm256_stream_si256((__m256i *)(d+32), v1);
+				_mm256_stream_si256((__m256i *)(d+64), v2);
+			}
+		} else {
+			for ( ; n >= 96; n -= 96, d += 96 ) {
+				_mm256_store_si256((__m256i *)d, v0);
+				_mm256_store_si256((__m256i *)(d+32), v1);
+				_mm256_store_si256((__m256i *)(d+64), v2);
+			}
+		}
+		if ( n >= 32 ) {
+			_mm256_store_si256((__m256i *)d, v0);
+			d += 32;
+			n -= 32;
+			p += 32;
+			if ( n >= 32 ) {
+				_mm256_store_si256((__m256i *)d, v1);
+				d += 32;
+				n -= 32;
+				p += 32;
+			}
 		}
-		return(video->FillHWRect(this, dst, dstrect, color));
+		SDL_memcpy(d, p, n);
+		row += pitch;
+	}
+	if ( stream ) {
+		_mm_sfence();
 	}
+	_mm256_zeroupper();
+}
+#endif /* SDL_AVX2_INTRINSICS */
 
-	/* Perform software fill */
-	if ( SDL_LockSurface(dst) != 0 ) {
-		return(-1);
+static SDL_FillRowsFunc SDL_ChooseFillRows(void)
+{
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		return SDL_FillRowsAVX2;
+	}
+#endif
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		return SDL_FillRowsSSE2;
+	}
+#endif
+	return NULL;
+}
+#endif /* SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS */
+
+/* Fill a rectangle of a locked surface with 8 bpp or more in software */
+static void SDL_FillRectSW(SDL_Surface *dst, const SDL_Rect32 *dstrect,
+						Uint32 color, int stream)
+{
+	int x, y;
+	int pitch = (int)SDL_SURFACE_PITCH(dst);
+	Uint8 *row;
+
+	row = (Uint8 *)dst->pixels+(size_t)dstrect->y*pitch+
+			(size_t)dstrect->x*dst->format->BytesPerPixel;
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+	{
+		SDL_FillRowsFunc fill = SDL_ChooseFillRows();
+
+		if ( fill ) {
+			Uint8 pattern[FILL_PATTERN_BYTES+3];
+			int bpp = dst->format->BytesPerPixel;
+
+			/* x86 is little endian, the pixel is in the low bytes */
+			for ( x=0; x<FILL_PATTERN_BYTES; x+=bpp ) {
+				SDL_memcpy(&pattern[x], &color, bpp);
+			}
+			fill(row, pitch, dstrect->w*bpp, dstrect->h,
+			     pattern, bpp, stream);
+			return;
+		}
 	}
-	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
-			dstrect->x*dst->format->BytesPerPixel;
+#endif
 #if SDL_ARM_NEON_BLITTERS
     if (SDL_HasNEON() && dst->format->BytesPerPixel != 3) {
         void FillRect8ARMNEONAsm(int32_t w, int32_t h, uint8_t *dst, int32_t dst_stride, uint8_t src);
@@ -610,18 +1170,17 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
         void FillRect32ARMNEONAsm(int32_t w, int32_t h, uint32_t *dst, int32_t dst_stride, uint32_t src);
         switch (dst->format->BytesPerPixel) {
         case 1:
-            FillRect8ARMNEONAsm(dstrect->w, dstrect->h, (uint8_t *) row, dst->pitch >> 0, color);
+            FillRect8ARMNEONAsm(dstrect->w, dstrect->h, (uint8_t *) row, pitch >> 0, color);
             break;
         case 2:
-            FillRect16ARMNEONAsm(dstrect->w, dstrect->h, (uint16_t *) row, dst->pitch >> 1, color);
+            FillRect16ARMNEONAsm(dstrect->w, dstrect->h, (uint16_t *) row, pitch >> 1, color);
             break;
         case 4:
-            FillRect32ARMNEONAsm(dstrect->w, dstrect->h, (uint32_t *) row, dst->pitch >> 2, color);
+            FillRect32ARMNEONAsm(dstrect->w, dstrect->h, (uint32_t *) row, pitch >> 2, color);
             break;
         }
 
-        SDL_UnlockSurface(dst);
-        return(0);
+        return;
     }
 #endif
 #if SDL_ARM_SIMD_BLITTERS
@@ -631,27 +1190,26 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 		void FillRect32ARMSIMDAsm(int32_t w, int32_t h, uint32_t *dst, int32_t dst_stride, uint32_t src);
 		switch (dst->format->BytesPerPixel) {
 		case 1:
-			FillRect8ARMSIMDAsm(dstrect->w, dstrect->h, (uint8_t *) row, dst->pitch >> 0, color);
+			FillRect8ARMSIMDAsm(dstrect->w, dstrect->h, (uint8_t *) row, pitch >> 0, color);
 			break;
 		case 2:
-			FillRect16ARMSIMDAsm(dstrect->w, dstrect->h, (uint16_t *) row, dst->pitch >> 1, color);
+			FillRect16ARMSIMDAsm(dstrect->w, dstrect->h, (uint16_t *) row, pitch >> 1, color);
 			break;
 		case 4:
-			FillRect32ARMSIMDAsm(dstrect->w, dstrect->h, (uint32_t *) row, dst->pitch >> 2, color);
+			FillRect32ARMSIMDAsm(dstrect->w, dstrect->h, (uint32_t *) row, pitch >> 2, color);
 			break;
 		}
 
-		SDL_UnlockSurface(dst);
-		return(0);
+		return;
 	}
 #endif
 	if ( dst->format->palette || (color == 0) ) {
 		x = dstrect->w*dst->format->BytesPerPixel;
-		if ( !color && !((uintptr_t)row&3) && !(x&3) && !(dst->pitch&3) ) {
+		if ( !color && !((uintptr_t)row&3) && !(x&3) && !(pitch&3) ) {
 			int n = x >> 2;
 			for ( y=dstrect->h; y; --y ) {
 				SDL_memset4(row, 0, n);
-				row += dst->pitch;
+				row += pitch;
 			}
 		} else {
 #ifdef __powerpc__
@@ -701,7 +1259,7 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 							*d++ = c;
 							n--;
 						}
-						row += dst->pitch;
+						row += pitch;
 					}
 				} else {
 					/* narrow boxes */
@@ -713,7 +1271,7 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 							*d++ = c;
 							n--;
 						}
-						row += dst->pitch;
+						row += pitch;
 					}
 				}
 			} else
@@ -721,7 +1279,7 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 			{
 				for(y = dstrect->h; y; y--) {
 					SDL_memset(row, color, x);
-					row += dst->pitch;
+					row += pitch;
 				}
 			}
 		}
@@ -741,7 +1299,7 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 					SDL_memset4(pixels, cc, n >> 1);
 				if(n & 1)
 					pixels[n - 1] = c;
-				row += dst->pitch;
+				row += pitch;
 			}
 			break;
 
@@ -755,24 +1313,233 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 					SDL_memcpy(pixels, &color, 3);
 					pixels += 3;
 				}
-				row += dst->pitch;
+				row += pitch;
 			}
 			break;
 
 		    case 4:
 			for(y = dstrect->h; y; --y) {
 				SDL_memset4(row, color, dstrect->w);
-				row += dst->pitch;
+				row += pitch;
 			}
 			break;
 		}
 	}
+}
+
+/* A fill split into horizontal bands for the worker pool */
+typedef struct {
+	SDL_Surface *dst;
+	const SDL_Rect32 *rect;
+	Uint32 color;
+	int stream;
+} SDL_BandFill;
+
+static void SDL_RunFillBand(void *data, int band, int nbands)
+{
+	SDL_BandFill *job = (SDL_BandFill *)data;
+	SDL_Rect32 rect = *job->rect;
+	int top, bottom;
+
+	top = (rect.h * band) / nbands;
+	bottom = (rect.h * (band+1)) / nbands;
+	rect.y += top;
+	rect.h = bottom - top;
+	SDL_FillRectSW(job->dst, &rect, job->color, job->stream);
+}
+
+/* Fill a clipped rectangle of a locked surface, on the workers if large */
+static void SDL_FillLockedRect(SDL_Surface *dst, const SDL_Rect32 *rect,
+							Uint32 color)
+{
+	int nbands;
+	int stream = 0;
+
+	/* Clipping can leave nothing to fill */
+	if ( rect->w <= 0 || rect->h <= 0 ) {
+		return;
+	}
+#if SDL_SSE2_INTRINSICS || SDL_AVX2_INTRINSICS
+	stream = ((Uint32)rect->h > SDL_GetFillStreamThreshold() /
+			((Uint32)rect->w*dst->format->BytesPerPixel));
+#endif
+	nbands = SDL_GetWorkerBands(SDL_WORKER_PIXELS(rect->w, rect->h),
+	                            rect->h);
+	if ( nbands > 1 ) {
+		SDL_BandFill job;
+
+		job.dst = dst;
+		job.rect = rect;
+		job.color = color;
+		job.stream = stream;
+		SDL_RunWorkers(SDL_RunFillBand, &job, nbands);
+	} else {
+		SDL_FillRectSW(dst, rect, color, stream);
+	}
+}
+
+/* Pass a clipped rectangle to the video driver, if it can fill it */
+static int SDL_FillHWRect(SDL_Surface *dst, SDL_Rect *rect, Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	SDL_Rect hw_rect;
+
+	if ( dst == SDL_VideoSurface ) {
+		hw_rect = *rect;
+		hw_rect.x += current_video->offset_x;
+		hw_rect.y += current_video->offset_y;
+		rect = &hw_rect;
+	}
+	return(video->FillHWRect(this, dst, rect, color));
+}
+
+#define SDL_CAN_FILL_HW(dst) \
+	(((dst)->flags & SDL_HWSURFACE) == SDL_HWSURFACE && \
+	 current_video->info.blit_fill)
+
+/* 
+ * This function performs a fast fill of the given rectangle with 'color'
+ */
+int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	SDL_Rect32 rect;
+
+	/* This function doesn't work on surfaces < 8 bpp */
+	if ( dst->format->BitsPerPixel < 8 ) {
+		switch(dst->format->BitsPerPixel) {
+		    case 1:
+			return SDL_FillRect1(dst, dstrect, color);
+			break;
+		    case 4:
+			return SDL_FillRect4(dst, dstrect, color);
+			break;
+		    default:
+			SDL_SetError("Fill rect on unsupported surface format");
+			return(-1);
+			break;
+		}
+	}
+
+	/* If 'dstrect' == NULL, then fill the whole surface */
+	if ( dstrect ) {
+		/* Perform clipping */
+		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
+			return(0);
+		}
+	} else {
+		dstrect = &dst->clip_rect;
+	}
+	if ( SDL_DAMAGE_TRACKED(dst) ) {
+		SDL_AddDamage(dstrect);
+	}
+
+	/* Check for hardware acceleration */
+	if ( SDL_CAN_FILL_HW(dst) ) {
+		return SDL_FillHWRect(dst, dstrect, color);
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	SDL_WIDEN_RECT(&rect, dstrect);
+	SDL_FillLockedRect(dst, &rect, color);
 	SDL_UnlockSurface(dst);
 
 	/* We're done! */
 	return(0);
 }
 
+int SDL_FillRect32(SDL_Surface *dst, SDL_Rect32 *dstrect, Uint32 color)
+{
+	SDL_Rect32 clip;
+	SDL_Rect rect;
+
+	if ( ! dst ) {
+		SDL_SetError("SDL_FillRect32: passed a NULL surface");
+		return(-1);
+	}
+
+	/* Perform clipping */
+	SDL_GetClipRect32(dst, &clip);
+	if ( dstrect ) {
+		if ( !SDL_IntersectRect32(dstrect, &clip, dstrect) ) {
+			return(0);
+		}
+	} else {
+		dstrect = &clip;
+	}
+	if ( dst->format->BitsPerPixel < 8 || SDL_CAN_FILL_HW(dst) ) {
+		/* Hardware surfaces are never too big for an SDL_Rect */
+		SDL_NARROW_RECT(&rect, dstrect);
+		return SDL_FillRect(dst, &rect, color);
+	}
+	if ( SDL_DAMAGE_TRACKED(dst) ) {
+		SDL_NARROW_RECT(&rect, dstrect);
+		SDL_AddDamage(&rect);
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	SDL_FillLockedRect(dst, dstrect, color);
+	SDL_UnlockSurface(dst);
+	return(0);
+}
+
+/*
+ * This function fills many rectangles with 'color', locking the surface
+ * only once for all of them.
+ */
+int SDL_FillRects(SDL_Surface *dst, const SDL_Rect *rects, int count,
+							Uint32 color)
+{
+	SDL_Rect rect;
+	SDL_Rect32 rect32;
+	int i;
+
+	if ( ! dst ) {
+		SDL_SetError("SDL_FillRects: passed a NULL surface");
+		return(-1);
+	}
+	if ( count <= 0 ) {
+		return(0);
+	}
+	if ( ! rects ) {
+		SDL_SetError("SDL_FillRects: passed NULL rectangles");
+		return(-1);
+	}
+
+	/* Small pixels and hardware fills go one rectangle at a time */
+	if ( dst->format->BitsPerPixel < 8 || SDL_CAN_FILL_HW(dst) ) {
+		for ( i=0; i<count; ++i ) {
+			rect = rects[i];
+			if ( SDL_FillRect(dst, &rect, color) < 0 ) {
+				return(-1);
+			}
+		}
+		return(0);
+	}
+
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	for ( i=0; i<count; ++i ) {
+		if ( SDL_IntersectRect(&rects[i], &dst->clip_rect, &rect) ) {
+			if ( SDL_DAMAGE_TRACKED(dst) ) {
+				SDL_AddDamage(&rect);
+			}
+			SDL_WIDEN_RECT(&rect32, &rect);
+			SDL_FillLockedRect(dst, &rect32, color);
+		}
+	}
+	SDL_UnlockSurface(dst);
+
+	return(0);
+}
+
 /*
  * Lock a surface to directly access the pixels
  */
@@ -838,7 +1605,7 @@ SDL_Surface * SDL_ConvertSurface (SDL_Surface *surface,
 	Uint32 colorkey = 0;
 	Uint8 alpha = 0;
 	Uint32 surface_flags;
-	SDL_Rect bounds;
+	SDL_Rect32 bounds;
 
 	/* Check for empty destination palette! (results in empty image) */
 	if ( format->palette != NULL ) {
@@ -864,7 +1631,7 @@ SDL_Surface * SDL_ConvertSurface (SDL_Surface *surface,
 	}
 
 	/* Create a new surface with the desired format */
-	convert = SDL_CreateRGBSurface(flags,
+	convert = SDL_CreateRGBSurface32(flags,
 				surface->w, surface->h, format->BitsPerPixel,
 		format->Rmask, format->Gmask, format->Bmask, format->Amask);
 	if ( convert == NULL ) {
@@ -906,11 +1673,12 @@ SDL_Surface * SDL_ConvertSurface (SDL_Surface *surface,
 	bounds.y = 0;
 	bounds.w = surface->w;
 	bounds.h = surface->h;
-	SDL_LowerBlit(surface, &bounds, convert, &bounds);
+	SDL_LowerBlit32(surface, &bounds, convert, &bounds);
 
 	/* Clean up the original surface, and update converted surface */
 	if ( convert != NULL ) {
-		SDL_SetClipRect(convert, &surface->clip_rect);
+		SDL_GetClipRect32(surface, &bounds);
+		SDL_SetClipRect32(convert, &bounds);
 	}
 	if ( (surface_flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY ) {
 		Uint32 cflags = surface_flags&(SDL_SRCCOLORKEY|SDL_RLEACCELOK);
@@ -973,9 +1741,8 @@ void SDL_FreeSurface (SDL_Surface *surface)
 		SDL_VideoDevice *this  = current_video;
 		video->FreeHWSurface(this, surface);
 	}
-	if ( surface->pixels &&
-	     ((surface->flags & SDL_PREALLOC) != SDL_PREALLOC) ) {
-		SDL_free(surface->pixels);
+	if ( (surface->flags & SDL_PREALLOC) != SDL_PREALLOC ) {
+		SDL_FreeSurfacePixels(surface);
 	}
 	SDL_free(surface);
 #ifdef CHECK_LEAKS
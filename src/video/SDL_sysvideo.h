@@ -106,6 +106,9 @@ struct SDL_VideoDevice {
 	 */
 	void (*UpdateRects)(_THIS, int numrects, SDL_Rect *rects);
 
+	/* Fill in the counters of the updates since the mode was set */
+	int (*GetPresentStats)(_THIS, SDL_PresentStats *stats);
+
 	/* Reverse the effects VideoInit() -- called if VideoInit() fails
 	   or if the application is shutting down the video subsystem.
 	*/
@@ -269,6 +272,8 @@ struct SDL_VideoDevice {
 	char *wm_icon;
 	int offset_x;
 	int offset_y;
+	Uint32 update_rects;	/* rectangles updated since the mode was set */
+	Uint32 update_pixels;	/* pixels updated since the mode was set */
 	SDL_GrabMode input_grab;
 
 	/* Driver information flags */
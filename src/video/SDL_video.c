@@ -28,6 +28,10 @@
 #include "SDL_blit.h"
 #include "SDL_pixels_c.h"
 #include "SDL_cursor_c.h"
+#include "SDL_damage_c.h"
+#include "SDL_pixelpool_c.h"
+#include "SDL_yuvfuncs.h"
+#include "SDL_yuv_sw_c.h"
 #include "../events/SDL_sysevents.h"
 #include "../events/SDL_events_c.h"
 
@@ -175,6 +179,7 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 	if ( current_video != NULL ) {
 		SDL_VideoQuit();
 	}
+	SDL_InitPixelPool();
 
 	/* Select the proper video driver */
 	i = index = 0;
@@ -257,6 +262,12 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 		return(-1);
 	}
 
+	/* SDL_MapRGB() shares the inverse colormaps between threads */
+	if ( SDL_InitInverseMaps() < 0 ) {
+		SDL_VideoQuit();
+		return(-1);
+	}
+
 	/* Create a zero sized video surface of the appropriate format */
 	video_flags = SDL_SWSURFACE;
 	SDL_VideoSurface = SDL_CreateRGBSurface(video_flags, 0, 0,
@@ -613,6 +624,9 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 	}
 	this = video = current_video;
 
+	/* An overlay frame may still be being drawn into the old screen */
+	SDL_FinishPendingYUV_SW();
+
 	/* Default to the current width and height */
 	if ( width == 0 ) {
 		width = video->info.current_w;
@@ -927,6 +941,11 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 	video->info.current_w = SDL_VideoSurface->w;
 	video->info.current_h = SDL_VideoSurface->h;
 
+	/* Start tracking screen updates afresh */
+	video->update_rects = 0;
+	video->update_pixels = 0;
+	SDL_InitDamage();
+
 	/* We're done! */
 	return(SDL_PublicSurface);
 }
@@ -1054,6 +1073,10 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 		SDL_SetError("OpenGL active, use SDL_GL_SwapBuffers()");
 		return;
 	}
+	if ( screen == SDL_ShadowSurface || screen == SDL_VideoSurface ) {
+		/* Merge the rectangles with the damage recorded so far */
+		rects = SDL_CoalesceDamage(screen, numrects, rects, &numrects);
+	}
 	if ( screen == SDL_ShadowSurface ) {
 		/* Blit the shadow surface using saved mapping */
 		SDL_Palette *pal = screen->format->palette;
@@ -1093,6 +1116,10 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 	}
 	if ( screen == SDL_VideoSurface ) {
 		/* Update the video surface */
+		for ( i=0; i<numrects; ++i ) {
+			video->update_pixels += (Uint32)rects[i].w * rects[i].h;
+		}
+		video->update_rects += numrects;
 		if ( screen->offset ) {
 			for ( i=0; i<numrects; ++i ) {
 				rects[i].x += video->offset_x;
@@ -1156,6 +1183,7 @@ int SDL_Flip(SDL_Surface *screen)
 	}
 	if ( (screen->flags & SDL_DOUBLEBUF) == SDL_DOUBLEBUF ) {
 		SDL_VideoDevice *this  = current_video;
+		SDL_ClearDamage();
 		return(video->FlipHWSurface(this, SDL_VideoSurface));
 	} else {
 		SDL_UpdateRect(screen, 0, 0, 0, 0);
@@ -1163,6 +1191,28 @@ int SDL_Flip(SDL_Surface *screen)
 	return(0);
 }
 
+int SDL_GetPresentStats(SDL_PresentStats *stats)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+
+	if ( ! video || ! SDL_VideoSurface ) {
+		SDL_SetError("Video mode has not been set");
+		return(-1);
+	}
+	if ( ! video->GetPresentStats ) {
+		SDL_SetError("Video driver doesn't count screen updates");
+		return(-1);
+	}
+	SDL_memset(stats, 0, sizeof(*stats));
+	if ( video->GetPresentStats(this, stats) < 0 ) {
+		return(-1);
+	}
+	stats->rects = video->update_rects;
+	stats->pixels = video->update_pixels;
+	return(0);
+}
+
 static void SetPalette_logical(SDL_Surface *screen, SDL_Color *colors,
 			       int firstcolor, int ncolors)
 {
@@ -1362,6 +1412,9 @@ void SDL_VideoQuit (void)
 		/* Halt event processing before doing anything else */
 		SDL_StopEventLoop();
 
+		/* Finish any overlay frame still being drawn into the screen */
+		SDL_FinishPendingYUV_SW();
+
 		/* Clean up allocated window manager items */
 		if ( SDL_PublicSurface ) {
 			SDL_PublicSurface = NULL;
@@ -1373,6 +1426,7 @@ void SDL_VideoQuit (void)
 
 		/* Clean up the system video */
 		video->VideoQuit(this);
+		SDL_QuitDamage();
 
 		/* Free any lingering surfaces */
 		ready_to_go = SDL_ShadowSurface;
@@ -1386,6 +1440,7 @@ void SDL_VideoQuit (void)
 		SDL_PublicSurface = NULL;
 
 		/* Clean up miscellaneous memory */
+		SDL_QuitInverseMaps();
 		if ( video->physpal ) {
 			SDL_free(video->physpal->colors);
 			SDL_free(video->physpal);
@@ -1759,7 +1814,7 @@ static void CreateMaskFromColorKeyOrAlpha(SDL_Surface *icon, Uint8 *mask, int fl
 	switch (icon->format->BytesPerPixel) {
 		case 1: { Uint8 *pixels;
 			for ( y=0; y<icon->h; ++y ) {
-				pixels = (Uint8 *)icon->pixels + y*icon->pitch;
+				pixels = (Uint8 *)icon->pixels + y*SDL_SURFACE_PITCH(icon);
 				for ( x=0; x<icon->w; ++x ) {
 					if ( *pixels++ == colorkey ) {
 						SET_MASKBIT(icon, x, y, mask);
@@ -1772,7 +1827,7 @@ static void CreateMaskFromColorKeyOrAlpha(SDL_Surface *icon, Uint8 *mask, int fl
 		case 2: { Uint16 *pixels;
 			for ( y=0; y<icon->h; ++y ) {
 				pixels = (Uint16 *)icon->pixels +
-				                   y*icon->pitch/2;
+				                   y*SDL_SURFACE_PITCH(icon)/2;
 				for ( x=0; x<icon->w; ++x ) {
 					if ( (flags & 1) && *pixels == colorkey ) {
 						SET_MASKBIT(icon, x, y, mask);
@@ -1788,7 +1843,7 @@ static void CreateMaskFromColorKeyOrAlpha(SDL_Surface *icon, Uint8 *mask, int fl
 		case 4: { Uint32 *pixels;
 			for ( y=0; y<icon->h; ++y ) {
 				pixels = (Uint32 *)icon->pixels +
-				                   y*icon->pitch/4;
+				                   y*SDL_SURFACE_PITCH(icon)/4;
 				for ( x=0; x<icon->w; ++x ) {
 					if ( (flags & 1) && *pixels == colorkey ) {
 						SET_MASKBIT(icon, x, y, mask);
@@ -0,0 +1,303 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* The worker pool used to run software blits and fills in bands */
+
+#include "SDL_thread.h"
+#include "SDL_workers_c.h"
+
+#define MAX_WORKERS	64
+
+#if !SDL_THREADS_DISABLED
+
+static int worker_count = 0;		/* 0 = not started */
+static SDL_Thread *workers[MAX_WORKERS];
+static SDL_mutex *worker_lock = NULL;
+static SDL_cond *worker_wake = NULL;	/* signaled when work is posted */
+static SDL_cond *worker_done = NULL;	/* signaled when a job completes */
+
+/* The current job, protected by worker_lock */
+static SDL_WorkerFunc job_func = NULL;
+static void *job_data = NULL;
+static int job_count = 0;
+static int job_next = 0;
+static int job_remaining = 0;
+static int job_busy = 0;
+static int workers_quit = 0;
+
+/* Run pieces of the current job until there are none left to claim.
+   Called and returns with worker_lock held.
+ */
+static void SDL_RunJobPieces(void)
+{
+	while ( job_next < job_count ) {
+		SDL_WorkerFunc func = job_func;
+		void *data = job_data;
+		int count = job_count;
+		int index = job_next++;
+
+		SDL_mutexV(worker_lock);
+		func(data, index, count);
+		SDL_mutexP(worker_lock);
+
+		if ( --job_remaining == 0 ) {
+			SDL_CondSignal(worker_done);
+		}
+	}
+}
+
+static int SDLCALL SDL_WorkerThread(void *unused)
+{
+	SDL_mutexP(worker_lock);
+	while ( ! workers_quit ) {
+		if ( job_next < job_count ) {
+			SDL_RunJobPieces();
+		} else {
+			SDL_CondWait(worker_wake, worker_lock);
+		}
+	}
+	SDL_mutexV(worker_lock);
+	return(0);
+}
+
+void SDL_InitWorkers(void)
+{
+	const char *env;
+	int wanted;
+	int i;
+
+	if ( worker_count != 0 ) {
+		return;
+	}
+
+	/* Only look once, even if the pool can't be started */
+	worker_count = 1;
+
+	env = SDL_getenv("SDL_BLIT_THREADS");
+	if ( env == NULL ) {
+		return;
+	}
+	wanted = SDL_atoi(env);
+	if ( wanted <= 1 ) {
+		return;
+	}
+	if ( wanted > MAX_WORKERS+1 ) {
+		wanted = MAX_WORKERS+1;
+	}
+
+	worker_lock = SDL_CreateMutex();
+	worker_wake = SDL_CreateCond();
+	worker_done = SDL_CreateCond();
+	if ( !worker_lock || !worker_wake || !worker_done ) {
+		SDL_QuitWorkers();
+		worker_count = 1;
+		return;
+	}
+	workers_quit = 0;
+
+	/* The calling thread is one of the workers */
+	for ( i=0; i<wanted-1; ++i ) {
+#if (defined(__WIN32__) && !defined(_WIN32_WCE)) && !defined(HAVE_LIBC) && !defined(__SYMBIAN32__)
+#undef SDL_CreateThread
+		workers[i] = SDL_CreateThread(SDL_WorkerThread, NULL, NULL, NULL);
+#else
+		workers[i] = SDL_CreateThread(SDL_WorkerThread, NULL);
+#endif
+		if ( workers[i] == NULL ) {
+			break;
+		}
+		++worker_count;
+	}
+}
+
+int SDL_GetWorkerCount(void)
+{
+	return((worker_count > 1) ? worker_count : 1);
+}
+
+void SDL_RunWorkers(SDL_WorkerFunc func, void *data, int count)
+{
+	int i;
+
+	if ( count > 1 && SDL_GetWorkerCount() > 1 ) {
+		SDL_mutexP(worker_lock);
+		if ( ! job_busy ) {
+			job_busy = 1;
+			job_func = func;
+			job_data = data;
+			job_next = 0;
+			job_count = count;
+			job_remaining = count;
+			SDL_CondBroadcast(worker_wake);
+
+			SDL_RunJobPieces();
+			while ( job_remaining > 0 ) {
+				SDL_CondWait(worker_done, worker_lock);
+			}
+
+			job_func = NULL;
+			job_data = NULL;
+			job_next = job_count = 0;
+			job_busy = 0;
+			SDL_mutexV(worker_lock);
+			return;
+		}
+		/* Somebody else owns the pool, do it all ourselves */
+		SDL_mutexV(worker_lock);
+	}
+	for ( i=0; i<count; ++i ) {
+		func(data, i, count);
+	}
+}
+
+int SDL_QueueWorkers(SDL_WorkerFunc func, void *data, int count)
+{
+	if ( count < 1 || SDL_GetWorkerCount() < 2 ) {
+		return(0);
+	}
+	SDL_mutexP(worker_lock);
+	if ( job_busy ) {
+		SDL_mutexV(worker_lock);
+		return(0);
+	}
+	job_busy = 1;
+	job_func = func;
+	job_data = data;
+	job_next = 0;
+	job_count = count;
+	job_remaining = count;
+	SDL_CondBroadcast(worker_wake);
+	SDL_mutexV(worker_lock);
+	return(1);
+}
+
+void SDL_WaitWorkers(void)
+{
+	if ( worker_lock == NULL ) {
+		/* The pool was shut down, which finished the job */
+		return;
+	}
+	SDL_mutexP(worker_lock);
+	SDL_RunJobPieces();
+	while ( job_remaining > 0 ) {
+		SDL_CondWait(worker_done, worker_lock);
+	}
+	job_func = NULL;
+	job_data = NULL;
+	job_next = job_count = 0;
+	job_busy = 0;
+	SDL_mutexV(worker_lock);
+}
+
+void SDL_QuitWorkers(void)
+{
+	int i;
+
+	if ( worker_lock ) {
+		SDL_mutexP(worker_lock);
+		/* Finish a queued job nobody has waited for yet */
+		SDL_RunJobPieces();
+		while ( job_remaining > 0 ) {
+			SDL_CondWait(worker_done, worker_lock);
+		}
+		job_func = NULL;
+		job_data = NULL;
+		job_next = job_count = 0;
+		job_busy = 0;
+		workers_quit = 1;
+		SDL_CondBroadcast(worker_wake);
+		SDL_mutexV(worker_lock);
+	}
+	for ( i=0; i<MAX_WORKERS; ++i ) {
+		if ( workers[i] ) {
+			SDL_WaitThread(workers[i], NULL);
+			workers[i] = NULL;
+		}
+	}
+	if ( worker_done ) {
+		SDL_DestroyCond(worker_done);
+		worker_done = NULL;
+	}
+	if ( worker_wake ) {
+		SDL_DestroyCond(worker_wake);
+		worker_wake = NULL;
+	}
+	if ( worker_lock ) {
+		SDL_DestroyMutex(worker_lock);
+		worker_lock = NULL;
+	}
+	worker_count = 0;
+}
+
+#else
+
+void SDL_InitWorkers(void)
+{
+}
+
+int SDL_GetWorkerCount(void)
+{
+	return(1);
+}
+
+void SDL_RunWorkers(SDL_WorkerFunc func, void *data, int count)
+{
+	int i;
+
+	for ( i=0; i<count; ++i ) {
+		func(data, i, count);
+	}
+}
+
+int SDL_QueueWorkers(SDL_WorkerFunc func, void *data, int count)
+{
+	return(0);
+}
+
+void SDL_WaitWorkers(void)
+{
+}
+
+void SDL_QuitWorkers(void)
+{
+}
+
+#endif /* !SDL_THREADS_DISABLED */
+
+int SDL_GetWorkerBands(int pixels, int rows)
+{
+	int bands = SDL_GetWorkerCount();
+
+	if ( bands > 1 ) {
+		if ( bands > pixels / SDL_WORKER_MIN_PIXELS ) {
+			bands = pixels / SDL_WORKER_MIN_PIXELS;
+		}
+		if ( bands > rows ) {
+			bands = rows;
+		}
+		if ( bands < 1 ) {
+			bands = 1;
+		}
+	}
+	return(bands);
+}
@@ -0,0 +1,77 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_workers_c_h
+#define _SDL_workers_c_h
+
+/* A persistent pool of worker threads used to split large software
+   blits and fills into horizontal bands.
+
+   The pool is disabled by default.  Setting the SDL_BLIT_THREADS
+   environment variable to a number greater than one enables it with
+   that many threads, counting the thread that issues the blit.  The
+   threads are started by SDL_Init() and stopped by SDL_Quit().
+*/
+
+/* Don't bother splitting work below this many pixels per band */
+#define SDL_WORKER_MIN_PIXELS	(64*1024)
+
+/* A unit of work: called once for each 'index' in [0, count) */
+typedef void (*SDL_WorkerFunc)(void *data, int index, int count);
+
+/* Start the worker threads, if SDL_BLIT_THREADS asks for them and they
+   aren't running already.
+*/
+extern void SDL_InitWorkers(void);
+
+/* Return the number of threads that can share a job, 1 if disabled */
+extern int SDL_GetWorkerCount(void);
+
+/* Return how many bands a job of 'pixels' over 'rows' should use */
+extern int SDL_GetWorkerBands(int pixels, int rows);
+
+/* The 'pixels' of a w x h job, saturated for very big surfaces */
+#define SDL_WORKER_PIXELS(w, h) \
+	(((h) > 0 && (w) > 0x7FFFFFFF / (h)) ? 0x7FFFFFFF : (w) * (h))
+
+/* Run func(data, i, count) for every i, using the worker pool if it
+   is idle.  The calling thread takes part and this returns when all
+   of the work is done.
+*/
+extern void SDL_RunWorkers(SDL_WorkerFunc func, void *data, int count);
+
+/* Hand func(data, i, count) for every i to the worker threads and return
+   at once.  This returns 1 if the job was queued, and SDL_WaitWorkers()
+   must then be called before 'data' is reused.  It returns 0, without
+   running anything, if the pool is disabled or busy.  While a queued job
+   is running, other jobs run on their calling threads alone.
+*/
+extern int SDL_QueueWorkers(SDL_WorkerFunc func, void *data, int count);
+
+/* Help with and wait for the job queued by SDL_QueueWorkers() */
+extern void SDL_WaitWorkers(void);
+
+/* Shut down the worker threads, finishing any queued job */
+extern void SDL_QuitWorkers(void);
+
+#endif /* _SDL_workers_c_h */
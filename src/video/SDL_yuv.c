@@ -29,14 +29,9 @@
 #include "SDL_yuv_sw_c.h"
 
 
-SDL_Overlay *SDL_CreateYUVOverlay(int w, int h, Uint32 format,
-                                  SDL_Surface *display)
+/* Check the display and pick the surface the overlay is drawn on */
+static SDL_Surface *SDL_GetYUVDisplay(SDL_Surface *display)
 {
-	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this  = current_video;
-	const char *yuv_hwaccel;
-	SDL_Overlay *overlay;
-
 	if ( (display->flags & SDL_OPENGL) == SDL_OPENGL ) {
 		SDL_SetError("YUV overlays are not supported in OpenGL mode");
 		return NULL;
@@ -50,6 +45,21 @@ SDL_Overlay *SDL_CreateYUVOverlay(int w, int h, Uint32 format,
 			display = SDL_VideoSurface;
 		}
 	}
+	return display;
+}
+
+SDL_Overlay *SDL_CreateYUVOverlay(int w, int h, Uint32 format,
+                                  SDL_Surface *display)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	const char *yuv_hwaccel;
+	SDL_Overlay *overlay;
+
+	display = SDL_GetYUVDisplay(display);
+	if ( display == NULL ) {
+		return NULL;
+	}
 	overlay = NULL;
         yuv_hwaccel = SDL_getenv("SDL_VIDEO_YUV_HWACCEL");
 	if ( ((display == SDL_VideoSurface) && video->CreateYUVOverlay) &&
@@ -63,6 +73,24 @@ SDL_Overlay *SDL_CreateYUVOverlay(int w, int h, Uint32 format,
 	return overlay;
 }
 
+SDL_Overlay *SDL_CreateYUVOverlayFrom(Uint8 **pixels, Uint16 *pitches,
+                                      int w, int h, Uint32 format,
+                                      SDL_Surface *display)
+{
+	SDL_VideoDevice *this  = current_video;
+
+	if ( pixels == NULL || pitches == NULL || display == NULL ) {
+		SDL_SetError("Passed NULL planes or display");
+		return NULL;
+	}
+	display = SDL_GetYUVDisplay(display);
+	if ( display == NULL ) {
+		return NULL;
+	}
+	/* Hardware overlays own their memory, so this is always software */
+	return SDL_CreateYUVFrom_SW(this, w, h, format, pixels, pitches, display);
+}
+
 int SDL_LockYUVOverlay(SDL_Overlay *overlay)
 {
 	if ( overlay == NULL ) {
@@ -0,0 +1,748 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* SSE2 and AVX2 versions of the software YUV overlay converters.
+
+   They take the same arguments as the table driven C converters in
+   SDL_yuv_sw.c and produce exactly the same pixels: the chroma tables
+   there hold (int)(k * (c-128)), which is computed here in fixed point
+   on the magnitude, with constants checked against all 256 values.
+   The pixel format is read back from the rgb_2_pix tables, so only
+   formats with at most 8 bits per channel may use these.
+ */
+
+#include "SDL_video.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
+
+#if SDL_SSE2_INTRINSICS
+
+/* trunc(k*a) == (a*K) >> shift for 0 <= a <= 128, and _mm_mulhi_epi16()
+   does a >> 16, so the magnitude is shifted up by 16-shift first.
+ */
+#define CR_R_MUL	717	/* 0.419/0.299, >> 9 */
+#define CR_R_PRE	7
+#define CR_G_MUL	731	/* 0.299/0.419, >> 10 */
+#define CR_G_PRE	6
+#define CB_G_MUL	2821	/* 0.114/0.331, >> 13 */
+#define CB_G_PRE	3
+#define CB_B_MUL	29055	/* 0.587/0.331, >> 14 */
+#define CB_B_PRE	2
+
+typedef struct {
+	int *colortab;
+	Uint32 *rgb_2_pix;
+	Uint8 *out;
+	int rows, cols;
+	int bpp, scale;
+	int dst_pitch;			/* bytes between output rows */
+	int lum_pitch;			/* bytes between source rows ... */
+	int chroma_pitch;		/* ... and chroma rows */
+	int chroma_step;		/* 2 for NV12 and NV21 */
+	int packed;			/* YUY2, UYVY or YVYU */
+	int yoff;			/* packed: byte of the first Y */
+	int cr_first;			/* packed, NV12: Cr comes before Cb */
+	int rshift, gshift, bshift;	/* where the channels go ... */
+	int rloss, gloss, bloss;	/* ... after dropping low bits */
+	int bytes[3];			/* 32 bpp: channels in bytes 0, 1, 2 */
+} SDL_YUVJob;
+
+static int SDL_YUVBitCount(Uint32 mask)
+{
+	int n = 0;
+
+	while ( mask ) {
+		n += (mask & 1);
+		mask >>= 1;
+	}
+	return(n);
+}
+
+static int SDL_YUVLowBit(Uint32 mask)
+{
+	int n = 0;
+
+	if ( mask ) {
+		while ( !(mask & 1) ) {
+			++n;
+			mask >>= 1;
+		}
+	}
+	return(n);
+}
+
+static void SDL_SetupYUVJob(SDL_YUVJob *job, int *colortab,
+                            Uint32 *rgb_2_pix, unsigned char *out,
+                            int rows, int cols, int mod,
+                            int lum_pitch, int chroma_pitch, int chroma_step,
+                            int bpp, int scale)
+{
+	Uint32 mask;
+
+	job->colortab = colortab;
+	job->rgb_2_pix = rgb_2_pix;
+	job->out = out;
+	job->rows = rows;
+	job->cols = cols;
+	job->bpp = bpp;
+	job->scale = scale;
+	job->dst_pitch = (cols*scale + mod) * bpp;
+	job->lum_pitch = lum_pitch;
+	job->chroma_pitch = chroma_pitch;
+	job->chroma_step = chroma_step;
+	job->packed = 0;
+	job->yoff = 0;
+	job->cr_first = 0;
+
+	/* The top entry of each table is the channel mask (doubled at 16 bpp) */
+	mask = rgb_2_pix[0*768+511];
+	if ( bpp == 2 ) mask &= 0xFFFF;
+	job->rshift = SDL_YUVLowBit(mask);
+	job->rloss = 8 - SDL_YUVBitCount(mask);
+	mask = rgb_2_pix[1*768+511];
+	if ( bpp == 2 ) mask &= 0xFFFF;
+	job->gshift = SDL_YUVLowBit(mask);
+	job->gloss = 8 - SDL_YUVBitCount(mask);
+	mask = rgb_2_pix[2*768+511];
+	if ( bpp == 2 ) mask &= 0xFFFF;
+	job->bshift = SDL_YUVLowBit(mask);
+	job->bloss = 8 - SDL_YUVBitCount(mask);
+
+	/* 8 bit channels in the low 3 bytes can be interleaved directly */
+	job->bytes[0] = -1;
+	if ( bpp == 4 && !job->rloss && !job->gloss && !job->bloss &&
+	     !(job->rshift & 7) && !(job->gshift & 7) && !(job->bshift & 7) &&
+	     job->rshift + job->gshift + job->bshift == 24 &&
+	     job->rshift != job->gshift && job->rshift != job->bshift ) {
+		job->bytes[job->rshift/8] = 0;
+		job->bytes[job->gshift/8] = 1;
+		job->bytes[job->bshift/8] = 2;
+	}
+}
+
+/* Write a pixel 'scale' times, the way the C converters do */
+static void SDL_PutYUVPixel(const SDL_YUVJob *job, Uint8 *dst, Uint32 value)
+{
+	int i;
+
+	for ( i=0; i<job->scale; ++i ) {
+		switch (job->bpp) {
+		    case 2:
+			*(Uint16 *)dst = (Uint16)value;
+			break;
+		    case 3:
+			dst[0] = (value      ) & 0xFF;
+			dst[1] = (value >>  8) & 0xFF;
+			dst[2] = (value >> 16) & 0xFF;
+			break;
+		    default:
+			*(Uint32 *)dst = value;
+			break;
+		}
+		dst += job->bpp;
+	}
+}
+
+/* Convert the pixel pairs left over after the vector loop with the tables.
+   'step' is 1 for planar luma and 2 for packed, chroma moves by 'cstep'.
+ */
+static void SDL_YUVTail(const SDL_YUVJob *job, const Uint8 *lum, int step,
+                        const Uint8 *cr, const Uint8 *cb, int cstep,
+                        Uint8 *dst, int pairs)
+{
+	const int *colortab = job->colortab;
+	const Uint32 *rgb_2_pix = job->rgb_2_pix;
+	int cr_r, crb_g, cb_b, L;
+
+	while ( pairs-- ) {
+		cr_r   = 0*768+256 + colortab[ *cr + 0*256 ];
+		crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
+		                   + colortab[ *cb + 2*256 ];
+		cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
+		cr += cstep; cb += cstep;
+
+		L = *lum; lum += step;
+		SDL_PutYUVPixel(job, dst, rgb_2_pix[ L + cr_r ] |
+		                          rgb_2_pix[ L + crb_g ] |
+		                          rgb_2_pix[ L + cb_b ]);
+		dst += job->bpp * job->scale;
+
+		L = *lum; lum += step;
+		SDL_PutYUVPixel(job, dst, rgb_2_pix[ L + cr_r ] |
+		                          rgb_2_pix[ L + crb_g ] |
+		                          rgb_2_pix[ L + cb_b ]);
+		dst += job->bpp * job->scale;
+	}
+}
+
+/* Pack 24-bit pixels, which have no vector store */
+static void SDL_PackYUV24(Uint8 *dst, const Uint32 *pixels, int n, int scale)
+{
+	int i, j;
+
+	for ( i=0; i<n; ++i ) {
+		for ( j=0; j<scale; ++j ) {
+			dst[0] = (pixels[i]      ) & 0xFF;
+			dst[1] = (pixels[i] >>  8) & 0xFF;
+			dst[2] = (pixels[i] >> 16) & 0xFF;
+			dst += 3;
+		}
+	}
+}
+
+/* The C 2x converters write every row twice */
+static void SDL_DoubleYUVRow(const SDL_YUVJob *job, Uint8 *dst)
+{
+	if ( job->scale == 2 ) {
+		SDL_memcpy(dst + job->dst_pitch, dst,
+		           (size_t)job->cols * 2 * job->bpp);
+	}
+}
+
+/* Offsets added to the luma, 8 lanes at a time */
+typedef struct {
+	__m128i r, g, b;
+} SDL_YUVOffsetsSSE2;
+
+/* sign(v) * ((|v| << pre) * mul >> 16), with 'sign' all ones if v < 0 */
+#define SCALE_CHROMA_SSE2(a, sign, pre, mul) \
+	_mm_sub_epi16(_mm_xor_si128(_mm_mulhi_epi16(_mm_slli_epi16(a, pre), \
+	                            _mm_set1_epi16(mul)), sign), sign)
+
+static void SDL_TARGETING("sse2")
+SDL_ChromaOffsetsSSE2(__m128i cr, __m128i cb, SDL_YUVOffsetsSSE2 *ofs)
+{
+	const __m128i bias = _mm_set1_epi16(128);
+	__m128i v, sign, a;
+
+	v = _mm_sub_epi16(cr, bias);
+	sign = _mm_srai_epi16(v, 15);
+	a = _mm_sub_epi16(_mm_xor_si128(v, sign), sign);
+	ofs->r = SCALE_CHROMA_SSE2(a, sign, CR_R_PRE, CR_R_MUL);
+	ofs->g = SCALE_CHROMA_SSE2(a, sign, CR_G_PRE, CR_G_MUL);
+
+	v = _mm_sub_epi16(cb, bias);
+	sign = _mm_srai_epi16(v, 15);
+	a = _mm_sub_epi16(_mm_xor_si128(v, sign), sign);
+	ofs->g = _mm_add_epi16(ofs->g,
+	                       SCALE_CHROMA_SSE2(a, sign, CB_G_PRE, CB_G_MUL));
+	ofs->b = SCALE_CHROMA_SSE2(a, sign, CB_B_PRE, CB_B_MUL);
+
+	/* Both green terms are negative */
+	ofs->g = _mm_sub_epi16(_mm_setzero_si128(), ofs->g);
+}
+
+/* Convert 8 luma values and store 8 pixels, or 16 when doubling */
+static void SDL_TARGETING("sse2")
+SDL_YUVStoreSSE2(const SDL_YUVJob *job, __m128i y,
+                 const SDL_YUVOffsetsSSE2 *ofs, Uint8 *dst)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i max = _mm_set1_epi16(255);
+	__m128i r, g, b, lo, hi;
+
+	r = _mm_max_epi16(_mm_min_epi16(_mm_add_epi16(y, ofs->r), max), zero);
+	g = _mm_max_epi16(_mm_min_epi16(_mm_add_epi16(y, ofs->g), max), zero);
+	b = _mm_max_epi16(_mm_min_epi16(_mm_add_epi16(y, ofs->b), max), zero);
+	r = _mm_srl_epi16(r, _mm_cvtsi32_si128(job->rloss));
+	g = _mm_srl_epi16(g, _mm_cvtsi32_si128(job->gloss));
+	b = _mm_srl_epi16(b, _mm_cvtsi32_si128(job->bloss));
+
+	if ( job->bpp == 2 ) {
+		lo = _mm_or_si128(_mm_or_si128(
+		        _mm_sll_epi16(r, _mm_cvtsi32_si128(job->rshift)),
+		        _mm_sll_epi16(g, _mm_cvtsi32_si128(job->gshift))),
+		        _mm_sll_epi16(b, _mm_cvtsi32_si128(job->bshift)));
+		if ( job->scale == 2 ) {
+			_mm_storeu_si128((__m128i *)dst,
+			                 _mm_unpacklo_epi16(lo, lo));
+			_mm_storeu_si128((__m128i *)(dst+16),
+			                 _mm_unpackhi_epi16(lo, lo));
+		} else {
+			_mm_storeu_si128((__m128i *)dst, lo);
+		}
+		return;
+	}
+
+	if ( job->bytes[0] >= 0 ) {
+		__m128i c[3];
+
+		c[0] = r;
+		c[1] = g;
+		c[2] = b;
+		lo = _mm_or_si128(c[job->bytes[0]],
+		                  _mm_slli_epi16(c[job->bytes[1]], 8));
+		hi = _mm_unpackhi_epi16(lo, c[job->bytes[2]]);
+		lo = _mm_unpacklo_epi16(lo, c[job->bytes[2]]);
+	} else {
+		lo = _mm_or_si128(_mm_or_si128(
+		        _mm_sll_epi32(_mm_unpacklo_epi16(r, zero),
+		                      _mm_cvtsi32_si128(job->rshift)),
+		        _mm_sll_epi32(_mm_unpacklo_epi16(g, zero),
+		                      _mm_cvtsi32_si128(job->gshift))),
+		        _mm_sll_epi32(_mm_unpacklo_epi16(b, zero),
+		                      _mm_cvtsi32_si128(job->bshift)));
+		hi = _mm_or_si128(_mm_or_si128(
+		        _mm_sll_epi32(_mm_unpackhi_epi16(r, zero),
+		                      _mm_cvtsi32_si128(job->rshift)),
+		        _mm_sll_epi32(_mm_unpackhi_epi16(g, zero),
+		                      _mm_cvtsi32_si128(job->gshift))),
+		        _mm_sll_epi32(_mm_unpackhi_epi16(b, zero),
+		                      _mm_cvtsi32_si128(job->bshift)));
+	}
+	if ( job->bpp == 3 ) {
+		Uint32 pixels[8];
+
+		_mm_storeu_si128((__m128i *)pixels, lo);
+		_mm_storeu_si128((__m128i *)(pixels+4), hi);
+		SDL_PackYUV24(dst, pixels, 8, job->scale);
+	} else if ( job->scale == 2 ) {
+		_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(lo, lo));
+		_mm_storeu_si128((__m128i *)(dst+16), _mm_unpackhi_epi32(lo, lo));
+		_mm_storeu_si128((__m128i *)(dst+32), _mm_unpacklo_epi32(hi, hi));
+		_mm_storeu_si128((__m128i *)(dst+48), _mm_unpackhi_epi32(hi, hi));
+	} else {
+		_mm_storeu_si128((__m128i *)dst, lo);
+		_mm_storeu_si128((__m128i *)(dst+16), hi);
+	}
+}
+
+/* Two luma rows sharing a row of each chroma plane, or of the
+   interleaved chroma plane of NV12 and NV21
+ */
+static void SDL_TARGETING("sse2")
+SDL_YV12RowsSSE2(const SDL_YUVJob *job, const Uint8 *lum,
+                 const Uint8 *cr, const Uint8 *cb, Uint8 *dst)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const int step = 8 * job->bpp * job->scale;
+	const int cstep = job->chroma_step;
+	const Uint8 *lum2 = lum + job->lum_pitch;
+	const Uint8 *pairs = (cr < cb) ? cr : cb;
+	Uint8 *dst2 = dst + job->dst_pitch * job->scale;
+	SDL_YUVOffsetsSSE2 ofs;
+	__m128i u, v;
+	int bits, x;
+
+	for ( x=0; x+8 <= job->cols; x += 8 ) {
+		if ( cstep == 2 ) {
+			/* Four chroma pairs, each covering two pixels */
+			u = _mm_unpacklo_epi8(_mm_loadl_epi64(
+			        (const __m128i *)(pairs + x)), zero);
+			v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(u,
+			        _MM_SHUFFLE(2,2,0,0)), _MM_SHUFFLE(2,2,0,0));
+			u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(u,
+			        _MM_SHUFFLE(3,3,1,1)), _MM_SHUFFLE(3,3,1,1));
+			if ( job->cr_first ) {
+				SDL_ChromaOffsetsSSE2(v, u, &ofs);
+			} else {
+				SDL_ChromaOffsetsSSE2(u, v, &ofs);
+			}
+		} else {
+			SDL_memcpy(&bits, cr + x/2, 4);
+			v = _mm_cvtsi32_si128(bits);
+			SDL_memcpy(&bits, cb + x/2, 4);
+			u = _mm_cvtsi32_si128(bits);
+			v = _mm_unpacklo_epi8(v, zero);
+			u = _mm_unpacklo_epi8(u, zero);
+			SDL_ChromaOffsetsSSE2(_mm_unpacklo_epi16(v, v),
+			                      _mm_unpacklo_epi16(u, u), &ofs);
+		}
+		SDL_YUVStoreSSE2(job, _mm_unpacklo_epi8(
+		    _mm_loadl_epi64((const __m128i *)(lum + x)), zero),
+		    &ofs, dst + (x/8)*step);
+		SDL_YUVStoreSSE2(job, _mm_unpacklo_epi8(
+		    _mm_loadl_epi64((const __m128i *)(lum2 + x)), zero),
+		    &ofs, dst2 + (x/8)*step);
+	}
+	if ( x < job->cols ) {
+		SDL_YUVTail(job, lum + x, 1, cr + (x/2)*cstep, cb + (x/2)*cstep,
+		            cstep, dst + (x/8)*step, (job->cols - x) / 2);
+		SDL_YUVTail(job, lum2 + x, 1, cr + (x/2)*cstep, cb + (x/2)*cstep,
+		            cstep, dst2 + (x/8)*step, (job->cols - x) / 2);
+	}
+	SDL_DoubleYUVRow(job, dst);
+	SDL_DoubleYUVRow(job, dst2);
+}
+
+/* One row of YUY2, UYVY or YVYU, 16 bytes for every 8 pixels */
+static void SDL_TARGETING("sse2")
+SDL_PackedRowSSE2(const SDL_YUVJob *job, const Uint8 *src, Uint8 *dst)
+{
+	const __m128i lowbytes = _mm_set1_epi16(0x00FF);
+	const int step = 8 * job->bpp * job->scale;
+	SDL_YUVOffsetsSSE2 ofs;
+	__m128i w, y, c, first, second;
+	int x;
+
+	for ( x=0; x+8 <= job->cols; x += 8 ) {
+		w = _mm_loadu_si128((const __m128i *)(src + x*2));
+		if ( job->yoff ) {
+			y = _mm_srli_epi16(w, 8);
+			c = _mm_and_si128(w, lowbytes);
+		} else {
+			y = _mm_and_si128(w, lowbytes);
+			c = _mm_srli_epi16(w, 8);
+		}
+		/* Each chroma sample covers two pixels */
+		first = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c,
+		                _MM_SHUFFLE(2,2,0,0)), _MM_SHUFFLE(2,2,0,0));
+		second = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c,
+		                _MM_SHUFFLE(3,3,1,1)), _MM_SHUFFLE(3,3,1,1));
+		if ( job->cr_first ) {
+			SDL_ChromaOffsetsSSE2(first, second, &ofs);
+		} else {
+			SDL_ChromaOffsetsSSE2(second, first, &ofs);
+		}
+		SDL_YUVStoreSSE2(job, y, &ofs, dst + (x/8)*step);
+	}
+	if ( x < job->cols ) {
+		const Uint8 *pair = src + x*2;
+		int crpos = job->yoff ? (job->cr_first ? 0 : 2)
+		                      : (job->cr_first ? 1 : 3);
+		int cbpos = crpos ^ 2;
+
+		SDL_YUVTail(job, pair + job->yoff, 2, pair + crpos, pair + cbpos,
+		            4, dst + (x/8)*step, (job->cols - x) / 2);
+	}
+	SDL_DoubleYUVRow(job, dst);
+}
+
+static void SDL_TARGETING("sse2")
+SDL_ConvertYUVSSE2(const SDL_YUVJob *job, unsigned char *lum,
+                   unsigned char *cr, unsigned char *cb)
+{
+	Uint8 *dst = job->out;
+	int y;
+
+	if ( job->packed ) {
+		for ( y=0; y<job->rows; ++y ) {
+			SDL_PackedRowSSE2(job, lum + (size_t)y*job->lum_pitch, dst);
+			dst += job->dst_pitch * job->scale;
+		}
+	} else {
+		for ( y=0; y<job->rows/2; ++y ) {
+			SDL_YV12RowsSSE2(job, lum + (size_t)y*2*job->lum_pitch,
+			                 cr + (size_t)y*job->chroma_pitch,
+			                 cb + (size_t)y*job->chroma_pitch, dst);
+			dst += job->dst_pitch * job->scale * 2;
+		}
+	}
+}
+
+#if SDL_AVX2_INTRINSICS
+
+typedef struct {
+	__m256i r, g, b;
+} SDL_YUVOffsetsAVX2;
+
+#define SCALE_CHROMA_AVX2(a, sign, pre, mul) \
+	_mm256_sub_epi16(_mm256_xor_si256(_mm256_mulhi_epi16( \
+	    _mm256_slli_epi16(a, pre), _mm256_set1_epi16(mul)), sign), sign)
+
+static void SDL_TARGETING("avx2")
+SDL_ChromaOffsetsAVX2(__m256i cr, __m256i cb, SDL_YUVOffsetsAVX2 *ofs)
+{
+	const __m256i bias = _mm256_set1_epi16(128);
+	__m256i v, sign, a;
+
+	v = _mm256_sub_epi16(cr, bias);
+	sign = _mm256_srai_epi16(v, 15);
+	a = _mm256_abs_epi16(v);
+	ofs->r = SCALE_CHROMA_AVX2(a, sign, CR_R_PRE, CR_R_MUL);
+	ofs->g = SCALE_CHROMA_AVX2(a, sign, CR_G_PRE, CR_G_MUL);
+
+	v = _mm256_sub_epi16(cb, bias);
+	sign = _mm256_srai_epi16(v, 15);
+	a = _mm256_abs_epi16(v);
+	ofs->g = _mm256_add_epi16(ofs->g,
+	                          SCALE_CHROMA_AVX2(a, sign, CB_G_PRE, CB_G_MUL));
+	ofs->b = SCALE_CHROMA_AVX2(a, sign, CB_B_PRE, CB_B_MUL);
+
+	ofs->g = _mm256_sub_epi16(_mm256_setzero_si256(), ofs->g);
+}
+
+/* Convert 16 luma values and store 16 pixels, or 32 when doubling.
+   The unpacks work within 128-bit lanes, so the halves are put back in
+   order with a permute before each store.
+ */
+static void SDL_TARGETING("avx2")
+SDL_YUVStoreAVX2(const SDL_YUVJob *job, __m256i y,
+                 const SDL_YUVOffsetsAVX2 *ofs, Uint8 *dst)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi16(255);
+	__m256i r, g, b, lo, hi;
+
+	r = _mm256_max_epi16(_mm256_min_epi16(_mm256_add_epi16(y, ofs->r),
+	                                      max), zero);
+	g = _mm256_max_epi16(_mm256_min_epi16(_mm256_add_epi16(y, ofs->g),
+	                                      max), zero);
+	b = _mm256_max_epi16(_mm256_min_epi16(_mm256_add_epi16(y, ofs->b),
+	                                      max), zero);
+	r = _mm256_srl_epi16(r, _mm_cvtsi32_si128(job->rloss));
+	g = _mm256_srl_epi16(g, _mm_cvtsi32_si128(job->gloss));
+	b = _mm256_srl_epi16(b, _mm_cvtsi32_si128(job->bloss));
+
+	if ( job->bpp == 2 ) {
+		lo = _mm256_or_si256(_mm256_or_si256(
+		        _mm256_sll_epi16(r, _mm_cvtsi32_si128(job->rshift)),
+		        _mm256_sll_epi16(g, _mm_cvtsi32_si128(job->gshift))),
+		        _mm256_sll_epi16(b, _mm_cvtsi32_si128(job->bshift)));
+		if ( job->scale == 2 ) {
+			r = _mm256_unpacklo_epi16(lo, lo);
+			g = _mm256_unpackhi_epi16(lo, lo);
+			_mm256_storeu_si256((__m256i *)dst,
+			                    _mm256_permute2x128_si256(r, g, 0x20));
+			_mm256_storeu_si256((__m256i *)(dst+32),
+			                    _mm256_permute2x128_si256(r, g, 0x31));
+		} else {
+			_mm256_storeu_si256((__m256i *)dst, lo);
+		}
+		return;
+	}
+
+	lo = _mm256_or_si256(_mm256_or_si256(
+	        _mm256_sll_epi32(_mm256_unpacklo_epi16(r, zero),
+	                         _mm_cvtsi32_si128(job->rshift)),
+	        _mm256_sll_epi32(_mm256_unpacklo_epi16(g, zero),
+	                         _mm_cvtsi32_si128(job->gshift))),
+	        _mm256_sll_epi32(_mm256_unpacklo_epi16(b, zero),
+	                         _mm_cvtsi32_si128(job->bshift)));
+	hi = _mm256_or_si256(_mm256_or_si256(
+	        _mm256_sll_epi32(_mm256_unpackhi_epi16(r, zero),
+	                         _mm_cvtsi32_si128(job->rshift)),
+	        _mm256_sll_epi32(_mm256_unpackhi_epi16(g, zero),
+	                         _mm_cvtsi32_si128(job->gshift))),
+	        _mm256_sll_epi32(_mm256_unpackhi_epi16(b, zero),
+	                         _mm_cvtsi32_si128(job->bshift)));
+	/* Pixels 0-7 and 8-15 */
+	r = _mm256_permute2x128_si256(lo, hi, 0x20);
+	g = _mm256_permute2x128_si256(lo, hi, 0x31);
+	if ( job->bpp == 3 ) {
+		Uint32 pixels[16];
+
+		_mm256_storeu_si256((__m256i *)pixels, r);
+		_mm256_storeu_si256((__m256i *)(pixels+8), g);
+		SDL_PackYUV24(dst, pixels, 16, job->scale);
+	} else if ( job->scale == 2 ) {
+		lo = _mm256_unpacklo_epi32(r, r);
+		hi = _mm256_unpackhi_epi32(r, r);
+		_mm256_storeu_si256((__m256i *)dst,
+		                    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst+32),
+		                    _mm256_permute2x128_si256(lo, hi, 0x31));
+		lo = _mm256_unpacklo_epi32(g, g);
+		hi = _mm256_unpackhi_epi32(g, g);
+		_mm256_storeu_si256((__m256i *)(dst+64),
+		                    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst+96),
+		                    _mm256_permute2x128_si256(lo, hi, 0x31));
+	} else {
+		_mm256_storeu_si256((__m256i *)dst, r);
+		_mm256_storeu_si256((__m256i *)(dst+32), g);
+	}
+}
+
+static void SDL_TARGETING("avx2")
+SDL_YV12RowsAVX2(const SDL_YUVJob *job, const Uint8 *lum,
+                 const Uint8 *cr, const Uint8 *cb, Uint8 *dst)
+{
+	const int step = 16 * job->bpp * job->scale;
+	const int cstep = job->chroma_step;
+	const Uint8 *lum2 = lum + job->lum_pitch;
+	const Uint8 *pairs = (cr < cb) ? cr : cb;
+	Uint8 *dst2 = dst + job->dst_pitch * job->scale;
+	SDL_YUVOffsetsAVX2 ofs;
+	__m256i c, first, second;
+	__m128i u, v;
+	int x;
+
+	for ( x=0; x+16 <= job->cols; x += 16 ) {
+		if ( cstep == 2 ) {
+			/* Pairs 0-3 land in the low lane, with pixels 0-7 */
+			c = _mm256_cvtepu8_epi16(
+			        _mm_loadu_si128((const __m128i *)(pairs + x)));
+			first = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c,
+			        _MM_SHUFFLE(2,2,0,0)), _MM_SHUFFLE(2,2,0,0));
+			second = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c,
+			        _MM_SHUFFLE(3,3,1,1)), _MM_SHUFFLE(3,3,1,1));
+			if ( job->cr_first ) {
+				SDL_ChromaOffsetsAVX2(first, second, &ofs);
+			} else {
+				SDL_ChromaOffsetsAVX2(second, first, &ofs);
+			}
+		} else {
+			v = _mm_unpacklo_epi8(_mm_loadl_epi64(
+			        (const __m128i *)(cr + x/2)), _mm_setzero_si128());
+			u = _mm_unpacklo_epi8(_mm_loadl_epi64(
+			        (const __m128i *)(cb + x/2)), _mm_setzero_si128());
+			SDL_ChromaOffsetsAVX2(
+			    _mm256_inserti128_si256(_mm256_castsi128_si256(
+			        _mm_unpacklo_epi16(v, v)), _mm_unpackhi_epi16(v, v), 1),
+			    _mm256_inserti128_si256(_mm256_castsi128_si256(
+			        _mm_unpacklo_epi16(u, u)), _mm_unpackhi_epi16(u, u), 1),
+			    &ofs);
+		}
+		SDL_YUVStoreAVX2(job, _mm256_cvtepu8_epi16(
+		    _mm_loadu_si128((const __m128i *)(lum + x))),
+		    &ofs, dst + (x/16)*step);
+		SDL_YUVStoreAVX2(job, _mm256_cvtepu8_epi16(
+		    _mm_loadu_si128((const __m128i *)(lum2 + x))),
+		    &ofs, dst2 + (x/16)*step);
+	}
+	if ( x < job->cols ) {
+		SDL_YUVTail(job, lum + x, 1, cr + (x/2)*cstep, cb + (x/2)*cstep,
+		            cstep, dst + (x/16)*step, (job->cols - x) / 2);
+		SDL_YUVTail(job, lum2 + x, 1, cr + (x/2)*cstep, cb + (x/2)*cstep,
+		            cstep, dst2 + (x/16)*step, (job->cols - x) / 2);
+	}
+	SDL_DoubleYUVRow(job, dst);
+	SDL_DoubleYUVRow(job, dst2);
+}
+
+static void SDL_TARGETING("avx2")
+SDL_PackedRowAVX2(const SDL_YUVJob *job, const Uint8 *src, Uint8 *dst)
+{
+	const __m256i lowbytes = _mm256_set1_epi16(0x00FF);
+	const int step = 16 * job->bpp * job->scale;
+	SDL_YUVOffsetsAVX2 ofs;
+	__m256i w, y, c, first, second;
+	int x;
+
+	for ( x=0; x+16 <= job->cols; x += 16 ) {
+		w = _mm256_loadu_si256((const __m256i *)(src + x*2));
+		if ( job->yoff ) {
+			y = _mm256_srli_epi16(w, 8);
+			c = _mm256_and_si256(w, lowbytes);
+		} else {
+			y = _mm256_and_si256(w, lowbytes);
+			c = _mm256_srli_epi16(w, 8);
+		}
+		first = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c,
+		                _MM_SHUFFLE(2,2,0,0)), _MM_SHUFFLE(2,2,0,0));
+		second = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c,
+		                _MM_SHUFFLE(3,3,1,1)), _MM_SHUFFLE(3,3,1,1));
+		if ( job->cr_first ) {
+			SDL_ChromaOffsetsAVX2(first, second, &ofs);
+		} else {
+			SDL_ChromaOffsetsAVX2(second, first, &ofs);
+		}
+		SDL_YUVStoreAVX2(job, y, &ofs, dst + (x/16)*step);
+	}
+	if ( x < job->cols ) {
+		const Uint8 *pair = src + x*2;
+		int crpos = job->yoff ? (job->cr_first ? 0 : 2)
+		                      : (job->cr_first ? 1 : 3);
+		int cbpos = crpos ^ 2;
+
+		SDL_YUVTail(job, pair + job->yoff, 2, pair + crpos, pair + cbpos,
+		            4, dst + (x/16)*step, (job->cols - x) / 2);
+	}
+	SDL_DoubleYUVRow(job, dst);
+}
+
+static void SDL_TARGETING("avx2")
+SDL_ConvertYUVAVX2(const SDL_YUVJob *job, unsigned char *lum,
+                   unsigned char *cr, unsigned char *cb)
+{
+	Uint8 *dst = job->out;
+	int y;
+
+	if ( job->packed ) {
+		for ( y=0; y<job->rows; ++y ) {
+			SDL_PackedRowAVX2(job, lum + (size_t)y*job->lum_pitch, dst);
+			dst += job->dst_pitch * job->scale;
+		}
+	} else {
+		for ( y=0; y<job->rows/2; ++y ) {
+			SDL_YV12RowsAVX2(job, lum + (size_t)y*2*job->lum_pitch,
+			                 cr + (size_t)y*job->chroma_pitch,
+			                 cb + (size_t)y*job->chroma_pitch, dst);
+			dst += job->dst_pitch * job->scale * 2;
+		}
+	}
+}
+
+#endif /* SDL_AVX2_INTRINSICS */
+
+/* Packed formats are passed as three pointers into the same pixels */
+static unsigned char *SDL_SetupPackedJob(SDL_YUVJob *job, unsigned char *lum,
+                                         unsigned char *cr, unsigned char *cb)
+{
+	unsigned char *src = lum;
+
+	if ( cr < src ) src = cr;
+	if ( cb < src ) src = cb;
+	job->packed = 1;
+	job->yoff = (int)(lum - src);
+	job->cr_first = (cr < cb);
+	return(src);
+}
+
+#define YUV_CONVERTER(name, isa, packed, bpp, scale) \
+void name( int *colortab, Uint32 *rgb_2_pix, \
+           unsigned char *lum, unsigned char *cr, \
+           unsigned char *cb, unsigned char *out, \
+           int rows, int cols, int mod, \
+           int lum_pitch, int chroma_pitch, int chroma_step ) \
+{ \
+	SDL_YUVJob job; \
+	SDL_SetupYUVJob(&job, colortab, rgb_2_pix, out, rows, cols, mod, \
+	                lum_pitch, chroma_pitch, chroma_step, bpp, scale); \
+	if ( packed ) { \
+		lum = SDL_SetupPackedJob(&job, lum, cr, cb); \
+	} else { \
+		job.cr_first = (cr < cb); \
+	} \
+	SDL_ConvertYUV##isa(&job, lum, cr, cb); \
+}
+
+YUV_CONVERTER(Color16DitherYV12SSE21X, SSE2, 0, 2, 1)
+YUV_CONVERTER(Color24DitherYV12SSE21X, SSE2, 0, 3, 1)
+YUV_CONVERTER(Color32DitherYV12SSE21X, SSE2, 0, 4, 1)
+YUV_CONVERTER(Color16DitherYV12SSE22X, SSE2, 0, 2, 2)
+YUV_CONVERTER(Color24DitherYV12SSE22X, SSE2, 0, 3, 2)
+YUV_CONVERTER(Color32DitherYV12SSE22X, SSE2, 0, 4, 2)
+YUV_CONVERTER(Color16DitherYUY2SSE21X, SSE2, 1, 2, 1)
+YUV_CONVERTER(Color24DitherYUY2SSE21X, SSE2, 1, 3, 1)
+YUV_CONVERTER(Color32DitherYUY2SSE21X, SSE2, 1, 4, 1)
+YUV_CONVERTER(Color16DitherYUY2SSE22X, SSE2, 1, 2, 2)
+YUV_CONVERTER(Color24DitherYUY2SSE22X, SSE2, 1, 3, 2)
+YUV_CONVERTER(Color32DitherYUY2SSE22X, SSE2, 1, 4, 2)
+
+#if SDL_AVX2_INTRINSICS
+YUV_CONVERTER(Color16DitherYV12AVX21X, AVX2, 0, 2, 1)
+YUV_CONVERTER(Color24DitherYV12AVX21X, AVX2, 0, 3, 1)
+YUV_CONVERTER(Color32DitherYV12AVX21X, AVX2, 0, 4, 1)
+YUV_CONVERTER(Color16DitherYV12AVX22X, AVX2, 0, 2, 2)
+YUV_CONVERTER(Color24DitherYV12AVX22X, AVX2, 0, 3, 2)
+YUV_CONVERTER(Color32DitherYV12AVX22X, AVX2, 0, 4, 2)
+YUV_CONVERTER(Color16DitherYUY2AVX21X, AVX2, 1, 2, 1)
+YUV_CONVERTER(Color24DitherYUY2AVX21X, AVX2, 1, 3, 1)
+YUV_CONVERTER(Color32DitherYUY2AVX21X, AVX2, 1, 4, 1)
+YUV_CONVERTER(Color16DitherYUY2AVX22X, AVX2, 1, 2, 2)
+YUV_CONVERTER(Color24DitherYUY2AVX22X, AVX2, 1, 3, 2)
+YUV_CONVERTER(Color32DitherYUY2AVX22X, AVX2, 1, 4, 2)
+#endif
+
+#endif /* SDL_SSE2_INTRINSICS */
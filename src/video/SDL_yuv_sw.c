@@ -84,10 +84,10 @@
  */
 
 #include "SDL_video.h"
-#include "SDL_cpuinfo.h"
-#include "SDL_stretch_c.h"
+#include "../cpuinfo/SDL_cpuinfo_c.h"
 #include "SDL_yuvfuncs.h"
 #include "SDL_yuv_sw_c.h"
+#include "SDL_workers_c.h"
 
 /* The functions used to manipulate software video overlays */
 static struct private_yuvhwfuncs sw_yuvfuncs = {
@@ -97,21 +97,69 @@ static struct private_yuvhwfuncs sw_yuvfuncs = {
 	SDL_FreeYUV_SW
 };
 
+/* The converters step 'chroma_step' bytes between chroma samples, which
+   is 1 for YV12, 2 for NV12 and 4 for the packed formats.  The pitches
+   of the source rows are in bytes, and packed formats only use lum_pitch.
+ */
+typedef void (*SDL_YUVConverter)(int *colortab, Uint32 *rgb_2_pix,
+                                 unsigned char *lum, unsigned char *cr,
+                                 unsigned char *cb, unsigned char *out,
+                                 int rows, int cols, int mod,
+                                 int lum_pitch, int chroma_pitch,
+                                 int chroma_step );
+
+/* Where one destination column or row samples the source: byte offsets
+   of the two nearest luma and chroma samples, and the weight (0-256) of
+   the second one.  Nearest sampling uses the first ones only, and the
+   source pixel, which is relative to the converted span for columns.
+ */
+typedef struct {
+	int pixel;
+	int lum[2];
+	int chroma[2];
+	int lum_weight;
+	int chroma_weight;
+} SDL_YUVTap;
+
+/* A frame being displayed, converted in bands of destination rows */
+typedef struct {
+	struct private_yuvhwdata *swdata;
+	SDL_YUVConverter convert;	/* NULL for the general scaler */
+	SDL_YUVConverter convert_rows;	/* nearest scaling, else NULL */
+	int span_x, span_w;		/* source columns it converts */
+	int row_size;			/* pixels of scratch for each band */
+	int src_h;
+	Uint8 *lum, *cr, *cb;
+	int lum_pitch, chroma_pitch, chroma_step;
+	Uint8 *out;
+	int dst_pitch;			/* bytes between destination rows */
+	int mod;			/* for the converters, in pixels */
+	int scale;			/* 1 or 2 with a converter */
+	int rows, cols;			/* converted, or destination size */
+	int bpp;
+} SDL_YUVFrame;
+
 /* RGB conversion lookup tables */
 struct private_yuvhwdata {
-	SDL_Surface *stretch;
 	SDL_Surface *display;
 	Uint8 *pixels;
 	int *colortab;
 	Uint32 *rgb_2_pix;
-	void (*Display1X)(int *colortab, Uint32 *rgb_2_pix,
-                          unsigned char *lum, unsigned char *cr,
-                          unsigned char *cb, unsigned char *out,
-                          int rows, int cols, int mod );
-	void (*Display2X)(int *colortab, Uint32 *rgb_2_pix,
-	                  unsigned char *lum, unsigned char *cr,
-                          unsigned char *cb, unsigned char *out,
-                          int rows, int cols, int mod );
+	SDL_YUVConverter Display1X;
+	SDL_YUVConverter Display2X;
+
+	/* Scaled and clipped display, straight into the display surface */
+	SDL_StretchFilter filter;
+	SDL_YUVTap *taps;		/* columns, then rows */
+	int max_taps;
+	Uint32 *rows;			/* converted rows for each band */
+	int max_rows;
+
+	/* Conversion on the worker threads, see SDL_workers_c.h */
+	SDL_YUVFrame frame;
+	int async;			/* return before the frame is done */
+	int pending;			/* the frame is still being converted */
+	SDL_Rect pending_rect;
 
 	/* These are just so we don't have to allocate them separately */
 	Uint16 pitches[3];
@@ -132,10 +180,68 @@ extern void ColorRGBDitherYV12MMX1X( int *colortab, Uint32 *rgb_2_pix,
                                      int rows, int cols, int mod );
 #endif 
 
+#if SDL_SSE2_INTRINSICS
+/* In SDL_yuv_simd.c, indexed by [2X][bytes per pixel - 2] */
+#define YUV_CONVERTER(name) \
+extern void name( int *colortab, Uint32 *rgb_2_pix, \
+                  unsigned char *lum, unsigned char *cr, \
+                  unsigned char *cb, unsigned char *out, \
+                  int rows, int cols, int mod, \
+                  int lum_pitch, int chroma_pitch, int chroma_step );
+YUV_CONVERTER(Color16DitherYV12SSE21X)
+YUV_CONVERTER(Color24DitherYV12SSE21X)
+YUV_CONVERTER(Color32DitherYV12SSE21X)
+YUV_CONVERTER(Color16DitherYV12SSE22X)
+YUV_CONVERTER(Color24DitherYV12SSE22X)
+YUV_CONVERTER(Color32DitherYV12SSE22X)
+YUV_CONVERTER(Color16DitherYUY2SSE21X)
+YUV_CONVERTER(Color24DitherYUY2SSE21X)
+YUV_CONVERTER(Color32DitherYUY2SSE21X)
+YUV_CONVERTER(Color16DitherYUY2SSE22X)
+YUV_CONVERTER(Color24DitherYUY2SSE22X)
+YUV_CONVERTER(Color32DitherYUY2SSE22X)
+#if SDL_AVX2_INTRINSICS
+YUV_CONVERTER(Color16DitherYV12AVX21X)
+YUV_CONVERTER(Color24DitherYV12AVX21X)
+YUV_CONVERTER(Color32DitherYV12AVX21X)
+YUV_CONVERTER(Color16DitherYV12AVX22X)
+YUV_CONVERTER(Color24DitherYV12AVX22X)
+YUV_CONVERTER(Color32DitherYV12AVX22X)
+YUV_CONVERTER(Color16DitherYUY2AVX21X)
+YUV_CONVERTER(Color24DitherYUY2AVX21X)
+YUV_CONVERTER(Color32DitherYUY2AVX21X)
+YUV_CONVERTER(Color16DitherYUY2AVX22X)
+YUV_CONVERTER(Color24DitherYUY2AVX22X)
+YUV_CONVERTER(Color32DitherYUY2AVX22X)
+#endif
+#undef YUV_CONVERTER
+
+static const SDL_YUVConverter yv12_sse2[2][3] = {
+	{ Color16DitherYV12SSE21X, Color24DitherYV12SSE21X, Color32DitherYV12SSE21X },
+	{ Color16DitherYV12SSE22X, Color24DitherYV12SSE22X, Color32DitherYV12SSE22X }
+};
+static const SDL_YUVConverter yuy2_sse2[2][3] = {
+	{ Color16DitherYUY2SSE21X, Color24DitherYUY2SSE21X, Color32DitherYUY2SSE21X },
+	{ Color16DitherYUY2SSE22X, Color24DitherYUY2SSE22X, Color32DitherYUY2SSE22X }
+};
+#if SDL_AVX2_INTRINSICS
+static const SDL_YUVConverter yv12_avx2[2][3] = {
+	{ Color16DitherYV12AVX21X, Color24DitherYV12AVX21X, Color32DitherYV12AVX21X },
+	{ Color16DitherYV12AVX22X, Color24DitherYV12AVX22X, Color32DitherYV12AVX22X }
+};
+static const SDL_YUVConverter yuy2_avx2[2][3] = {
+	{ Color16DitherYUY2AVX21X, Color24DitherYUY2AVX21X, Color32DitherYUY2AVX21X },
+	{ Color16DitherYUY2AVX22X, Color24DitherYUY2AVX22X, Color32DitherYUY2AVX22X }
+};
+#endif
+#endif /* SDL_SSE2_INTRINSICS */
+
 static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned short* row1;
     unsigned short* row2;
@@ -148,7 +254,7 @@ static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 
     row1 = (unsigned short*) out;
     row2 = row1 + cols + mod;
-    lum2 = lum + cols;
+    lum2 = lum + lum_pitch;
 
     mod += cols + mod;
 
@@ -164,7 +270,7 @@ static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
             crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
                                + colortab[ *cb + 2*256 ];
             cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
-            ++cr; ++cb;
+            cr += chroma_step; cb += chroma_step;
 
             L = *lum++;
             *row1++ = (unsigned short)(rgb_2_pix[ L + cr_r ] |
@@ -195,8 +301,10 @@ static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
          * to the ++'s above),but they need to be at the start
          * of the line after that.
          */
-        lum  += cols;
-        lum2 += cols;
+        lum  += 2*lum_pitch - cols;
+        lum2 += 2*lum_pitch - cols;
+        cr += chroma_pitch - cols_2*chroma_step;
+        cb += chroma_pitch - cols_2*chroma_step;
         row1 += mod;
         row2 += mod;
     }
@@ -205,7 +313,9 @@ static void Color16DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int value;
     unsigned char* row1;
@@ -219,7 +329,7 @@ static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 
     row1 = out;
     row2 = row1 + cols*3 + mod*3;
-    lum2 = lum + cols;
+    lum2 = lum + lum_pitch;
 
     mod += cols + mod;
     mod *= 3;
@@ -236,7 +346,7 @@ static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
             crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
                                + colortab[ *cb + 2*256 ];
             cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
-            ++cr; ++cb;
+            cr += chroma_step; cb += chroma_step;
 
             L = *lum++;
             value = (rgb_2_pix[ L + cr_r ] |
@@ -279,8 +389,10 @@ static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
          * to the ++'s above),but they need to be at the start
          * of the line after that.
          */
-        lum  += cols;
-        lum2 += cols;
+        lum  += 2*lum_pitch - cols;
+        lum2 += 2*lum_pitch - cols;
+        cr += chroma_pitch - cols_2*chroma_step;
+        cb += chroma_pitch - cols_2*chroma_step;
         row1 += mod;
         row2 += mod;
     }
@@ -289,7 +401,9 @@ static void Color24DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int* row1;
     unsigned int* row2;
@@ -302,7 +416,7 @@ static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 
     row1 = (unsigned int*) out;
     row2 = row1 + cols + mod;
-    lum2 = lum + cols;
+    lum2 = lum + lum_pitch;
 
     mod += cols + mod;
 
@@ -318,7 +432,7 @@ static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
             crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
                                + colortab[ *cb + 2*256 ];
             cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
-            ++cr; ++cb;
+            cr += chroma_step; cb += chroma_step;
 
             L = *lum++;
             *row1++ = (rgb_2_pix[ L + cr_r ] |
@@ -349,8 +463,10 @@ static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
          * to the ++'s above),but they need to be at the start
          * of the line after that.
          */
-        lum  += cols;
-        lum2 += cols;
+        lum  += 2*lum_pitch - cols;
+        lum2 += 2*lum_pitch - cols;
+        cr += chroma_pitch - cols_2*chroma_step;
+        cb += chroma_pitch - cols_2*chroma_step;
         row1 += mod;
         row2 += mod;
     }
@@ -364,7 +480,9 @@ static void Color32DitherYV12Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int* row1 = (unsigned int*) out;
     const int next_row = cols+(mod/2);
@@ -376,7 +494,7 @@ static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int cb_b;
     int cols_2 = cols / 2;
 
-    lum2 = lum + cols;
+    lum2 = lum + lum_pitch;
 
     mod = (next_row * 3) + (mod/2);
 
@@ -392,7 +510,7 @@ static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
             crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
                                + colortab[ *cb + 2*256 ];
             cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
-            ++cr; ++cb;
+            cr += chroma_step; cb += chroma_step;
 
             L = *lum++;
             row1[0] = row1[next_row] = (rgb_2_pix[ L + cr_r ] |
@@ -427,8 +545,10 @@ static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
          * to the ++'s above),but they need to be at the start
          * of the line after that.
          */
-        lum  += cols;
-        lum2 += cols;
+        lum  += 2*lum_pitch - cols;
+        lum2 += 2*lum_pitch - cols;
+        cr += chroma_pitch - cols_2*chroma_step;
+        cb += chroma_pitch - cols_2*chroma_step;
         row1 += mod;
         row2 += mod;
     }
@@ -437,7 +557,9 @@ static void Color16DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
 static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int value;
     unsigned char* row1 = out;
@@ -450,7 +572,7 @@ static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int cb_b;
     int cols_2 = cols / 2;
 
-    lum2 = lum + cols;
+    lum2 = lum + lum_pitch;
 
     mod = next_row*3 + mod*3;
 
@@ -466,7 +588,7 @@ static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
             crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
                                + colortab[ *cb + 2*256 ];
             cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
-            ++cr; ++cb;
+            cr += chroma_step; cb += chroma_step;
 
             L = *lum++;
             value = (rgb_2_pix[ L + cr_r ] |
@@ -525,8 +647,10 @@ static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
          * to the ++'s above),but they need to be at the start
          * of the line after that.
          */
-        lum  += cols;
-        lum2 += cols;
+        lum  += 2*lum_pitch - cols;
+        lum2 += 2*lum_pitch - cols;
+        cr += chroma_pitch - cols_2*chroma_step;
+        cb += chroma_pitch - cols_2*chroma_step;
         row1 += mod;
         row2 += mod;
     }
@@ -535,7 +659,9 @@ static void Color24DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
 static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int* row1 = (unsigned int*) out;
     const int next_row = cols*2+mod;
@@ -547,7 +673,7 @@ static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int cb_b;
     int cols_2 = cols / 2;
 
-    lum2 = lum + cols;
+    lum2 = lum + lum_pitch;
 
     mod = (next_row * 3) + mod;
 
@@ -563,7 +689,7 @@ static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
             crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]
                                + colortab[ *cb + 2*256 ];
             cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];
-            ++cr; ++cb;
+            cr += chroma_step; cb += chroma_step;
 
             L = *lum++;
             row1[0] = row1[1] = row1[next_row] = row1[next_row+1] =
@@ -602,8 +728,10 @@ static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
          * to the ++'s above),but they need to be at the start
          * of the line after that.
          */
-        lum  += cols;
-        lum2 += cols;
+        lum  += 2*lum_pitch - cols;
+        lum2 += 2*lum_pitch - cols;
+        cr += chroma_pitch - cols_2*chroma_step;
+        cb += chroma_pitch - cols_2*chroma_step;
         row1 += mod;
         row2 += mod;
     }
@@ -612,7 +740,9 @@ static void Color32DitherYV12Mod2X( int *colortab, Uint32 *rgb_2_pix,
 static void Color16DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned short* row;
     int x, y;
@@ -649,6 +779,9 @@ static void Color16DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 
         }
 
+        lum += lum_pitch - cols*2;
+        cr += lum_pitch - cols*2;
+        cb += lum_pitch - cols*2;
         row += mod;
     }
 }
@@ -656,7 +789,9 @@ static void Color16DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color24DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int value;
     unsigned char* row;
@@ -699,6 +834,9 @@ static void Color24DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
             *row++ = (value >> 16) & 0xFF;
 
         }
+        lum += lum_pitch - cols*2;
+        cr += lum_pitch - cols*2;
+        cb += lum_pitch - cols*2;
         row += mod;
     }
 }
@@ -706,7 +844,9 @@ static void Color24DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color32DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int* row;
     int x, y;
@@ -742,6 +882,9 @@ static void Color32DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 
 
         }
+        lum += lum_pitch - cols*2;
+        cr += lum_pitch - cols*2;
+        cb += lum_pitch - cols*2;
         row += mod;
     }
 }
@@ -754,7 +897,9 @@ static void Color32DitherYUY2Mod1X( int *colortab, Uint32 *rgb_2_pix,
 static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int* row = (unsigned int*) out;
     const int next_row = cols+(mod/2);
@@ -791,14 +936,19 @@ static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row++;
 
         }
-        row += next_row;
+        lum += lum_pitch - cols*2;
+        cr += lum_pitch - cols*2;
+        cb += lum_pitch - cols*2;
+        row += next_row + mod/2;
     }
 }
 
 static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int value;
     unsigned char* row = out;
@@ -847,14 +997,19 @@ static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row += 2*3;
 
         }
-        row += next_row;
+        lum += lum_pitch - cols*2;
+        cr += lum_pitch - cols*2;
+        cb += lum_pitch - cols*2;
+        row += next_row + mod*3;
     }
 }
 
 static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
                                     unsigned char *lum, unsigned char *cr,
                                     unsigned char *cb, unsigned char *out,
-                                    int rows, int cols, int mod )
+                                    int rows, int cols, int mod,
+                                    int lum_pitch, int chroma_pitch,
+                                    int chroma_step )
 {
     unsigned int* row = (unsigned int*) out;
     const int next_row = cols*2+mod;
@@ -863,7 +1018,6 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
-    mod+=mod;
     y = rows;
     while( y-- )
     {
@@ -895,10 +1049,50 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
 
         }
 
-        row += next_row;
+        lum += lum_pitch - cols*2;
+        cr += lum_pitch - cols*2;
+        cb += lum_pitch - cols*2;
+        row += next_row + mod;
     }
 }
 
+#if (__GNUC__ > 2) && defined(__i386__) && __OPTIMIZE__ && SDL_ASSEMBLY_ROUTINES
+/* The MMX converters only know YV12 and IYUV planes without padding */
+static void Color565DitherYV12MMX( int *colortab, Uint32 *rgb_2_pix,
+                                   unsigned char *lum, unsigned char *cr,
+                                   unsigned char *cb, unsigned char *out,
+                                   int rows, int cols, int mod,
+                                   int lum_pitch, int chroma_pitch,
+                                   int chroma_step )
+{
+    if ( lum_pitch == cols && chroma_pitch == cols/2 && chroma_step == 1 ) {
+        Color565DitherYV12MMX1X(colortab, rgb_2_pix, lum, cr, cb, out,
+                                rows, cols, mod);
+    } else {
+        Color16DitherYV12Mod1X(colortab, rgb_2_pix, lum, cr, cb, out,
+                               rows, cols, mod,
+                               lum_pitch, chroma_pitch, chroma_step);
+    }
+}
+
+static void ColorRGBDitherYV12MMX( int *colortab, Uint32 *rgb_2_pix,
+                                   unsigned char *lum, unsigned char *cr,
+                                   unsigned char *cb, unsigned char *out,
+                                   int rows, int cols, int mod,
+                                   int lum_pitch, int chroma_pitch,
+                                   int chroma_step )
+{
+    if ( lum_pitch == cols && chroma_pitch == cols/2 && chroma_step == 1 ) {
+        ColorRGBDitherYV12MMX1X(colortab, rgb_2_pix, lum, cr, cb, out,
+                                rows, cols, mod);
+    } else {
+        Color32DitherYV12Mod1X(colortab, rgb_2_pix, lum, cr, cb, out,
+                               rows, cols, mod,
+                               lum_pitch, chroma_pitch, chroma_step);
+    }
+}
+#endif
+
 /*
  * How many 1 bits are there in the Uint32.
  * Low performance, do not call often.
@@ -924,6 +1118,55 @@ static int free_bits_at_bottom( Uint32 a )
 
 
 SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_Surface *display)
+{
+	return SDL_CreateYUVFrom_SW(_this, width, height, format,
+	                            NULL, NULL, display);
+}
+
+/* Check that the planes passed to SDL_CreateYUVOverlayFrom() hold a frame */
+static int SDL_CheckYUVPlanes(int width, Uint32 format,
+                              Uint8 **pixels, Uint16 *pitches)
+{
+	int planes, i;
+
+	switch (format) {
+	    case SDL_YV12_OVERLAY:
+	    case SDL_IYUV_OVERLAY:
+		planes = 3;
+		if ( pitches[0] < width || pitches[1] < width/2 ||
+		     pitches[2] != pitches[1] ) {
+			SDL_SetError("Overlay pitches too small or different");
+			return(-1);
+		}
+		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+		planes = 2;
+		if ( pitches[0] < width || pitches[1] < (width/2)*2 ) {
+			SDL_SetError("Overlay pitches too small");
+			return(-1);
+		}
+		break;
+	    default:
+		planes = 1;
+		if ( pitches[0] < width*2 ) {
+			SDL_SetError("Overlay pitch too small");
+			return(-1);
+		}
+		break;
+	}
+	for ( i=0; i<planes; ++i ) {
+		if ( pixels[i] == NULL ) {
+			SDL_SetError("Passed NULL overlay plane");
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+SDL_Overlay *SDL_CreateYUVFrom_SW(_THIS, int width, int height, Uint32 format,
+                                  Uint8 **pixels, Uint16 *pitches,
+                                  SDL_Surface *display)
 {
 	SDL_Overlay *overlay;
 	struct private_yuvhwdata *swdata;
@@ -937,6 +1180,8 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	int i;
 	int CR, CB;
 	Uint32 Rmask, Gmask, Bmask;
+	const char *env;
+	int planar;
 
 	/* Only RGB packed pixel conversion supported */
 	if ( (display->format->BytesPerPixel != 2) &&
@@ -953,12 +1198,27 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	    case SDL_YUY2_OVERLAY:
 	    case SDL_UYVY_OVERLAY:
 	    case SDL_YVYU_OVERLAY:
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
 		break;
 	    default:
 		SDL_SetError("Unsupported YUV format");
 		return(NULL);
 	}
 
+	/* Each chroma sample is shared by a pair of pixels, and by a pair
+	   of rows in the planar formats, so there must be at least one.
+	 */
+	planar = (format == SDL_YV12_OVERLAY || format == SDL_IYUV_OVERLAY ||
+	          format == SDL_NV12_OVERLAY || format == SDL_NV21_OVERLAY);
+	if ( width < 2 || (planar && height < 2) ) {
+		SDL_SetError("YUV overlay too small for its chroma");
+		return(NULL);
+	}
+	if ( pixels && SDL_CheckYUVPlanes(width, format, pixels, pitches) < 0 ) {
+		return(NULL);
+	}
+
 	/* Create the overlay structure */
 	overlay = (SDL_Overlay *)SDL_malloc(sizeof *overlay);
 	if ( overlay == NULL ) {
@@ -983,9 +1243,27 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
 	}
-	swdata->stretch = NULL;
 	swdata->display = display;
-	swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
+	swdata->filter = SDL_STRETCH_NEAREST;
+	env = SDL_getenv("SDL_VIDEO_YUV_FILTER");
+	if ( env && (SDL_strcasecmp(env, "bilinear") == 0 ||
+	             SDL_strcasecmp(env, "linear") == 0 ||
+	             SDL_strcmp(env, "1") == 0) ) {
+		swdata->filter = SDL_STRETCH_BILINEAR;
+	}
+	swdata->taps = NULL;
+	swdata->max_taps = 0;
+	swdata->rows = NULL;
+	swdata->max_rows = 0;
+	swdata->pending = 0;
+	env = SDL_getenv("SDL_VIDEO_YUV_ASYNC");
+	swdata->async = (env && SDL_atoi(env) > 0);
+	if ( pixels ) {
+		/* The caller owns the planes */
+		swdata->pixels = NULL;
+	} else {
+		swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
+	}
 	swdata->colortab = (int *)SDL_malloc(4*256*sizeof(int));
 	Cr_r_tab = &swdata->colortab[0*256];
 	Cr_g_tab = &swdata->colortab[1*256];
@@ -995,7 +1273,8 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	r_2_pix_alloc = &swdata->rgb_2_pix[0*768];
 	g_2_pix_alloc = &swdata->rgb_2_pix[1*768];
 	b_2_pix_alloc = &swdata->rgb_2_pix[2*768];
-	if ( ! swdata->pixels || ! swdata->colortab || ! swdata->rgb_2_pix ) {
+	if ( (! swdata->pixels && ! pixels) ||
+	     ! swdata->colortab || ! swdata->rgb_2_pix ) {
 		SDL_OutOfMemory();
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
@@ -1060,6 +1339,8 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	switch (format) {
 	    case SDL_YV12_OVERLAY:
 	    case SDL_IYUV_OVERLAY:
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
 		if ( display->format->BytesPerPixel == 2 ) {
 #if (__GNUC__ > 2) && defined(__i386__) && __OPTIMIZE__ && SDL_ASSEMBLY_ROUTINES
 			/* inline assembly functions */
@@ -1068,7 +1349,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 				             (Bmask == 0x001F) &&
 			                     (width & 15) == 0) {
 /*printf("Using MMX 16-bit 565 dither\n");*/
-				swdata->Display1X = Color565DitherYV12MMX1X;
+				swdata->Display1X = Color565DitherYV12MMX;
 			} else {
 /*printf("Using C 16-bit dither\n");*/
 				swdata->Display1X = Color16DitherYV12Mod1X;
@@ -1090,7 +1371,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 				             (Bmask == 0x000000FF) && 
 			                     (width & 15) == 0) {
 /*printf("Using MMX 32-bit dither\n");*/
-				swdata->Display1X = ColorRGBDitherYV12MMX1X;
+				swdata->Display1X = ColorRGBDitherYV12MMX;
 			} else {
 /*printf("Using C 32-bit dither\n");*/
 				swdata->Display1X = Color32DitherYV12Mod1X;
@@ -1121,6 +1402,32 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		/* We should never get here (caught above) */
 		break;
 	}
+#if SDL_SSE2_INTRINSICS
+	/* The vector converters take up to 8 bits per channel */
+	if ( number_of_bits_set(Rmask) <= 8 &&
+	     number_of_bits_set(Gmask) <= 8 &&
+	     number_of_bits_set(Bmask) <= 8 ) {
+		const SDL_YUVConverter (*funcs)[3] = NULL;
+		int packed = (format != SDL_YV12_OVERLAY &&
+		              format != SDL_IYUV_OVERLAY &&
+		              format != SDL_NV12_OVERLAY &&
+		              format != SDL_NV21_OVERLAY);
+
+#if SDL_AVX2_INTRINSICS
+		if ( SDL_HasAVX2() ) {
+			funcs = packed ? yuy2_avx2 : yv12_avx2;
+		} else
+#endif
+		if ( SDL_HasSSE2() ) {
+			funcs = packed ? yuy2_sse2 : yv12_sse2;
+		}
+		if ( funcs ) {
+			i = display->format->BytesPerPixel - 2;
+			swdata->Display1X = funcs[0][i];
+			swdata->Display2X = funcs[1][i];
+		}
+	}
+#endif
 
 	/* Find the pitch and offset values for the overlay */
 	overlay->pitches = swdata->pitches;
@@ -1138,6 +1445,16 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		                     overlay->pitches[1] * overlay->h / 2;
 		overlay->planes = 3;
 		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+		/* Luma, then interleaved chroma at half resolution */
+		overlay->pitches[0] = overlay->w;
+		overlay->pitches[1] = (overlay->w / 2) * 2;
+	        overlay->pixels[0] = swdata->pixels;
+	        overlay->pixels[1] = overlay->pixels[0] +
+		                     overlay->pitches[0] * overlay->h;
+		overlay->planes = 2;
+		break;
 	    case SDL_YUY2_OVERLAY:
 	    case SDL_UYVY_OVERLAY:
 	    case SDL_YVYU_OVERLAY:
@@ -1149,13 +1466,43 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		/* We should never get here (caught above) */
 		break;
 	}
+	if ( pixels ) {
+		for ( i=0; i<overlay->planes; ++i ) {
+			overlay->pitches[i] = pitches[i];
+			overlay->pixels[i] = pixels[i];
+		}
+	}
 
 	/* We're all done.. */
 	return(overlay);
 }
 
+/* The overlay whose frame is being converted in the background, if any.
+   The worker pool only holds one queued job at a time.
+ */
+static struct private_yuvhwdata *pending_swdata = NULL;
+
+/* Wait for a frame converted in the background and show it */
+static void SDL_FinishYUV_SW(struct private_yuvhwdata *swdata)
+{
+	if ( swdata->pending ) {
+		SDL_WaitWorkers();
+		swdata->pending = 0;
+		pending_swdata = NULL;
+		SDL_UpdateRects(swdata->display, 1, &swdata->pending_rect);
+	}
+}
+
+void SDL_FinishPendingYUV_SW(void)
+{
+	if ( pending_swdata ) {
+		SDL_FinishYUV_SW(pending_swdata);
+	}
+}
+
 int SDL_LockYUV_SW(_THIS, SDL_Overlay *overlay)
 {
+	SDL_FinishYUV_SW(overlay->hwdata);
 	return(0);
 }
 
@@ -1164,24 +1511,361 @@ void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay)
 	return;
 }
 
+static int SDL_FloorYUV(double x)
+{
+	int i = (int)x;
+	return (x < i) ? i-1 : i;
+}
+
+/* Compute the taps of 'n' destination pixels along one axis, which show
+   'src_len' source pixels from 'src_pos' on.  Luma has 'lum_max' samples
+   'lum_step' bytes apart, and chroma 'chroma_max' samples 'chroma_step'
+   bytes apart, at half resolution if 'subsampled' is set.  The sample
+   positions are the 16.16 fixed point steps of SDL_SoftStretch(), or the
+   pixel centers of the bilinear filter of SDL_SoftStretchFiltered().
+ */
+static void SDL_BuildYUVTaps(SDL_YUVTap *taps, int n, SDL_StretchFilter filter,
+                             int src_pos, int src_len,
+                             int lum_max, int lum_step,
+                             int chroma_max, int chroma_step, int subsampled)
+{
+	double scale = (double)src_len / n;
+	Uint32 step = ((Uint32)src_len << 16) / n;
+	double pos;
+	int i, k, s[2];
+
+	for ( i=0; i<n; ++i ) {
+		SDL_YUVTap *tap = &taps[i];
+
+		if ( filter == SDL_STRETCH_NEAREST ) {
+			s[0] = src_pos + (int)(((Uint32)i * step) >> 16);
+			if ( s[0] < 0 ) s[0] = 0;
+			if ( s[0] > lum_max-1 ) s[0] = lum_max-1;
+			tap->pixel = s[0];
+			tap->lum[0] = tap->lum[1] = s[0] * lum_step;
+			tap->lum_weight = 0;
+			if ( subsampled ) {
+				s[0] /= 2;
+			}
+			if ( s[0] > chroma_max-1 ) s[0] = chroma_max-1;
+			tap->chroma[0] = tap->chroma[1] = s[0] * chroma_step;
+			tap->chroma_weight = 0;
+			continue;
+		}
+
+		/* Between the two nearest sample centers */
+		pos = src_pos + (i+0.5)*scale - 0.5;
+		s[0] = SDL_FloorYUV(pos);
+		tap->pixel = s[0];
+		tap->lum_weight = (int)((pos - s[0]) * 256 + 0.5);
+		s[1] = s[0] + 1;
+		for ( k=0; k<2; ++k ) {
+			if ( s[k] < 0 ) s[k] = 0;
+			if ( s[k] > lum_max-1 ) s[k] = lum_max-1;
+			tap->lum[k] = s[k] * lum_step;
+		}
+
+		/* Chroma samples are centered between two luma samples */
+		if ( subsampled ) {
+			pos = (pos - 0.5) / 2;
+		}
+		s[0] = SDL_FloorYUV(pos);
+		tap->chroma_weight = (int)((pos - s[0]) * 256 + 0.5);
+		s[1] = s[0] + 1;
+		for ( k=0; k<2; ++k ) {
+			if ( s[k] < 0 ) s[k] = 0;
+			if ( s[k] > chroma_max-1 ) s[k] = chroma_max-1;
+			tap->chroma[k] = s[k] * chroma_step;
+		}
+	}
+}
+
+/* Blend four samples with 8-bit weights */
+#define YUV_BILERP(row0, row1, o, wx, wy) \
+	(((((row0)[(o)[0]] * 256) + ((row0)[(o)[1]] - (row0)[(o)[0]]) * (wx)) * 256 + \
+	  ((((row1)[(o)[0]] - (row0)[(o)[0]]) * 256) + \
+	   ((row1)[(o)[1]] - (row1)[(o)[0]] - (row0)[(o)[1]] + (row0)[(o)[0]]) \
+	   * (wx)) * (wy) + 32768) >> 16)
+
+/* Set up the taps for showing the source rectangle 'src' at any size,
+   and the row buffers for each of 'bands' bands.
+
+   With nearest sampling, the source rows are converted a pair at a time
+   by the fixed size converters, over the even aligned span of columns
+   which is shown, and the destination pixels are picked from them.
+   Bilinear filtering blends the YUV samples, one pixel at a time.
+ */
+static int SDL_SetupYUVScale(struct private_yuvhwdata *swdata,
+                             SDL_Overlay *overlay, SDL_Rect *src,
+                             SDL_Rect *dst, int bands)
+{
+	SDL_YUVFrame *frame = &swdata->frame;
+	int planar = (frame->chroma_step < 4);
+	int x;
+
+	frame->span_x = src->x & ~1;
+	frame->span_w = ((src->x + src->w + 1) & ~1);
+	if ( frame->span_w > (overlay->w & ~1) ) {
+		frame->span_w = (overlay->w & ~1);
+	}
+	frame->span_w -= frame->span_x;
+	frame->convert_rows = NULL;
+	if ( swdata->filter == SDL_STRETCH_NEAREST &&
+	     frame->span_w > 0 && overlay->h >= 2 ) {
+		frame->convert_rows = swdata->Display1X;
+	}
+	frame->row_size = dst->w;
+	if ( frame->convert_rows && 2*frame->span_w > frame->row_size ) {
+		frame->row_size = 2*frame->span_w;
+	}
+
+	if ( dst->w + dst->h > swdata->max_taps ) {
+		int max_taps = dst->w + dst->h;
+		SDL_YUVTap *taps;
+
+		taps = (SDL_YUVTap *)SDL_realloc(swdata->taps,
+		                                 max_taps*sizeof(*taps));
+		if ( taps == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		swdata->taps = taps;
+		swdata->max_taps = max_taps;
+	}
+	if ( frame->row_size * bands > swdata->max_rows ) {
+		int max_rows = frame->row_size * bands;
+		Uint32 *rows;
+
+		rows = (Uint32 *)SDL_realloc(swdata->rows,
+		                             max_rows*sizeof(*rows));
+		if ( rows == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		swdata->rows = rows;
+		swdata->max_rows = max_rows;
+	}
+
+	SDL_BuildYUVTaps(swdata->taps, dst->w, swdata->filter, src->x, src->w,
+	                 overlay->w, planar ? 1 : 2,
+	                 overlay->w/2, frame->chroma_step, 1);
+	SDL_BuildYUVTaps(swdata->taps + dst->w, dst->h, swdata->filter,
+	                 src->y, src->h, overlay->h, frame->lum_pitch,
+	                 planar ? overlay->h/2 : overlay->h,
+	                 frame->chroma_pitch, planar);
+	if ( frame->convert_rows ) {
+		for ( x=0; x<dst->w; ++x ) {
+			SDL_YUVTap *tap = &swdata->taps[x];
+
+			tap->pixel -= frame->span_x;
+			if ( tap->pixel > frame->span_w-1 ) {
+				tap->pixel = frame->span_w-1;
+			}
+		}
+	}
+	return(0);
+}
+
+/* Convert source rows 2*pair and 2*pair+1 of the span, to 'out' */
+static void SDL_ConvertYUVPair(const SDL_YUVFrame *frame, int pair, Uint8 *out)
+{
+	const struct private_yuvhwdata *swdata = frame->swdata;
+	int planar = (frame->chroma_step < 4);
+	int y = 2*pair;
+	int lum_pitch = frame->lum_pitch;
+	int lum, chroma;
+
+	lum = y * frame->lum_pitch + frame->span_x * (planar ? 1 : 2);
+	if ( planar ) {
+		/* An odd last row has no chroma of its own */
+		if ( pair > frame->src_h/2 - 1 ) {
+			pair = frame->src_h/2 - 1;
+		}
+		chroma = pair * frame->chroma_pitch;
+	} else {
+		chroma = y * frame->lum_pitch;
+	}
+	chroma += (frame->span_x / 2) * frame->chroma_step;
+	if ( y+1 >= frame->src_h ) {
+		/* The last row of an odd height frame is converted twice */
+		lum_pitch = 0;
+	}
+	frame->convert_rows(swdata->colortab, swdata->rgb_2_pix,
+	                    frame->lum + lum, frame->cr + chroma,
+	                    frame->cb + chroma, out, 2, frame->span_w, 0,
+	                    lum_pitch, frame->chroma_pitch, frame->chroma_step);
+}
+
+/* Pick destination rows 'first' to 'last'-1 from converted source rows */
+static void SDL_ScaleYUVRowsNearest(const SDL_YUVFrame *frame,
+                                    int first, int last, Uint8 *pairs)
+{
+	const SDL_YUVTap *xtaps = frame->swdata->taps;
+	const SDL_YUVTap *ytap = xtaps + frame->cols + first;
+	const int row_pitch = frame->span_w * frame->bpp;
+	Uint8 *dstp = frame->out + first * frame->dst_pitch;
+	int pair = -1;
+	int x, y;
+
+	for ( y=first; y<last; ++y, ++ytap ) {
+		const Uint8 *src;
+
+		if ( ytap->pixel / 2 != pair ) {
+			pair = ytap->pixel / 2;
+			SDL_ConvertYUVPair(frame, pair, pairs);
+		}
+		src = pairs + (ytap->pixel & 1) * row_pitch;
+		switch (frame->bpp) {
+		    case 2:
+			for ( x=0; x<frame->cols; ++x ) {
+				((Uint16 *)dstp)[x] =
+					((const Uint16 *)src)[xtaps[x].pixel];
+			}
+			break;
+		    case 3:
+			for ( x=0; x<frame->cols; ++x ) {
+				const Uint8 *p = src + xtaps[x].pixel * 3;
+				dstp[x*3+0] = p[0];
+				dstp[x*3+1] = p[1];
+				dstp[x*3+2] = p[2];
+			}
+			break;
+		    case 4:
+			for ( x=0; x<frame->cols; ++x ) {
+				((Uint32 *)dstp)[x] =
+					((const Uint32 *)src)[xtaps[x].pixel];
+			}
+			break;
+		}
+		dstp += frame->dst_pitch;
+	}
+}
+
+/* Sample and convert destination rows 'first' to 'last'-1 */
+static void SDL_ScaleYUVRows(const SDL_YUVFrame *frame, int first, int last,
+                             Uint32 *row)
+{
+	const struct private_yuvhwdata *swdata = frame->swdata;
+	const int *colortab = swdata->colortab;
+	const Uint32 *rgb_2_pix = swdata->rgb_2_pix;
+	const SDL_YUVTap *xtaps = swdata->taps;
+	const SDL_YUVTap *ytap = xtaps + frame->cols + first;
+	Uint8 *dstp = frame->out + first * frame->dst_pitch;
+	int x, y;
+
+	for ( y=first; y<last; ++y, ++ytap ) {
+		const Uint8 *lum0 = frame->lum + ytap->lum[0];
+		const Uint8 *lum1 = frame->lum + ytap->lum[1];
+		const Uint8 *cr0 = frame->cr + ytap->chroma[0];
+		const Uint8 *cr1 = frame->cr + ytap->chroma[1];
+		const Uint8 *cb0 = frame->cb + ytap->chroma[0];
+		const Uint8 *cb1 = frame->cb + ytap->chroma[1];
+		int ly = ytap->lum_weight, cy = ytap->chroma_weight;
+		int L, cr, cb;
+
+		for ( x=0; x<frame->cols; ++x ) {
+			const SDL_YUVTap *tap = &xtaps[x];
+
+			if ( swdata->filter == SDL_STRETCH_NEAREST ) {
+				L = lum0[tap->lum[0]];
+				cr = cr0[tap->chroma[0]];
+				cb = cb0[tap->chroma[0]];
+			} else {
+				L = YUV_BILERP(lum0, lum1, tap->lum,
+				               tap->lum_weight, ly);
+				cr = YUV_BILERP(cr0, cr1, tap->chroma,
+				                tap->chroma_weight, cy);
+				cb = YUV_BILERP(cb0, cb1, tap->chroma,
+				                tap->chroma_weight, cy);
+			}
+			row[x] = rgb_2_pix[ L + 0*768+256 + colortab[cr + 0*256] ] |
+			         rgb_2_pix[ L + 1*768+256 + colortab[cr + 1*256]
+			                                  + colortab[cb + 2*256] ] |
+			         rgb_2_pix[ L + 2*768+256 + colortab[cb + 3*256] ];
+		}
+
+		switch (frame->bpp) {
+		    case 2:
+			for ( x=0; x<frame->cols; ++x ) {
+				((Uint16 *)dstp)[x] = (Uint16)row[x];
+			}
+			break;
+		    case 3:
+			for ( x=0; x<frame->cols; ++x ) {
+				dstp[x*3+0] = (row[x]      ) & 0xFF;
+				dstp[x*3+1] = (row[x] >>  8) & 0xFF;
+				dstp[x*3+2] = (row[x] >> 16) & 0xFF;
+			}
+			break;
+		    case 4:
+			SDL_memcpy(dstp, row, frame->cols * 4);
+			break;
+		}
+		dstp += frame->dst_pitch;
+	}
+}
+
+/* Convert one band of the frame.  The fixed size converters get whole
+   pairs of rows, which share a row of chroma in the planar formats.
+ */
+static void SDL_RunYUVBand(void *data, int band, int nbands)
+{
+	const SDL_YUVFrame *frame = (const SDL_YUVFrame *)data;
+	const struct private_yuvhwdata *swdata = frame->swdata;
+	int first, last, chroma;
+	Uint32 *rows;
+
+	if ( frame->convert == NULL ) {
+		first = (frame->rows * band) / nbands;
+		last = (frame->rows * (band+1)) / nbands;
+		rows = swdata->rows + band * frame->row_size;
+		if ( frame->convert_rows ) {
+			SDL_ScaleYUVRowsNearest(frame, first, last, (Uint8 *)rows);
+		} else {
+			SDL_ScaleYUVRows(frame, first, last, rows);
+		}
+		return;
+	}
+
+	first = 2 * (((frame->rows / 2) * band) / nbands);
+	if ( band == nbands-1 ) {
+		last = frame->rows;
+	} else {
+		last = 2 * (((frame->rows / 2) * (band+1)) / nbands);
+	}
+	if ( frame->chroma_step < 4 ) {
+		chroma = (first / 2) * frame->chroma_pitch;
+	} else {
+		chroma = first * frame->chroma_pitch;
+	}
+	frame->convert(swdata->colortab, swdata->rgb_2_pix,
+	               frame->lum + first * frame->lum_pitch,
+	               frame->cr + chroma, frame->cb + chroma,
+	               frame->out + first * frame->scale * frame->dst_pitch,
+	               last - first, frame->cols, frame->mod,
+	               frame->lum_pitch, frame->chroma_pitch,
+	               frame->chroma_step);
+}
+
 int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 {
 	struct private_yuvhwdata *swdata;
+	SDL_YUVFrame *frame;
 	int stretch;
 	int scale_2x;
 	SDL_Surface *display;
-	Uint8 *lum, *Cr, *Cb;
-	Uint8 *dstp;
-	int mod;
+	int bands;
 
 	swdata = overlay->hwdata;
+	frame = &swdata->frame;
+	SDL_FinishYUV_SW(swdata);
+
 	stretch = 0;
 	scale_2x = 0;
 	if ( src->x || src->y || src->w < overlay->w || src->h < overlay->h ) {
 		/* The source rectangle has been clipped.
-		   Using a scratch surface is easier than adding clipped
-		   source support to all the blitters, plus that would
-		   slow them down in the general unclipped case.
+		   The general scaler reads just the visible part, which
+		   keeps the fixed size converters fast for the usual case.
 		*/
 		stretch = 1;
 	} else if ( (src->w != dst->w) || (src->h != dst->h) ) {
@@ -1192,84 +1876,109 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 			stretch = 1;
 		}
 	}
-	if ( stretch ) {
-		if ( ! swdata->stretch ) {
-			display = swdata->display;
-			swdata->stretch = SDL_CreateRGBSurface(
-				SDL_SWSURFACE,
-				overlay->w, overlay->h,
-				display->format->BitsPerPixel,
-				display->format->Rmask,
-				display->format->Gmask,
-				display->format->Bmask, 0);
-			if ( ! swdata->stretch ) {
-				return(-1);
-			}
-		}
-		display = swdata->stretch;
-	} else {
-		display = swdata->display;
-	}
+	display = swdata->display;
+	frame->swdata = swdata;
+	frame->lum_pitch = overlay->pitches[0];
+	frame->chroma_pitch = overlay->pitches[0];
+	frame->chroma_step = 4;
 	switch (overlay->format) {
 	    case SDL_YV12_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr =  overlay->pixels[1];
-		Cb =  overlay->pixels[2];
+		frame->lum = overlay->pixels[0];
+		frame->cr =  overlay->pixels[1];
+		frame->cb =  overlay->pixels[2];
+		frame->chroma_pitch = overlay->pitches[1];
+		frame->chroma_step = 1;
 		break;
 	    case SDL_IYUV_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr =  overlay->pixels[2];
-		Cb =  overlay->pixels[1];
+		frame->lum = overlay->pixels[0];
+		frame->cr =  overlay->pixels[2];
+		frame->cb =  overlay->pixels[1];
+		frame->chroma_pitch = overlay->pitches[1];
+		frame->chroma_step = 1;
+		break;
+	    case SDL_NV12_OVERLAY:
+		frame->lum = overlay->pixels[0];
+		frame->cr =  overlay->pixels[1] + 1;
+		frame->cb =  overlay->pixels[1];
+		frame->chroma_pitch = overlay->pitches[1];
+		frame->chroma_step = 2;
+		break;
+	    case SDL_NV21_OVERLAY:
+		frame->lum = overlay->pixels[0];
+		frame->cr =  overlay->pixels[1];
+		frame->cb =  overlay->pixels[1] + 1;
+		frame->chroma_pitch = overlay->pitches[1];
+		frame->chroma_step = 2;
 		break;
 	    case SDL_YUY2_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr = lum + 3;
-		Cb = lum + 1;
+		frame->lum = overlay->pixels[0];
+		frame->cr = frame->lum + 3;
+		frame->cb = frame->lum + 1;
 		break;
 	    case SDL_UYVY_OVERLAY:
-		lum = overlay->pixels[0]+1;
-		Cr = lum + 1;
-		Cb = lum - 1;
+		frame->lum = overlay->pixels[0]+1;
+		frame->cr = frame->lum + 1;
+		frame->cb = frame->lum - 1;
 		break;
 	    case SDL_YVYU_OVERLAY:
-		lum = overlay->pixels[0];
-		Cr = lum + 1;
-		Cb = lum + 3;
+		frame->lum = overlay->pixels[0];
+		frame->cr = frame->lum + 1;
+		frame->cb = frame->lum + 3;
 		break;
 	    default:
 		SDL_SetError("Unsupported YUV format in blit");
 		return(-1);
 	}
+	frame->src_h = overlay->h;
+	frame->bpp = display->format->BytesPerPixel;
+	frame->dst_pitch = display->pitch;
+	frame->mod = (display->pitch / display->format->BytesPerPixel);
+	if ( stretch ) {
+		frame->convert = NULL;
+		frame->rows = dst->h;
+		frame->cols = dst->w;
+		bands = SDL_GetWorkerBands(SDL_WORKER_PIXELS(dst->w, dst->h),
+		                           dst->h);
+		if ( SDL_SetupYUVScale(swdata, overlay, src, dst, bands) < 0 ) {
+			return(-1);
+		}
+	} else {
+		frame->rows = overlay->h;
+		frame->cols = overlay->w;
+		if ( scale_2x ) {
+			frame->convert = swdata->Display2X;
+			frame->scale = 2;
+		} else {
+			frame->convert = swdata->Display1X;
+			frame->scale = 1;
+		}
+		frame->mod -= (overlay->w * frame->scale);
+		bands = SDL_GetWorkerBands(SDL_WORKER_PIXELS(dst->w, dst->h),
+		                           overlay->h / 2);
+	}
+
 	if ( SDL_MUSTLOCK(display) ) {
         	if ( SDL_LockSurface(display) < 0 ) {
 			return(-1);
 		}
 	}
-	if ( stretch ) {
-		dstp = (Uint8 *)swdata->stretch->pixels;
-	} else {
-		dstp = (Uint8 *)display->pixels
-			+ dst->x * display->format->BytesPerPixel
-			+ dst->y * display->pitch;
+	frame->out = (Uint8 *)display->pixels
+		+ dst->x * display->format->BytesPerPixel
+		+ dst->y * display->pitch;
+
+	/* The display can't stay locked while the caller goes on */
+	if ( swdata->async && ! SDL_MUSTLOCK(display) &&
+	     SDL_QueueWorkers(SDL_RunYUVBand, frame, bands) ) {
+		swdata->pending = 1;
+		swdata->pending_rect = *dst;
+		pending_swdata = swdata;
+		return(0);
 	}
-	mod = (display->pitch / display->format->BytesPerPixel);
+	SDL_RunWorkers(SDL_RunYUVBand, frame, bands);
 
-	if ( scale_2x ) {
-		mod -= (overlay->w * 2);
-		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
-	} else {
-		mod -= overlay->w;
-		swdata->Display1X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
-	}
 	if ( SDL_MUSTLOCK(display) ) {
 		SDL_UnlockSurface(display);
 	}
-	if ( stretch ) {
-		display = swdata->display;
-		SDL_SoftStretch(swdata->stretch, src, display, dst);
-	}
 	SDL_UpdateRects(display, 1, dst);
 
 	return(0);
@@ -1281,8 +1990,12 @@ void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay)
 
 	swdata = overlay->hwdata;
 	if ( swdata ) {
-		if ( swdata->stretch ) {
-			SDL_FreeSurface(swdata->stretch);
+		SDL_FinishYUV_SW(swdata);
+		if ( swdata->taps ) {
+			SDL_free(swdata->taps);
+		}
+		if ( swdata->rows ) {
+			SDL_free(swdata->rows);
 		}
 		if ( swdata->pixels ) {
 			SDL_free(swdata->pixels);
@@ -28,6 +28,9 @@
 
 extern SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_Surface *display);
 
+/* Create an overlay on planes owned by the caller, or allocate them if NULL */
+extern SDL_Overlay *SDL_CreateYUVFrom_SW(_THIS, int width, int height, Uint32 format, Uint8 **pixels, Uint16 *pitches, SDL_Surface *display);
+
 extern int SDL_LockYUV_SW(_THIS, SDL_Overlay *overlay);
 
 extern void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay);
@@ -35,3 +38,7 @@ extern void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay);
 extern int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst);
 
 extern void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay);
+
+/* Finish the frame an overlay is drawing into the screen in the
+   background, before the screen is changed or freed */
+extern void SDL_FinishPendingYUV_SW(void);
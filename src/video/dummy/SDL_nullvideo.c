@@ -63,6 +63,7 @@ static void DUMMY_FreeHWSurface(_THIS, SDL_Surface *surface);
 
 /* etc. */
 static void DUMMY_UpdateRects(_THIS, int numrects, SDL_Rect *rects);
+static int DUMMY_GetPresentStats(_THIS, SDL_PresentStats *stats);
 
 /* DUMMY driver bootstrap functions */
 
@@ -109,6 +110,7 @@ static SDL_VideoDevice *DUMMY_CreateDevice(int devindex)
 	device->CreateYUVOverlay = NULL;
 	device->SetColors = DUMMY_SetColors;
 	device->UpdateRects = DUMMY_UpdateRects;
+	device->GetPresentStats = DUMMY_GetPresentStats;
 	device->VideoQuit = DUMMY_VideoQuit;
 	device->AllocHWSurface = DUMMY_AllocHWSurface;
 	device->CheckHWBlit = NULL;
@@ -189,6 +191,7 @@ SDL_Surface *DUMMY_SetVideoMode(_THIS, SDL_Surface *current,
 	this->hidden->h = current->h = height;
 	current->pitch = current->w * (bpp / 8);
 	current->pixels = this->hidden->buffer;
+	this->hidden->frames = 0;
 
 	/* We're done */
 	return(current);
@@ -217,7 +220,16 @@ static void DUMMY_UnlockHWSurface(_THIS, SDL_Surface *surface)
 
 static void DUMMY_UpdateRects(_THIS, int numrects, SDL_Rect *rects)
 {
-	/* do nothing. */
+	/* do nothing but count it. */
+	++this->hidden->frames;
+}
+
+static int DUMMY_GetPresentStats(_THIS, SDL_PresentStats *stats)
+{
+	stats->buffers = 1;
+	stats->frames = this->hidden->frames;
+	stats->completed = this->hidden->frames;
+	return(0);
 }
 
 int DUMMY_SetColors(_THIS, int firstcolor, int ncolors, SDL_Color *colors)
@@ -35,6 +35,7 @@
 struct SDL_PrivateVideoData {
     int w, h;
     void *buffer;
+    Uint32 frames;
 };
 
 #endif /* _SDL_nullvideo_h */
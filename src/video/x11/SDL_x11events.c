@@ -391,6 +391,39 @@ static __inline__ int X11_WarpedMotion(_THIS, XEvent *xevent)
 	return(posted);
 }
 
+/* Fold the motion events queued right behind this one into it, so a
+   high rate mouse doesn't fill the SDL event queue.  The last position
+   gives the sum of the relative motion, except for DGA motion, which is
+   relative already and is added up.
+ */
+static void X11_CompressMotion(_THIS, XEvent *xevent)
+{
+	XEvent next;
+	int dga_motion;
+	int coalesced;
+
+	dga_motion = (mouse_relative && (using_dga & DGA_MOUSE));
+	coalesced = 0;
+	while ( XEventsQueued(SDL_Display, QueuedAlready) ) {
+		XPeekEvent(SDL_Display, &next);
+		if ( (next.type != MotionNotify) ||
+		     (next.xmotion.window != xevent->xmotion.window) ||
+		     (next.xmotion.state != xevent->xmotion.state) ) {
+			break;
+		}
+		XNextEvent(SDL_Display, &next);
+		if ( dga_motion ) {
+			next.xmotion.x_root += xevent->xmotion.x_root;
+			next.xmotion.y_root += xevent->xmotion.y_root;
+		}
+		*xevent = next;
+		++coalesced;
+	}
+	if ( coalesced ) {
+		SDL_PrivateEventsCoalesced(coalesced);
+	}
+}
+
 static int X11_DispatchEvent(_THIS)
 {
 	int posted;
@@ -553,6 +586,9 @@ printf("KeymapNotify!\n");
 
 	    /* Mouse motion? */
 	    case MotionNotify: {
+		if ( motion_compress ) {
+			X11_CompressMotion(this, &xevent);
+		}
 		if ( SDL_VideoSurface ) {
 			if ( mouse_relative ) {
 				if ( using_dga & DGA_MOUSE ) {
@@ -982,8 +1018,12 @@ void X11_PumpEvents(_THIS)
 	/* Keep processing pending events */
 	pending = 0;
 	while ( X11_Pending(SDL_Display) ) {
-		X11_DispatchEvent(this);
-		++pending;
+		/* Handle all the events read so far before flushing again */
+		do {
+			X11_DispatchEvent(this);
+			++pending;
+		} while ( motion_compress &&
+			  XEventsQueued(SDL_Display, QueuedAlready) );
 	}
 	if ( switch_waiting ) {
 		Uint32 now;
@@ -25,6 +25,7 @@
 #include <unistd.h>
 
 #include "SDL_endian.h"
+#include "SDL_timer.h"
 #include "../../events/SDL_events_c.h"
 #include "SDL_x11image_c.h"
 
@@ -42,39 +43,221 @@ static int shm_errhandler(Display *d, XErrorEvent *e)
 		return(X_handler(d,e));
 }
 
-static void try_mitshm(_THIS, SDL_Surface *screen)
+/* Create a shared memory segment and attach it to the X server */
+static int attach_mitshm(_THIS, XShmSegmentInfo *info, int size)
 {
-	/* Dynamic X11 may not have SHM entry points on this box. */
-	if ((use_mitshm) && (!SDL_X11_HAVE_SHM))
-		use_mitshm = 0;
-
-	if(!use_mitshm)
-		return;
-	shminfo.shmid = shmget(IPC_PRIVATE, screen->h*screen->pitch,
-			       IPC_CREAT | 0777);
-	if ( shminfo.shmid >= 0 ) {
-		shminfo.shmaddr = (char *)shmat(shminfo.shmid, 0, 0);
-		shminfo.readOnly = False;
-		if ( shminfo.shmaddr != (char *)-1 ) {
+	info->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0777);
+	if ( info->shmid >= 0 ) {
+		info->shmaddr = (char *)shmat(info->shmid, 0, 0);
+		info->readOnly = False;
+		if ( info->shmaddr != (char *)-1 ) {
 			shm_error = False;
 			X_handler = XSetErrorHandler(shm_errhandler);
-			XShmAttach(SDL_Display, &shminfo);
+			XShmAttach(SDL_Display, info);
 			XSync(SDL_Display, False);
 			XSetErrorHandler(X_handler);
 			if ( shm_error )
-				shmdt(shminfo.shmaddr);
+				shmdt(info->shmaddr);
 		} else {
 			shm_error = True;
 		}
-		shmctl(shminfo.shmid, IPC_RMID, NULL);
+		shmctl(info->shmid, IPC_RMID, NULL);
 	} else {
 		shm_error = True;
 	}
-	if ( shm_error )
+	return(shm_error ? -1 : 0);
+}
+
+static void try_mitshm(_THIS, SDL_Surface *screen)
+{
+	/* Dynamic X11 may not have SHM entry points on this box. */
+	if ((use_mitshm) && (!SDL_X11_HAVE_SHM))
+		use_mitshm = 0;
+
+	if(!use_mitshm)
+		return;
+	if ( attach_mitshm(this, &shminfo, screen->h*screen->pitch) < 0 )
 		use_mitshm = 0;
 	if ( use_mitshm )
 		screen->pixels = shminfo.shmaddr;
 }
+
+/* Multi-buffered updates.
+
+   With SDL_VIDEO_X11_SHM_BUFFERS=2 or 3 the screen is drawn in one of that
+   many shared images.  An update asks the server for a ShmCompletion event
+   instead of waiting for it, and the application goes on drawing in the
+   next image while the server is still reading the last one.  It only
+   waits when it comes back around to an image the server hasn't released.
+
+   The new image is brought up to date by copying what the other images
+   showed since it was last drawn in, unless SDL_DOUBLEBUF was asked for,
+   which means the application redraws the whole screen every frame.
+*/
+static void X11_MultiSHMUpdate(_THIS, int numrects, SDL_Rect *rects);
+
+static void setup_shm_buffers(_THIS, SDL_Surface *screen)
+{
+	const char *env;
+	int i, size;
+
+	shm_nbuffers = 1;
+	shm_current = 0;
+	shm_front = 0;
+	env = SDL_getenv("SDL_VIDEO_X11_SHM_BUFFERS");
+	if ( env ) {
+		shm_nbuffers = SDL_atoi(env);
+	}
+	if ( shm_nbuffers <= 1 ) {
+		shm_nbuffers = 1;
+		return;
+	}
+	if ( shm_nbuffers > MAX_SHM_BUFFERS ) {
+		shm_nbuffers = MAX_SHM_BUFFERS;
+	}
+	shm_completion = XShmGetEventBase(GFX_Display) + ShmCompletion;
+
+	SDL_memset(shm_buffers, 0, sizeof(shm_buffers));
+	shm_buffers[0].info = shminfo;
+	shm_buffers[0].image = SDL_Ximage;
+	size = screen->h*SDL_Ximage->bytes_per_line;
+	for ( i=1; i<shm_nbuffers; ++i ) {
+		XImage *image;
+
+		if ( attach_mitshm(this, &shm_buffers[i].info, size) < 0 ) {
+			break;
+		}
+		image = XShmCreateImage(SDL_Display, SDL_Visual,
+					this->hidden->depth, ZPixmap,
+					shm_buffers[i].info.shmaddr,
+					&shm_buffers[i].info,
+					screen->w, screen->h);
+		if ( ! image ) {
+			XShmDetach(SDL_Display, &shm_buffers[i].info);
+			XSync(SDL_Display, False);
+			shmdt(shm_buffers[i].info.shmaddr);
+			break;
+		}
+		shm_buffers[i].image = image;
+	}
+	/* Make do with the images we could get */
+	shm_nbuffers = i;
+	if ( shm_nbuffers > 1 ) {
+		this->UpdateRects = X11_MultiSHMUpdate;
+	}
+}
+
+/* Mark the image an ShmCompletion event is about as free */
+static void shm_completed(_THIS, XEvent *event)
+{
+	XShmCompletionEvent *done = (XShmCompletionEvent *)event;
+	Uint32 latency;
+	int i;
+
+	for ( i=0; i<shm_nbuffers; ++i ) {
+		if ( shm_buffers[i].busy &&
+		     shm_buffers[i].info.shmseg == done->shmseg ) {
+			shm_buffers[i].busy = 0;
+			latency = SDL_GetTicks() - shm_buffers[i].sent;
+			present_stats.completed++;
+			present_stats.latency_ms += latency;
+			if ( latency > present_stats.max_latency_ms ) {
+				present_stats.max_latency_ms = latency;
+			}
+			break;
+		}
+	}
+}
+
+static Bool is_shm_completion(Display *display, XEvent *event, XPointer arg)
+{
+	return(event->type == *(int *)arg);
+}
+
+/* Block until the server is done with an image */
+static void wait_shm_buffer(_THIS, int which)
+{
+	XEvent event;
+
+	while ( shm_buffers[which].busy ) {
+		XIfEvent(GFX_Display, &event, is_shm_completion,
+			 (XPointer)&shm_completion);
+		shm_completed(this, &event);
+	}
+}
+
+/* Copy the rectangles from one image to another */
+static void copy_shm_rects(_THIS, XImage *dst, XImage *src,
+			   int numrects, SDL_Rect *rects)
+{
+	SDL_Surface *screen = SDL_VideoSurface;
+	int bpp = screen->format->BytesPerPixel;
+	int pitch = src->bytes_per_line;
+	int i, x, y, w, h;
+	Uint8 *srcp, *dstp;
+
+	for ( i=0; i<numrects; ++i ) {
+		x = rects[i].x;
+		y = rects[i].y;
+		w = rects[i].w;
+		h = rects[i].h;
+		if ( x + w > screen->w ) w = screen->w - x;
+		if ( y + h > screen->h ) h = screen->h - y;
+		if ( w <= 0 || h <= 0 ) {
+			continue;
+		}
+		srcp = (Uint8 *)src->data + y*pitch + x*bpp;
+		dstp = (Uint8 *)dst->data + y*pitch + x*bpp;
+		while ( h-- ) {
+			SDL_memcpy(dstp, srcp, w*bpp);
+			srcp += pitch;
+			dstp += pitch;
+		}
+	}
+}
+
+/* Remember what an image showed, so it can be copied to the next ones */
+static void save_shm_rects(_THIS, int which, int numrects, SDL_Rect *rects)
+{
+	SDL_Rect *saved;
+
+	if ( numrects > shm_buffers[which].maxrects ) {
+		saved = (SDL_Rect *)SDL_realloc(shm_buffers[which].rects,
+						numrects*sizeof(*saved));
+		if ( saved == NULL ) {
+			/* Copy the whole screen instead */
+			shm_buffers[which].numrects = -1;
+			return;
+		}
+		shm_buffers[which].rects = saved;
+		shm_buffers[which].maxrects = numrects;
+	}
+	SDL_memcpy(shm_buffers[which].rects, rects, numrects*sizeof(*rects));
+	shm_buffers[which].numrects = numrects;
+}
+
+static void free_shm_buffers(_THIS)
+{
+	XEvent event;
+	int i;
+
+	/* Let the server finish with the images and drop the completions */
+	XSync(GFX_Display, False);
+	while ( XCheckTypedEvent(GFX_Display, shm_completion, &event) ) {
+		continue;
+	}
+	for ( i=0; i<shm_nbuffers; ++i ) {
+		XDestroyImage(shm_buffers[i].image);
+		XShmDetach(SDL_Display, &shm_buffers[i].info);
+		XSync(SDL_Display, False);
+		shmdt(shm_buffers[i].info.shmaddr);
+		if ( shm_buffers[i].rects ) {
+			SDL_free(shm_buffers[i].rects);
+		}
+	}
+	SDL_memset(shm_buffers, 0, sizeof(shm_buffers));
+	shm_nbuffers = 1;
+}
 #endif /* ! NO_SHARED_MEMORY */
 
 /* Various screen update functions available */
@@ -98,6 +281,7 @@ int X11_SetupImage(_THIS, SDL_Surface *screen)
 			goto error;
 		}
 		this->UpdateRects = X11_MITSHMUpdate;
+		setup_shm_buffers(this, screen);
 	}
 	if(!use_mitshm)
 #endif /* not NO_SHARED_MEMORY */
@@ -120,6 +304,7 @@ int X11_SetupImage(_THIS, SDL_Surface *screen)
 		this->UpdateRects = X11_NormalUpdate;
 	}
 	screen->pitch = SDL_Ximage->bytes_per_line;
+	SDL_memset(&present_stats, 0, sizeof(present_stats));
 	return(0);
 
 error:
@@ -129,6 +314,12 @@ error:
 
 void X11_DestroyImage(_THIS, SDL_Surface *screen)
 {
+#ifndef NO_SHARED_MEMORY
+	if ( SDL_Ximage && (shm_nbuffers > 1) ) {
+		free_shm_buffers(this);
+		SDL_Ximage = NULL;
+	}
+#endif /* ! NO_SHARED_MEMORY */
 	if ( SDL_Ximage ) {
 		XDestroyImage(SDL_Ximage);
 #ifndef NO_SHARED_MEMORY
@@ -202,6 +393,25 @@ int X11_ResizeImage(_THIS, SDL_Surface *screen, Uint32 flags)
 	return(retval);
 }
 
+/* Called on every mode set, since SDL_DOUBLEBUF can change without the
+   image being made again.
+ */
+void X11_SetImageFlags(_THIS, Uint32 flags)
+{
+#ifndef NO_SHARED_MEMORY
+	int redraw = ((flags & SDL_DOUBLEBUF) == SDL_DOUBLEBUF);
+	int i;
+
+	if ( shm_redraw && !redraw ) {
+		/* Nothing was saved while the application redrew it all */
+		for ( i=0; i<shm_nbuffers; ++i ) {
+			shm_buffers[i].numrects = -1;
+		}
+	}
+	shm_redraw = redraw;
+#endif
+}
+
 /* We don't actually allow hardware surfaces other than the main one */
 int X11_AllocHWSurface(_THIS, SDL_Surface *surface)
 {
@@ -230,6 +440,30 @@ int X11_FlipHWSurface(_THIS, SDL_Surface *surface)
 	return(0);
 }
 
+/* Send the update, and wait for the server to show it unless the
+   application asked for asynchronous blits
+ */
+static void X11_FinishUpdate(_THIS)
+{
+	Uint32 then, latency;
+
+	++present_stats.frames;
+	if ( SDL_VideoSurface->flags & SDL_ASYNCBLIT ) {
+		XFlush(GFX_Display);
+		blit_queued = 1;
+	} else {
+		then = SDL_GetTicks();
+		XSync(GFX_Display, False);
+		latency = SDL_GetTicks() - then;
+		++present_stats.completed;
+		present_stats.latency_ms += latency;
+		present_stats.stall_ms += latency;
+		if ( latency > present_stats.max_latency_ms ) {
+			present_stats.max_latency_ms = latency;
+		}
+	}
+}
+
 static void X11_NormalUpdate(_THIS, int numrects, SDL_Rect *rects)
 {
 	int i;
@@ -242,12 +476,7 @@ static void X11_NormalUpdate(_THIS, int numrects, SDL_Rect *rects)
 			  rects[i].x, rects[i].y,
 			  rects[i].x, rects[i].y, rects[i].w, rects[i].h);
 	}
-	if ( SDL_VideoSurface->flags & SDL_ASYNCBLIT ) {
-		XFlush(GFX_Display);
-		blit_queued = 1;
-	} else {
-		XSync(GFX_Display, False);
-	}
+	X11_FinishUpdate(this);
 }
 
 static void X11_MITSHMUpdate(_THIS, int numrects, SDL_Rect *rects)
@@ -264,15 +493,99 @@ static void X11_MITSHMUpdate(_THIS, int numrects, SDL_Rect *rects)
 				rects[i].x, rects[i].y, rects[i].w, rects[i].h,
 									False);
 	}
-	if ( SDL_VideoSurface->flags & SDL_ASYNCBLIT ) {
-		XFlush(GFX_Display);
-		blit_queued = 1;
-	} else {
-		XSync(GFX_Display, False);
+	X11_FinishUpdate(this);
+#endif /* ! NO_SHARED_MEMORY */
+}
+
+static void X11_MultiSHMUpdate(_THIS, int numrects, SDL_Rect *rects)
+{
+#ifndef NO_SHARED_MEMORY
+	XEvent event;
+	XImage *image = SDL_Ximage;
+	Uint32 then;
+	int i, last, next;
+
+	/* The last rectangle put asks for the completion event */
+	for ( last=numrects-1; last>=0; --last ) {
+		if ( rects[last].w && rects[last].h ) {
+			break;
+		}
+	}
+	if ( last < 0 ) {
+		return;
+	}
+	for ( i=0; i<=last; ++i ) {
+		if ( rects[i].w == 0 || rects[i].h == 0 ) { /* Clipped? */
+			continue;
+		}
+		XShmPutImage(GFX_Display, SDL_Window, SDL_GC, image,
+				rects[i].x, rects[i].y,
+				rects[i].x, rects[i].y, rects[i].w, rects[i].h,
+				(i == last));
+	}
+	XFlush(GFX_Display);
+	shm_buffers[shm_current].busy = 1;
+	shm_buffers[shm_current].sent = SDL_GetTicks();
+	++present_stats.frames;
+	if ( ! shm_redraw ) {
+		save_shm_rects(this, shm_current, last+1, rects);
+	}
+	shm_front = shm_current;
+
+	/* Pick up whatever the server has finished, then take the next image */
+	while ( XCheckTypedEvent(GFX_Display, shm_completion, &event) ) {
+		shm_completed(this, &event);
+	}
+	next = (shm_current + 1) % shm_nbuffers;
+	if ( shm_buffers[next].busy ) {
+		then = SDL_GetTicks();
+		wait_shm_buffer(this, next);
+		++present_stats.stalls;
+		present_stats.stall_ms += SDL_GetTicks() - then;
 	}
+
+	/* Bring it up to date with what was shown since it was drawn in */
+	if ( ! shm_redraw ) {
+		for ( i=0; i<shm_nbuffers; ++i ) {
+			SDL_Rect all;
+
+			if ( i == next ) {
+				continue;
+			}
+			if ( shm_buffers[i].numrects < 0 ) {
+				all.x = 0;
+				all.y = 0;
+				all.w = SDL_VideoSurface->w;
+				all.h = SDL_VideoSurface->h;
+				copy_shm_rects(this, shm_buffers[next].image,
+					       image, 1, &all);
+			} else {
+				copy_shm_rects(this, shm_buffers[next].image,
+					       image, shm_buffers[i].numrects,
+					       shm_buffers[i].rects);
+			}
+		}
+	}
+
+	shm_current = next;
+	shminfo = shm_buffers[next].info;
+	SDL_Ximage = shm_buffers[next].image;
+	SDL_VideoSurface->pixels = SDL_Ximage->data;
 #endif /* ! NO_SHARED_MEMORY */
 }
 
+int X11_GetPresentStats(_THIS, SDL_PresentStats *stats)
+{
+	*stats = present_stats;
+	stats->buffers = 1;
+#ifndef NO_SHARED_MEMORY
+	if ( SDL_Ximage && (shm_nbuffers > 1) ) {
+		stats->buffers = shm_nbuffers;
+	}
+#endif
+	return(0);
+}
+
 /* There's a problem with the automatic refreshing of the display.
    Even though the XVideo code uses the GFX_Display to update the
    video memory, it appears that updating the window asynchronously
@@ -301,7 +614,13 @@ void X11_RefreshDisplay(_THIS)
 		return;
 	}
 #ifndef NO_SHARED_MEMORY
-	if ( this->UpdateRects == X11_MITSHMUpdate ) {
+	if ( this->UpdateRects == X11_MultiSHMUpdate ) {
+		/* The image being drawn in may be half done */
+		XShmPutImage(SDL_Display, SDL_Window, SDL_GC,
+				shm_buffers[shm_front].image,
+				0, 0, 0, 0, this->screen->w, this->screen->h,
+				False);
+	} else if ( this->UpdateRects == X11_MITSHMUpdate ) {
 		XShmPutImage(SDL_Display, SDL_Window, SDL_GC, SDL_Ximage,
 				0, 0, 0, 0, this->screen->w, this->screen->h,
 				False);
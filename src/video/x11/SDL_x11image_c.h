@@ -26,6 +26,7 @@
 extern int X11_SetupImage(_THIS, SDL_Surface *screen);
 extern void X11_DestroyImage(_THIS, SDL_Surface *screen);
 extern int X11_ResizeImage(_THIS, SDL_Surface *screen, Uint32 flags);
+extern void X11_SetImageFlags(_THIS, Uint32 flags);
 
 extern int X11_AllocHWSurface(_THIS, SDL_Surface *surface);
 extern void X11_FreeHWSurface(_THIS, SDL_Surface *surface);
@@ -36,3 +37,5 @@ extern int X11_FlipHWSurface(_THIS, SDL_Surface *surface);
 extern void X11_DisableAutoRefresh(_THIS);
 extern void X11_EnableAutoRefresh(_THIS);
 extern void X11_RefreshDisplay(_THIS);
+
+extern int X11_GetPresentStats(_THIS, SDL_PresentStats *stats);
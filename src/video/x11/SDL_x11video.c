@@ -140,6 +140,7 @@ static SDL_VideoDevice *X11_CreateDevice(int devindex)
 #endif
 		device->SetColors = X11_SetColors;
 		device->UpdateRects = NULL;
+		device->GetPresentStats = X11_GetPresentStats;
 		device->VideoQuit = X11_VideoQuit;
 		device->AllocHWSurface = X11_AllocHWSurface;
 		device->CheckHWBlit = NULL;
@@ -705,6 +706,10 @@ static int X11_VideoInit(_THIS, SDL_PixelFormat *vformat)
 #endif
 	}
 
+	/* Allow collapsing mouse motion from high rate mice */
+	env = SDL_getenv("SDL_VIDEO_X11_MOTION_COMPRESS");
+	motion_compress = ( env && SDL_atoi(env) > 0 );
+
 	/* See if we have been passed a window to use */
 	SDL_windowid = SDL_getenv("SDL_WINDOWID");
 
@@ -1237,6 +1242,7 @@ SDL_Surface *X11_SetVideoMode(_THIS, SDL_Surface *current,
 			goto done;
 		}
 	}
+	X11_SetImageFlags(this, flags);
 
 	/* Clear these flags and set them only if they are in the new set. */
 	current->flags &= ~(SDL_RESIZABLE|SDL_NOFRAME);
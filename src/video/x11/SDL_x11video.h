@@ -52,6 +52,9 @@
 /* Hidden "this" pointer for the video functions */
 #define _THIS	SDL_VideoDevice *this
 
+/* The most screen images SDL_VIDEO_X11_SHM_BUFFERS can ask for */
+#define MAX_SHM_BUFFERS	3
+
 /* Private display data */
 struct SDL_PrivateVideoData {
     int local_X11;		/* Flag: true if local display */
@@ -75,8 +78,28 @@ struct SDL_PrivateVideoData {
     /* MIT shared memory extension information */
     int use_mitshm;
     XShmSegmentInfo shminfo;
+
+    /* Screen images in rotation with SDL_VIDEO_X11_SHM_BUFFERS,
+       shminfo and Ximage are always those of the one being drawn in */
+    struct {
+        XShmSegmentInfo info;
+        XImage *image;
+        int busy;		/* Flag: the server may still be reading it */
+        Uint32 sent;		/* SDL_GetTicks() when it was shown */
+        SDL_Rect *rects;	/* What was shown from it */
+        int numrects;
+        int maxrects;
+    } shm_buffers[MAX_SHM_BUFFERS];
+    int shm_nbuffers;		/* 0 or 1 if there is just the one image */
+    int shm_current;		/* The image being drawn in */
+    int shm_front;		/* The image shown last */
+    int shm_redraw;		/* Flag: the application redraws every frame */
+    int shm_completion;		/* The ShmCompletion event type */
 #endif
 
+    /* Counters for SDL_GetPresentStats() */
+    SDL_PresentStats present_stats;
+
     /* The variables used for displaying graphics */
     XImage *Ximage;		/* The X image for our window */
     GC	gc;			/* The graphic context for drawing */
@@ -154,6 +177,9 @@ struct SDL_PrivateVideoData {
 
     /* Screensaver settings */
     int allow_screensaver;
+
+    /* Flag: fold queued mouse motion into one event */
+    int motion_compress;
 };
 
 /* Old variable names */
@@ -174,6 +200,13 @@ struct SDL_PrivateVideoData {
 #define using_dga		(this->hidden->using_dga)
 #define use_mitshm		(this->hidden->use_mitshm)
 #define shminfo			(this->hidden->shminfo)
+#define shm_buffers		(this->hidden->shm_buffers)
+#define shm_nbuffers		(this->hidden->shm_nbuffers)
+#define shm_current		(this->hidden->shm_current)
+#define shm_front		(this->hidden->shm_front)
+#define shm_redraw		(this->hidden->shm_redraw)
+#define shm_completion		(this->hidden->shm_completion)
+#define present_stats		(this->hidden->present_stats)
 #define SDL_Ximage		(this->hidden->Ximage)
 #define SDL_GC			(this->hidden->gc)
 #define window_w		(this->hidden->window_w)
@@ -205,6 +238,7 @@ struct SDL_PrivateVideoData {
 #define gamma_changed		(this->hidden->gamma_changed)
 #define SDL_iconcolors		(this->hidden->iconcolors)
 #define allow_screensaver	(this->hidden->allow_screensaver)
+#define motion_compress		(this->hidden->motion_compress)
 
 /* Some versions of XFree86 have bugs - detect if this is one of them */
 #define BUGGY_XFREE86(condition, buggy_version) \
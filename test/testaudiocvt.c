@@ -0,0 +1,201 @@
+/* Time SDL_ConvertAudio() between every pair of 8 and 16 bit formats,
+   mono and stereo, with the single pass conversions and with the chain
+   of filters they replace (SDL_AUDIO_FUSED_CONVERT=0), and check that
+   both give the same samples.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int frames = 4096;
+static int iterations = 500;
+static int src_rate = 22050;
+static int dst_rate = 44100;
+
+static const struct {
+	Uint16 format;
+	const char *name;
+} formats[] = {
+	{ AUDIO_U8, "U8" },
+	{ AUDIO_S8, "S8" },
+	{ AUDIO_U16LSB, "U16LSB" },
+	{ AUDIO_S16LSB, "S16LSB" },
+	{ AUDIO_U16MSB, "U16MSB" },
+	{ AUDIO_S16MSB, "S16MSB" }
+};
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+	"Usage: %s [-frames N] [-iterations N] [-rates from to]\n", argv0);
+	quit(1);
+}
+
+static void build_cvt(SDL_AudioCVT *cvt, int fused,
+	Uint16 src_format, int src_channels, int src_rate,
+	Uint16 dst_format, int dst_channels, int dst_rate)
+{
+	putenv(fused ? "SDL_AUDIO_FUSED_CONVERT=1" : "SDL_AUDIO_FUSED_CONVERT=0");
+	if ( SDL_BuildAudioCVT(cvt, src_format, src_channels, src_rate,
+	                       dst_format, dst_channels, dst_rate) < 0 ) {
+		fprintf(stderr, "Couldn't build the conversion: %s\n",
+		        SDL_GetError());
+		quit(3);
+	}
+	cvt->len = frames * (src_format & 0xFF) / 8 * src_channels;
+	cvt->buf = (Uint8 *)malloc(cvt->len * cvt->len_mult);
+	if ( cvt->buf == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+}
+
+/* Convert the input a number of times, returning the total milliseconds.
+   A conversion is too quick to time on its own, so this includes
+   copying the input into place each time.
+ */
+static Uint32 time_cvt(SDL_AudioCVT *cvt, const Uint8 *input, int count)
+{
+	Uint32 then;
+	int i;
+
+	then = SDL_GetTicks();
+	for ( i=0; i<count; ++i ) {
+		memcpy(cvt->buf, input, cvt->len);
+		SDL_ConvertAudio(cvt);
+	}
+	return(SDL_GetTicks() - then);
+}
+
+/* Compare the fused and chained conversions, and time them if asked */
+static int compare(const Uint8 *input, int src, int src_channels, int srate,
+			int dst, int dst_channels, int drate, int count,
+			Uint32 *chain_ms, Uint32 *fused_ms)
+{
+	SDL_AudioCVT chain, fused;
+	int same;
+
+	build_cvt(&chain, 0, formats[src].format, src_channels, srate,
+	          formats[dst].format, dst_channels, drate);
+	build_cvt(&fused, 1, formats[src].format, src_channels, srate,
+	          formats[dst].format, dst_channels, drate);
+	*chain_ms = time_cvt(&chain, input, count);
+	*fused_ms = time_cvt(&fused, input, count);
+	same = (chain.len_cvt == fused.len_cvt &&
+	        memcmp(chain.buf, fused.buf, chain.len_cvt) == 0);
+	if ( !same ) {
+		printf("FAIL: %s %d ch %d Hz -> %s %d ch %d Hz differ\n",
+		       formats[src].name, src_channels, srate,
+		       formats[dst].name, dst_channels, drate);
+	}
+	free(chain.buf);
+	free(fused.buf);
+	return(same);
+}
+
+int main(int argc, char *argv[])
+{
+	static const int rate_changes[][2] = {
+		{ 22050, 22050 }, { 11025, 22050 }, { 11025, 44100 },
+		{ 44100, 22050 }, { 44100, 11025 }
+	};
+	Uint8 *input;
+	Uint32 chain_ms, fused_ms, total_chain = 0, total_fused = 0;
+	int i, src, dst, src_channels, dst_channels, failed = 0;
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-frames") == 0 && argv[i+1] ) {
+			frames = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-iterations") == 0 && argv[i+1] ) {
+			iterations = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-rates") == 0 && argv[i+1] && argv[i+2] ) {
+			src_rate = atoi(argv[++i]);
+			dst_rate = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( frames < 4 || iterations < 1 || src_rate < 1 || dst_rate < 1 ) {
+		usage(argv[0]);
+	}
+	frames &= ~3;
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	/* Random stereo 16-bit samples cover every input format */
+	input = (Uint8 *)malloc(frames*4);
+	if ( input == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+	srand(1);
+	for ( i=0; i<frames*4; ++i ) {
+		input[i] = (Uint8)rand();
+	}
+
+	/* Every combination should give the same samples as the chain */
+	for ( src=0; src<SDL_arraysize(formats); ++src ) {
+	    for ( dst=0; dst<SDL_arraysize(formats); ++dst ) {
+		for ( src_channels=1; src_channels<=2; ++src_channels ) {
+		    for ( dst_channels=1; dst_channels<=2; ++dst_channels ) {
+			for ( i=0; i<SDL_arraysize(rate_changes); ++i ) {
+				if ( !compare(input, src, src_channels,
+				              rate_changes[i][0], dst,
+				              dst_channels, rate_changes[i][1],
+				              1, &chain_ms, &fused_ms) ) {
+					++failed;
+				}
+			}
+		    }
+		}
+	    }
+	}
+
+	printf("%d frames, %d Hz -> %d Hz, %d iterations\n",
+	       frames, src_rate, dst_rate, iterations);
+	printf("%-14s %-14s %8s %8s\n", "from", "to", "chain", "fused");
+	for ( src=0; src<SDL_arraysize(formats); ++src ) {
+	    for ( dst=0; dst<SDL_arraysize(formats); ++dst ) {
+		for ( src_channels=1; src_channels<=2; ++src_channels ) {
+		    for ( dst_channels=1; dst_channels<=2; ++dst_channels ) {
+			char from[32], to[32];
+
+			if ( !compare(input, src, src_channels, src_rate,
+			              dst, dst_channels, dst_rate,
+			              iterations, &chain_ms, &fused_ms) ) {
+				++failed;
+			}
+			sprintf(from, "%s %s", formats[src].name,
+			        src_channels == 1 ? "mono" : "stereo");
+			sprintf(to, "%s %s", formats[dst].name,
+			        dst_channels == 1 ? "mono" : "stereo");
+			printf("%-14s %-14s %6d ms %6d ms\n",
+			       from, to, chain_ms, fused_ms);
+			total_chain += chain_ms;
+			total_fused += fused_ms;
+		    }
+		}
+	    }
+	}
+	printf("Total: chain %d ms, fused %d ms\n", total_chain, total_fused);
+	free(input);
+	SDL_Quit();
+
+	if ( failed ) {
+		printf("FAIL: %d conversions differ\n", failed);
+		return(3);
+	}
+	return(0);
+}
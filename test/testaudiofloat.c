@@ -0,0 +1,536 @@
+/* Check the AUDIO_S32 and AUDIO_F32 formats: conversions to and from
+   every other format, that floats keep their headroom until they have
+   to be clipped, rate and channel changes on floats, and mixing with
+   SDL_MixAudio() and SDL_MixAudioMulti().  Then time the conversions
+   between 16-bit and float audio, and float mixing.  This uses the
+   dummy audio driver, so it doesn't play anything.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#define PI	3.14159265358979323846
+#define KNEE	0.75f	/* Where SDL_MixAudio() starts soft clipping floats */
+
+static int frames = 4096;
+static int iterations = 1000;
+static int failed = 0;
+
+static const struct {
+	Uint16 format;
+	const char *name;
+} formats[] = {
+	{ AUDIO_U8, "U8" },
+	{ AUDIO_S8, "S8" },
+	{ AUDIO_U16LSB, "U16LSB" },
+	{ AUDIO_S16LSB, "S16LSB" },
+	{ AUDIO_U16MSB, "U16MSB" },
+	{ AUDIO_S16MSB, "S16MSB" },
+	{ AUDIO_S32LSB, "S32LSB" },
+	{ AUDIO_S32MSB, "S32MSB" },
+	{ AUDIO_F32LSB, "F32LSB" },
+	{ AUDIO_F32MSB, "F32MSB" }
+};
+
+typedef union {
+	Uint32 u;
+	float f;
+} FloatBits;
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-frames N] [-iterations N]\n", argv0);
+	quit(1);
+}
+
+static void SDLCALL fill_nothing(void *unused, Uint8 *stream, int len)
+{
+}
+
+static void *alloc(int len)
+{
+	void *mem = malloc(len);
+
+	if ( mem == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+	return(mem);
+}
+
+/* Read and write any sample as a float from -1.0 to 1.0 */
+static double get_sample(const Uint8 *data, int i, Uint16 format)
+{
+	int size = (format & 0xFF) / 8;
+	const Uint8 *p = data + i*size;
+	Uint32 v = 0;
+	FloatBits bits;
+	int b;
+
+	for ( b=0; b<size; ++b ) {
+		if ( (format & 0x1000) ) {
+			v = (v << 8) | p[b];
+		} else {
+			v = (v << 8) | p[size-1-b];
+		}
+	}
+	if ( !(format & 0x8000) ) {
+		v ^= 1 << ((size*8) - 1);
+	}
+	switch (size) {
+	    case 1:
+		return((Sint8)v / 128.0);
+	    case 2:
+		return((Sint16)v / 32768.0);
+	    default:
+		if ( format & 0x0100 ) {
+			bits.u = v;
+			return(bits.f);
+		}
+		return((Sint32)v / 2147483648.0);
+	}
+}
+
+static void put_sample(Uint8 *data, int i, double sample, Uint16 format)
+{
+	int size = (format & 0xFF) / 8;
+	Uint8 *p = data + i*size;
+	double scaled, top;
+	Uint32 v;
+	FloatBits bits;
+	int b;
+
+	if ( format & 0x0100 ) {
+		bits.f = (float)sample;
+		v = bits.u;
+	} else {
+		top = (double)(1u << (size*8 - 1));
+		scaled = floor(sample * top + 0.5);
+		if ( scaled > top - 1 ) scaled = top - 1;
+		if ( scaled < -top ) scaled = -top;
+		v = (Uint32)(Sint32)scaled;
+		if ( !(format & 0x8000) ) {
+			v ^= 1 << ((size*8) - 1);
+		}
+	}
+	for ( b=0; b<size; ++b ) {
+		if ( (format & 0x1000) ) {
+			p[size-1-b] = (Uint8)(v >> (b*8));
+		} else {
+			p[b] = (Uint8)(v >> (b*8));
+		}
+	}
+}
+
+static void random_samples(Uint8 *data, int count, Uint16 format, float peak)
+{
+	int i;
+
+	for ( i=0; i<count; ++i ) {
+		put_sample(data, i, peak * (rand() / (RAND_MAX/2.0f) - 1.0f),
+		           format);
+	}
+}
+
+static void convert(Uint8 **buf, int *len, Uint16 src, int src_channels,
+			int src_rate, Uint16 dst, int dst_channels, int dst_rate)
+{
+	SDL_AudioCVT cvt;
+
+	if ( SDL_BuildAudioCVT(&cvt, src, src_channels, src_rate,
+	                       dst, dst_channels, dst_rate) < 0 ) {
+		fprintf(stderr, "Couldn't build the conversion: %s\n",
+		        SDL_GetError());
+		quit(3);
+	}
+	cvt.len = *len;
+	cvt.buf = (Uint8 *)alloc(cvt.len * cvt.len_mult);
+	memcpy(cvt.buf, *buf, cvt.len);
+	SDL_ConvertAudio(&cvt);
+	free(*buf);
+	*buf = cvt.buf;
+	*len = cvt.len_cvt;
+}
+
+static void fail(const char *what, Uint16 src, Uint16 dst, int i)
+{
+	int f, s = 0, d = 0;
+
+	for ( f=0; f<SDL_arraysize(formats); ++f ) {
+		if ( formats[f].format == src ) s = f;
+		if ( formats[f].format == dst ) d = f;
+	}
+	printf("FAIL: %s %s -> %s at sample %d\n",
+	       what, formats[s].name, formats[d].name, i);
+	++failed;
+}
+
+/* Every format to every other should give the nearest sample */
+static void check_conversions(void)
+{
+	Uint8 *input, *buf;
+	double expect, got, step;
+	int s, d, i, len, count = frames;
+
+	input = (Uint8 *)alloc(count*4);
+	for ( s=0; s<SDL_arraysize(formats); ++s ) {
+	    for ( d=0; d<SDL_arraysize(formats); ++d ) {
+		Uint16 src = formats[s].format;
+		Uint16 dst = formats[d].format;
+
+		if ( (src & 0xFF) != 32 && (dst & 0xFF) != 32 ) {
+			continue;
+		}
+		srand(s*16+d);
+		random_samples(input, count, src, 1.0f);
+		len = count * (src & 0xFF) / 8;
+		buf = (Uint8 *)alloc(len);
+		memcpy(buf, input, len);
+		convert(&buf, &len, src, 1, 44100, dst, 1, 44100);
+		if ( len != count * (dst & 0xFF) / 8 ) {
+			fail("length", src, dst, 0);
+			free(buf);
+			continue;
+		}
+
+		/* Half a step of the coarser format, floats are exact
+		   up to the 24 bits they have */
+		step = 1.0 / (1 << ((dst & 0xFF) - 1));
+		if ( (dst & 0xFF) == 32 ) {
+			step = 1.0 / (1 << 23);
+		}
+		for ( i=0; i<count; ++i ) {
+			expect = get_sample(input, i, src);
+			if ( expect > 1.0 - step ) {
+				expect = 1.0 - step;
+			}
+			got = get_sample(buf, i, dst);
+			if ( fabs(got - expect) > step ) {
+				fail("conversion", src, dst, i);
+				break;
+			}
+		}
+
+		/* 8 and 16-bit audio survives the trip through floats */
+		if ( (src & 0xFF) <= 16 && (dst & 0x0100) ) {
+			convert(&buf, &len, dst, 1, 44100, src, 1, 44100);
+			if ( memcmp(buf, input, len) != 0 ) {
+				fail("round trip", src, dst, 0);
+			}
+		}
+		free(buf);
+	    }
+	}
+	free(input);
+}
+
+/* Floats louder than full scale clip only when they have to */
+static void check_headroom(void)
+{
+	Uint8 *buf;
+	float *f;
+	int len;
+
+	buf = (Uint8 *)alloc(4*4);
+	f = (float *)buf;
+	f[0] = 1.5f; f[1] = -1.5f; f[2] = 2.0f; f[3] = -2.0f;
+	len = 4*4;
+	convert(&buf, &len, AUDIO_F32SYS, 2, 44100, AUDIO_F32SYS, 1, 44100);
+	f = (float *)buf;
+	if ( len != 2*4 || f[0] != 0.0f || f[1] != 0.0f ) {
+		fail("mono mix of loud floats", AUDIO_F32SYS, AUDIO_F32SYS, 0);
+	}
+	free(buf);
+
+	buf = (Uint8 *)alloc(4*4);
+	f = (float *)buf;
+	f[0] = 1.5f; f[1] = 1.5f; f[2] = 0.25f; f[3] = 0.75f;
+	len = 4*4;
+	convert(&buf, &len, AUDIO_F32SYS, 2, 44100, AUDIO_F32SYS, 1, 44100);
+	f = (float *)buf;
+	if ( len != 2*4 || f[0] != 1.5f || f[1] != 0.5f ) {
+		fail("headroom", AUDIO_F32SYS, AUDIO_F32SYS, 0);
+	}
+	len = 2*4;
+	convert(&buf, &len, AUDIO_F32SYS, 1, 44100, AUDIO_S16SYS, 1, 44100);
+	if ( ((Sint16 *)buf)[0] != 32767 || ((Sint16 *)buf)[1] != 16384 ) {
+		fail("clipping", AUDIO_F32SYS, AUDIO_S16SYS, 0);
+	}
+	free(buf);
+}
+
+/* Rate and channel changes on floats, with a tone at the end */
+static void check_resampling(void)
+{
+	const int src_rate = 44100, dst_rate = 48000;
+	const double freq = 1000.0, amp = 0.5;
+	double signal = 0.0, noise = 0.0, ideal, diff, snr;
+	Uint8 *buf;
+	float *f;
+	int i, len, out;
+
+	len = src_rate * 4;
+	buf = (Uint8 *)alloc(len);
+	for ( i=0; i<src_rate; ++i ) {
+		put_sample(buf, i, (float)(amp * sin(2.0*PI*freq*i / src_rate)),
+		           AUDIO_S32SYS);
+	}
+	convert(&buf, &len, AUDIO_S32SYS, 1, src_rate,
+	        AUDIO_F32SYS, 2, dst_rate);
+	out = len / 8;
+	f = (float *)buf;
+	for ( i=dst_rate/100; i<out - dst_rate/100; ++i ) {
+		ideal = amp * sin(2.0*PI*freq*i / dst_rate);
+		diff = f[i*2] - ideal;
+		signal += ideal * ideal;
+		noise += diff * diff;
+		diff = f[i*2+1] - ideal;
+		noise += diff * diff;
+	}
+	snr = 10.0 * log10(2.0 * signal / noise);
+	printf("S32 mono %d Hz -> F32 stereo %d Hz: %.1f dB SNR\n",
+	       src_rate, dst_rate, snr);
+	if ( snr < 70.0 ) {
+		fail("resampling", AUDIO_S32SYS, AUDIO_F32SYS, 0);
+	}
+	free(buf);
+}
+
+/* What SDL_MixAudio() does to floats above the knee */
+static float soft_clip(float sample)
+{
+	float over, sign = 1.0f;
+
+	if ( sample < 0.0f ) {
+		sign = -1.0f;
+		sample = -sample;
+	}
+	if ( sample > KNEE ) {
+		over = (sample - KNEE) / (1.0f - KNEE);
+		sample = KNEE + (1.0f - KNEE) * (over / (1.0f + over));
+	}
+	return(sign * sample);
+}
+
+static int open_audio(Uint16 format)
+{
+	SDL_AudioSpec spec;
+
+	memset(&spec, 0, sizeof(spec));
+	spec.freq = 44100;
+	spec.format = format;
+	spec.channels = 2;
+	spec.samples = 1024;
+	spec.callback = fill_nothing;
+	if ( SDL_OpenAudio(&spec, NULL) < 0 ) {
+		fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+		quit(2);
+	}
+	return(0);
+}
+
+static void check_mixing(Uint16 format)
+{
+	const int voices = 8;
+	Uint8 *dst, *src[8];
+	double expect, got, sum, tolerance;
+	int volume[8];
+	int i, j, count = frames + 3;
+
+	open_audio(format);
+	dst = (Uint8 *)alloc(count*4);
+	for ( j=0; j<voices; ++j ) {
+		src[j] = (Uint8 *)alloc(count*4);
+		random_samples(src[j], count, format, 0.6f);
+		volume[j] = rand() % (SDL_MIX_MAXVOLUME+1);
+	}
+	tolerance = (format & 0x0100) ? 1e-6 : 1.0 / (1 << 30);
+
+	/* One voice at a time */
+	random_samples(dst, count, format, 0.6f);
+	{
+		Uint8 *before = (Uint8 *)alloc(count*4);
+
+		memcpy(before, dst, count*4);
+		SDL_MixAudio(dst, src[0], count*4, volume[0]);
+		for ( i=0; i<count; ++i ) {
+			sum = get_sample(before, i, format) +
+			      get_sample(src[0], i, format) *
+			      volume[0] / SDL_MIX_MAXVOLUME;
+			if ( format & 0x0100 ) {
+				expect = soft_clip((float)sum);
+			} else {
+				expect = (sum > 1.0) ? 1.0 :
+				         (sum < -1.0) ? -1.0 : sum;
+			}
+			got = get_sample(dst, i, format);
+			if ( fabs(got - expect) > tolerance ) {
+				fail("SDL_MixAudio()", format, format, i);
+				break;
+			}
+		}
+		free(before);
+	}
+
+	/* All of them at once, clipped at the end */
+	random_samples(dst, count, format, 0.2f);
+	{
+		Uint8 *before = (Uint8 *)alloc(count*4);
+
+		memcpy(before, dst, count*4);
+		SDL_MixAudioMulti(dst, (const Uint8 **)src, volume,
+		                  voices, count*4);
+		for ( i=0; i<count; ++i ) {
+			sum = get_sample(before, i, format);
+			for ( j=0; j<voices; ++j ) {
+				sum += get_sample(src[j], i, format) *
+				       volume[j] / SDL_MIX_MAXVOLUME;
+			}
+			if ( format & 0x0100 ) {
+				expect = soft_clip((float)sum);
+			} else {
+				expect = (sum > 1.0) ? 1.0 :
+				         (sum < -1.0) ? -1.0 : sum;
+			}
+			got = get_sample(dst, i, format);
+			if ( fabs(got - expect) > tolerance*voices ) {
+				fail("SDL_MixAudioMulti()", format, format, i);
+				break;
+			}
+		}
+		free(before);
+	}
+	for ( j=0; j<voices; ++j ) {
+		free(src[j]);
+	}
+	free(dst);
+	SDL_CloseAudio();
+}
+
+static void time_conversion(Uint16 src, Uint16 dst, const char *what)
+{
+	SDL_AudioCVT cvt;
+	Uint8 *input;
+	Uint32 then, ms;
+	int i;
+
+	SDL_BuildAudioCVT(&cvt, src, 2, 44100, dst, 2, 44100);
+	cvt.len = frames * 2 * (src & 0xFF) / 8;
+	cvt.buf = (Uint8 *)alloc(cvt.len * cvt.len_mult);
+	input = (Uint8 *)alloc(cvt.len);
+	random_samples(input, frames*2, src, 1.0f);
+	then = SDL_GetTicks();
+	for ( i=0; i<iterations; ++i ) {
+		memcpy(cvt.buf, input, cvt.len);
+		SDL_ConvertAudio(&cvt);
+	}
+	ms = SDL_GetTicks() - then;
+	printf("  %-18s %8.1f Msamples/s\n", what,
+	       (double)frames*2*iterations / ((ms ? ms : 1) * 1000.0));
+	free(input);
+	free(cvt.buf);
+}
+
+static void time_mixing(void)
+{
+	Uint8 *dst, *src;
+	Uint32 then, ms;
+	int i;
+
+	open_audio(AUDIO_F32SYS);
+	dst = (Uint8 *)alloc(frames*2*4);
+	src = (Uint8 *)alloc(frames*2*4);
+	random_samples(dst, frames*2, AUDIO_F32SYS, 0.5f);
+	random_samples(src, frames*2, AUDIO_F32SYS, 0.5f);
+	then = SDL_GetTicks();
+	for ( i=0; i<iterations; ++i ) {
+		SDL_MixAudio(dst, src, frames*2*4, SDL_MIX_MAXVOLUME/2);
+		if ( (i % 4) == 3 ) {
+			memcpy(dst, src, frames*2*4);
+		}
+	}
+	ms = SDL_GetTicks() - then;
+	printf("  %-18s %8.1f Msamples/s\n", "F32 SDL_MixAudio()",
+	       (double)frames*2*iterations / ((ms ? ms : 1) * 1000.0));
+	free(dst);
+	free(src);
+	SDL_CloseAudio();
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_AudioSpec spec;
+	Uint16 swapped;
+	int i;
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-frames") == 0 && argv[i+1] ) {
+			frames = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-iterations") == 0 && argv[i+1] ) {
+			iterations = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( frames < 16 || iterations < 1 ) {
+		usage(argv[0]);
+	}
+
+	putenv("SDL_AUDIODRIVER=dummy");
+	putenv("SDL_AUDIO_FORMAT=F32SYS");
+	if ( SDL_Init(SDL_INIT_AUDIO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	/* The dummy driver takes float audio as it is */
+	memset(&spec, 0, sizeof(spec));
+	spec.callback = fill_nothing;
+	if ( SDL_OpenAudio(&spec, NULL) < 0 ) {
+		fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+		quit(2);
+	}
+	if ( spec.format != AUDIO_F32SYS ) {
+		printf("FAIL: SDL_AUDIO_FORMAT=F32SYS gave format 0x%x\n",
+		       spec.format);
+		++failed;
+	}
+	SDL_CloseAudio();
+
+	check_conversions();
+	check_headroom();
+	check_resampling();
+	for ( i=0; i<SDL_arraysize(formats); ++i ) {
+		if ( (formats[i].format & 0xFF) == 32 ) {
+			check_mixing(formats[i].format);
+		}
+	}
+
+	printf("%d frames of stereo, %d times:\n", frames, iterations);
+	time_conversion(AUDIO_S16SYS, AUDIO_F32SYS, "S16 -> F32");
+	time_conversion(AUDIO_F32SYS, AUDIO_S16SYS, "F32 -> S16");
+	time_conversion(AUDIO_S32SYS, AUDIO_F32SYS, "S32 -> F32");
+	time_conversion(AUDIO_F32SYS, AUDIO_S32SYS, "F32 -> S32");
+	swapped = (AUDIO_S16SYS == AUDIO_S16LSB) ? AUDIO_S16MSB : AUDIO_S16LSB;
+	time_conversion(swapped, AUDIO_F32SYS, "S16 swapped -> F32");
+	time_mixing();
+	SDL_Quit();
+
+	if ( failed ) {
+		printf("FAIL: %d checks failed\n", failed);
+		return(3);
+	}
+	printf("All checks passed\n");
+	return(0);
+}
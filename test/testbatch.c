@@ -0,0 +1,196 @@
+
+/* Compare SDL_BlitSurfaceBatch() against individual SDL_BlitSurface() calls
+   for a tile map, and make sure both produce the same image.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define SHEET_TILES	16
+
+static int tilesize = 16;
+static int frames = 200;
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+	"Usage: %s [-frames N] [-tilesize N] [-colorkey] [-alpha] [-bpp N]\n",
+								argv0);
+	quit(1);
+}
+
+/* Fill the tile sheet with a different pattern in each tile */
+static void draw_sheet(SDL_Surface *sheet)
+{
+	SDL_Rect r;
+	int x, y;
+
+	for ( y=0; y<SHEET_TILES; ++y ) {
+		for ( x=0; x<SHEET_TILES; ++x ) {
+			r.x = x*tilesize;
+			r.y = y*tilesize;
+			r.w = tilesize;
+			r.h = tilesize;
+			SDL_FillRect(sheet, &r, SDL_MapRGBA(sheet->format,
+			             x*16, y*16, (x^y)*16, 128+x*8));
+			r.x += tilesize/4;
+			r.y += tilesize/4;
+			r.w = tilesize/2;
+			r.h = tilesize/2;
+			SDL_FillRect(sheet, &r, SDL_MapRGBA(sheet->format,
+			             255, 0, 255, 255));
+		}
+	}
+}
+
+/* Lay out a tile map a little bigger than the screen, so that the
+   rectangles along the edges get clipped.
+ */
+static int make_tiles(SDL_Surface *screen, SDL_Rect **srcrects,
+                      SDL_Rect **dstrects, SDL_Rect **work)
+{
+	int cols = screen->w/tilesize + 2;
+	int rows = screen->h/tilesize + 2;
+	int n = cols*rows;
+	int i;
+
+	*srcrects = (SDL_Rect *)malloc(n*sizeof(SDL_Rect));
+	*dstrects = (SDL_Rect *)malloc(n*sizeof(SDL_Rect));
+	*work = (SDL_Rect *)malloc(n*sizeof(SDL_Rect));
+	if ( !*srcrects || !*dstrects || !*work ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+	for ( i=0; i<n; ++i ) {
+		int tile = rand() % (SHEET_TILES*SHEET_TILES);
+		(*srcrects)[i].x = (tile % SHEET_TILES) * tilesize;
+		(*srcrects)[i].y = (tile / SHEET_TILES) * tilesize;
+		(*srcrects)[i].w = tilesize;
+		(*srcrects)[i].h = tilesize;
+		(*dstrects)[i].x = (i % cols) * tilesize - tilesize/2;
+		(*dstrects)[i].y = (i / cols) * tilesize - tilesize/2;
+		(*dstrects)[i].w = 0;
+		(*dstrects)[i].h = 0;
+	}
+	return(n);
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Surface *screen, *sheet, *single;
+	SDL_Rect *srcrects, *dstrects, *work;
+	Uint32 colorkey = 0, alpha = 0;
+	int bpp = 32;
+	int i, n, frame, y, rowbytes;
+	Uint32 then, single_ticks, batch_ticks;
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-frames") == 0 && argv[i+1] ) {
+			frames = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-tilesize") == 0 && argv[i+1] ) {
+			tilesize = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-bpp") == 0 && argv[i+1] ) {
+			bpp = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-colorkey") == 0 ) {
+			colorkey = SDL_SRCCOLORKEY;
+		} else if ( strcmp(argv[i], "-alpha") == 0 ) {
+			alpha = SDL_SRCALPHA;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( frames < 1 || tilesize < 4 ) {
+		usage(argv[0]);
+	}
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	/* Render to off-screen surfaces, so we can compare the results */
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 640, 480, bpp,
+	                              0, 0, 0, 0);
+	single = SDL_CreateRGBSurface(SDL_SWSURFACE, 640, 480, bpp,
+	                              0, 0, 0, 0);
+	sheet = SDL_CreateRGBSurface(SDL_SWSURFACE,
+	                             SHEET_TILES*tilesize, SHEET_TILES*tilesize,
+	                             32, 0x00FF0000, 0x0000FF00, 0x000000FF,
+	                             alpha ? 0xFF000000 : 0);
+	if ( !screen || !single || !sheet ) {
+		fprintf(stderr, "Couldn't create surfaces: %s\n",
+							SDL_GetError());
+		quit(2);
+	}
+	SDL_SetAlpha(sheet, alpha, SDL_ALPHA_OPAQUE);
+	draw_sheet(sheet);
+	SDL_SetColorKey(sheet, colorkey,
+	                SDL_MapRGB(sheet->format, 255, 0, 255));
+
+	n = make_tiles(screen, &srcrects, &dstrects, &work);
+	printf("Blitting %d %dx%d tiles to a %d bpp surface, %d frames%s%s\n",
+	       n, tilesize, tilesize, bpp, frames,
+	       colorkey ? ", colorkey" : "", alpha ? ", alpha" : "");
+
+	/* One blit at a time */
+	then = SDL_GetTicks();
+	for ( frame=0; frame<frames; ++frame ) {
+		for ( i=0; i<n; ++i ) {
+			work[i] = dstrects[i];
+			SDL_BlitSurface(sheet, &srcrects[i], single, &work[i]);
+		}
+	}
+	single_ticks = SDL_GetTicks() - then;
+
+	/* The whole tile map at once */
+	then = SDL_GetTicks();
+	for ( frame=0; frame<frames; ++frame ) {
+		memcpy(work, dstrects, n*sizeof(SDL_Rect));
+		if ( SDL_BlitSurfaceBatch(sheet, screen,
+		                          srcrects, work, n) < 0 ) {
+			fprintf(stderr, "Batch blit failed: %s\n",
+							SDL_GetError());
+			quit(3);
+		}
+	}
+	batch_ticks = SDL_GetTicks() - then;
+
+	printf("SDL_BlitSurface:      %6u ms, %.2f us per blit\n",
+	       single_ticks, (single_ticks*1000.0)/((double)n*frames));
+	printf("SDL_BlitSurfaceBatch: %6u ms, %.2f us per blit\n",
+	       batch_ticks, (batch_ticks*1000.0)/((double)n*frames));
+	if ( batch_ticks ) {
+		printf("Speedup: %.2fx\n", (double)single_ticks/batch_ticks);
+	}
+
+	/* Both ways must draw exactly the same thing */
+	rowbytes = screen->w * screen->format->BytesPerPixel;
+	for ( y=0; y<screen->h; ++y ) {
+		if ( memcmp((Uint8 *)screen->pixels + y*screen->pitch,
+		            (Uint8 *)single->pixels + y*single->pitch,
+		            rowbytes) != 0 ) {
+			fprintf(stderr, "Images differ at row %d!\n", y);
+			quit(4);
+		}
+	}
+	printf("Images match\n");
+
+	free(srcrects);
+	free(dstrects);
+	free(work);
+	SDL_FreeSurface(sheet);
+	SDL_FreeSurface(single);
+	SDL_FreeSurface(screen);
+	SDL_Quit();
+	return(0);
+}
@@ -0,0 +1,295 @@
+/* Check the alpha blitters against the plain C ones, on random rows
+   with odd widths and unaligned starts.
+
+   The per-surface alpha blits to 16 bpp are compared against the
+   generic C blitter by blitting the same colours from a source format
+   that no specialized blitter takes.  The others are compared against
+   the math of the C blitters written out below.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define SURF_W	80
+#define SURF_H	4
+#define LOOPS	2000
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static SDL_Surface *create(int bpp, Uint32 R, Uint32 G, Uint32 B, Uint32 A)
+{
+	SDL_Surface *surface;
+
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, SURF_W, SURF_H,
+	                               bpp, R, G, B, A);
+	if ( surface == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n", SDL_GetError());
+		quit(1);
+	}
+	return(surface);
+}
+
+static Uint32 random32(void)
+{
+	return((Uint32)(rand() & 0xffff) << 16 | (Uint32)(rand() & 0xffff));
+}
+
+/* Fill a surface with random pixels, favouring opaque and clear alpha */
+static void fill(SDL_Surface *surface)
+{
+	int x, y;
+
+	for ( y=0; y<surface->h; ++y ) {
+		Uint8 *row = (Uint8 *)surface->pixels + y*surface->pitch;
+		for ( x=0; x<surface->w; ++x ) {
+			Uint32 pixel = random32();
+			switch (rand() % 4) {
+			    case 0:
+				pixel |= 0xff0000ff;
+				break;
+			    case 1:
+				pixel &= 0x00ffff00;
+				break;
+			}
+			if ( surface->format->BytesPerPixel == 2 ) {
+				((Uint16 *)row)[x] = (Uint16)pixel;
+			} else {
+				((Uint32 *)row)[x] = pixel;
+			}
+		}
+	}
+}
+
+/* Copy the source pixels from ARGB8888 into another 32 bpp format */
+static void convert(SDL_Surface *src, SDL_Surface *dst)
+{
+	SDL_PixelFormat *fmt = dst->format;
+	int x, y;
+
+	for ( y=0; y<src->h; ++y ) {
+		Uint32 *s = (Uint32 *)((Uint8 *)src->pixels + y*src->pitch);
+		Uint32 *d = (Uint32 *)((Uint8 *)dst->pixels + y*dst->pitch);
+		for ( x=0; x<src->w; ++x ) {
+			d[x] = ((s[x] >> 16 & 0xff) << fmt->Rshift)
+			     | ((s[x] >> 8 & 0xff) << fmt->Gshift)
+			     | ((s[x] & 0xff) << fmt->Bshift);
+		}
+	}
+}
+
+/* BlitRGBtoRGBSurfaceAlpha() and BlitRGBtoRGBPixelAlpha() */
+static Uint32 blend32(Uint32 s, Uint32 d, unsigned alpha, int surface)
+{
+	Uint32 s1, d1, dalpha;
+
+	if ( !surface ) {
+		alpha = s >> 24;
+		if ( alpha == 0 ) {
+			return(d);
+		}
+		if ( alpha == SDL_ALPHA_OPAQUE ) {
+			return((s & 0x00ffffff) | (d & 0xff000000));
+		}
+	}
+	dalpha = surface ? 0xff000000 : (d & 0xff000000);
+	s1 = s & 0xff00ff;
+	d1 = d & 0xff00ff;
+	d1 = (d1 + ((s1 - d1) * alpha >> 8)) & 0xff00ff;
+	s &= 0xff00;
+	d &= 0xff00;
+	d = (d + ((s - d) * alpha >> 8)) & 0xff00;
+	return(d1 | d | dalpha);
+}
+
+/* BlitARGBto565PixelAlpha() and BlitARGBto555PixelAlpha() */
+static Uint16 blend16(Uint32 s, Uint16 dst, int is565)
+{
+	unsigned alpha = s >> 27;
+	Uint32 d = dst;
+
+	if ( alpha == 0 ) {
+		return(dst);
+	}
+	if ( is565 ) {
+		if ( alpha == (SDL_ALPHA_OPAQUE >> 3) ) {
+			return((Uint16)((s >> 8 & 0xf800) + (s >> 5 & 0x7e0)
+			                + (s >> 3 & 0x1f)));
+		}
+		s = ((s & 0xfc00) << 11) + (s >> 8 & 0xf800) + (s >> 3 & 0x1f);
+		d = (d | d << 16) & 0x07e0f81f;
+		d += (s - d) * alpha >> 5;
+		d &= 0x07e0f81f;
+	} else {
+		if ( alpha == (SDL_ALPHA_OPAQUE >> 3) ) {
+			return((Uint16)((s >> 9 & 0x7c00) + (s >> 6 & 0x3e0)
+			                + (s >> 3 & 0x1f)));
+		}
+		s = ((s & 0xf800) << 10) + (s >> 9 & 0x7c00) + (s >> 3 & 0x1f);
+		d = (d | d << 16) & 0x03e07c1f;
+		d += (s - d) * alpha >> 5;
+		d &= 0x03e07c1f;
+	}
+	return((Uint16)(d | d >> 16));
+}
+
+/* Pick a random blit rectangle, anywhere on the row */
+static void pick(SDL_Rect *srcrect, SDL_Rect *dstrect)
+{
+	int w = 1 + rand() % SURF_W;
+
+	srcrect->w = w;
+	srcrect->h = 1 + rand() % SURF_H;
+	srcrect->x = rand() % (SURF_W - w + 1);
+	srcrect->y = rand() % (SURF_H - srcrect->h + 1);
+	dstrect->x = rand() % (SURF_W - w + 1);
+	dstrect->y = rand() % (SURF_H - srcrect->h + 1);
+}
+
+static int compare(const char *name, SDL_Surface *got, SDL_Surface *want,
+                   const SDL_Rect *r, unsigned alpha)
+{
+	int y;
+
+	for ( y=0; y<got->h; ++y ) {
+		if ( memcmp((Uint8 *)got->pixels + y*got->pitch,
+		            (Uint8 *)want->pixels + y*want->pitch,
+		            got->w * got->format->BytesPerPixel) != 0 ) {
+			printf("%s: alpha %u, %dx%d at %d,%d, row %d: FAILED\n",
+				name, alpha, r->w, r->h, r->x, r->y, y);
+			return(1);
+		}
+	}
+	return(0);
+}
+
+/* Per-surface alpha into 16 bpp, against the generic C blitter */
+static int test_surface16(const char *name, int is565)
+{
+	SDL_Surface *src, *ref, *dst, *want;
+	SDL_Rect srcrect, dstrect, r;
+	int i, failed;
+
+	src = create(32, 0xff0000, 0xff00, 0xff, 0);
+	ref = create(32, 0xff000000, 0xff0000, 0xff00, 0);
+	if ( is565 ) {
+		dst = create(16, 0xf800, 0x7e0, 0x1f, 0);
+		want = create(16, 0xf800, 0x7e0, 0x1f, 0);
+	} else {
+		dst = create(16, 0x7c00, 0x3e0, 0x1f, 0);
+		want = create(16, 0x7c00, 0x3e0, 0x1f, 0);
+	}
+
+	failed = 0;
+	for ( i=0; i<LOOPS && !failed; ++i ) {
+		unsigned alpha = rand() % 256;
+
+		fill(src);
+		convert(src, ref);
+		fill(dst);
+		memcpy(want->pixels, dst->pixels, dst->h * dst->pitch);
+		SDL_SetAlpha(src, SDL_SRCALPHA, (Uint8)alpha);
+		SDL_SetAlpha(ref, SDL_SRCALPHA, (Uint8)alpha);
+
+		pick(&srcrect, &dstrect);
+		r = dstrect;
+		SDL_BlitSurface(src, &srcrect, dst, &dstrect);
+		SDL_BlitSurface(ref, &srcrect, want, &r);
+		failed = compare(name, dst, want, &dstrect, alpha);
+	}
+	if ( !failed ) {
+		printf("%s: ok\n", name);
+	}
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(ref);
+	SDL_FreeSurface(dst);
+	SDL_FreeSurface(want);
+	return(failed);
+}
+
+/* Per-pixel alpha into 16 bpp, and both kinds into 32 bpp */
+static int test_blend(const char *name, int bpp, int is565, int surface)
+{
+	SDL_Surface *src, *dst, *want;
+	SDL_Rect srcrect, dstrect;
+	int i, x, y, failed;
+
+	src = create(32, 0xff0000, 0xff00, 0xff, surface ? 0 : 0xff000000);
+	if ( bpp == 32 ) {
+		dst = create(32, 0xff0000, 0xff00, 0xff, 0);
+		want = create(32, 0xff0000, 0xff00, 0xff, 0);
+	} else if ( is565 ) {
+		dst = create(16, 0xf800, 0x7e0, 0x1f, 0);
+		want = create(16, 0xf800, 0x7e0, 0x1f, 0);
+	} else {
+		dst = create(16, 0x7c00, 0x3e0, 0x1f, 0);
+		want = create(16, 0x7c00, 0x3e0, 0x1f, 0);
+	}
+
+	failed = 0;
+	for ( i=0; i<LOOPS && !failed; ++i ) {
+		/* opaque surfaces aren't blended at all */
+		unsigned alpha = surface ? rand() % 255 : SDL_ALPHA_OPAQUE;
+
+		fill(src);
+		fill(dst);
+		memcpy(want->pixels, dst->pixels, dst->h * dst->pitch);
+		SDL_SetAlpha(src, SDL_SRCALPHA, (Uint8)alpha);
+
+		pick(&srcrect, &dstrect);
+		for ( y=0; y<srcrect.h; ++y ) {
+			Uint32 *s = (Uint32 *)((Uint8 *)src->pixels
+			            + (srcrect.y+y)*src->pitch) + srcrect.x;
+			Uint8 *d = (Uint8 *)want->pixels
+			           + (dstrect.y+y)*want->pitch;
+			for ( x=0; x<srcrect.w; ++x ) {
+				if ( bpp == 32 ) {
+					Uint32 *p = (Uint32 *)d + dstrect.x + x;
+					*p = blend32(s[x], *p, alpha, surface);
+				} else {
+					Uint16 *p = (Uint16 *)d + dstrect.x + x;
+					*p = blend16(s[x], *p, is565);
+				}
+			}
+		}
+		SDL_BlitSurface(src, &srcrect, dst, &dstrect);
+		failed = compare(name, dst, want, &dstrect, alpha);
+	}
+	if ( !failed ) {
+		printf("%s: ok\n", name);
+	}
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst);
+	SDL_FreeSurface(want);
+	return(failed);
+}
+
+int main(int argc, char *argv[])
+{
+	int failed;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	srand(1);
+	failed = 0;
+	failed += test_surface16("surface alpha RGB565", 1);
+	failed += test_surface16("surface alpha RGB555", 0);
+	failed += test_blend("pixel alpha RGB565", 16, 1, 0);
+	failed += test_blend("pixel alpha RGB555", 16, 0, 0);
+	failed += test_blend("surface alpha RGB888", 32, 0, 1);
+	failed += test_blend("pixel alpha RGB888", 32, 0, 0);
+	if ( failed ) {
+		printf("%d checks FAILED\n", failed);
+	}
+	quit(failed ? 1 : 0);
+	return(0);
+}
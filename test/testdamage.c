@@ -0,0 +1,150 @@
+/* Check that SDL_UpdateRects() sends overlapping rectangles only once,
+   using the update counters of the dummy video driver.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define SCREEN_W	320
+#define SCREEN_H	240
+
+static Uint8 covered[SCREEN_H][SCREEN_W];
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+/* Count the screen pixels the rectangles cover */
+static Uint32 union_area(int numrects, const SDL_Rect *rects)
+{
+	Uint32 area;
+	int i, x, y;
+
+	memset(covered, 0, sizeof(covered));
+	for ( i=0; i<numrects; ++i ) {
+		for ( y=rects[i].y; y<rects[i].y+rects[i].h; ++y ) {
+			for ( x=rects[i].x; x<rects[i].x+rects[i].w; ++x ) {
+				covered[y][x] = 1;
+			}
+		}
+	}
+	area = 0;
+	for ( y=0; y<SCREEN_H; ++y ) {
+		for ( x=0; x<SCREEN_W; ++x ) {
+			area += covered[y][x];
+		}
+	}
+	return(area);
+}
+
+/* Update the rectangles and return the number of pixels sent */
+static Uint32 update(SDL_Surface *screen, int numrects, SDL_Rect *rects)
+{
+	SDL_PresentStats before, after;
+
+	if ( SDL_GetPresentStats(&before) < 0 ) {
+		fprintf(stderr, "Couldn't get the update counters: %s\n",
+							SDL_GetError());
+		quit(1);
+	}
+	SDL_UpdateRects(screen, numrects, rects);
+	SDL_GetPresentStats(&after);
+	return(after.pixels - before.pixels);
+}
+
+static int check(SDL_Surface *screen, const char *name,
+		int numrects, SDL_Rect *rects, Uint32 expected)
+{
+	Uint32 area, pixels;
+
+	area = union_area(numrects, rects);
+	pixels = update(screen, numrects, rects);
+	if ( pixels < area || (expected && pixels != expected) ) {
+		printf("%s: sent %u pixels, covering %u, expected %u: FAILED\n",
+			name ? name : "random", (unsigned)pixels, (unsigned)area,
+			(unsigned)(expected ? expected : area));
+		return(1);
+	}
+	if ( name ) {
+		printf("%s: sent %u pixels, covering %u: ok\n",
+			name, (unsigned)pixels, (unsigned)area);
+	}
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Surface *screen;
+	SDL_Rect rects[64];
+	int i, failed;
+
+	/* Corners overlapping, the bounding box would waste a third of it */
+	static SDL_Rect corner[2] = {
+		{ 10, 10, 50, 30 }, { 40, 25, 50, 30 }
+	};
+	/* A cross, the bounding box would be three times as big */
+	static SDL_Rect cross[2] = {
+		{ 101, 53, 19, 97 }, { 47, 91, 123, 21 }
+	};
+	/* Off by one pixel, cheaper as one rectangle */
+	static SDL_Rect shifted[2] = {
+		{ 7, 9, 101, 53 }, { 8, 10, 101, 53 }
+	};
+	/* Each one overlapping the one before */
+	static SDL_Rect chain[4] = {
+		{ 3, 5, 40, 40 }, { 33, 37, 41, 43 },
+		{ 65, 71, 39, 37 }, { 11, 29, 90, 11 }
+	};
+
+	/* Use the dummy driver, which counts the updates */
+	SDL_putenv("SDL_VIDEODRIVER=dummy");
+	SDL_putenv("SDL_VIDEO_UPDATE_TILE=");
+	SDL_putenv("SDL_VIDEO_UPDATE_FULL=");
+	SDL_putenv("SDL_VIDEO_AUTO_DAMAGE=");
+	if ( SDL_Init(SDL_INIT_VIDEO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	screen = SDL_SetVideoMode(SCREEN_W, SCREEN_H, 32, SDL_SWSURFACE);
+	if ( screen == NULL ) {
+		fprintf(stderr, "Couldn't set video mode: %s\n",SDL_GetError());
+		quit(1);
+	}
+
+	failed = 0;
+	failed += check(screen, "corner", 2, corner, 2700);
+	failed += check(screen, "cross", 2, cross, 19*97 + 123*21 - 19*21);
+	failed += check(screen, "shifted", 2, shifted, 102*54);
+	failed += check(screen, "chain", 4, chain, 0);
+
+	/* Random overlapping rectangles, never sent more than once */
+	srand(1);
+	for ( i=0; i<1000; ++i ) {
+		int n, j;
+
+		n = 2 + rand() % 63;
+		for ( j=0; j<n; ++j ) {
+			rects[j].w = 1 + rand() % 80;
+			rects[j].h = 1 + rand() % 60;
+			rects[j].x = rand() % (SCREEN_W - rects[j].w + 1);
+			rects[j].y = rand() % (SCREEN_H - rects[j].h + 1);
+		}
+		if ( check(screen, NULL, n, rects, 0) ) {
+			++failed;
+			break;
+		}
+	}
+	if ( failed ) {
+		printf("%d checks FAILED\n", failed);
+	} else {
+		printf("random: %d sets of rectangles ok\n", i);
+	}
+	quit(failed ? 1 : 0);
+	return(0);
+}
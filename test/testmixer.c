@@ -0,0 +1,279 @@
+/* Check SDL_MixAudio() and SDL_MixAudioMulti() against plain C versions
+   for each audio format, then time mixing a number of voices into one
+   buffer: with a C loop, with SDL_MixAudio() once per voice, and with
+   a single SDL_MixAudioMulti() call.  This uses the dummy audio driver,
+   so it doesn't play anything.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int voices = 32;
+static int length = 4096;
+static int iterations = 2000;
+
+static const struct {
+	Uint16 format;
+	const char *name;
+} formats[] = {
+	{ AUDIO_U8, "U8" },
+	{ AUDIO_S8, "S8" },
+	{ AUDIO_S16LSB, "S16LSB" },
+	{ AUDIO_S16MSB, "S16MSB" }
+};
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+	"Usage: %s [-voices N] [-length bytes] [-iterations N]\n", argv0);
+	quit(1);
+}
+
+static void SDLCALL fill_nothing(void *unused, Uint8 *stream, int len)
+{
+}
+
+/* Read and write a sample as a signed value */
+static int get_sample(const Uint8 *data, int i, Uint16 format)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		return((int)data[i] - 128);
+	    case AUDIO_S8:
+		return((Sint8)data[i]);
+	    case AUDIO_S16LSB:
+		return((Sint16)((data[i*2+1] << 8) | data[i*2]));
+	    default:
+		return((Sint16)((data[i*2] << 8) | data[i*2+1]));
+	}
+}
+
+static void put_sample(Uint8 *data, int i, int sample, Uint16 format)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		/* SDL_MixAudio() clips U8 at 0xFE */
+		if ( sample > 126 ) sample = 126;
+		if ( sample < -128 ) sample = -128;
+		data[i] = (Uint8)(sample + 128);
+		break;
+	    case AUDIO_S8:
+		if ( sample > 127 ) sample = 127;
+		if ( sample < -128 ) sample = -128;
+		data[i] = (Uint8)sample;
+		break;
+	    case AUDIO_S16LSB:
+		if ( sample > 32767 ) sample = 32767;
+		if ( sample < -32768 ) sample = -32768;
+		data[i*2] = (Uint8)sample;
+		data[i*2+1] = (Uint8)(sample >> 8);
+		break;
+	    default:
+		if ( sample > 32767 ) sample = 32767;
+		if ( sample < -32768 ) sample = -32768;
+		data[i*2] = (Uint8)(sample >> 8);
+		data[i*2+1] = (Uint8)sample;
+		break;
+	}
+}
+
+/* Add up the sources, then clip, the way SDL_MixAudioMulti() does */
+static void mix_c(Uint8 *dst, Uint8 **src, const int *volume, int count,
+					int len, Uint16 format)
+{
+	int size = (format & 0xFF) / 8;
+	int i, j, sum;
+
+	for ( i=0; i<len/size; ++i ) {
+		sum = get_sample(dst, i, format);
+		for ( j=0; j<count; ++j ) {
+			sum += (get_sample(src[j], i, format) * volume[j]) /
+			       SDL_MIX_MAXVOLUME;
+		}
+		put_sample(dst, i, sum, format);
+	}
+}
+
+static void randomize(Uint8 *data, int len, int quiet)
+{
+	int i;
+
+	for ( i=0; i<len; ++i ) {
+		if ( quiet ) {
+			/* Near silence in every format, so it doesn't clip */
+			data[i] = (Uint8)(rand() % 16 + 120);
+		} else {
+			data[i] = (Uint8)rand();
+		}
+	}
+}
+
+static int check_format(Uint16 format, Uint8 **src, int *volume)
+{
+	Uint8 *dst, *expect;
+	int i, len, failed = 0;
+
+	dst = (Uint8 *)malloc(length);
+	expect = (Uint8 *)malloc(length);
+
+	/* Single sources, at every volume and odd lengths */
+	for ( i=1; i<=SDL_MIX_MAXVOLUME; ++i ) {
+		len = length - (i % 17) * ((format & 0xFF) / 8);
+		randomize(src[0], len, 0);
+		randomize(dst, len, 0);
+		memcpy(expect, dst, len);
+		mix_c(expect, src, &i, 1, len, format);
+		SDL_MixAudio(dst, src[0], len, i);
+		if ( memcmp(dst, expect, len) != 0 ) {
+			printf("FAIL: SDL_MixAudio() at volume %d\n", i);
+			++failed;
+		}
+		randomize(dst, len, 0);
+		memcpy(expect, dst, len);
+		mix_c(expect, src, &i, 1, len, format);
+		SDL_MixAudioMulti(dst, (const Uint8 **)src, &i, 1, len);
+		if ( memcmp(dst, expect, len) != 0 ) {
+			printf("FAIL: SDL_MixAudioMulti() at volume %d\n", i);
+			++failed;
+		}
+	}
+
+	/* All the voices at once, loud and quiet */
+	for ( i=0; i<2; ++i ) {
+		int j;
+
+		for ( j=0; j<voices; ++j ) {
+			randomize(src[j], length, i);
+			volume[j] = rand() % (SDL_MIX_MAXVOLUME+1);
+		}
+		randomize(dst, length, i);
+		memcpy(expect, dst, length);
+		mix_c(expect, src, volume, voices, length, format);
+		SDL_MixAudioMulti(dst, (const Uint8 **)src, volume,
+		                  voices, length);
+		if ( memcmp(dst, expect, length) != 0 ) {
+			printf("FAIL: SDL_MixAudioMulti() with %d voices\n",
+			       voices);
+			++failed;
+		}
+	}
+	free(dst);
+	free(expect);
+	return(failed);
+}
+
+static void time_format(Uint16 format, Uint8 **src, int *volume)
+{
+	Uint8 *dst;
+	Uint32 then, c_ms, single_ms, multi_ms;
+	int i, j;
+
+	dst = (Uint8 *)malloc(length);
+	memset(dst, (format == AUDIO_U8) ? 0x80 : 0, length);
+
+	then = SDL_GetTicks();
+	for ( i=0; i<iterations/10; ++i ) {
+		mix_c(dst, src, volume, voices, length, format);
+	}
+	c_ms = (SDL_GetTicks() - then) * 10;
+
+	then = SDL_GetTicks();
+	for ( i=0; i<iterations; ++i ) {
+		for ( j=0; j<voices; ++j ) {
+			SDL_MixAudio(dst, src[j], length, volume[j]);
+		}
+	}
+	single_ms = SDL_GetTicks() - then;
+
+	then = SDL_GetTicks();
+	for ( i=0; i<iterations; ++i ) {
+		SDL_MixAudioMulti(dst, (const Uint8 **)src, volume,
+		                  voices, length);
+	}
+	multi_ms = SDL_GetTicks() - then;
+
+	printf("  C loop %d ms, SDL_MixAudio() %d ms, "
+	       "SDL_MixAudioMulti() %d ms\n", c_ms, single_ms, multi_ms);
+	free(dst);
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_AudioSpec spec;
+	Uint8 **src;
+	int *volume;
+	int i, f, failed = 0;
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-voices") == 0 && argv[i+1] ) {
+			voices = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-length") == 0 && argv[i+1] ) {
+			length = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-iterations") == 0 && argv[i+1] ) {
+			iterations = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( voices < 1 || length < 64 || iterations < 10 ) {
+		usage(argv[0]);
+	}
+	length &= ~1;
+
+	putenv("SDL_AUDIODRIVER=dummy");
+	if ( SDL_Init(SDL_INIT_AUDIO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	src = (Uint8 **)malloc(voices * sizeof(*src));
+	volume = (int *)malloc(voices * sizeof(*volume));
+	for ( i=0; i<voices; ++i ) {
+		src[i] = (Uint8 *)malloc(length);
+	}
+
+	printf("Mixing %d voices of %d bytes, %d times\n",
+	       voices, length, iterations);
+	for ( f=0; f<SDL_arraysize(formats); ++f ) {
+		/* SDL_MixAudio() mixes in the format of the open device */
+		memset(&spec, 0, sizeof(spec));
+		spec.freq = 44100;
+		spec.format = formats[f].format;
+		spec.channels = 2;
+		spec.samples = 1024;
+		spec.callback = fill_nothing;
+		if ( SDL_OpenAudio(&spec, NULL) < 0 ) {
+			fprintf(stderr, "Couldn't open audio: %s\n",
+			        SDL_GetError());
+			quit(2);
+		}
+		printf("%s:\n", formats[f].name);
+		srand(1);
+		failed += check_format(formats[f].format, src, volume);
+		time_format(formats[f].format, src, volume);
+		SDL_CloseAudio();
+	}
+
+	for ( i=0; i<voices; ++i ) {
+		free(src[i]);
+	}
+	free(src);
+	free(volume);
+	SDL_Quit();
+
+	if ( failed ) {
+		printf("FAIL: %d checks failed\n", failed);
+		return(3);
+	}
+	printf("All checks passed\n");
+	return(0);
+}
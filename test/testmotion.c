@@ -0,0 +1,179 @@
+
+/* Flood the X11 driver with mouse motion through the XTEST extension,
+   followed by a key press, and check that the key press makes it through
+   the event queue when SDL_VIDEO_X11_MOTION_COMPRESS is set.  With
+   -nocompress the queue fills up and the key press is expected to be lost.
+
+   Run it on a display with XTEST, like Xvfb:
+	Xvfb :99 & DISPLAY=:99 ./testmotion
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_syswm.h"
+
+#if defined(SDL_VIDEO_DRIVER_X11)
+#include <X11/keysym.h>
+
+static int (*pXSync)(Display *, Bool);
+static Window (*pXDefaultRootWindow)(Display *);
+static Bool (*pXTranslateCoordinates)(Display *, Window, Window, int, int,
+                                      int *, int *, Window *);
+static KeyCode (*pXKeysymToKeycode)(Display *, KeySym);
+static int (*pXTestFakeMotionEvent)(Display *, int, int, int, unsigned long);
+static int (*pXTestFakeKeyEvent)(Display *, unsigned int, Bool, unsigned long);
+
+static int load_functions(void)
+{
+	void *x11, *xtst;
+
+	x11 = SDL_LoadObject("libX11.so.6");
+	xtst = SDL_LoadObject("libXtst.so.6");
+	if ( x11 == NULL || xtst == NULL ) {
+		return(-1);
+	}
+	pXSync = SDL_LoadFunction(x11, "XSync");
+	pXDefaultRootWindow = SDL_LoadFunction(x11, "XDefaultRootWindow");
+	pXTranslateCoordinates = SDL_LoadFunction(x11, "XTranslateCoordinates");
+	pXKeysymToKeycode = SDL_LoadFunction(x11, "XKeysymToKeycode");
+	pXTestFakeMotionEvent = SDL_LoadFunction(xtst, "XTestFakeMotionEvent");
+	pXTestFakeKeyEvent = SDL_LoadFunction(xtst, "XTestFakeKeyEvent");
+	if ( !pXSync || !pXDefaultRootWindow || !pXTranslateCoordinates ||
+	     !pXKeysymToKeycode ||
+	     !pXTestFakeMotionEvent || !pXTestFakeKeyEvent ) {
+		return(-1);
+	}
+	return(0);
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Surface *screen;
+	SDL_SysWMinfo info;
+	SDL_Event event;
+	Display *display;
+	Window child;
+	KeyCode key;
+	Uint32 coalesced, dropped;
+	Uint32 now_coalesced, now_dropped;
+	int motions = 1000;
+	int i, x, y, rootx, rooty;
+	int moved, pressed, mousex, mousey;
+	char driver[32];
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-motions") == 0 && argv[i+1] ) {
+			motions = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-nocompress") == 0 ) {
+			putenv("SDL_VIDEO_X11_MOTION_COMPRESS=0");
+		} else {
+			fprintf(stderr,
+			"Usage: %s [-motions N] [-nocompress]\n", argv[0]);
+			return(1);
+		}
+	}
+	if ( motions < 1 ) {
+		motions = 1;
+	}
+	if ( getenv("SDL_VIDEO_X11_MOTION_COMPRESS") == NULL ) {
+		putenv("SDL_VIDEO_X11_MOTION_COMPRESS=1");
+	}
+
+	if ( SDL_Init(SDL_INIT_VIDEO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	if ( !SDL_VideoDriverName(driver, sizeof(driver)) ||
+	     strcmp(driver, "x11") != 0 ) {
+		printf("Not running on X11, skipped\n");
+		SDL_Quit();
+		return(0);
+	}
+	if ( load_functions() < 0 ) {
+		printf("Couldn't load the XTEST functions, skipped\n");
+		SDL_Quit();
+		return(0);
+	}
+	screen = SDL_SetVideoMode(320, 240, 0, SDL_SWSURFACE);
+	if ( screen == NULL ) {
+		fprintf(stderr, "Couldn't set video mode: %s\n",SDL_GetError());
+		SDL_Quit();
+		return(2);
+	}
+	SDL_VERSION(&info.version);
+	if ( SDL_GetWMInfo(&info) <= 0 ) {
+		fprintf(stderr, "Couldn't get window info: %s\n",SDL_GetError());
+		SDL_Quit();
+		return(2);
+	}
+	display = info.info.x11.display;
+
+	/* Let the window come up, and forget the events so far */
+	for ( i=0; i<10; ++i ) {
+		SDL_Delay(50);
+		SDL_PumpEvents();
+		while ( SDL_PollEvent(&event) )
+			;
+	}
+	SDL_GetEventStats(&coalesced, &dropped);
+
+	/* Move the mouse around the window, then press a key */
+	info.info.x11.lock_func();
+	pXTranslateCoordinates(display, info.info.x11.window,
+	                       pXDefaultRootWindow(display), 0, 0,
+	                       &rootx, &rooty, &child);
+	for ( i=0; i<motions; ++i ) {
+		x = 10 + i % 300;
+		y = 10 + (i / 300) % 220;
+		pXTestFakeMotionEvent(display, -1, rootx+x, rooty+y, 0);
+	}
+	key = pXKeysymToKeycode(display, XK_a);
+	pXTestFakeKeyEvent(display, key, True, 0);
+	pXTestFakeKeyEvent(display, key, False, 0);
+	pXSync(display, False);
+	info.info.x11.unlock_func();
+
+	/* Everything is queued in Xlib now, a single pump handles it */
+	SDL_PumpEvents();
+	moved = pressed = 0;
+	while ( SDL_PollEvent(&event) ) {
+		if ( event.type == SDL_MOUSEMOTION ) {
+			++moved;
+		} else if ( event.type == SDL_KEYDOWN &&
+		            event.key.keysym.sym == SDLK_a ) {
+			++pressed;
+		}
+	}
+	SDL_GetMouseState(&mousex, &mousey);
+	SDL_GetEventStats(&now_coalesced, &now_dropped);
+
+	printf("%d motions sent, %d motion events, %d coalesced, %d dropped\n",
+	       motions, moved, (int)(now_coalesced - coalesced),
+	       (int)(now_dropped - dropped));
+	printf("Mouse at %d,%d, expected %d,%d\n", mousex, mousey, x, y);
+	SDL_Quit();
+
+	if ( !pressed ) {
+		printf("FAIL: the key press was lost\n");
+		return(3);
+	}
+	if ( mousex != x || mousey != y ) {
+		printf("FAIL: the mouse is in the wrong place\n");
+		return(3);
+	}
+	printf("PASS\n");
+	return(0);
+}
+
+#else
+
+int main(int argc, char *argv[])
+{
+	printf("No X11 support on this system, skipped\n");
+	return(0);
+}
+
+#endif /* SDL_VIDEO_DRIVER_X11 */
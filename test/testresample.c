@@ -0,0 +1,290 @@
+/* Compare the band-limited resampler used by SDL_BuildAudioCVT() with
+   the nearest sample rate conversion SDL used to have, for speed and
+   for quality: the signal to noise ratio of a converted tone, how much
+   of a tone above the new Nyquist frequency leaks through as aliasing,
+   and whether converting a buffer at a time gives the same result as
+   converting everything at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#define PI	3.14159265358979323846
+
+static int seconds = 10;
+static int channels = 2;
+static int chunk = 4096;
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+	"Usage: %s [-seconds N] [-channels N] [-chunk frames]\n", argv0);
+	quit(1);
+}
+
+/* A tone at 'freq' Hz, the same in every channel */
+static Sint16 *make_tone(int rate, int frames, double freq, double amp)
+{
+	Sint16 *data;
+	int i, c;
+
+	data = (Sint16 *)malloc(frames*channels*sizeof(Sint16));
+	if ( data == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+	for ( i=0; i<frames; ++i ) {
+		Sint16 v = (Sint16)(amp * sin(2.0*PI*freq*i / rate));
+		for ( c=0; c<channels; ++c ) {
+			data[i*channels+c] = v;
+		}
+	}
+	return(data);
+}
+
+/* What SDL_RateSLOW did: pick the nearest earlier input frame */
+static int nearest_convert(const Sint16 *src, int frames, Sint16 *dst,
+					int src_rate, int dst_rate)
+{
+	double ipos, incr = (double)src_rate / dst_rate;
+	int out, c;
+
+	out = (int)((double)frames * dst_rate / src_rate);
+	for ( ipos=0.0, c=0; c<out*channels; c+=channels, ipos+=incr ) {
+		SDL_memcpy(dst + c, src + (int)ipos*channels,
+		           channels*sizeof(Sint16));
+	}
+	return(out);
+}
+
+/* Run the SDL conversion over the input, 'chunk' frames at a time */
+static int sdl_convert(SDL_AudioCVT *cvt, const Sint16 *src, int frames,
+					Sint16 *dst, int chunk_frames)
+{
+	int frame_size = channels*sizeof(Sint16);
+	int i, n, out = 0;
+
+	for ( i=0; i<frames; i+=n ) {
+		n = frames - i;
+		if ( n > chunk_frames ) {
+			n = chunk_frames;
+		}
+		cvt->len = n*frame_size;
+		SDL_memcpy(cvt->buf, src + i*channels, cvt->len);
+		if ( SDL_ConvertAudio(cvt) < 0 ) {
+			fprintf(stderr, "Conversion failed: %s\n",
+			        SDL_GetError());
+			quit(3);
+		}
+		SDL_memcpy(dst + out*channels, cvt->buf, cvt->len_cvt);
+		out += cvt->len_cvt / frame_size;
+	}
+
+	/* And the last frames, which were waiting for look ahead */
+	cvt->len = chunk_frames*frame_size;
+	do {
+		if ( SDL_FlushAudioCVT(cvt) < 0 ) {
+			fprintf(stderr, "Conversion failed: %s\n",
+			        SDL_GetError());
+			quit(3);
+		}
+		SDL_memcpy(dst + out*channels, cvt->buf, cvt->len_cvt);
+		out += cvt->len_cvt / frame_size;
+	} while ( cvt->len_cvt > 0 );
+	return(out);
+}
+
+static void build_cvt(SDL_AudioCVT *cvt, int src_rate, int dst_rate)
+{
+	if ( SDL_BuildAudioCVT(cvt, AUDIO_S16SYS, channels, src_rate,
+	                            AUDIO_S16SYS, channels, dst_rate) < 0 ) {
+		fprintf(stderr, "Couldn't build the conversion: %s\n",
+		        SDL_GetError());
+		quit(3);
+	}
+	cvt->buf = (Uint8 *)malloc(chunk*channels*sizeof(Sint16)*cvt->len_mult);
+	if ( cvt->buf == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+}
+
+/* Signal to noise of the output against the ideal tone, in dB.
+   The start is skipped, where the filter history was silence.
+ */
+static double tone_snr(const Sint16 *data, int frames, int rate,
+					double freq, double amp)
+{
+	double signal = 0.0, noise = 0.0, ideal, diff;
+	int i;
+
+	for ( i=rate/100; i<frames; ++i ) {
+		ideal = amp * sin(2.0*PI*freq*i / rate);
+		diff = data[i*channels] - ideal;
+		signal += ideal * ideal;
+		noise += diff * diff;
+	}
+	if ( noise == 0.0 ) {
+		return(999.0);
+	}
+	return(10.0 * log10(signal / noise));
+}
+
+/* Level of whatever is left in the output, relative to 'amp', in dB */
+static double tone_level(const Sint16 *data, int frames, int rate, double amp)
+{
+	double power = 0.0;
+	int i;
+
+	for ( i=rate/100; i<frames; ++i ) {
+		power += (double)data[i*channels] * data[i*channels];
+	}
+	power /= (frames - rate/100);
+	if ( power == 0.0 ) {
+		return(-999.0);
+	}
+	return(10.0 * log10(power / (amp*amp/2.0)));
+}
+
+static void test_rates(int src_rate, int dst_rate)
+{
+	SDL_AudioCVT cvt;
+	Sint16 *src, *dst;
+	int frames, out, nearest, whole, n, i;
+	Uint32 then, slow_ms, fast_ms;
+	double amp = 16000.0, freq;
+
+	build_cvt(&cvt, src_rate, dst_rate);
+	frames = src_rate * seconds;
+	out = (int)((double)frames * dst_rate / src_rate) + chunk*4;
+	dst = (Sint16 *)malloc(out*channels*sizeof(Sint16));
+	if ( dst == NULL ) {
+		fprintf(stderr, "Out of memory\n");
+		quit(2);
+	}
+	printf("%5d -> %5d Hz:\n", src_rate, dst_rate);
+
+	/* Throughput, and quality of a 1 kHz tone */
+	freq = 1000.0;
+	src = make_tone(src_rate, frames, freq, amp);
+	then = SDL_GetTicks();
+	nearest = nearest_convert(src, frames, dst, src_rate, dst_rate);
+	slow_ms = SDL_GetTicks() - then;
+	printf("  nearest:    %7.1f Msamples/s, %5.1f dB SNR\n",
+	       (double)nearest*channels / ((slow_ms ? slow_ms : 1) * 1000.0),
+	       tone_snr(dst, nearest, dst_rate, freq, amp));
+	then = SDL_GetTicks();
+	out = sdl_convert(&cvt, src, frames, dst, chunk);
+	fast_ms = SDL_GetTicks() - then;
+	printf("  resampler:  %7.1f Msamples/s, %5.1f dB SNR\n",
+	       (double)out*channels / ((fast_ms ? fast_ms : 1) * 1000.0),
+	       tone_snr(dst, out, dst_rate, freq, amp));
+	free(src);
+
+	/* A tone above the output Nyquist frequency should disappear */
+	if ( dst_rate < src_rate ) {
+		freq = dst_rate/2 + (src_rate - dst_rate)/4;
+		frames = src_rate;
+		src = make_tone(src_rate, frames, freq, amp);
+		nearest = nearest_convert(src, frames, dst, src_rate, dst_rate);
+		printf("  %5.0f Hz tone aliased: nearest %6.1f dB,",
+		       freq, tone_level(dst, nearest, dst_rate, amp));
+		free(cvt.buf);
+		build_cvt(&cvt, src_rate, dst_rate);
+		out = sdl_convert(&cvt, src, frames, dst, chunk);
+		printf(" resampler %6.1f dB\n",
+		       tone_level(dst, out, dst_rate, amp));
+		free(src);
+	}
+
+	/* Odd sized buffers should make the same samples as one big one */
+	freq = 440.0;
+	frames = src_rate;
+	src = make_tone(src_rate, frames, freq, amp);
+	free(cvt.buf);
+	chunk = frames;
+	build_cvt(&cvt, src_rate, dst_rate);
+	whole = sdl_convert(&cvt, src, frames, dst, frames);
+	n = (int)((double)frames * dst_rate / src_rate + 0.5);
+	if ( whole < n-1 || whole > n+1 ) {
+		printf("  FAIL: %d frames made %d frames, not %d\n",
+		       frames, whole, n);
+	}
+	{
+		SDL_AudioCVT pieces;
+		Sint16 *again;
+		int saved = chunk;
+
+		chunk = 333;
+		build_cvt(&pieces, src_rate, dst_rate);
+		again = (Sint16 *)malloc((whole+chunk*4)*channels*sizeof(Sint16));
+		n = sdl_convert(&pieces, src, frames, again, chunk);
+		for ( i=0; i<whole*channels && i<n*channels; ++i ) {
+			if ( again[i] != dst[i] ) {
+				break;
+			}
+		}
+		if ( i == whole*channels && n == whole ) {
+			printf("  %d frame buffers match one %d frame buffer\n",
+			       chunk, frames);
+		} else {
+			printf("  FAIL: %d frame buffers differ at sample %d "
+			       "(%d/%d frames)\n", chunk, i, n, whole);
+		}
+		free(again);
+		free(pieces.buf);
+		chunk = saved;
+	}
+	free(src);
+	free(cvt.buf);
+	free(dst);
+}
+
+int main(int argc, char *argv[])
+{
+	static const int rates[][2] = {
+		{ 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 },
+		{ 48000, 32000 }, { 8000, 44100 }
+	};
+	int i, saved_chunk;
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-seconds") == 0 && argv[i+1] ) {
+			seconds = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-channels") == 0 && argv[i+1] ) {
+			channels = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-chunk") == 0 && argv[i+1] ) {
+			chunk = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( seconds < 1 || channels < 1 || channels > 8 || chunk < 1 ) {
+		usage(argv[0]);
+	}
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	printf("%d seconds of %d channel audio in %d frame buffers\n",
+	       seconds, channels, chunk);
+	saved_chunk = chunk;
+	for ( i=0; i<SDL_arraysize(rates); ++i ) {
+		chunk = saved_chunk;
+		test_rates(rates[i][0], rates[i][1]);
+	}
+	SDL_Quit();
+	return(0);
+}
@@ -0,0 +1,210 @@
+
+/* Measure how fast surfaces are RLE encoded for SDL_RLEACCEL blits,
+   for colorkeyed surfaces of each depth and for per-pixel alpha surfaces
+   going to 16 and 32 bit destinations.
+
+   Set SDL_BLIT_THREADS to encode large surfaces in parallel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int width = 1024;
+static int height = 1024;
+static int iterations = 50;
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+	"Usage: %s [-width N] [-height N] [-iterations N]\n", argv0);
+	quit(1);
+}
+
+/* Scatter sprite-like blobs over a transparent background, with soft
+   edges when the surface has an alpha channel.
+ */
+static void draw_sprites(SDL_Surface *surface, Uint32 background)
+{
+	SDL_Rect r;
+	int i, j;
+
+	SDL_FillRect(surface, NULL, background);
+	srand(1);
+	for ( i=0; i<width*height/2048; ++i ) {
+		Uint8 red = rand()%256, green = rand()%256, blue = rand()%256;
+		int size = 8 + rand()%40;
+		int x = rand()%width - size/2;
+		int y = rand()%height - size/2;
+
+		for ( j=0; j<4; ++j ) {
+			r.x = x + j*size/8;
+			r.y = y + j*size/8;
+			r.w = size - j*size/4;
+			r.h = size - j*size/4;
+			SDL_FillRect(surface, &r, SDL_MapRGBA(surface->format,
+			             red, green, blue, 64 + j*64 - (j == 3)));
+		}
+	}
+}
+
+/* Encode the surface a number of times, returning the total milliseconds */
+static Uint32 time_encoding(SDL_Surface *sprite, SDL_Surface *target)
+{
+	Uint32 then, ticks = 0;
+	int i;
+
+	/* The first blit encodes the surface */
+	if ( SDL_BlitSurface(sprite, NULL, target, NULL) < 0 ) {
+		fprintf(stderr, "Blit failed: %s\n", SDL_GetError());
+		quit(3);
+	}
+	if ( !(sprite->flags & SDL_RLEACCEL) ) {
+		return(0);
+	}
+
+	/* Locking decodes it again, and unlocking encodes it */
+	for ( i=0; i<iterations; ++i ) {
+		SDL_LockSurface(sprite);
+		then = SDL_GetTicks();
+		SDL_UnlockSurface(sprite);
+		ticks += SDL_GetTicks() - then;
+	}
+	return(ticks);
+}
+
+static void report(const char *name, SDL_Surface *sprite, Uint32 ticks)
+{
+	double pixels = (double)sprite->w*sprite->h*iterations;
+	double bytes = pixels*sprite->format->BytesPerPixel;
+
+	if ( !(sprite->flags & SDL_RLEACCEL) ) {
+		printf("%-28s not RLE accelerated\n", name);
+	} else if ( ticks == 0 ) {
+		printf("%-28s too fast to measure\n", name);
+	} else {
+		printf("%-28s %8.2f ms %9.1f Mpixels/s %9.1f MB/s\n", name,
+		       (double)ticks/iterations, pixels/(ticks*1000.0),
+		       bytes/(ticks*1000.0));
+	}
+}
+
+static void test_colorkey(int bpp)
+{
+	SDL_Surface *sprite, *target;
+	Uint32 key;
+	Uint32 ticks;
+	char name[64];
+
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, bpp,
+	                              0, 0, 0, 0);
+	if ( sprite == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(2);
+	}
+	if ( bpp == 8 ) {
+		SDL_Color colors[256];
+		int i;
+
+		/* A 3-3-2 palette, new 8-bit surfaces are all black */
+		for ( i=0; i<256; ++i ) {
+			colors[i].r = (i >> 5) * 255 / 7;
+			colors[i].g = ((i >> 2) & 7) * 255 / 7;
+			colors[i].b = (i & 3) * 255 / 3;
+		}
+		SDL_SetColors(sprite, colors, 0, 256);
+	}
+	key = SDL_MapRGB(sprite->format, 255, 0, 255);
+	draw_sprites(sprite, key);
+
+	/* Colorkey RLE only works for blits to the same pixel format */
+	target = SDL_ConvertSurface(sprite, sprite->format, SDL_SWSURFACE);
+	if ( target == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(2);
+	}
+	SDL_SetColorKey(sprite, SDL_SRCCOLORKEY|SDL_RLEACCEL, key);
+	ticks = time_encoding(sprite, target);
+
+	sprintf(name, "colorkey %d bpp", bpp);
+	report(name, sprite, ticks);
+
+	SDL_FreeSurface(target);
+	SDL_FreeSurface(sprite);
+}
+
+static void test_alpha(int bpp, Uint32 Rmask, Uint32 Gmask, Uint32 Bmask)
+{
+	SDL_Surface *sprite, *target;
+	Uint32 ticks;
+	char name[64];
+
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+	               0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+	target = SDL_CreateRGBSurface(SDL_SWSURFACE, 64, 64, bpp,
+	                              Rmask, Gmask, Bmask, 0);
+	if ( sprite == NULL || target == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(2);
+	}
+	draw_sprites(sprite, 0);
+	SDL_SetAlpha(sprite, SDL_SRCALPHA|SDL_RLEACCEL, SDL_ALPHA_OPAQUE);
+	ticks = time_encoding(sprite, target);
+
+	sprintf(name, "alpha ARGB8888 to %d bpp", target->format->BitsPerPixel);
+	report(name, sprite, ticks);
+
+	SDL_FreeSurface(target);
+	SDL_FreeSurface(sprite);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *threads;
+	int i;
+
+	for ( i=1; i<argc; ++i ) {
+		if ( strcmp(argv[i], "-width") == 0 && argv[i+1] ) {
+			width = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-height") == 0 && argv[i+1] ) {
+			height = atoi(argv[++i]);
+		} else if ( strcmp(argv[i], "-iterations") == 0 && argv[i+1] ) {
+			iterations = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( width < 1 || height < 1 || iterations < 1 ) {
+		usage(argv[0]);
+	}
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+
+	threads = getenv("SDL_BLIT_THREADS");
+	printf("Encoding %dx%d surfaces %d times, %s threads\n",
+	       width, height, iterations, threads ? threads : "1");
+
+	test_colorkey(8);
+	test_colorkey(15);
+	test_colorkey(16);
+	test_colorkey(24);
+	test_colorkey(32);
+	test_alpha(16, 0xF800, 0x07E0, 0x001F);
+	test_alpha(15, 0x7C00, 0x03E0, 0x001F);
+	test_alpha(32, 0x00FF0000, 0x0000FF00, 0x000000FF);
+
+	SDL_Quit();
+	return(0);
+}
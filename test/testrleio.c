@@ -0,0 +1,304 @@
+/* Check that RLE encoded surfaces saved with SDL_SaveRLE_RW() blit the
+   same after being loaded with SDL_LoadRLE_RW() and
+   SDL_CreateRLESurfaceFrom(), and that broken files are turned down.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define SPRITE_W	67
+#define SPRITE_H	41
+
+/* Big enough for any of the sprites, 4-byte aligned for mapping */
+static Uint32 file[SPRITE_W*SPRITE_H*2 + 1024];
+static Uint32 copy[SPRITE_W*SPRITE_H*2 + 1024];
+
+/* Call this instead of exit(), so we can clean up SDL: atexit() is evil. */
+static void quit(int rc)
+{
+	SDL_Quit();
+	exit(rc);
+}
+
+/* Scatter rectangles of various alpha over a transparent background */
+static void draw_sprite(SDL_Surface *surface, Uint32 background)
+{
+	SDL_Rect r;
+	int i;
+
+	SDL_FillRect(surface, NULL, background);
+	for ( i=0; i<40; ++i ) {
+		r.w = 1 + rand() % 20;
+		r.h = 1 + rand() % 20;
+		r.x = rand() % (surface->w - r.w + 1);
+		r.y = rand() % (surface->h - r.h + 1);
+		SDL_FillRect(surface, &r, SDL_MapRGBA(surface->format,
+		             rand()%256, rand()%256, rand()%256,
+		             i % 3 ? rand()%256 : SDL_ALPHA_OPAQUE));
+	}
+}
+
+/* Fill the destination with the same thing every time */
+static void draw_background(SDL_Surface *surface)
+{
+	Uint8 *row;
+	int x, y;
+
+	for ( y=0; y<surface->h; ++y ) {
+		row = (Uint8 *)surface->pixels + y*surface->pitch;
+		for ( x=0; x<surface->pitch; ++x ) {
+			row[x] = (Uint8)(x*7 + y*13);
+		}
+	}
+}
+
+/* Blit the sprite to a fresh background at a few places */
+static int draw(SDL_Surface *sprite, SDL_Surface *screen)
+{
+	SDL_Rect r;
+	int i;
+
+	draw_background(screen);
+	for ( i=0; i<4; ++i ) {
+		r.x = i*23 - 11;
+		r.y = i*17 - 9;
+		if ( SDL_BlitSurface(sprite, NULL, screen, &r) < 0 ) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+static int same(SDL_Surface *a, SDL_Surface *b)
+{
+	int y;
+
+	for ( y=0; y<a->h; ++y ) {
+		if ( memcmp((Uint8 *)a->pixels + y*a->pitch,
+		            (Uint8 *)b->pixels + y*b->pitch,
+		            a->w * a->format->BytesPerPixel) != 0 ) {
+			return(0);
+		}
+	}
+	return(1);
+}
+
+/* Save the sprite into 'file', returning the size */
+static int save(SDL_Surface *sprite)
+{
+	SDL_RWops *dst;
+	int size;
+
+	dst = SDL_RWFromMem(file, sizeof(file));
+	if ( SDL_SaveRLE_RW(sprite, dst, 0) < 0 ) {
+		fprintf(stderr, "Couldn't save: %s\n", SDL_GetError());
+		quit(1);
+	}
+	size = SDL_RWtell(dst);
+	SDL_RWclose(dst);
+	return(size);
+}
+
+/* Load 'size' bytes of 'data' both ways, they should fail together */
+static SDL_Surface *load(const Uint32 *data, int size, SDL_Surface **mapped)
+{
+	SDL_Surface *surface;
+
+	memcpy(copy, data, size);
+	surface = SDL_LoadRLE_RW(SDL_RWFromConstMem(copy, size), 1);
+	*mapped = SDL_CreateRLESurfaceFrom(copy, size);
+	return(surface);
+}
+
+/* Load the file back with a header field changed */
+static int rejects_field(int size, int offset, Uint32 value)
+{
+	SDL_Surface *surface, *mapped;
+	Uint8 *header = (Uint8 *)file;
+	Uint8 saved[4];
+	int rejected;
+
+	memcpy(saved, header + offset, 4);
+	header[offset] = (Uint8)value;
+	header[offset + 1] = (Uint8)(value >> 8);
+	header[offset + 2] = (Uint8)(value >> 16);
+	header[offset + 3] = (Uint8)(value >> 24);
+	surface = load(file, size, &mapped);
+	rejected = (surface == NULL && mapped == NULL);
+	SDL_FreeSurface(surface);
+	SDL_FreeSurface(mapped);
+	memcpy(header + offset, saved, 4);
+	return(rejected);
+}
+
+static int test(const char *name, SDL_Surface *sprite, SDL_Surface *screen)
+{
+	SDL_Surface *want, *loaded, *mapped;
+	int size, i, failed;
+
+	want = SDL_CreateRGBSurface(SDL_SWSURFACE, screen->w, screen->h,
+		screen->format->BitsPerPixel, screen->format->Rmask,
+		screen->format->Gmask, screen->format->Bmask,
+		screen->format->Amask);
+	if ( want == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(1);
+	}
+
+	/* The first blit encodes the sprite */
+	if ( draw(sprite, want) < 0 || !(sprite->flags & SDL_RLEACCEL) ) {
+		printf("%s: not RLE encoded: FAILED\n", name);
+		SDL_FreeSurface(want);
+		return(1);
+	}
+	size = save(sprite);
+
+	failed = 0;
+	loaded = load(file, size, &mapped);
+	if ( loaded == NULL || mapped == NULL ) {
+		printf("%s: couldn't load %d bytes: %s: FAILED\n",
+			name, size, SDL_GetError());
+		failed = 1;
+	} else if ( draw(loaded, screen) < 0 || !same(screen, want) ) {
+		printf("%s: loaded surface blits differently: FAILED\n", name);
+		failed = 1;
+	} else if ( draw(mapped, screen) < 0 || !same(screen, want) ) {
+		printf("%s: mapped surface blits differently: FAILED\n", name);
+		failed = 1;
+	}
+	SDL_FreeSurface(loaded);
+	SDL_FreeSurface(mapped);
+
+	/* Cut short anywhere, in the header or in the encoding */
+	for ( i=0; i<size && !failed; ++i ) {
+		loaded = load(file, i, &mapped);
+		if ( loaded || mapped ) {
+			printf("%s: loaded %d of %d bytes: FAILED\n",
+				name, i, size);
+			failed = 1;
+		}
+		SDL_FreeSurface(loaded);
+		SDL_FreeSurface(mapped);
+	}
+
+	/* Header fields: magic, width and height */
+	if ( !failed && !rejects_field(size, 0, 0x454c5254) ) {
+		printf("%s: loaded with a bad magic: FAILED\n", name);
+		failed = 1;
+	}
+	if ( !failed && (!rejects_field(size, 12, 16384) ||
+	                 !rejects_field(size, 12, 0x7fffffff) ||
+	                 !rejects_field(size, 12, 0x80000000) ||
+	                 !rejects_field(size, 16, 65536) ||
+	                 !rejects_field(size, 16, 0xffffffff)) ) {
+		printf("%s: loaded with oversized dimensions: FAILED\n", name);
+		failed = 1;
+	}
+
+	/* Anything else may load, but must blit safely if it does */
+	for ( i=0; i<2000 && !failed; ++i ) {
+		Uint8 *bytes = (Uint8 *)file;
+		int at = rand() % size;
+		Uint8 was = bytes[at];
+
+		bytes[at] ^= 1 << (rand() % 8);
+		loaded = load(file, size, &mapped);
+		if ( loaded ) {
+			draw(loaded, screen);
+		}
+		if ( mapped ) {
+			draw(mapped, screen);
+		}
+		SDL_FreeSurface(loaded);
+		SDL_FreeSurface(mapped);
+		bytes[at] = was;
+	}
+
+	if ( !failed ) {
+		printf("%s: %d bytes ok\n", name, size);
+	}
+	SDL_FreeSurface(want);
+	return(failed);
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Surface *sprite, *screen;
+	int failed;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n",SDL_GetError());
+		return(1);
+	}
+	srand(1);
+	failed = 0;
+
+	/* Colorkeyed 16 bit sprite */
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_W, SPRITE_H,
+	                              16, 0xf800, 0x7e0, 0x1f, 0);
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 96, 72,
+	                              16, 0xf800, 0x7e0, 0x1f, 0);
+	if ( sprite == NULL || screen == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(1);
+	}
+	draw_sprite(sprite, 0x1234);
+	SDL_SetColorKey(sprite, SDL_SRCCOLORKEY|SDL_RLEACCEL, 0x1234);
+	failed += test("colorkey 16 bpp", sprite, screen);
+	SDL_FreeSurface(sprite);
+	SDL_FreeSurface(screen);
+
+	/* Colorkeyed 32 bit sprite with surface alpha */
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_W, SPRITE_H,
+	                              32, 0xff0000, 0xff00, 0xff, 0);
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 96, 72,
+	                              32, 0xff0000, 0xff00, 0xff, 0);
+	if ( sprite == NULL || screen == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(1);
+	}
+	draw_sprite(sprite, 0x00ff00ff);
+	SDL_SetColorKey(sprite, SDL_SRCCOLORKEY|SDL_RLEACCEL, 0x00ff00ff);
+	SDL_SetAlpha(sprite, SDL_SRCALPHA|SDL_RLEACCEL, 100);
+	failed += test("colorkey 32 bpp", sprite, screen);
+	SDL_FreeSurface(sprite);
+	SDL_FreeSurface(screen);
+
+	/* Per-pixel alpha sprite, to 16 and 32 bit destinations */
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_W, SPRITE_H,
+	                              32, 0xff0000, 0xff00, 0xff, 0xff000000);
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 96, 72,
+	                              16, 0xf800, 0x7e0, 0x1f, 0);
+	if ( sprite == NULL || screen == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(1);
+	}
+	draw_sprite(sprite, 0);
+	SDL_SetAlpha(sprite, SDL_SRCALPHA|SDL_RLEACCEL, SDL_ALPHA_OPAQUE);
+	failed += test("pixel alpha to 16 bpp", sprite, screen);
+	SDL_FreeSurface(sprite);
+	SDL_FreeSurface(screen);
+
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_W, SPRITE_H,
+	                              32, 0xff0000, 0xff00, 0xff, 0xff000000);
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, 96, 72,
+	                              32, 0xff0000, 0xff00, 0xff, 0);
+	if ( sprite == NULL || screen == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n",SDL_GetError());
+		quit(1);
+	}
+	draw_sprite(sprite, 0);
+	SDL_SetAlpha(sprite, SDL_SRCALPHA|SDL_RLEACCEL, SDL_ALPHA_OPAQUE);
+	failed += test("pixel alpha to 32 bpp", sprite, screen);
+	SDL_FreeSurface(sprite);
+	SDL_FreeSurface(screen);
+
+	if ( failed ) {
+		printf("%d checks FAILED\n", failed);
+	}
+	quit(failed ? 1 : 0);
+	return(0);
+}
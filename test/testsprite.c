@@ -159,6 +159,7 @@ int main(int argc, char *argv[])
 	int    i, done;
 	SDL_Event event;
 	Uint32 then, now, frames;
+	SDL_PresentStats stats;
 
 	/* Initialize SDL */
 	if ( SDL_Init(SDL_INIT_VIDEO) < 0 ) {
@@ -321,6 +322,13 @@ int main(int argc, char *argv[])
 		printf("%2.2f frames per second\n",
 					((double)frames*1000)/(now-then));
 	}
+	if ( SDL_GetPresentStats(&stats) == 0 && stats.completed ) {
+		printf("%d screen buffers, %2.2f ms average update latency, "
+		       "%d ms worst, %d waits for %d ms\n", (int)stats.buffers,
+		       (double)stats.latency_ms/stats.completed,
+		       (int)stats.max_latency_ms, (int)stats.stalls,
+		       (int)stats.stall_ms);
+	}
 	SDL_Quit();
 	return(0);
 }